@@ -226,6 +226,7 @@ endif ()
 option (URHO3D_PACKAGING "Enable resources packaging support, on Web platform default to 1, on other platforms default to 0" ${WEB})
 option (URHO3D_PROFILING "Enable profiling support" TRUE)
 option (URHO3D_LOGGING "Enable logging support" TRUE)
+option (URHO3D_HASH_DEBUG "Enable StringHash reverse lookup registry for debugging; disables compile-time hashing of string literals")
 # Emscripten thread support is yet experimental; default false
 if (NOT WEB)
     option (URHO3D_THREADING "Enable thread support, on Web platform default to 0, on other platforms default to 1" TRUE)
@@ -395,6 +396,11 @@ if (URHO3D_LOGGING)
     add_definitions (-DURHO3D_LOGGING)
 endif ()
 
+# Disable StringHash reverse lookup by default. If enabled, hashes remember the strings they were calculated from, retrievable with StringHash::Reverse().
+if (URHO3D_HASH_DEBUG)
+    add_definitions (-DURHO3D_HASH_DEBUG)
+endif ()
+
 # Enable threading by default, except for Emscripten.
 if (URHO3D_THREADING)
     add_definitions (-DURHO3D_THREADING)
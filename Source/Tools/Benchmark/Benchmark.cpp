@@ -0,0 +1,174 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Engine/Engine.h>
+#include <Urho3D/Graphics/Graphics.h>
+#include <Urho3D/IO/Log.h>
+
+#include "Benchmark.h"
+
+#include <cstdio>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <Urho3D/DebugNew.h>
+
+struct BenchmarkSuite
+{
+    /// Name used on the command line.
+    const char* name_;
+    /// Description for the usage text.
+    const char* description_;
+    /// Suite function.
+    void (*function_)();
+};
+
+static const BenchmarkSuite suites[] =
+{
+    {"containers", "HashMap and FlatHashMap insert, find, iteration and erase", BenchmarkContainers},
+    {"events", "Event sending to non-specific and sender-specific receivers", BenchmarkEvents},
+    {"math", "Frustum intersection tests against a scalar reference, and matrix operations", BenchmarkMath},
+#ifdef URHO3D_NETWORK
+    {"network", "Network bandwidth, server update time versus client count, and packet loss recovery", BenchmarkNetwork},
+#endif
+    {"octree", "Octree update and frustum query with moving objects at different loosenesses", BenchmarkOctree},
+    {"resources", "Image loading in the main thread and with different numbers of background loader threads", BenchmarkResources},
+    {"stringhash", "StringHash calculation from runtime strings", BenchmarkStringHash},
+    {0, 0, 0}
+};
+
+SharedPtr<Context> context_(new Context());
+SharedPtr<Engine> engine_(new Engine(context_));
+unsigned runs_ = 5;
+volatile unsigned sink_ = 0;
+
+int main(int argc, char** argv);
+void Run(const Vector<String>& arguments);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+
+    Run(arguments);
+    return 0;
+}
+
+void Run(const Vector<String>& arguments)
+{
+    if (arguments.Size() < 1)
+    {
+        String usage =
+            "Usage: Benchmark <suite> [suite ...] [options]\n"
+            "\n"
+            "Options:\n"
+            "-r <count>  Number of runs per measurement, the best run is reported (default 5)\n"
+            "-t <count>  Number of worker threads (default one less than the number of CPU cores)\n"
+            "\n"
+            "Suites:\n"
+            "all         Run all suites\n";
+        char buffer[256];
+        for (const BenchmarkSuite* suite = suites; suite->name_; ++suite)
+        {
+            sprintf(buffer, "%-11s %s\n", suite->name_, suite->description_);
+            usage += String(buffer);
+        }
+        ErrorExit(usage);
+    }
+
+    Log* log = context_->GetSubsystem<Log>();
+    if (log)
+    {
+        log->SetLevel(LOG_WARNING);
+        log->SetTimeStamp(false);
+    }
+
+    // Register the graphics components as in headless mode, without initializing the graphics subsystem
+    RegisterGraphicsLibrary(context_);
+
+    Vector<String> names;
+    int numThreads = -1;
+
+    for (unsigned i = 0; i < arguments.Size(); ++i)
+    {
+        if (arguments[i].Length() < 2 || arguments[i][0] != '-')
+        {
+            names.Push(arguments[i].ToLower());
+            continue;
+        }
+
+        String value = i + 1 < arguments.Size() ? arguments[i + 1] : String::EMPTY;
+        switch (arguments[i][1])
+        {
+        case 'r':
+            runs_ = Max(ToInt(value), 1);
+            ++i;
+            break;
+
+        case 't':
+            numThreads = Max(ToInt(value), 0);
+            ++i;
+            break;
+        }
+    }
+
+    if (numThreads < 0)
+        numThreads = Max((int)GetNumPhysicalCPUs() - 1, 0);
+    context_->GetSubsystem<WorkQueue>()->CreateThreads((unsigned)numThreads);
+
+    for (unsigned i = 0; i < names.Size(); ++i)
+    {
+        bool found = false;
+        for (const BenchmarkSuite* suite = suites; suite->name_; ++suite)
+        {
+            if (names[i] == "all" || names[i] == suite->name_)
+            {
+                PrintLine(String(suite->name_) + ":");
+                suite->function_();
+                PrintLine("");
+                found = true;
+            }
+        }
+
+        if (!found)
+            ErrorExit("Unknown benchmark suite " + names[i]);
+    }
+}
+
+void PrintResult(const String& name, const BenchmarkTimer& timer, unsigned operations)
+{
+    char buffer[256];
+    long long time = timer.GetBest();
+    sprintf(buffer, "  %-56s %10.3f ms %10.1f ns/op", name.CString(), time / 1000.0,
+        operations ? time * 1000.0 / operations : 0.0);
+    PrintLine(buffer);
+}
@@ -0,0 +1,88 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/Timer.h>
+
+using namespace Urho3D;
+
+/// Measures the best time of repeated runs, to filter out interruptions by the OS.
+class BenchmarkTimer
+{
+public:
+    /// Construct.
+    BenchmarkTimer() :
+        best_(-1)
+    {
+    }
+
+    /// Begin a run.
+    void Begin() { timer_.Reset(); }
+
+    /// End a run.
+    void End() { Record(timer_.GetUSec(false)); }
+
+    /// Record the time of a run measured in parts, in microseconds.
+    void Record(long long time)
+    {
+        if (best_ < 0 || time < best_)
+            best_ = time;
+    }
+
+    /// Return the best run time in microseconds.
+    long long GetBest() const { return best_ < 0 ? 0 : best_; }
+
+private:
+    /// High-resolution timer.
+    HiresTimer timer_;
+    /// Best run time.
+    long long best_;
+};
+
+/// Context shared by the benchmark suites.
+extern SharedPtr<Context> context_;
+/// Number of runs per measurement.
+extern unsigned runs_;
+/// Sink for results of the measured loops, so that the compiler does not optimize them away.
+extern volatile unsigned sink_;
+
+/// Print the best run time of a measurement and the time per operation.
+void PrintResult(const String& name, const BenchmarkTimer& timer, unsigned operations);
+
+/// Benchmark hash map containers.
+void BenchmarkContainers();
+/// Benchmark event sending.
+void BenchmarkEvents();
+/// Benchmark frustum tests and math operations.
+void BenchmarkMath();
+#ifdef URHO3D_NETWORK
+/// Benchmark server network updates with loopback clients.
+void BenchmarkNetwork();
+#endif
+/// Benchmark octree updates and queries.
+void BenchmarkOctree();
+/// Benchmark resource loading.
+void BenchmarkResources();
+/// Benchmark string hashing.
+void BenchmarkStringHash();
@@ -0,0 +1,125 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Container/FlatHashMap.h>
+#include <Urho3D/Container/HashMap.h>
+
+#include "Benchmark.h"
+
+#include <Urho3D/DebugNew.h>
+
+template <class MapType> static void BenchmarkMap(const String& name, const PODVector<unsigned>& keys,
+    const PODVector<unsigned>& missingKeys)
+{
+    // Small sizes are measured on several maps at once, so that the timer resolution does not dominate
+    const unsigned numKeys = keys.Size();
+    const unsigned numMaps = Max(100000 / (int)numKeys, 1);
+    const unsigned numOperations = numKeys * numMaps;
+    Vector<MapType> maps(numMaps);
+    BenchmarkTimer insertTimer;
+    BenchmarkTimer findTimer;
+    BenchmarkTimer missTimer;
+    BenchmarkTimer iterateTimer;
+    BenchmarkTimer eraseTimer;
+
+    for (unsigned i = 0; i < runs_; ++i)
+    {
+        for (unsigned j = 0; j < numMaps; ++j)
+            maps[j].Clear();
+
+        insertTimer.Begin();
+        for (unsigned j = 0; j < numMaps; ++j)
+        {
+            for (unsigned k = 0; k < numKeys; ++k)
+                maps[j][keys[k]] = k;
+        }
+        insertTimer.End();
+
+        unsigned sum = 0;
+        findTimer.Begin();
+        for (unsigned j = 0; j < numMaps; ++j)
+        {
+            for (unsigned k = 0; k < numKeys; ++k)
+                sum += maps[j].Find(keys[k])->second_;
+        }
+        findTimer.End();
+
+        missTimer.Begin();
+        for (unsigned j = 0; j < numMaps; ++j)
+        {
+            for (unsigned k = 0; k < numKeys; ++k)
+                sum += maps[j].Contains(missingKeys[k]) ? 1 : 0;
+        }
+        missTimer.End();
+
+        iterateTimer.Begin();
+        for (unsigned j = 0; j < numMaps; ++j)
+        {
+            for (typename MapType::ConstIterator k = maps[j].Begin(); k != maps[j].End(); ++k)
+                sum += k->second_;
+        }
+        iterateTimer.End();
+
+        eraseTimer.Begin();
+        for (unsigned j = 0; j < numMaps; ++j)
+        {
+            for (unsigned k = 0; k < numKeys; ++k)
+                maps[j].Erase(keys[k]);
+        }
+        eraseTimer.End();
+
+        sink_ += sum;
+    }
+
+    PrintResult(name + " insert", insertTimer, numOperations);
+    PrintResult(name + " find", findTimer, numOperations);
+    PrintResult(name + " find missing", missTimer, numOperations);
+    PrintResult(name + " iterate", iterateTimer, numOperations);
+    PrintResult(name + " erase", eraseTimer, numOperations);
+}
+
+void BenchmarkContainers()
+{
+    const unsigned sizes[] = {100, 10000, 100000};
+
+    for (unsigned i = 0; i < sizeof sizes / sizeof sizes[0]; ++i)
+    {
+        // Scattered keys, like the string hashes used as map keys in the engine. The mixing function is a bijection, so
+        // the missing keys differ from the stored ones
+        PODVector<unsigned> keys(sizes[i]);
+        PODVector<unsigned> missingKeys(sizes[i]);
+        for (unsigned j = 0; j < sizes[i] * 2; ++j)
+        {
+            unsigned key = j + 1;
+            key = (key ^ (key >> 16)) * 0x85ebca6b;
+            key = (key ^ (key >> 13)) * 0xc2b2ae35;
+            key ^= key >> 16;
+            if (j < sizes[i])
+                keys[j] = key;
+            else
+                missingKeys[j - sizes[i]] = key;
+        }
+
+        BenchmarkMap<HashMap<unsigned, unsigned> >("HashMap " + String(sizes[i]), keys, missingKeys);
+        BenchmarkMap<FlatHashMap<unsigned, unsigned> >("FlatHashMap " + String(sizes[i]), keys, missingKeys);
+    }
+}
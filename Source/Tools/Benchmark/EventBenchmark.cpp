@@ -0,0 +1,123 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Core/Object.h>
+
+#include "Benchmark.h"
+
+#include <Urho3D/DebugNew.h>
+
+URHO3D_EVENT(E_BENCHMARK, Benchmark)
+{
+}
+
+/// Event receiver which counts the received events.
+class BenchmarkReceiver : public Object
+{
+    URHO3D_OBJECT(BenchmarkReceiver, Object);
+
+public:
+    /// Construct.
+    BenchmarkReceiver(Context* context) :
+        Object(context),
+        count_(0)
+    {
+    }
+
+    /// Subscribe to the benchmark event from any sender.
+    void Subscribe() { SubscribeToEvent(E_BENCHMARK, URHO3D_HANDLER(BenchmarkReceiver, HandleBenchmark)); }
+
+    /// Subscribe to the benchmark event from a specific sender.
+    void Subscribe(Object* sender) { SubscribeToEvent(sender, E_BENCHMARK, URHO3D_HANDLER(BenchmarkReceiver, HandleBenchmark)); }
+
+    /// Handle the benchmark event.
+    void HandleBenchmark(StringHash eventType, VariantMap& eventData) { ++count_; }
+
+    /// Number of received events.
+    unsigned count_;
+};
+
+static void SendEvents(const String& name, Object* sender, unsigned numSends, unsigned numDeliveries)
+{
+    VariantMap& eventData = sender->GetEventDataMap();
+    BenchmarkTimer timer;
+
+    for (unsigned i = 0; i < runs_; ++i)
+    {
+        timer.Begin();
+        for (unsigned j = 0; j < numSends; ++j)
+            sender->SendEvent(E_BENCHMARK, eventData);
+        timer.End();
+    }
+
+    PrintResult(name, timer, numSends * numDeliveries);
+}
+
+void BenchmarkEvents()
+{
+    const unsigned numReceivers = 100;
+    const unsigned numSpecific = 4;
+    const unsigned numSends = 20000;
+
+    SharedPtr<BenchmarkReceiver> sender(new BenchmarkReceiver(context_));
+    Vector<SharedPtr<BenchmarkReceiver> > receivers;
+    for (unsigned i = 0; i < numReceivers; ++i)
+        receivers.Push(SharedPtr<BenchmarkReceiver>(new BenchmarkReceiver(context_)));
+
+    // Send with no receivers to measure the fixed overhead of a send
+    SendEvents("Send, no receivers", sender, numSends, 1);
+
+    receivers[0]->Subscribe();
+    SendEvents("Send, 1 receiver", sender, numSends, 1);
+
+    for (unsigned i = 1; i < numReceivers; ++i)
+        receivers[i]->Subscribe();
+    SendEvents("Send, " + String(numReceivers) + " receivers", sender, numSends, numReceivers);
+
+    // Some of the receivers also subscribe to the sender specifically, so the non-specific send has to skip them
+    for (unsigned i = 0; i < numSpecific; ++i)
+        receivers[i]->Subscribe(sender);
+    SendEvents("Send, " + String(numReceivers) + " receivers, " + String(numSpecific) + " also specific", sender,
+        numSends, numReceivers);
+
+    for (unsigned i = 0; i < numReceivers; ++i)
+        receivers[i]->UnsubscribeFromAllEvents();
+
+    // Subscribing and unsubscribing a large number of receivers, as happens when scenes are loaded and unloaded
+    const unsigned numChurn = 5000;
+    Vector<SharedPtr<BenchmarkReceiver> > churn;
+    for (unsigned i = 0; i < numChurn; ++i)
+        churn.Push(SharedPtr<BenchmarkReceiver>(new BenchmarkReceiver(context_)));
+
+    BenchmarkTimer timer;
+    for (unsigned i = 0; i < runs_; ++i)
+    {
+        timer.Begin();
+        for (unsigned j = 0; j < numChurn; ++j)
+            churn[j]->Subscribe();
+        for (unsigned j = 0; j < numChurn; ++j)
+            churn[j]->UnsubscribeFromEvent(E_BENCHMARK);
+        timer.End();
+    }
+
+    PrintResult("Subscribe and unsubscribe " + String(numChurn) + " receivers", timer, numChurn);
+}
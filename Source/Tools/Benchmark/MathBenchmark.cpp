@@ -0,0 +1,165 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Math/Frustum.h>
+#include <Urho3D/Math/Random.h>
+
+#include "Benchmark.h"
+
+#include <Urho3D/DebugNew.h>
+
+/// Scalar reference of Frustum::IsInside() for bounding boxes.
+static Intersection ScalarIsInside(const Frustum& frustum, const BoundingBox& box)
+{
+    Vector3 center = box.Center();
+    Vector3 edge = center - box.min_;
+    bool allInside = true;
+
+    for (unsigned i = 0; i < NUM_FRUSTUM_PLANES; ++i)
+    {
+        const Plane& plane = frustum.planes_[i];
+        float dist = plane.normal_.DotProduct(center) + plane.d_;
+        float absDist = plane.absNormal_.DotProduct(edge);
+
+        if (dist < -absDist)
+            return OUTSIDE;
+        else if (dist < absDist)
+            allInside = false;
+    }
+
+    return allInside ? INSIDE : INTERSECTS;
+}
+
+/// Scalar reference of Frustum::IsInside() for spheres.
+static Intersection ScalarIsInside(const Frustum& frustum, const Sphere& sphere)
+{
+    bool allInside = true;
+
+    for (unsigned i = 0; i < NUM_FRUSTUM_PLANES; ++i)
+    {
+        float dist = frustum.planes_[i].Distance(sphere.center_);
+        if (dist < -sphere.radius_)
+            return OUTSIDE;
+        else if (dist < sphere.radius_)
+            allInside = false;
+    }
+
+    return allInside ? INSIDE : INTERSECTS;
+}
+
+void BenchmarkMath()
+{
+    const unsigned numObjects = 100000;
+
+    // A camera frustum looking into a field of boxes and spheres, of which roughly a third is inside
+    Frustum frustum;
+    frustum.Define(60.0f, 16.0f / 9.0f, 1.0f, 0.1f, 500.0f, Matrix3x4(Vector3(0.0f, 10.0f, -200.0f),
+        Quaternion(10.0f, 20.0f, 0.0f), 1.0f));
+
+    SetRandomSeed(1);
+    PODVector<BoundingBox> boxes(numObjects);
+    PODVector<Sphere> spheres(numObjects);
+    for (unsigned i = 0; i < numObjects; ++i)
+    {
+        Vector3 center(Random(-400.0f, 400.0f), Random(-50.0f, 50.0f), Random(-400.0f, 400.0f));
+        Vector3 size(Random(0.5f, 20.0f), Random(0.5f, 20.0f), Random(0.5f, 20.0f));
+        boxes[i] = BoundingBox(center - size, center + size);
+        spheres[i] = Sphere(center, size.x_);
+    }
+
+    // The SIMD paths must give exactly the same results as the scalar ones
+    unsigned mismatches = 0;
+    for (unsigned i = 0; i < numObjects; ++i)
+    {
+        Intersection boxResult = ScalarIsInside(frustum, boxes[i]);
+        Intersection sphereResult = ScalarIsInside(frustum, spheres[i]);
+        if (frustum.IsInside(boxes[i]) != boxResult || (frustum.IsInsideFast(boxes[i]) == OUTSIDE) != (boxResult == OUTSIDE) ||
+            frustum.IsInside(spheres[i]) != sphereResult ||
+            (frustum.IsInsideFast(spheres[i]) == OUTSIDE) != (sphereResult == OUTSIDE))
+            ++mismatches;
+    }
+    PrintLine("  Frustum test results differing from the scalar reference: " + String(mismatches) + "/" + String(numObjects));
+
+    BenchmarkTimer boxTimer;
+    BenchmarkTimer boxFastTimer;
+    BenchmarkTimer boxScalarTimer;
+    BenchmarkTimer sphereTimer;
+    BenchmarkTimer sphereScalarTimer;
+    BenchmarkTimer transformTimer;
+    BenchmarkTimer matrixTimer;
+
+    PODVector<Matrix3x4> transforms(numObjects);
+    for (unsigned i = 0; i < numObjects; ++i)
+        transforms[i] = Matrix3x4(boxes[i].Center(), Quaternion(Random(360.0f), Vector3::UP), 1.0f);
+
+    for (unsigned i = 0; i < runs_; ++i)
+    {
+        unsigned sum = 0;
+
+        boxTimer.Begin();
+        for (unsigned j = 0; j < numObjects; ++j)
+            sum += frustum.IsInside(boxes[j]);
+        boxTimer.End();
+
+        boxFastTimer.Begin();
+        for (unsigned j = 0; j < numObjects; ++j)
+            sum += frustum.IsInsideFast(boxes[j]);
+        boxFastTimer.End();
+
+        boxScalarTimer.Begin();
+        for (unsigned j = 0; j < numObjects; ++j)
+            sum += ScalarIsInside(frustum, boxes[j]);
+        boxScalarTimer.End();
+
+        sphereTimer.Begin();
+        for (unsigned j = 0; j < numObjects; ++j)
+            sum += frustum.IsInside(spheres[j]);
+        sphereTimer.End();
+
+        sphereScalarTimer.Begin();
+        for (unsigned j = 0; j < numObjects; ++j)
+            sum += ScalarIsInside(frustum, spheres[j]);
+        sphereScalarTimer.End();
+
+        float total = 0.0f;
+        transformTimer.Begin();
+        for (unsigned j = 0; j < numObjects; ++j)
+            total += boxes[j].Transformed(transforms[j]).max_.x_;
+        transformTimer.End();
+
+        Matrix3x4 product = Matrix3x4::IDENTITY;
+        matrixTimer.Begin();
+        for (unsigned j = 0; j < numObjects; ++j)
+            product = transforms[j] * product;
+        matrixTimer.End();
+
+        sink_ += sum + (unsigned)total + (unsigned)product.m00_;
+    }
+
+    PrintResult("Frustum::IsInside(BoundingBox)", boxTimer, numObjects);
+    PrintResult("Frustum::IsInsideFast(BoundingBox)", boxFastTimer, numObjects);
+    PrintResult("Scalar reference IsInside(BoundingBox)", boxScalarTimer, numObjects);
+    PrintResult("Frustum::IsInside(Sphere)", sphereTimer, numObjects);
+    PrintResult("Scalar reference IsInside(Sphere)", sphereScalarTimer, numObjects);
+    PrintResult("BoundingBox::Transformed(Matrix3x4)", transformTimer, numObjects);
+    PrintResult("Matrix3x4 * Matrix3x4", matrixTimer, numObjects);
+}
@@ -0,0 +1,354 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifdef URHO3D_NETWORK
+
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/MemoryBuffer.h>
+#include <Urho3D/Network/Connection.h>
+#include <Urho3D/Network/Network.h>
+#include <Urho3D/Network/Protocol.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/Scene.h>
+#include <Urho3D/Scene/SmoothedTransform.h>
+
+#include "Benchmark.h"
+
+#include <cstdio>
+
+#include <kNet/kNet.h>
+
+#include <Urho3D/DebugNew.h>
+
+static const unsigned short SERVER_PORT = 2346;
+static const int UPDATE_FPS = 30;
+
+/// Client in its own context, connected to the benchmark server through the loopback interface.
+struct BenchmarkClient
+{
+    /// Context.
+    SharedPtr<Context> context_;
+    /// Network subsystem.
+    Network* network_;
+    /// Replicated scene.
+    SharedPtr<Scene> scene_;
+};
+
+/// Create a client and connect it to the server.
+static BenchmarkClient CreateClient()
+{
+    BenchmarkClient client;
+    client.context_ = new Context();
+    client.context_->RegisterSubsystem(new FileSystem(client.context_));
+    client.context_->RegisterSubsystem(new ResourceCache(client.context_));
+    RegisterSceneLibrary(client.context_);
+    client.network_ = new Network(client.context_);
+    client.context_->RegisterSubsystem(client.network_);
+    client.scene_ = new Scene(client.context_);
+    client.network_->Connect("127.0.0.1", SERVER_PORT, client.scene_);
+    return client;
+}
+
+/// Update the server and the clients once.
+static void UpdateNetwork(Network* server, Vector<BenchmarkClient>& clients, HiresTimer* timer = 0, long long* time = 0)
+{
+    const float timeStep = 1.0f / UPDATE_FPS;
+
+    server->Update(timeStep);
+    if (timer)
+        timer->Reset();
+    server->PostUpdate(timeStep);
+    if (time)
+        *time += timer->GetUSec(false);
+
+    for (unsigned i = 0; i < clients.Size(); ++i)
+    {
+        clients[i].network_->Update(timeStep);
+        clients[i].network_->PostUpdate(timeStep);
+    }
+}
+
+/// Update until all clients have loaded the scene and received all its nodes. Return true on success.
+static bool WaitForClients(Network* server, Vector<BenchmarkClient>& clients, Scene* scene)
+{
+    bool sceneSet = false;
+    unsigned loadedFrames = 0;
+
+    for (unsigned i = 0; i < 20000 && loadedFrames < UPDATE_FPS; ++i)
+    {
+        UpdateNetwork(server, clients);
+        Time::Sleep(1);
+
+        Vector<SharedPtr<Connection> > connections = server->GetClientConnections();
+        if (!sceneSet && connections.Size() == clients.Size())
+        {
+            for (unsigned j = 0; j < connections.Size(); ++j)
+                connections[j]->SetScene(scene);
+            sceneSet = true;
+        }
+
+        bool loaded = sceneSet;
+        for (unsigned j = 0; j < connections.Size() && loaded; ++j)
+            loaded = connections[j]->IsSceneLoaded();
+        // The node creation messages are throttled by the connection's data rate, so take a while to arrive
+        for (unsigned j = 0; j < clients.Size() && loaded; ++j)
+            loaded = clients[j].scene_->GetNumChildren() == scene->GetNumChildren();
+        if (loaded)
+            ++loadedFrames;
+    }
+
+    return loadedFrames >= UPDATE_FPS;
+}
+
+/// Disconnect the clients and update until the server has removed their connections.
+static void DisconnectClients(Network* server, Vector<BenchmarkClient>& clients)
+{
+    for (unsigned i = 0; i < clients.Size(); ++i)
+        clients[i].network_->Disconnect();
+
+    for (unsigned i = 0; i < 2000 && server->GetClientConnections().Size(); ++i)
+    {
+        UpdateNetwork(server, clients);
+        Time::Sleep(1);
+    }
+
+    clients.Clear();
+}
+
+/// Measure the attribute data sent for moving and rotating nodes with the given node transform encodings.
+static void MeasureBandwidth(const String& name, const NetworkEncoding& positionEncoding, const NetworkEncoding& rotationEncoding,
+    float distance, float angle)
+{
+    const unsigned numNodes = 1000;
+    const unsigned numUpdates = 100;
+
+    context_->SetAttributeNetworkEncoding<Node>("Network Position", positionEncoding);
+    context_->SetAttributeNetworkEncoding<Node>("Network Rotation", rotationEncoding);
+
+    SharedPtr<Scene> scene(new Scene(context_));
+    PODVector<Node*> nodes(numNodes);
+    for (unsigned i = 0; i < numNodes; ++i)
+    {
+        nodes[i] = scene->CreateChild();
+        nodes[i]->SetPosition(Vector3((float)(i % 50), 0.0f, (float)(i / 50)));
+        nodes[i]->SetRotation(Quaternion((float)i, Vector3::UP));
+    }
+
+    // Offline connection, whose messages are only encoded
+    SharedPtr<Connection> connection(new Connection(context_, true, kNet::SharedPtr<kNet::MessageConnection>()));
+    connection->SetScene(scene);
+    VectorBuffer loaded;
+    loaded.WriteUInt(scene->GetChecksum());
+    MemoryBuffer msg(loaded.GetData(), loaded.GetSize());
+    connection->ProcessMessage(MSG_SCENELOADED, msg);
+    scene->PrepareNetworkUpdate();
+    connection->SendServerUpdate();
+
+    const NetworkEncodeStats& stats = connection->GetEncodeStats();
+    unsigned long long startBytes = stats.encodedBytes_ + stats.reusedBytes_;
+    for (unsigned i = 0; i < numUpdates; ++i)
+    {
+        // Alternate the direction, so that small steps do not accumulate over the precision
+        float sign = i & 1 ? -1.0f : 1.0f;
+        for (unsigned j = 0; j < numNodes; ++j)
+        {
+            nodes[j]->Translate(Vector3(0.0f, sign * distance, 0.0f));
+            nodes[j]->Rotate(Quaternion(sign * angle, Vector3::UP));
+        }
+        scene->PrepareNetworkUpdate();
+        connection->SendServerUpdate();
+    }
+
+    char buffer[256];
+    sprintf(buffer, "  %-56s %10.2f bytes/node", name.CString(),
+        (double)(stats.encodedBytes_ + stats.reusedBytes_ - startBytes) / (numUpdates * numNodes));
+    PrintLine(buffer);
+}
+
+/// Return whether the client scene has received the same node positions as the server scene has.
+static bool IsReplicated(Scene* scene, Scene* clientScene)
+{
+    const Vector<SharedPtr<Node> >& children = scene->GetChildren();
+    for (unsigned i = 0; i < children.Size(); ++i)
+    {
+        Node* clientNode = clientScene->GetNode(children[i]->GetID());
+        if (!clientNode)
+            return false;
+        // Compare the received position instead of the smoothed one, as the client scene is not updated
+        SmoothedTransform* transform = clientNode->GetComponent<SmoothedTransform>();
+        const Vector3& position = transform ? transform->GetTargetPosition() : clientNode->GetPosition();
+        if (!position.Equals(children[i]->GetPosition()))
+            return false;
+    }
+
+    return true;
+}
+
+/// Measure how many updates a client needs to converge to the server state after the nodes stop moving under packet loss.
+static void MeasureConvergence(Network* server, bool snapshots, float packetLoss)
+{
+    const unsigned numNodes = 200;
+    const unsigned numMovingUpdates = 60;
+    const unsigned maxUpdates = 300;
+
+    SharedPtr<Scene> scene(new Scene(context_));
+    scene->SetSnapshotReplication(snapshots);
+    PODVector<Node*> nodes(numNodes);
+    for (unsigned i = 0; i < numNodes; ++i)
+    {
+        nodes[i] = scene->CreateChild("Node" + String(i));
+        nodes[i]->SetPosition(Vector3((float)(i % 20), 0.0f, (float)(i / 20)));
+    }
+
+    Vector<BenchmarkClient> clients;
+    clients.Push(CreateClient());
+
+    char name[256];
+    sprintf(name, "%s, %d%% packet loss", snapshots ? "Snapshot" : "Delta", (int)(packetLoss * 100.0f + 0.5f));
+    if (!WaitForClients(server, clients, scene))
+    {
+        PrintLine("  " + String(name) + ": client did not connect");
+        DisconnectClients(server, clients);
+        return;
+    }
+
+    server->SetSimulatedPacketLoss(packetLoss);
+    for (unsigned i = 0; i < numMovingUpdates; ++i)
+    {
+        for (unsigned j = i % 3; j < numNodes; j += 3)
+            nodes[j]->Translate(Vector3(0.0f, 0.0f, 0.1f));
+        UpdateNetwork(server, clients);
+        Time::Sleep(1000 / UPDATE_FPS);
+    }
+
+    // Count the updates after the last movement until the client has the final positions. The updates run in real time,
+    // as the connections limit their send rate
+    unsigned updates = 0;
+    while (updates < maxUpdates && !IsReplicated(scene, clients[0].scene_))
+    {
+        UpdateNetwork(server, clients);
+        Time::Sleep(1000 / UPDATE_FPS);
+        ++updates;
+    }
+    server->SetSimulatedPacketLoss(0.0f);
+
+    char buffer[256];
+    if (updates < maxUpdates)
+        sprintf(buffer, "  %-56s %10u updates", name, updates);
+    else
+        sprintf(buffer, "  %-56s %10s", name, "not converged");
+    PrintLine(buffer);
+
+    DisconnectClients(server, clients);
+}
+
+void BenchmarkNetwork()
+{
+    // Attribute data per node update, restoring the default encodings afterward
+    MeasureBandwidth("Moving, full precision transform", NetworkEncoding(), NetworkEncoding(), 0.1f, 1.0f);
+    MeasureBandwidth("Moving, smallest three rotation", NetworkEncoding(), NetworkEncoding(NE_SMALLESTTHREE, 15), 0.1f,
+        1.0f);
+    MeasureBandwidth("Moving, also 1 mm position", NetworkEncoding(-1000.0f, 1000.0f, 0.001f),
+        NetworkEncoding(NE_SMALLESTTHREE, 15), 0.1f, 1.0f);
+    MeasureBandwidth("Jitter below precision, full precision transform", NetworkEncoding(), NetworkEncoding(), 0.0001f,
+        0.001f);
+    MeasureBandwidth("Jitter below precision, quantized transform", NetworkEncoding(-1000.0f, 1000.0f, 0.001f),
+        NetworkEncoding(NE_SMALLESTTHREE, 15), 0.0001f, 0.001f);
+    context_->SetAttributeNetworkEncoding<Node>("Network Position", NetworkEncoding());
+    context_->SetAttributeNetworkEncoding<Node>("Network Rotation", NetworkEncoding(NE_SMALLESTTHREE, 15));
+
+    const unsigned numNodes = 2000;
+    const unsigned numUpdates = 30;
+    const unsigned clientCounts[] = {1, 4, 16, 32};
+
+    Network* server = context_->GetSubsystem<Network>();
+    server->SetUpdateFps(UPDATE_FPS);
+    if (!server->StartServer(SERVER_PORT))
+    {
+        PrintLine("  Could not start the server on port " + String(SERVER_PORT));
+        return;
+    }
+
+    // Nodes of which a quarter move on each update, replicated either with delta updates or snapshots
+    for (unsigned i = 0; i < 2; ++i)
+    {
+        bool snapshots = i == 1;
+        SharedPtr<Scene> scene(new Scene(context_));
+        scene->SetSnapshotReplication(snapshots);
+        PODVector<Node*> nodes(numNodes);
+        for (unsigned j = 0; j < numNodes; ++j)
+        {
+            nodes[j] = scene->CreateChild("Node" + String(j));
+            nodes[j]->SetPosition(Vector3((float)(j % 50), 0.0f, (float)(j / 50)));
+        }
+
+        for (unsigned j = 0; j < sizeof clientCounts / sizeof clientCounts[0]; ++j)
+        {
+            unsigned numClients = clientCounts[j];
+            Vector<BenchmarkClient> clients;
+            for (unsigned k = 0; k < numClients; ++k)
+                clients.Push(CreateClient());
+
+            String name = String(snapshots ? "Snapshot" : "Delta") + " update " + String(numNodes) + " nodes, " +
+                String(numClients) + (numClients == 1 ? " client" : " clients");
+            if (!WaitForClients(server, clients, scene))
+            {
+                PrintLine("  " + name + ": clients did not connect");
+                DisconnectClients(server, clients);
+                continue;
+            }
+
+            // Measure the time spent in the server update. Report the time per client update. Run in real time, as otherwise
+            // the connections would skip snapshots due to their limited send rate
+            BenchmarkTimer timer;
+            HiresTimer updateTimer;
+            for (unsigned k = 0; k < runs_; ++k)
+            {
+                long long time = 0;
+                for (unsigned l = 0; l < numUpdates; ++l)
+                {
+                    for (unsigned m = l & 3; m < numNodes; m += 4)
+                        nodes[m]->Translate(Vector3(0.0f, (k + l) & 1 ? -0.1f : 0.1f, 0.0f));
+                    UpdateNetwork(server, clients, &updateTimer, &time);
+                    Time::Sleep(1000 / UPDATE_FPS);
+                }
+                timer.Record(time);
+            }
+
+            PrintResult(name + ", " + String(numUpdates) + " updates", timer, numUpdates * numClients);
+            DisconnectClients(server, clients);
+        }
+    }
+
+    // Updates needed to recover from packet loss, which stalls delta updates on reliable resends
+    const float packetLosses[] = {0.1f, 0.3f};
+    for (unsigned i = 0; i < 2; ++i)
+    {
+        for (unsigned j = 0; j < sizeof packetLosses / sizeof packetLosses[0]; ++j)
+            MeasureConvergence(server, i == 1, packetLosses[j]);
+    }
+
+    server->StopServer();
+}
+
+#endif
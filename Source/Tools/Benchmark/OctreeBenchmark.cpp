@@ -0,0 +1,129 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Graphics/Drawable.h>
+#include <Urho3D/Graphics/Octree.h>
+#include <Urho3D/Graphics/OctreeQuery.h>
+#include <Urho3D/Math/Random.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include "Benchmark.h"
+
+#include <Urho3D/DebugNew.h>
+
+/// Drawable with a fixed size bounding box, standing in for the models of a physics stress scene.
+class BenchmarkDrawable : public Drawable
+{
+    URHO3D_OBJECT(BenchmarkDrawable, Drawable);
+
+public:
+    /// Construct.
+    BenchmarkDrawable(Context* context) :
+        Drawable(context, DRAWABLE_GEOMETRY)
+    {
+        boundingBox_ = BoundingBox(-1.0f, 1.0f);
+    }
+
+protected:
+    /// Recalculate the world-space bounding box.
+    virtual void OnWorldBoundingBoxUpdate() { worldBoundingBox_ = boundingBox_.Transformed(node_->GetWorldTransform()); }
+};
+
+void BenchmarkOctree()
+{
+    const unsigned numObjects = 20000;
+    const unsigned numFrames = 20;
+    const float loosenesses[] = {1.25f, 2.0f, 4.0f};
+
+    context_->RegisterFactory<BenchmarkDrawable>();
+
+    for (unsigned i = 0; i < sizeof loosenesses / sizeof loosenesses[0]; ++i)
+    {
+        // Boxes scattered in a pile, of which half move every frame like simulated rigid bodies
+        SharedPtr<Scene> scene(new Scene(context_));
+        Octree* octree = scene->CreateComponent<Octree>();
+        octree->SetLooseness(loosenesses[i]);
+
+        SetRandomSeed(1);
+        PODVector<Node*> nodes(numObjects);
+        PODVector<Vector3> velocities(numObjects);
+        for (unsigned j = 0; j < numObjects; ++j)
+        {
+            nodes[j] = scene->CreateChild();
+            nodes[j]->SetPosition(Vector3(Random(-200.0f, 200.0f), Random(0.0f, 50.0f), Random(-200.0f, 200.0f)));
+            nodes[j]->SetScale(Random(0.5f, 4.0f));
+            nodes[j]->CreateComponent<BenchmarkDrawable>();
+            velocities[j] = j & 1 ? Vector3(Random(-1.0f, 1.0f), Random(-2.0f, 0.0f), Random(-1.0f, 1.0f)) : Vector3::ZERO;
+        }
+
+        FrameInfo frame;
+        frame.frameNumber_ = 0;
+        frame.timeStep_ = 1.0f / 60.0f;
+        frame.viewSize_ = IntVector2(1920, 1080);
+        frame.camera_ = 0;
+        octree->Update(frame);
+
+        Frustum frustum;
+        frustum.Define(60.0f, 16.0f / 9.0f, 1.0f, 0.1f, 300.0f, Matrix3x4(Vector3(0.0f, 30.0f, -250.0f),
+            Quaternion(10.0f, 0.0f, 0.0f), 1.0f));
+        PODVector<Drawable*> result;
+
+        BenchmarkTimer updateTimer;
+        BenchmarkTimer queryTimer;
+        for (unsigned j = 0; j < runs_; ++j)
+        {
+            long long updateTime = 0;
+            long long queryTime = 0;
+            HiresTimer timer;
+
+            for (unsigned k = 0; k < numFrames; ++k)
+            {
+                for (unsigned l = 1; l < numObjects; l += 2)
+                    nodes[l]->Translate(velocities[l], TS_WORLD);
+
+                ++frame.frameNumber_;
+                timer.Reset();
+                octree->Update(frame);
+                updateTime += timer.GetUSec(false);
+
+                timer.Reset();
+                FrustumOctreeQuery query(result, frustum, DRAWABLE_GEOMETRY);
+                octree->GetDrawables(query);
+                queryTime += timer.GetUSec(false);
+                sink_ += result.Size();
+            }
+
+            // Move the bodies back so that every run measures the same scene
+            for (unsigned l = 1; l < numObjects; l += 2)
+                nodes[l]->Translate(-velocities[l] * (float)numFrames, TS_WORLD);
+            octree->Update(frame);
+
+            updateTimer.Record(updateTime);
+            queryTimer.Record(queryTime);
+        }
+
+        // Report the update time per moving object and the query time per object in the scene
+        String name = "Looseness " + String(loosenesses[i]) + ",";
+        PrintResult(name + " update " + String(numFrames) + " frames", updateTimer, numFrames * numObjects / 2);
+        PrintResult(name + " query " + String(numFrames) + " frames", queryTimer, numFrames * numObjects);
+    }
+}
@@ -0,0 +1,129 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/Math/Random.h>
+#include <Urho3D/Resource/Image.h>
+#include <Urho3D/Resource/ResourceCache.h>
+
+#include "Benchmark.h"
+
+#include <Urho3D/DebugNew.h>
+
+/// Create the benchmark images into a directory, unless they already exist. Return the directory.
+static String CreateImages(unsigned numImages, int size)
+{
+    FileSystem* fileSystem = context_->GetSubsystem<FileSystem>();
+    String pathName = fileSystem->GetAppPreferencesDir("urho3d", "Benchmark") + "Images/";
+    fileSystem->CreateDir(pathName);
+
+    SharedPtr<Image> image(new Image(context_));
+    image->SetSize(size, size, 4);
+    for (unsigned i = 0; i < numImages; ++i)
+    {
+        String fileName = pathName + "Image" + String(i) + ".png";
+        if (fileSystem->FileExists(fileName))
+            continue;
+
+        // A smooth gradient with some noise, so that decoding takes a realistic time
+        for (int y = 0; y < size; ++y)
+        {
+            for (int x = 0; x < size; ++x)
+                image->SetPixelInt(x, y, ((x + i) & 0xff) | ((y & 0xff) << 8) | ((Rand() & 0x1f) << 16) | 0xff000000);
+        }
+        image->SavePNG(fileName);
+    }
+
+    return pathName;
+}
+
+/// Send the begin frame event to finish background loaded resources, until none are left.
+static void FinishBackgroundLoading(ResourceCache* cache)
+{
+    VariantMap& eventData = context_->GetEventDataMap();
+    eventData[BeginFrame::P_FRAMENUMBER] = 0;
+    eventData[BeginFrame::P_TIMESTEP] = 0.0f;
+
+    for (;;)
+    {
+        cache->SendEvent(E_BEGINFRAME, eventData);
+        if (!cache->GetNumBackgroundLoadResources())
+            break;
+        Time::Sleep(1);
+    }
+}
+
+void BenchmarkResources()
+{
+    const unsigned numImages = 400;
+    const int imageSize = 256;
+    const unsigned threadCounts[] = {1, 2, 4, 8};
+
+    ResourceCache* cache = context_->GetSubsystem<ResourceCache>();
+    String pathName = CreateImages(numImages, imageSize);
+    cache->AddResourceDir(pathName);
+    cache->SetFinishBackgroundResourcesMs(1000);
+
+    Vector<String> names;
+    for (unsigned i = 0; i < numImages; ++i)
+        names.Push("Image" + String(i) + ".png");
+
+    // Loading in the main thread as the reference
+    BenchmarkTimer timer;
+    for (unsigned run = 0; run < runs_; ++run)
+    {
+        timer.Begin();
+        for (unsigned i = 0; i < names.Size(); ++i)
+            sink_ += cache->GetResource<Image>(names[i])->GetWidth();
+        timer.End();
+        cache->ReleaseAllResources(true);
+    }
+    PrintResult("Image load, main thread", timer, numImages);
+
+    for (unsigned i = 0; i < sizeof threadCounts / sizeof threadCounts[0]; ++i)
+    {
+        unsigned numThreads = threadCounts[i];
+        if (numThreads > 1 && numThreads > GetNumLogicalCPUs())
+            break;
+
+        cache->SetNumBackgroundLoadThreads(numThreads);
+        BenchmarkTimer timer;
+        for (unsigned run = 0; run < runs_; ++run)
+        {
+            timer.Begin();
+            for (unsigned j = 0; j < names.Size(); ++j)
+                cache->BackgroundLoadResource<Image>(names[j]);
+            FinishBackgroundLoading(cache);
+            timer.End();
+
+            for (unsigned j = 0; j < names.Size(); ++j)
+                sink_ += cache->GetExistingResource<Image>(names[j])->GetWidth();
+            cache->ReleaseAllResources(true);
+        }
+        PrintResult("Image background load, " + String(numThreads) + " thread" + (numThreads > 1 ? "s" : ""), timer,
+            numImages);
+    }
+
+    cache->RemoveResourceDir(pathName);
+}
@@ -0,0 +1,69 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Math/StringHash.h>
+
+#include "Benchmark.h"
+
+#include <Urho3D/DebugNew.h>
+
+void BenchmarkStringHash()
+{
+    const unsigned numHashes = 200000;
+    const unsigned lengths[] = {8, 32, 128};
+
+    for (unsigned i = 0; i < sizeof lengths / sizeof lengths[0]; ++i)
+    {
+        // Mixed case attribute-like names, built at runtime so that nothing can be hashed at compile time
+        String str;
+        for (unsigned j = 0; j < lengths[i]; ++j)
+            str += (char)((j & 1 ? 'a' : 'A') + j % 26);
+        const char* cstr = str.CString();
+
+        BenchmarkTimer timer;
+        for (unsigned j = 0; j < runs_; ++j)
+        {
+            unsigned sum = 0;
+            timer.Begin();
+            for (unsigned k = 0; k < numHashes; ++k)
+                sum += StringHash(cstr).Value();
+            timer.End();
+            sink_ += sum;
+        }
+        PrintResult("StringHash " + String(lengths[i]) + " chars", timer, numHashes);
+
+#ifdef URHO3D_CONSTEXPR_HASH
+        // The recursive compile-time calculation evaluated at runtime, for comparison
+        BenchmarkTimer constexprTimer;
+        for (unsigned j = 0; j < runs_; ++j)
+        {
+            unsigned sum = 0;
+            constexprTimer.Begin();
+            for (unsigned k = 0; k < numHashes; ++k)
+                sum += StringHash::CalculateConstexpr(cstr, 0);
+            constexprTimer.End();
+            sink_ += sum;
+        }
+        PrintResult("CalculateConstexpr at runtime " + String(lengths[i]) + " chars", constexprTimer, numHashes);
+#endif
+    }
+}
@@ -0,0 +1,449 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Engine/Engine.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/IO/MemoryBuffer.h>
+#include <Urho3D/IO/VectorBuffer.h>
+#include <Urho3D/Network/Connection.h>
+#include <Urho3D/Network/InterestGrid.h>
+#include <Urho3D/Network/Protocol.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/Scene.h>
+
+#include <kNet/kNet.h>
+
+#include <cstdio>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <Urho3D/DebugNew.h>
+
+using namespace Urho3D;
+
+struct MessageRecord
+{
+    /// Time since the start of the recording in milliseconds.
+    unsigned time_;
+    /// Record flags.
+    unsigned char flags_;
+    /// Message ID.
+    int msgID_;
+    /// Message data offset in the recording data.
+    unsigned offset_;
+    /// Message data size.
+    unsigned size_;
+};
+
+struct Recording
+{
+    /// Recorded messages.
+    PODVector<MessageRecord> records_;
+    /// Message data.
+    PODVector<unsigned char> data_;
+    /// Whether was recorded on the server from a client connection.
+    bool isClient_;
+    /// Received message bytes.
+    unsigned long long bytesIn_;
+    /// Sent message bytes.
+    unsigned long long bytesOut_;
+    /// Number of sent messages.
+    unsigned messagesOut_;
+};
+
+struct ReplayStats
+{
+    /// Total replay time in microseconds.
+    long long totalTime_;
+    /// Time spent processing received messages in microseconds.
+    long long messageTime_;
+    /// Time spent in scene and server updates in microseconds.
+    long long updateTime_;
+    /// Number of frames.
+    unsigned frames_;
+    /// Number of network updates.
+    unsigned updates_;
+};
+
+SharedPtr<Context> context_(new Context());
+SharedPtr<Engine> engine_(new Engine(context_));
+String sceneName_;
+String outputName_;
+unsigned iterations_ = 1;
+int updateFps_ = 30;
+bool quiet_ = false;
+
+int main(int argc, char** argv);
+void Run(const Vector<String>& arguments);
+void LoadRecording(const String& fileName, Recording& recording);
+void ReplayClient(const Recording& recording, bool record, ReplayStats& stats);
+void ReplayServer(const Recording& recording, bool record, ReplayStats& stats);
+void EndFrame(Connection* connection, Scene* scene, float timeStep, bool isClient, float& updateAcc, ReplayStats& stats);
+
+int main(int argc, char** argv)
+{
+    Vector<String> arguments;
+
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+
+    Run(arguments);
+    return 0;
+}
+
+void Run(const Vector<String>& arguments)
+{
+    if (arguments.Size() < 1)
+        ErrorExit(
+            "Usage: NetworkReplay <recording file> [options]\n"
+            "\n"
+            "Options:\n"
+            "-p <paths>  Resource paths, separated by semicolons\n"
+            "-s <file>   Scene file to replay a server recording in, instead of the scene sent to the client\n"
+            "-o <file>   Record the messages sent during the first replay, for comparing against the original\n"
+            "-n <count>  Number of times to replay the recording\n"
+            "-u <fps>    Network update FPS (default 30)\n"
+            "-q          Enable quiet mode\n"
+            "\n"
+            "Recordings are made with Connection::StartRecording(). A recording made on the server from a client\n"
+            "connection is replayed by feeding the client's messages to a server scene, and a recording made on the\n"
+            "client by feeding the server's messages to a client scene. Messages are replayed as fast as possible,\n"
+            "with the scene updated using the recorded time steps.\n"
+        );
+
+    Log* log = context_->GetSubsystem<Log>();
+    if (log)
+    {
+        log->SetLevel(LOG_WARNING);
+        log->SetTimeStamp(false);
+    }
+
+    for (unsigned i = 1; i < arguments.Size(); ++i)
+    {
+        if (arguments[i].Length() < 2 || arguments[i][0] != '-')
+            continue;
+
+        String value = i + 1 < arguments.Size() ? arguments[i + 1] : String::EMPTY;
+        switch (arguments[i][1])
+        {
+        case 'p':
+            {
+                Vector<String> paths = value.Split(';');
+                for (unsigned j = 0; j < paths.Size(); ++j)
+                    context_->GetSubsystem<ResourceCache>()->AddResourceDir(paths[j]);
+                ++i;
+            }
+            break;
+
+        case 's':
+            sceneName_ = value;
+            ++i;
+            break;
+
+        case 'o':
+            outputName_ = value;
+            ++i;
+            break;
+
+        case 'n':
+            iterations_ = Max(ToInt(value), 1);
+            ++i;
+            break;
+
+        case 'u':
+            updateFps_ = Max(ToInt(value), 1);
+            ++i;
+            break;
+
+        case 'q':
+            quiet_ = true;
+            if (log)
+                log->SetLevel(LOG_ERROR);
+            break;
+        }
+    }
+
+    char buffer[256];
+
+    Recording recording;
+    LoadRecording(arguments[0], recording);
+    if (!quiet_)
+    {
+        sprintf(buffer, "Loaded %u messages recorded on the %s, received %.3f KB, sent %u messages %.3f KB",
+            recording.records_.Size(), recording.isClient_ ? "server" : "client", recording.bytesIn_ / 1000.0,
+            recording.messagesOut_, recording.bytesOut_ / 1000.0);
+        PrintLine(buffer);
+    }
+
+    ReplayStats total;
+    memset(&total, 0, sizeof total);
+
+    for (unsigned i = 0; i < iterations_; ++i)
+    {
+        ReplayStats stats;
+        memset(&stats, 0, sizeof stats);
+
+        bool record = !i && !outputName_.Empty();
+        if (recording.isClient_)
+            ReplayServer(recording, record, stats);
+        else
+            ReplayClient(recording, record, stats);
+
+        if (!quiet_)
+        {
+            sprintf(buffer, "Replay %u: %.3f ms total, %.3f ms processing messages, %.3f ms updating, %u frames, %u network updates",
+                i + 1, stats.totalTime_ / 1000.0, stats.messageTime_ / 1000.0, stats.updateTime_ / 1000.0, stats.frames_,
+                stats.updates_);
+            PrintLine(buffer);
+        }
+
+        total.totalTime_ += stats.totalTime_;
+        total.messageTime_ += stats.messageTime_;
+        total.updateTime_ += stats.updateTime_;
+    }
+
+    sprintf(buffer, "Average over %u replays: %.3f ms total, %.3f ms processing messages, %.3f ms updating", iterations_,
+        total.totalTime_ / 1000.0 / iterations_, total.messageTime_ / 1000.0 / iterations_,
+        total.updateTime_ / 1000.0 / iterations_);
+    PrintLine(buffer);
+
+    if (!outputName_.Empty())
+    {
+        Recording output;
+        LoadRecording(outputName_, output);
+        sprintf(buffer, "Replay sent %u messages %.3f KB, originally %u messages %.3f KB", output.messagesOut_,
+            output.bytesOut_ / 1000.0, recording.messagesOut_, recording.bytesOut_ / 1000.0);
+        PrintLine(buffer);
+    }
+}
+
+void LoadRecording(const String& fileName, Recording& recording)
+{
+    File file(context_);
+    if (!file.Open(fileName))
+        ErrorExit("Could not open recording file " + fileName);
+    if (file.ReadFileID() != "UREC")
+        ErrorExit(fileName + " is not a valid recording file");
+
+    recording.isClient_ = file.ReadBool();
+    recording.bytesIn_ = 0;
+    recording.bytesOut_ = 0;
+    recording.messagesOut_ = 0;
+
+    // Read all messages to memory first, so that file access does not affect the replay timing
+    unsigned time = 0;
+    while (!file.IsEof())
+    {
+        MessageRecord record;
+        time += file.ReadVLE();
+        record.time_ = time;
+        record.flags_ = file.ReadUByte();
+        if (record.flags_ & RECORD_LONGID)
+        {
+            record.msgID_ = (int)file.ReadUInt();
+            if (record.flags_ & RECORD_CONTENTID)
+                file.ReadUInt();
+        }
+        else
+        {
+            record.msgID_ = (int)file.ReadVLE();
+            if (record.flags_ & RECORD_CONTENTID)
+                file.ReadVLE();
+        }
+        record.size_ = file.ReadVLE();
+        record.offset_ = recording.data_.Size();
+
+        // A recording may be truncated if the application exited without closing it
+        if (record.size_ > file.GetSize() - file.GetPosition())
+            break;
+
+        recording.data_.Resize(record.offset_ + record.size_);
+        if (record.size_)
+            file.Read(&recording.data_[record.offset_], record.size_);
+        recording.records_.Push(record);
+
+        if (record.flags_ & RECORD_OUTBOUND)
+        {
+            recording.bytesOut_ += record.size_;
+            ++recording.messagesOut_;
+        }
+        else
+            recording.bytesIn_ += record.size_;
+    }
+}
+
+void ReplayClient(const Recording& recording, bool record, ReplayStats& stats)
+{
+    SharedPtr<Scene> scene(new Scene(context_));
+    SharedPtr<Connection> connection(new Connection(context_, false, kNet::SharedPtr<kNet::MessageConnection>()));
+    if (record && !connection->StartRecording(outputName_))
+        ErrorExit("Could not open output file " + outputName_);
+    connection->SetScene(scene);
+
+    HiresTimer totalTimer;
+    HiresTimer timer;
+    float updateAcc = 0.0f;
+    unsigned time = 0;
+
+    for (unsigned i = 0; i < recording.records_.Size(); ++i)
+    {
+        const MessageRecord& message = recording.records_[i];
+        // The messages sent by the original client are sent again by the replaying connection
+        if (message.flags_ & RECORD_OUTBOUND)
+            continue;
+
+        // Messages received at different times belong to different frames
+        if (message.time_ != time)
+        {
+            EndFrame(connection, scene, (message.time_ - time) * 0.001f, false, updateAcc, stats);
+            time = message.time_;
+        }
+
+        timer.Reset();
+        MemoryBuffer msg(message.size_ ? &recording.data_[message.offset_] : 0, message.size_);
+        connection->ProcessMessage(message.msgID_, msg);
+        stats.messageTime_ += timer.GetUSec(false);
+    }
+
+    EndFrame(connection, scene, 0.0f, false, updateAcc, stats);
+    stats.totalTime_ = totalTimer.GetUSec(false);
+}
+
+void ReplayServer(const Recording& recording, bool record, ReplayStats& stats)
+{
+    // Load the scene the client was sent, unless overridden
+    String sceneName = sceneName_;
+    for (unsigned i = 0; i < recording.records_.Size() && sceneName.Empty(); ++i)
+    {
+        const MessageRecord& message = recording.records_[i];
+        if ((message.flags_ & RECORD_OUTBOUND) && message.msgID_ == MSG_LOADSCENE)
+        {
+            MemoryBuffer msg(&recording.data_[message.offset_], message.size_);
+            sceneName = msg.ReadString();
+        }
+    }
+    if (sceneName.Empty())
+        ErrorExit("No scene file to replay the server recording in, specify one with -s");
+
+    SharedPtr<File> file = context_->GetSubsystem<ResourceCache>()->GetFile(sceneName);
+    if (!file)
+        ErrorExit("Could not open scene file " + sceneName);
+
+    SharedPtr<Scene> scene(new Scene(context_));
+    bool success = GetExtension(sceneName) == ".xml" ? scene->LoadXML(*file) : scene->Load(*file);
+    if (!success)
+        ErrorExit("Could not load scene file " + sceneName);
+
+    SharedPtr<Connection> connection(new Connection(context_, true, kNet::SharedPtr<kNet::MessageConnection>()));
+    if (record && !connection->StartRecording(outputName_))
+        ErrorExit("Could not open output file " + outputName_);
+    connection->SetScene(scene);
+
+    HiresTimer totalTimer;
+    HiresTimer timer;
+    float updateAcc = 0.0f;
+    unsigned time = 0;
+
+    for (unsigned i = 0; i < recording.records_.Size(); ++i)
+    {
+        const MessageRecord& message = recording.records_[i];
+        // Advance time also on sent messages, so that server updates happen at the recorded times
+        if (message.time_ != time)
+        {
+            EndFrame(connection, scene, (message.time_ - time) * 0.001f, true, updateAcc, stats);
+            time = message.time_;
+        }
+
+        if (message.flags_ & RECORD_OUTBOUND)
+            continue;
+
+        timer.Reset();
+        if (message.msgID_ == MSG_SCENELOADED)
+        {
+            // The scene may have been saved separately from the one the client loaded, so reply with its checksum
+            VectorBuffer loaded;
+            loaded.WriteUInt(scene->GetChecksum());
+            MemoryBuffer msg(loaded.GetData(), loaded.GetSize());
+            connection->ProcessMessage(message.msgID_, msg);
+        }
+        else
+        {
+            MemoryBuffer msg(message.size_ ? &recording.data_[message.offset_] : 0, message.size_);
+            connection->ProcessMessage(message.msgID_, msg);
+        }
+        stats.messageTime_ += timer.GetUSec(false);
+    }
+
+    EndFrame(connection, scene, 0.0f, true, updateAcc, stats);
+    stats.totalTime_ = totalTimer.GetUSec(false);
+}
+
+void EndFrame(Connection* connection, Scene* scene, float timeStep, bool isClient, float& updateAcc, ReplayStats& stats)
+{
+    HiresTimer timer;
+
+    if (!isClient)
+        connection->ProcessPendingLatestData();
+    if (timeStep > 0.0f)
+        scene->Update(timeStep);
+
+    // Send updates at the network update rate, like Network does
+    float updateInterval = 1.0f / (float)updateFps_;
+    updateAcc += timeStep;
+    if (updateAcc >= updateInterval)
+    {
+        updateAcc = fmodf(updateAcc, updateInterval);
+
+        if (isClient)
+        {
+            scene->PrepareNetworkUpdate();
+            InterestGrid* grid = scene->GetComponent<InterestGrid>();
+            if (grid)
+                grid->Update();
+
+            connection->SendServerUpdate();
+            connection->SendRemoteEvents();
+            connection->SendPackages();
+        }
+        else
+        {
+            connection->SendClientUpdate();
+            connection->SendRemoteEvents();
+        }
+
+        ++stats.updates_;
+    }
+
+    stats.updateTime_ += timer.GetUSec(false);
+    ++stats.frames_;
+}
@@ -45,6 +45,7 @@ struct FileEntry
     unsigned offset_;
     unsigned size_;
     unsigned checksum_;
+    PODVector<unsigned> blockOffsets_;
 };
 
 SharedPtr<Context> context_(new Context());
@@ -67,6 +68,7 @@ void Run(const Vector<String>& arguments);
 void ProcessFile(const String& fileName, const String& rootDir);
 void WritePackageFile(const String& fileName, const String& rootDir);
 void WriteHeader(File& dest);
+void WriteEntry(File& dest, const FileEntry& entry);
 
 int main(int argc, char** argv)
 {
@@ -164,6 +166,13 @@ void ProcessFile(const String& fileName, const String& rootDir)
     newEntry.offset_ = 0; // Offset not yet known
     newEntry.size_ = file.GetSize();
     newEntry.checksum_ = 0; // Will be calculated later
+    // Offsets of the compressed blocks and the end of the compressed data, for seeking within compressed files
+    if (compress_)
+    {
+        unsigned numBlocks = (newEntry.size_ + blockSize_ - 1) / blockSize_;
+        for (unsigned i = 0; i <= numBlocks; ++i)
+            newEntry.blockOffsets_.Push(0);
+    }
     entries_.Push(newEntry);
 }
 
@@ -179,14 +188,9 @@ void WritePackageFile(const String& fileName, const String& rootDir)
     // Write ID, number of files & placeholder for checksum
     WriteHeader(dest);
 
+    // Write entries (correct offsets are still unknown, will be filled in later)
     for (unsigned i = 0; i < entries_.Size(); ++i)
-    {
-        // Write entry (correct offset is still unknown, will be filled in later)
-        dest.WriteString(basePath_ + entries_[i].name_);
-        dest.WriteUInt(entries_[i].offset_);
-        dest.WriteUInt(entries_[i].size_);
-        dest.WriteUInt(entries_[i].checksum_);
-    }
+        WriteEntry(dest, entries_[i]);
 
     unsigned totalDataSize = 0;
 
@@ -226,9 +230,12 @@ void WritePackageFile(const String& fileName, const String& rootDir)
 
             unsigned pos = 0;
             unsigned totalPackedBytes = 0;
+            unsigned block = 0;
 
             while (pos < dataSize)
             {
+                entries_[i].blockOffsets_[block++] = dest.GetSize() - entries_[i].offset_;
+
                 unsigned unpackedSize = blockSize_;
                 if (pos + unpackedSize > dataSize)
                     unpackedSize = dataSize - pos;
@@ -245,6 +252,8 @@ void WritePackageFile(const String& fileName, const String& rootDir)
                 pos += unpackedSize;
             }
 
+            entries_[i].blockOffsets_[block] = dest.GetSize() - entries_[i].offset_;
+
             if (!quiet_)
                 PrintLine(entries_[i].name_ + " in " + String(dataSize) + " out " + String(totalPackedBytes));
         }
@@ -259,12 +268,7 @@ void WritePackageFile(const String& fileName, const String& rootDir)
     WriteHeader(dest);
 
     for (unsigned i = 0; i < entries_.Size(); ++i)
-    {
-        dest.WriteString(basePath_ + entries_[i].name_);
-        dest.WriteUInt(entries_[i].offset_);
-        dest.WriteUInt(entries_[i].size_);
-        dest.WriteUInt(entries_[i].checksum_);
-    }
+        WriteEntry(dest, entries_[i]);
 
     if (!quiet_)
     {
@@ -279,7 +283,19 @@ void WriteHeader(File& dest)
     if (!compress_)
         dest.WriteFileID("UPAK");
     else
-        dest.WriteFileID("ULZ4");
+        dest.WriteFileID("ULZI");
     dest.WriteUInt(entries_.Size());
     dest.WriteUInt(checksum_);
+    if (compress_)
+        dest.WriteUInt(blockSize_);
+}
+
+void WriteEntry(File& dest, const FileEntry& entry)
+{
+    dest.WriteString(basePath_ + entry.name_);
+    dest.WriteUInt(entry.offset_);
+    dest.WriteUInt(entry.size_);
+    dest.WriteUInt(entry.checksum_);
+    for (unsigned i = 0; i < entry.blockOffsets_.Size(); ++i)
+        dest.WriteUInt(entry.blockOffsets_[i]);
 }
@@ -26,12 +26,22 @@
 
 #include "../AngelScript/APITemplates.h"
 #include "../Network/HttpRequest.h"
+#include "../Network/InterestGrid.h"
+#include "../Network/LagCompensation.h"
 #include "../Network/Network.h"
 #include "../Network/NetworkPriority.h"
 
 namespace Urho3D
 {
 
+static void RegisterInterestGrid(asIScriptEngine* engine)
+{
+    RegisterComponent<InterestGrid>(engine, "InterestGrid");
+    engine->RegisterObjectMethod("InterestGrid", "void set_interestRadius(float)", asMETHOD(InterestGrid, SetInterestRadius), asCALL_THISCALL);
+    engine->RegisterObjectMethod("InterestGrid", "float get_interestRadius() const", asMETHOD(InterestGrid, GetInterestRadius), asCALL_THISCALL);
+    engine->RegisterObjectMethod("InterestGrid", "uint get_numNodes() const", asMETHOD(InterestGrid, GetNumNodes), asCALL_THISCALL);
+}
+
 static void RegisterNetworkPriority(asIScriptEngine* engine)
 {
     RegisterComponent<NetworkPriority>(engine, "NetworkPriority");
@@ -63,6 +73,8 @@ static void RegisterConnection(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Connection", "void SendRemoteEvent(Node@+, const String&in, bool, const VariantMap&in eventData = VariantMap())", asFUNCTION(SendRemoteNodeEvent), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Connection", "void Disconnect(int waitMSec = 0)", asMETHOD(Connection, Disconnect), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "String ToString() const", asMETHOD(Connection, ToString), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "bool StartRecording(const String&in)", asMETHOD(Connection, StartRecording), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "void StopRecording()", asMETHOD(Connection, StopRecording), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "void set_scene(Scene@+)", asMETHOD(Connection, SetScene), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "Scene@+ get_scene() const", asMETHOD(Connection, GetScene), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "void set_logStatistics(bool)", asMETHOD(Connection, SetLogStatistics), asCALL_THISCALL);
@@ -71,6 +83,7 @@ static void RegisterConnection(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Connection", "bool get_connected() const", asMETHOD(Connection, IsConnected), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "bool get_connectPending() const", asMETHOD(Connection, IsConnectPending), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "bool get_sceneLoaded() const", asMETHOD(Connection, IsSceneLoaded), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "bool get_recording() const", asMETHOD(Connection, IsRecording), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "String get_address() const", asMETHOD(Connection, GetAddress), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "uint16 get_port() const", asMETHOD(Connection, GetPort), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "float get_roundTripTime() const", asMETHOD(Connection, GetRoundTripTime), asCALL_THISCALL);
@@ -80,6 +93,7 @@ static void RegisterConnection(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Connection", "float get_packetsInPerSec() const", asMETHOD(Connection, GetPacketsInPerSec), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "float get_packetsOutPerSec() const", asMETHOD(Connection, GetPacketsOutPerSec), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "uint get_numDownloads() const", asMETHOD(Connection, GetNumDownloads), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Connection", "uint get_numScopedNodes() const", asMETHOD(Connection, GetNumScopedNodes), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "const String& get_downloadName() const", asMETHOD(Connection, GetDownloadName), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "float get_downloadProgress() const", asMETHOD(Connection, GetDownloadProgress), asCALL_THISCALL);
     engine->RegisterObjectMethod("Connection", "void set_position(const Vector3&in)", asMETHOD(Connection, SetPosition), asCALL_THISCALL);
@@ -96,6 +110,26 @@ static void RegisterConnection(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Node", "Connection@+ get_owner() const", asMETHOD(Node, GetOwner), asCALL_THISCALL);
 }
 
+static bool LagCompensationRewindNodes(float time, CScriptArray* nodes, LagCompensation* ptr)
+{
+    return ptr->Rewind(time, ArrayToPODVector<Node*>(nodes));
+}
+
+static void RegisterLagCompensation(asIScriptEngine* engine)
+{
+    RegisterComponent<LagCompensation>(engine, "LagCompensation");
+    engine->RegisterObjectMethod("LagCompensation", "bool Rewind(float)", asMETHODPR(LagCompensation, Rewind, (float), bool), asCALL_THISCALL);
+    engine->RegisterObjectMethod("LagCompensation", "bool Rewind(float, Array<Node@>@+)", asFUNCTION(LagCompensationRewindNodes), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("LagCompensation", "void Restore()", asMETHOD(LagCompensation, Restore), asCALL_THISCALL);
+    engine->RegisterObjectMethod("LagCompensation", "bool GetTransform(Node@+, float, Vector3&out, Quaternion&out) const", asMETHOD(LagCompensation, GetTransform), asCALL_THISCALL);
+    engine->RegisterObjectMethod("LagCompensation", "float GetClientTime(Connection@+, uint8) const", asMETHOD(LagCompensation, GetClientTime), asCALL_THISCALL);
+    engine->RegisterObjectMethod("LagCompensation", "float GetEstimatedClientTime(Connection@+) const", asMETHOD(LagCompensation, GetEstimatedClientTime), asCALL_THISCALL);
+    engine->RegisterObjectMethod("LagCompensation", "void set_historyLength(float)", asMETHOD(LagCompensation, SetHistoryLength), asCALL_THISCALL);
+    engine->RegisterObjectMethod("LagCompensation", "float get_historyLength() const", asMETHOD(LagCompensation, GetHistoryLength), asCALL_THISCALL);
+    engine->RegisterObjectMethod("LagCompensation", "uint get_numNodes() const", asMETHOD(LagCompensation, GetNumNodes), asCALL_THISCALL);
+    engine->RegisterObjectMethod("LagCompensation", "bool get_rewound() const", asMETHOD(LagCompensation, IsRewound), asCALL_THISCALL);
+}
+
 static void RegisterHttpRequest(asIScriptEngine* engine)
 {
     engine->RegisterEnum("HttpRequestState");
@@ -155,6 +189,26 @@ static bool NetworkCheckRemoteEvent(const String& eventType, Network* ptr)
     return ptr->CheckRemoteEvent(eventType);
 }
 
+static void NetworkRegisterRemoteEventSchema(const String& eventType, const VariantMap& layout, Network* ptr)
+{
+    ptr->RegisterRemoteEventSchema(eventType, layout);
+}
+
+static void NetworkUnregisterRemoteEventSchema(const String& eventType, Network* ptr)
+{
+    ptr->UnregisterRemoteEventSchema(eventType);
+}
+
+static void NetworkSetRemoteEventCoalescing(const String& eventType, bool enable, Network* ptr)
+{
+    ptr->SetRemoteEventCoalescing(eventType, enable);
+}
+
+static bool NetworkGetRemoteEventCoalescing(const String& eventType, Network* ptr)
+{
+    return ptr->GetRemoteEventCoalescing(eventType);
+}
+
 static HttpRequest* NetworkMakeHttpRequest(const String& url, const String& verb, CScriptArray* headers, const String& postData, Network* ptr)
 {
     SharedPtr<HttpRequest> request = ptr->MakeHttpRequest(url, verb, ArrayToVector<String>(headers), postData);
@@ -180,6 +234,10 @@ void RegisterNetwork(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Network", "void UnregisterRemoteEvent(const String&in) const", asFUNCTION(NetworkUnregisterRemoteEvent), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Network", "void UnregisterAllRemoteEvents()", asMETHOD(Network, UnregisterAllRemoteEvents), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "bool CheckRemoteEvent(const String&in) const", asFUNCTION(NetworkCheckRemoteEvent), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Network", "void RegisterRemoteEventSchema(const String&in, const VariantMap&in)", asFUNCTION(NetworkRegisterRemoteEventSchema), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Network", "void UnregisterRemoteEventSchema(const String&in)", asFUNCTION(NetworkUnregisterRemoteEventSchema), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Network", "void SetRemoteEventCoalescing(const String&in, bool)", asFUNCTION(NetworkSetRemoteEventCoalescing), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("Network", "bool GetRemoteEventCoalescing(const String&in) const", asFUNCTION(NetworkGetRemoteEventCoalescing), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Network", "HttpRequest@ MakeHttpRequest(const String&in, const String&in verb = String(), Array<String>@+ headers = null, const String&in postData = String())", asFUNCTION(NetworkMakeHttpRequest), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("Network", "void SendPackageToClients(Scene@+, PackageFile@+)", asMETHOD(Network, SendPackageToClients), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "void set_updateFps(int)", asMETHOD(Network, SetUpdateFps), asCALL_THISCALL);
@@ -190,6 +248,12 @@ void RegisterNetwork(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Network", "float get_simulatedPacketLoss() const", asMETHOD(Network, GetSimulatedPacketLoss), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "void set_packageCacheDir(const String&in)", asMETHOD(Network, SetPackageCacheDir), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "const String& get_packageCacheDir() const", asMETHOD(Network, GetPackageCacheDir), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "void set_packageFragmentSize(uint)", asMETHOD(Network, SetPackageFragmentSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "uint get_packageFragmentSize() const", asMETHOD(Network, GetPackageFragmentSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "void set_packageWindowSize(uint)", asMETHOD(Network, SetPackageWindowSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "uint get_packageWindowSize() const", asMETHOD(Network, GetPackageWindowSize), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "void set_packageCompression(bool)", asMETHOD(Network, SetPackageCompression), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Network", "bool get_packageCompression() const", asMETHOD(Network, GetPackageCompression), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "bool get_serverRunning() const", asMETHOD(Network, IsServerRunning), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "Connection@+ get_serverConnection() const", asMETHOD(Network, GetServerConnection), asCALL_THISCALL);
     engine->RegisterObjectMethod("Network", "Array<Connection@>@ get_clientConnections() const", asFUNCTION(NetworkGetClientConnections), asCALL_CDECL_OBJLAST);
@@ -198,8 +262,10 @@ void RegisterNetwork(asIScriptEngine* engine)
 
 void RegisterNetworkAPI(asIScriptEngine* engine)
 {
+    RegisterInterestGrid(engine);
     RegisterNetworkPriority(engine);
     RegisterConnection(engine);
+    RegisterLagCompensation(engine);
     RegisterHttpRequest(engine);
     RegisterNetwork(engine);
 }
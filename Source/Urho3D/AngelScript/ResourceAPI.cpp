@@ -99,9 +99,9 @@ static CScriptArray* ResourceCacheGetPackageFiles(ResourceCache* ptr)
     return VectorToHandleArray<PackageFile>(ptr->GetPackageFiles(), "Array<PackageFile@>");
 }
 
-static bool ResourceCacheBackgroundLoadResource(const String& type, const String& name, bool sendEventOnFailure, ResourceCache* ptr)
+static bool ResourceCacheBackgroundLoadResource(const String& type, const String& name, bool sendEventOnFailure, float priority, ResourceCache* ptr)
 {
-    return ptr->BackgroundLoadResource(type, name, sendEventOnFailure);
+    return ptr->BackgroundLoadResource(type, name, sendEventOnFailure, 0, priority);
 }
 
 static Localization* GetLocalization()
@@ -153,7 +153,7 @@ static void RegisterResourceCache(asIScriptEngine* engine)
     engine->RegisterObjectMethod("ResourceCache", "Resource@+ GetResource(StringHash, const String&in, bool sendEventOnFailure = true)", asMETHODPR(ResourceCache, GetResource, (StringHash, const String&, bool), Resource*), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "Resource@+ GetExistingResource(const String&in, const String&in)", asFUNCTION(ResourceCacheGetExistingResource), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "Resource@+ GetExistingResource(StringHash, const String&in)", asMETHODPR(ResourceCache, GetExistingResource, (StringHash, const String&), Resource*), asCALL_THISCALL);
-    engine->RegisterObjectMethod("ResourceCache", "bool BackgroundLoadResource(const String&in, const String&in, bool sendEventOnFailure = true)", asFUNCTION(ResourceCacheBackgroundLoadResource), asCALL_CDECL_OBJLAST);
+    engine->RegisterObjectMethod("ResourceCache", "bool BackgroundLoadResource(const String&in, const String&in, bool sendEventOnFailure = true, float priority = 0.0f)", asFUNCTION(ResourceCacheBackgroundLoadResource), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "void set_memoryBudget(const String&in, uint64)", asFUNCTION(ResourceCacheSetMemoryBudget), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "uint64 get_memoryBudget(const String&in) const", asFUNCTION(ResourceCacheGetMemoryBudget), asCALL_CDECL_OBJLAST);
     engine->RegisterObjectMethod("ResourceCache", "uint64 get_memoryUse(const String&in) const", asFUNCTION(ResourceCacheGetMemoryUse), asCALL_CDECL_OBJLAST);
@@ -166,9 +166,18 @@ static void RegisterResourceCache(asIScriptEngine* engine)
     engine->RegisterObjectMethod("ResourceCache", "bool get_autoReloadResources() const", asMETHOD(ResourceCache, GetAutoReloadResources), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "void set_returnFailedResources(bool)", asMETHOD(ResourceCache, SetReturnFailedResources), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "bool get_returnFailedResources() const", asMETHOD(ResourceCache, GetReturnFailedResources), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void set_indexResources(bool)", asMETHOD(ResourceCache, SetIndexResources), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "bool get_indexResources() const", asMETHOD(ResourceCache, GetIndexResources), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void set_processedCacheDir(const String&in)", asMETHOD(ResourceCache, SetProcessedCacheDir), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "const String& get_processedCacheDir() const", asMETHOD(ResourceCache, GetProcessedCacheDir), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void set_processedCacheSizeLimit(uint64)", asMETHOD(ResourceCache, SetProcessedCacheSizeLimit), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "uint64 get_processedCacheSizeLimit() const", asMETHOD(ResourceCache, GetProcessedCacheSizeLimit), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "uint64 get_processedCacheSize() const", asMETHOD(ResourceCache, GetProcessedCacheSize), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "void set_finishBackgroundResourcesMs(int)", asMETHOD(ResourceCache, SetFinishBackgroundResourcesMs), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "int get_finishBackgroundResourcesMs() const", asMETHOD(ResourceCache, GetFinishBackgroundResourcesMs), asCALL_THISCALL);
     engine->RegisterObjectMethod("ResourceCache", "uint get_numBackgroundLoadResources() const", asMETHOD(ResourceCache, GetNumBackgroundLoadResources), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "void set_numBackgroundLoadThreads(uint)", asMETHOD(ResourceCache, SetNumBackgroundLoadThreads), asCALL_THISCALL);
+    engine->RegisterObjectMethod("ResourceCache", "uint get_numBackgroundLoadThreads() const", asMETHOD(ResourceCache, GetNumBackgroundLoadThreads), asCALL_THISCALL);
     engine->RegisterGlobalFunction("ResourceCache@+ get_resourceCache()", asFUNCTION(GetResourceCache), asCALL_CDECL);
     engine->RegisterGlobalFunction("ResourceCache@+ get_cache()", asFUNCTION(GetResourceCache), asCALL_CDECL);
 }
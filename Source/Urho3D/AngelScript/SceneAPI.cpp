@@ -25,6 +25,7 @@
 #include "../AngelScript/APITemplates.h"
 #include "../Graphics/DebugRenderer.h"
 #include "../IO/PackageFile.h"
+#include "../Scene/InterpolatedTransform.h"
 #include "../Scene/ObjectAnimation.h"
 #include "../Scene/Scene.h"
 #include "../Scene/SmoothedTransform.h"
@@ -293,6 +294,22 @@ static void RegisterSmoothedTransform(asIScriptEngine* engine)
     engine->RegisterObjectMethod("SmoothedTransform", "bool get_inProgress() const", asMETHOD(SmoothedTransform, IsInProgress), asCALL_THISCALL);
 }
 
+static void RegisterInterpolatedTransform(asIScriptEngine* engine)
+{
+    RegisterComponent<InterpolatedTransform>(engine, "InterpolatedTransform");
+    engine->RegisterObjectMethod("InterpolatedTransform", "void Update(float, float)", asMETHOD(InterpolatedTransform, Update), asCALL_THISCALL);
+    engine->RegisterObjectMethod("InterpolatedTransform", "void AddPosition(const Vector3&in, uint8)", asMETHOD(InterpolatedTransform, AddPosition), asCALL_THISCALL);
+    engine->RegisterObjectMethod("InterpolatedTransform", "void AddRotation(const Quaternion&in, uint8)", asMETHOD(InterpolatedTransform, AddRotation), asCALL_THISCALL);
+    engine->RegisterObjectMethod("InterpolatedTransform", "void Snap()", asMETHOD(InterpolatedTransform, Snap), asCALL_THISCALL);
+    engine->RegisterObjectMethod("InterpolatedTransform", "void ResetUnderruns()", asMETHOD(InterpolatedTransform, ResetUnderruns), asCALL_THISCALL);
+    engine->RegisterObjectMethod("InterpolatedTransform", "uint get_numSamples() const", asMETHOD(InterpolatedTransform, GetNumSamples), asCALL_THISCALL);
+    engine->RegisterObjectMethod("InterpolatedTransform", "Vector3 get_targetPosition() const", asMETHOD(InterpolatedTransform, GetTargetPosition), asCALL_THISCALL);
+    engine->RegisterObjectMethod("InterpolatedTransform", "Quaternion get_targetRotation() const", asMETHOD(InterpolatedTransform, GetTargetRotation), asCALL_THISCALL);
+    engine->RegisterObjectMethod("InterpolatedTransform", "float get_updateInterval() const", asMETHOD(InterpolatedTransform, GetUpdateInterval), asCALL_THISCALL);
+    engine->RegisterObjectMethod("InterpolatedTransform", "uint get_numUnderruns() const", asMETHOD(InterpolatedTransform, GetNumUnderruns), asCALL_THISCALL);
+    engine->RegisterObjectMethod("InterpolatedTransform", "bool get_extrapolating() const", asMETHOD(InterpolatedTransform, IsExtrapolating), asCALL_THISCALL);
+}
+
 static void RegisterSplinePath(asIScriptEngine* engine)
 {
     RegisterComponent<SplinePath>(engine, "SplinePath");
@@ -377,6 +394,14 @@ static void RegisterScene(asIScriptEngine* engine)
     engine->RegisterObjectMethod("Scene", "float get_smoothingConstant() const", asMETHOD(Scene, GetSmoothingConstant), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "void set_snapThreshold(float)", asMETHOD(Scene, SetSnapThreshold), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "float get_snapThreshold() const", asMETHOD(Scene, GetSnapThreshold), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "void set_networkInterpolation(bool)", asMETHOD(Scene, SetNetworkInterpolation), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "bool get_networkInterpolation() const", asMETHOD(Scene, GetNetworkInterpolation), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "void set_interpolationDelay(float)", asMETHOD(Scene, SetInterpolationDelay), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "float get_interpolationDelay() const", asMETHOD(Scene, GetInterpolationDelay), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "void set_maxExtrapolation(float)", asMETHOD(Scene, SetMaxExtrapolation), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "float get_maxExtrapolation() const", asMETHOD(Scene, GetMaxExtrapolation), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "void set_snapshotReplication(bool)", asMETHOD(Scene, SetSnapshotReplication), asCALL_THISCALL);
+    engine->RegisterObjectMethod("Scene", "bool get_snapshotReplication() const", asMETHOD(Scene, GetSnapshotReplication), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "bool get_asyncLoading() const", asMETHOD(Scene, IsAsyncLoading), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "float get_asyncProgress() const", asMETHOD(Scene, GetAsyncProgress), asCALL_THISCALL);
     engine->RegisterObjectMethod("Scene", "LoadMode get_asyncLoadMode() const", asMETHOD(Scene, GetAsyncLoadMode), asCALL_THISCALL);
@@ -400,6 +425,7 @@ void RegisterSceneAPI(asIScriptEngine* engine)
     RegisterAnimatable(engine);
     RegisterNode(engine);
     RegisterSmoothedTransform(engine);
+    RegisterInterpolatedTransform(engine);
     RegisterSplinePath(engine);
     RegisterScene(engine);
 }
@@ -618,6 +618,7 @@ void ScriptInstance::GetScriptAttributes()
         AttributeInfo info;
         info.mode_ = AM_FILE;
         info.name_ = name;
+        info.nameHash_ = name;
         info.ptr_ = scriptObject_->GetAddressOfProperty(i);
 
         if (!isHandle)
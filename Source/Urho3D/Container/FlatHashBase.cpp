@@ -0,0 +1,162 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Container/FlatHashBase.h"
+
+#include <cstring>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+FlatHashBase::FlatHashBase(const FlatHashBase& rhs) :
+    slots_(0),
+    numSlots_(0),
+    shift_(32)
+{
+    *this = rhs;
+}
+
+FlatHashBase& FlatHashBase::operator =(const FlatHashBase& rhs)
+{
+    if (&rhs == this)
+        return *this;
+
+    if (numSlots_ != rhs.numSlots_)
+    {
+        delete[] slots_;
+        slots_ = rhs.numSlots_ ? new FlatHashSlot[rhs.numSlots_] : 0;
+        numSlots_ = rhs.numSlots_;
+        shift_ = rhs.shift_;
+    }
+
+    if (numSlots_)
+        memcpy(slots_, rhs.slots_, numSlots_ * sizeof(FlatHashSlot));
+
+    return *this;
+}
+
+void FlatHashBase::ReserveSlots(unsigned size)
+{
+    // Keep the load factor at or below 3/4 so that probe sequences stay short
+    if (size * 4 <= numSlots_ * 3)
+        return;
+
+    unsigned numSlots = numSlots_ ? numSlots_ : MIN_SLOTS;
+    while (size * 4 > numSlots * 3)
+        numSlots <<= 1;
+
+    ResizeSlots(numSlots);
+}
+
+void FlatHashBase::ResizeSlots(unsigned numSlots)
+{
+    FlatHashSlot* oldSlots = slots_;
+    unsigned oldNumSlots = numSlots_;
+
+    slots_ = new FlatHashSlot[numSlots];
+    numSlots_ = numSlots;
+    shift_ = 32;
+    while (numSlots > 1)
+    {
+        --shift_;
+        numSlots >>= 1;
+    }
+    ResetSlots();
+
+    for (unsigned i = 0; i < oldNumSlots; ++i)
+    {
+        if (oldSlots[i].index_ != EMPTY_SLOT)
+            InsertSlot(oldSlots[i].hash_, oldSlots[i].index_);
+    }
+
+    delete[] oldSlots;
+}
+
+void FlatHashBase::ResetSlots()
+{
+    for (unsigned i = 0; i < numSlots_; ++i)
+        slots_[i].index_ = EMPTY_SLOT;
+}
+
+void FlatHashBase::InsertSlot(unsigned hash, unsigned index)
+{
+    unsigned mask = numSlots_ - 1;
+    unsigned pos = HomeSlot(hash);
+    unsigned distance = 0;
+    FlatHashSlot entry;
+    entry.hash_ = hash;
+    entry.index_ = index;
+
+    for (;;)
+    {
+        FlatHashSlot& slot = slots_[pos];
+        if (slot.index_ == EMPTY_SLOT)
+        {
+            slot = entry;
+            return;
+        }
+
+        // Robin hood: take the slot from an entry that is closer to its home slot, and continue inserting that one instead
+        unsigned slotDistance = ProbeDistance(slot.hash_, pos);
+        if (slotDistance < distance)
+        {
+            Urho3D::Swap(slot, entry);
+            distance = slotDistance;
+        }
+
+        pos = (pos + 1) & mask;
+        ++distance;
+    }
+}
+
+void FlatHashBase::EraseSlot(unsigned pos)
+{
+    unsigned mask = numSlots_ - 1;
+    unsigned next = (pos + 1) & mask;
+
+    // Backward shift deletion: no tombstones are needed, so lookups never slow down after erasing
+    while (slots_[next].index_ != EMPTY_SLOT && ProbeDistance(slots_[next].hash_, next) > 0)
+    {
+        slots_[pos] = slots_[next];
+        pos = next;
+        next = (next + 1) & mask;
+    }
+
+    slots_[pos].index_ = EMPTY_SLOT;
+}
+
+unsigned FlatHashBase::FindSlotByIndex(unsigned hash, unsigned index) const
+{
+    unsigned mask = numSlots_ - 1;
+    unsigned pos = HomeSlot(hash);
+
+    while (slots_[pos].index_ != index)
+        pos = (pos + 1) & mask;
+
+    return pos;
+}
+
+}
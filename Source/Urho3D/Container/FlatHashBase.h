@@ -0,0 +1,117 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#ifdef URHO3D_IS_BUILDING
+#include "Urho3D.h"
+#else
+#include <Urho3D/Urho3D.h>
+#endif
+
+#include "../Container/Hash.h"
+#include "../Container/Swap.h"
+
+namespace Urho3D
+{
+
+/// Open addressing hash table slot. Refers to an element in the dense element array.
+struct FlatHashSlot
+{
+    /// Scrambled hash of the key.
+    unsigned hash_;
+    /// Index of the element, or FlatHashBase::EMPTY_SLOT if unused.
+    unsigned index_;
+};
+
+/// Flat hash set/map base class. Manages the open addressing (robin hood) index table, while the derived classes store the elements contiguously in insertion order.
+/** Note that to prevent extra memory use due to vtable pointer, %FlatHashBase intentionally does not declare a virtual destructor
+    and therefore %FlatHashBase pointers should never be used.
+  */
+class URHO3D_API FlatHashBase
+{
+public:
+    /// Initial amount of slots.
+    static const unsigned MIN_SLOTS = 8;
+    /// Slot index value to denote an unused slot.
+    static const unsigned EMPTY_SLOT = 0xffffffff;
+
+    /// Construct.
+    FlatHashBase() :
+        slots_(0),
+        numSlots_(0),
+        shift_(32)
+    {
+    }
+
+    /// Copy-construct.
+    FlatHashBase(const FlatHashBase& rhs);
+
+    /// Destruct.
+    ~FlatHashBase() { delete[] slots_; }
+
+    /// Assign.
+    FlatHashBase& operator =(const FlatHashBase& rhs);
+
+    /// Swap with another flat hash set or map.
+    void Swap(FlatHashBase& rhs)
+    {
+        Urho3D::Swap(slots_, rhs.slots_);
+        Urho3D::Swap(numSlots_, rhs.numSlots_);
+        Urho3D::Swap(shift_, rhs.shift_);
+    }
+
+    /// Return number of slots in the index table.
+    unsigned NumSlots() const { return numSlots_; }
+
+protected:
+    /// Scramble a key hash so that sequential keys and aligned pointers spread over the table. The operation is a bijection, so equal scrambled hashes mean equal original hashes.
+    static unsigned ScrambleHash(unsigned hash) { return hash * 0x9e3779b9; }
+
+    /// Return the home slot of a scrambled hash.
+    unsigned HomeSlot(unsigned hash) const { return hash >> shift_; }
+
+    /// Return how far a slot is from the home slot of the hash it contains.
+    unsigned ProbeDistance(unsigned hash, unsigned pos) const { return (pos - HomeSlot(hash)) & (numSlots_ - 1); }
+
+    /// Ensure the index table can hold the specified number of elements without exceeding the maximum load factor.
+    void ReserveSlots(unsigned size);
+    /// Resize the index table to a power of two slot count and reinsert the existing slots.
+    void ResizeSlots(unsigned numSlots);
+    /// Mark all slots unused. The table is not deallocated.
+    void ResetSlots();
+    /// Insert an element index. The key must not already exist in the table.
+    void InsertSlot(unsigned hash, unsigned index);
+    /// Erase a slot and shift the following displaced slots back.
+    void EraseSlot(unsigned pos);
+    /// Find the slot that refers to an element index. The element must exist in the table.
+    unsigned FindSlotByIndex(unsigned hash, unsigned index) const;
+
+    /// Index table.
+    FlatHashSlot* slots_;
+    /// Number of slots, always zero or a power of two.
+    unsigned numSlots_;
+    /// Shift to get the home slot from the upper bits of a scrambled hash.
+    unsigned shift_;
+};
+
+}
@@ -0,0 +1,334 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/FlatHashBase.h"
+#include "../Container/Pair.h"
+#include "../Container/Sort.h"
+#include "../Container/Vector.h"
+
+#include <cassert>
+
+namespace Urho3D
+{
+
+/// Hash map template class using open addressing. Key-value pairs are stored contiguously in insertion order, which makes finding and iterating faster than with HashMap, at the expense of invalidating pointers and iterators on insertion. Erasing moves the last pair into the erased pair's place.
+template <class T, class U> class FlatHashMap : public FlatHashBase
+{
+public:
+    typedef T KeyType;
+    typedef U ValueType;
+
+    /// Hash map key-value pair. The key is not const as the pairs are moved when erasing, but it must not be modified through an iterator.
+    class KeyValue
+    {
+    public:
+        /// Construct with default key.
+        KeyValue() :
+            first_(T())
+        {
+        }
+
+        /// Construct with key and value.
+        KeyValue(const T& first, const U& second) :
+            first_(first),
+            second_(second)
+        {
+        }
+
+        /// Test for equality with another pair.
+        bool operator ==(const KeyValue& rhs) const { return first_ == rhs.first_ && second_ == rhs.second_; }
+
+        /// Test for inequality with another pair.
+        bool operator !=(const KeyValue& rhs) const { return first_ != rhs.first_ || second_ != rhs.second_; }
+
+        /// Key.
+        T first_;
+        /// Value.
+        U second_;
+    };
+
+    typedef RandomAccessIterator<KeyValue> Iterator;
+    typedef RandomAccessConstIterator<KeyValue> ConstIterator;
+
+    /// Construct empty.
+    FlatHashMap()
+    {
+    }
+
+    /// Add-assign a pair.
+    FlatHashMap& operator +=(const Pair<T, U>& rhs)
+    {
+        Insert(rhs);
+        return *this;
+    }
+
+    /// Add-assign a hash map.
+    FlatHashMap& operator +=(const FlatHashMap<T, U>& rhs)
+    {
+        Insert(rhs);
+        return *this;
+    }
+
+    /// Test for equality with another hash map.
+    bool operator ==(const FlatHashMap<T, U>& rhs) const
+    {
+        if (rhs.Size() != Size())
+            return false;
+
+        for (ConstIterator i = Begin(); i != End(); ++i)
+        {
+            ConstIterator j = rhs.Find(i->first_);
+            if (j == rhs.End() || j->second_ != i->second_)
+                return false;
+        }
+
+        return true;
+    }
+
+    /// Test for inequality with another hash map.
+    bool operator !=(const FlatHashMap<T, U>& rhs) const { return !(*this == rhs); }
+
+    /// Index the map. Create a new pair if key not found.
+    U& operator [](const T& key)
+    {
+        unsigned hash = HashKey(key);
+        unsigned pos = FindSlot(key, hash);
+        return entries_[pos != EMPTY_SLOT ? slots_[pos].index_ : InsertEntry(key, U(), hash)].second_;
+    }
+
+    /// Index the map. Return null if key is not found, does not create a new pair.
+    U* operator [](const T& key) const
+    {
+        unsigned pos = FindSlot(key, HashKey(key));
+        return pos != EMPTY_SLOT ? const_cast<U*>(&entries_[slots_[pos].index_].second_) : 0;
+    }
+
+    /// Insert a pair. Return an iterator to it.
+    Iterator Insert(const Pair<T, U>& pair)
+    {
+        unsigned hash = HashKey(pair.first_);
+        unsigned pos = FindSlot(pair.first_, hash);
+        if (pos != EMPTY_SLOT)
+        {
+            // If exists, just change the value
+            unsigned index = slots_[pos].index_;
+            entries_[index].second_ = pair.second_;
+            return entries_.Begin() + index;
+        }
+
+        return entries_.Begin() + InsertEntry(pair.first_, pair.second_, hash);
+    }
+
+    /// Insert a map.
+    void Insert(const FlatHashMap<T, U>& map)
+    {
+        Reserve(Size() + map.Size());
+        for (ConstIterator i = map.Begin(); i != map.End(); ++i)
+            Insert(MakePair(i->first_, i->second_));
+    }
+
+    /// Erase a pair by key. Return true if was found.
+    bool Erase(const T& key)
+    {
+        unsigned pos = FindSlot(key, HashKey(key));
+        if (pos == EMPTY_SLOT)
+            return false;
+
+        EraseEntry(pos);
+        return true;
+    }
+
+    /// Erase a pair by iterator. Return iterator to the next pair, which is the former last pair moved into its place.
+    Iterator Erase(const Iterator& it)
+    {
+        unsigned index = (unsigned)(it - entries_.Begin());
+        if (index >= entries_.Size())
+            return End();
+
+        EraseEntry(FindSlotByIndex(HashKey(it->first_), index));
+        return entries_.Begin() + index;
+    }
+
+    /// Clear the map. The index table and element storage are retained for reuse.
+    void Clear()
+    {
+        entries_.Clear();
+        ResetSlots();
+    }
+
+    /// Reserve room for the specified number of pairs.
+    void Reserve(unsigned size)
+    {
+        entries_.Reserve(size);
+        ReserveSlots(size);
+    }
+
+    /// Sort pairs. After sorting the map can be iterated in order until new elements are inserted or erased.
+    void Sort()
+    {
+        Urho3D::Sort(entries_.Begin(), entries_.End(), CompareEntries);
+        RebuildSlots();
+    }
+
+    /// Swap with another hash map.
+    void Swap(FlatHashMap<T, U>& rhs)
+    {
+        FlatHashBase::Swap(rhs);
+        entries_.Swap(rhs.entries_);
+    }
+
+    /// Return iterator to the pair with key, or end iterator if not found.
+    Iterator Find(const T& key)
+    {
+        unsigned pos = FindSlot(key, HashKey(key));
+        return pos != EMPTY_SLOT ? entries_.Begin() + slots_[pos].index_ : End();
+    }
+
+    /// Return const iterator to the pair with key, or end iterator if not found.
+    ConstIterator Find(const T& key) const
+    {
+        unsigned pos = FindSlot(key, HashKey(key));
+        return pos != EMPTY_SLOT ? entries_.Begin() + slots_[pos].index_ : End();
+    }
+
+    /// Return whether contains a pair with key.
+    bool Contains(const T& key) const { return FindSlot(key, HashKey(key)) != EMPTY_SLOT; }
+
+    /// Return all the keys.
+    Vector<T> Keys() const
+    {
+        Vector<T> result;
+        result.Reserve(Size());
+        for (ConstIterator i = Begin(); i != End(); ++i)
+            result.Push(i->first_);
+        return result;
+    }
+
+    /// Return all the values.
+    Vector<U> Values() const
+    {
+        Vector<U> result;
+        result.Reserve(Size());
+        for (ConstIterator i = Begin(); i != End(); ++i)
+            result.Push(i->second_);
+        return result;
+    }
+
+    /// Return iterator to the beginning.
+    Iterator Begin() { return entries_.Begin(); }
+
+    /// Return iterator to the beginning.
+    ConstIterator Begin() const { return entries_.Begin(); }
+
+    /// Return iterator to the end.
+    Iterator End() { return entries_.End(); }
+
+    /// Return iterator to the end.
+    ConstIterator End() const { return entries_.End(); }
+
+    /// Return number of pairs.
+    unsigned Size() const { return entries_.Size(); }
+
+    /// Return whether has no pairs.
+    bool Empty() const { return entries_.Empty(); }
+
+private:
+    /// Return the scrambled hash of a key.
+    static unsigned HashKey(const T& key) { return ScrambleHash(MakeHash(key)); }
+
+    /// Find the slot of a key, or EMPTY_SLOT if not found.
+    unsigned FindSlot(const T& key, unsigned hash) const
+    {
+        if (!numSlots_)
+            return EMPTY_SLOT;
+
+        unsigned mask = numSlots_ - 1;
+        unsigned pos = HomeSlot(hash);
+        for (unsigned distance = 0;; ++distance)
+        {
+            const FlatHashSlot& slot = slots_[pos];
+            // The key can not be further from its home slot than the entry in the way, due to robin hood ordering
+            if (slot.index_ == EMPTY_SLOT || ProbeDistance(slot.hash_, pos) < distance)
+                return EMPTY_SLOT;
+            if (slot.hash_ == hash && entries_[slot.index_].first_ == key)
+                return pos;
+            pos = (pos + 1) & mask;
+        }
+    }
+
+    /// Append a new pair and return its index. The key must not already exist.
+    unsigned InsertEntry(const T& key, const U& value, unsigned hash)
+    {
+        unsigned index = entries_.Size();
+        ReserveSlots(index + 1);
+        InsertSlot(hash, index);
+        entries_.Push(KeyValue(key, value));
+        return index;
+    }
+
+    /// Erase the pair referred to by a slot, moving the last pair into its place.
+    void EraseEntry(unsigned pos)
+    {
+        unsigned index = slots_[pos].index_;
+        unsigned last = entries_.Size() - 1;
+        EraseSlot(pos);
+
+        if (index != last)
+        {
+            slots_[FindSlotByIndex(HashKey(entries_[last].first_), last)].index_ = index;
+            entries_[index] = entries_[last];
+        }
+
+        entries_.Pop();
+    }
+
+    /// Rebuild the index table after the pairs have been reordered.
+    void RebuildSlots()
+    {
+        ResetSlots();
+        for (unsigned i = 0; i < entries_.Size(); ++i)
+            InsertSlot(HashKey(entries_[i].first_), i);
+    }
+
+    /// Compare two pairs.
+    static bool CompareEntries(const KeyValue& lhs, const KeyValue& rhs) { return lhs.first_ < rhs.first_; }
+
+    /// Key-value pairs.
+    Vector<KeyValue> entries_;
+};
+
+}
+
+namespace std
+{
+
+template <class T, class U> typename Urho3D::FlatHashMap<T, U>::ConstIterator begin(const Urho3D::FlatHashMap<T, U>& v) { return v.Begin(); }
+
+template <class T, class U> typename Urho3D::FlatHashMap<T, U>::ConstIterator end(const Urho3D::FlatHashMap<T, U>& v) { return v.End(); }
+
+template <class T, class U> typename Urho3D::FlatHashMap<T, U>::Iterator begin(Urho3D::FlatHashMap<T, U>& v) { return v.Begin(); }
+
+template <class T, class U> typename Urho3D::FlatHashMap<T, U>::Iterator end(Urho3D::FlatHashMap<T, U>& v) { return v.End(); }
+
+}
@@ -0,0 +1,239 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/FlatHashBase.h"
+#include "../Container/Sort.h"
+#include "../Container/Vector.h"
+
+#include <cassert>
+
+namespace Urho3D
+{
+
+/// Hash set template class using open addressing. Keys are stored contiguously in insertion order, which makes finding and iterating faster than with HashSet, at the expense of invalidating pointers and iterators on insertion. Erasing moves the last key into the erased key's place.
+template <class T> class FlatHashSet : public FlatHashBase
+{
+public:
+    typedef T KeyType;
+
+    /// Keys must not be modified through an iterator, so only const iteration is provided.
+    typedef RandomAccessConstIterator<T> ConstIterator;
+    typedef RandomAccessConstIterator<T> Iterator;
+
+    /// Construct empty.
+    FlatHashSet()
+    {
+    }
+
+    /// Add-assign a key.
+    FlatHashSet& operator +=(const T& rhs)
+    {
+        Insert(rhs);
+        return *this;
+    }
+
+    /// Add-assign a hash set.
+    FlatHashSet& operator +=(const FlatHashSet<T>& rhs)
+    {
+        Insert(rhs);
+        return *this;
+    }
+
+    /// Test for equality with another hash set.
+    bool operator ==(const FlatHashSet<T>& rhs) const
+    {
+        if (rhs.Size() != Size())
+            return false;
+
+        for (ConstIterator i = Begin(); i != End(); ++i)
+        {
+            if (!rhs.Contains(*i))
+                return false;
+        }
+
+        return true;
+    }
+
+    /// Test for inequality with another hash set.
+    bool operator !=(const FlatHashSet<T>& rhs) const { return !(*this == rhs); }
+
+    /// Insert a key. Return an iterator to it.
+    Iterator Insert(const T& key)
+    {
+        unsigned hash = HashKey(key);
+        unsigned pos = FindSlot(key, hash);
+        if (pos != EMPTY_SLOT)
+            return Begin() + slots_[pos].index_;
+
+        unsigned index = keys_.Size();
+        ReserveSlots(index + 1);
+        InsertSlot(hash, index);
+        keys_.Push(key);
+        return Begin() + index;
+    }
+
+    /// Insert a key. Return an iterator and set exists flag according to whether the key already existed.
+    Iterator Insert(const T& key, bool& exists)
+    {
+        unsigned oldSize = Size();
+        Iterator ret = Insert(key);
+        exists = (Size() == oldSize);
+        return ret;
+    }
+
+    /// Insert a set.
+    void Insert(const FlatHashSet<T>& set)
+    {
+        Reserve(Size() + set.Size());
+        for (ConstIterator i = set.Begin(); i != set.End(); ++i)
+            Insert(*i);
+    }
+
+    /// Erase a key. Return true if was found.
+    bool Erase(const T& key)
+    {
+        unsigned pos = FindSlot(key, HashKey(key));
+        if (pos == EMPTY_SLOT)
+            return false;
+
+        EraseEntry(pos);
+        return true;
+    }
+
+    /// Erase a key by iterator. Return iterator to the next key, which is the former last key moved into its place.
+    Iterator Erase(const Iterator& it)
+    {
+        unsigned index = (unsigned)(it - Begin());
+        if (index >= keys_.Size())
+            return End();
+
+        EraseEntry(FindSlotByIndex(HashKey(*it), index));
+        return Begin() + index;
+    }
+
+    /// Clear the set. The index table and element storage are retained for reuse.
+    void Clear()
+    {
+        keys_.Clear();
+        ResetSlots();
+    }
+
+    /// Reserve room for the specified number of keys.
+    void Reserve(unsigned size)
+    {
+        keys_.Reserve(size);
+        ReserveSlots(size);
+    }
+
+    /// Sort keys. After sorting the set can be iterated in order until new elements are inserted or erased.
+    void Sort()
+    {
+        Urho3D::Sort(keys_.Begin(), keys_.End());
+        ResetSlots();
+        for (unsigned i = 0; i < keys_.Size(); ++i)
+            InsertSlot(HashKey(keys_[i]), i);
+    }
+
+    /// Swap with another hash set.
+    void Swap(FlatHashSet<T>& rhs)
+    {
+        FlatHashBase::Swap(rhs);
+        keys_.Swap(rhs.keys_);
+    }
+
+    /// Return iterator to the key, or end iterator if not found.
+    ConstIterator Find(const T& key) const
+    {
+        unsigned pos = FindSlot(key, HashKey(key));
+        return pos != EMPTY_SLOT ? Begin() + slots_[pos].index_ : End();
+    }
+
+    /// Return whether contains a key.
+    bool Contains(const T& key) const { return FindSlot(key, HashKey(key)) != EMPTY_SLOT; }
+
+    /// Return iterator to the beginning.
+    ConstIterator Begin() const { return keys_.Begin(); }
+
+    /// Return iterator to the end.
+    ConstIterator End() const { return keys_.End(); }
+
+    /// Return number of keys.
+    unsigned Size() const { return keys_.Size(); }
+
+    /// Return whether has no keys.
+    bool Empty() const { return keys_.Empty(); }
+
+private:
+    /// Return the scrambled hash of a key.
+    static unsigned HashKey(const T& key) { return ScrambleHash(MakeHash(key)); }
+
+    /// Find the slot of a key, or EMPTY_SLOT if not found.
+    unsigned FindSlot(const T& key, unsigned hash) const
+    {
+        if (!numSlots_)
+            return EMPTY_SLOT;
+
+        unsigned mask = numSlots_ - 1;
+        unsigned pos = HomeSlot(hash);
+        for (unsigned distance = 0;; ++distance)
+        {
+            const FlatHashSlot& slot = slots_[pos];
+            if (slot.index_ == EMPTY_SLOT || ProbeDistance(slot.hash_, pos) < distance)
+                return EMPTY_SLOT;
+            if (slot.hash_ == hash && keys_[slot.index_] == key)
+                return pos;
+            pos = (pos + 1) & mask;
+        }
+    }
+
+    /// Erase the key referred to by a slot, moving the last key into its place.
+    void EraseEntry(unsigned pos)
+    {
+        unsigned index = slots_[pos].index_;
+        unsigned last = keys_.Size() - 1;
+        EraseSlot(pos);
+
+        if (index != last)
+        {
+            slots_[FindSlotByIndex(HashKey(keys_[last]), last)].index_ = index;
+            keys_[index] = keys_[last];
+        }
+
+        keys_.Pop();
+    }
+
+    /// Keys.
+    Vector<T> keys_;
+};
+
+}
+
+namespace std
+{
+
+template <class T> typename Urho3D::FlatHashSet<T>::ConstIterator begin(const Urho3D::FlatHashSet<T>& v) { return v.Begin(); }
+
+template <class T> typename Urho3D::FlatHashSet<T>::ConstIterator end(const Urho3D::FlatHashSet<T>& v) { return v.End(); }
+
+}
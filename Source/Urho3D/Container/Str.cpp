@@ -164,7 +164,7 @@ String::String(char value) :
     buffer_(&endZero)
 {
     Resize(1);
-    buffer_[0] = value;
+    Buffer()[0] = value;
 }
 
 String::String(char value, unsigned length) :
@@ -174,7 +174,7 @@ String::String(char value, unsigned length) :
 {
     Resize(length);
     for (unsigned i = 0; i < length; ++i)
-        buffer_[i] = value;
+        Buffer()[i] = value;
 }
 
 String& String::operator +=(int rhs)
@@ -233,8 +233,8 @@ void String::Replace(char replaceThis, char replaceWith, bool caseSensitive)
     {
         for (unsigned i = 0; i < length_; ++i)
         {
-            if (buffer_[i] == replaceThis)
-                buffer_[i] = replaceWith;
+            if (Buffer()[i] == replaceThis)
+                Buffer()[i] = replaceWith;
         }
     }
     else
@@ -242,8 +242,8 @@ void String::Replace(char replaceThis, char replaceWith, bool caseSensitive)
         replaceThis = (char)tolower(replaceThis);
         for (unsigned i = 0; i < length_; ++i)
         {
-            if (tolower(buffer_[i]) == replaceThis)
-                buffer_[i] = replaceWith;
+            if (tolower(Buffer()[i]) == replaceThis)
+                Buffer()[i] = replaceWith;
         }
     }
 }
@@ -268,7 +268,7 @@ void String::Replace(unsigned pos, unsigned length, const String& replaceWith)
     if (pos + length > length_)
         return;
 
-    Replace(pos, length, replaceWith.buffer_, replaceWith.length_);
+    Replace(pos, length, replaceWith.Buffer(), replaceWith.length_);
 }
 
 void String::Replace(unsigned pos, unsigned length, const char* replaceWith)
@@ -326,7 +326,7 @@ String& String::Append(const char* str, unsigned length)
     {
         unsigned oldLength = length_;
         Resize(oldLength + length);
-        CopyChars(&buffer_[oldLength], str, length);
+        CopyChars(&Buffer()[oldLength], str, length);
     }
     return *this;
 }
@@ -354,7 +354,7 @@ void String::Insert(unsigned pos, char c)
         unsigned oldLength = length_;
         Resize(length_ + 1);
         MoveRange(pos + 1, pos, oldLength - pos);
-        buffer_[pos] = c;
+        Buffer()[pos] = c;
     }
 }
 
@@ -423,17 +423,26 @@ void String::Resize(unsigned newLength)
         if (!newLength)
             return;
 
-        // Calculate initial capacity
-        capacity_ = newLength + 1;
-        if (capacity_ < MIN_CAPACITY)
-            capacity_ = MIN_CAPACITY;
+        // Short strings fit in the local buffer without allocating
+        if (newLength + 1 <= LOCAL_CAPACITY)
+            capacity_ = LOCAL_CAPACITY;
+        else
+        {
+            // Calculate initial capacity
+            capacity_ = newLength + 1;
+            if (capacity_ < MIN_CAPACITY)
+                capacity_ = MIN_CAPACITY;
 
-        buffer_ = new char[capacity_];
+            buffer_ = new char[capacity_];
+        }
     }
     else
     {
         if (newLength && capacity_ < newLength + 1)
         {
+            char* oldBuffer = Buffer();
+            bool wasLocal = capacity_ == LOCAL_CAPACITY;
+
             // Increase the capacity with half each time it is exceeded
             while (capacity_ < newLength + 1)
                 capacity_ += (capacity_ + 1) >> 1;
@@ -441,14 +450,15 @@ void String::Resize(unsigned newLength)
             char* newBuffer = new char[capacity_];
             // Move the existing data to the new buffer, then delete the old buffer
             if (length_)
-                CopyChars(newBuffer, buffer_, length_);
-            delete[] buffer_;
+                CopyChars(newBuffer, oldBuffer, length_);
+            if (!wasLocal)
+                delete[] oldBuffer;
 
             buffer_ = newBuffer;
         }
     }
 
-    buffer_[newLength] = 0;
+    Buffer()[newLength] = 0;
     length_ = newLength;
 }
 
@@ -456,17 +466,31 @@ void String::Reserve(unsigned newCapacity)
 {
     if (newCapacity < length_ + 1)
         newCapacity = length_ + 1;
+    if (newCapacity <= LOCAL_CAPACITY)
+        newCapacity = LOCAL_CAPACITY;
     if (newCapacity == capacity_)
         return;
 
-    char* newBuffer = new char[newCapacity];
-    // Move the existing data to the new buffer, then delete the old buffer
-    CopyChars(newBuffer, buffer_, length_ + 1);
-    if (capacity_)
-        delete[] buffer_;
+    char* oldBuffer = Buffer();
+    bool wasAllocated = capacity_ > LOCAL_CAPACITY;
 
-    capacity_ = newCapacity;
-    buffer_ = newBuffer;
+    if (newCapacity == LOCAL_CAPACITY)
+    {
+        // Move the existing data to the local buffer. The old buffer is always on the heap at this point
+        capacity_ = newCapacity;
+        CopyChars(localBuffer_, oldBuffer, length_ + 1);
+    }
+    else
+    {
+        char* newBuffer = new char[newCapacity];
+        // Move the existing data to the new buffer
+        CopyChars(newBuffer, oldBuffer, length_ + 1);
+        capacity_ = newCapacity;
+        buffer_ = newBuffer;
+    }
+
+    if (wasAllocated)
+        delete[] oldBuffer;
 }
 
 void String::Compact()
@@ -482,9 +506,14 @@ void String::Clear()
 
 void String::Swap(String& str)
 {
+    // The local buffers are part of the union, so swapping it as raw bytes swaps either the heap pointers or the local contents
+    char temp[LOCAL_CAPACITY];
+    memcpy(temp, localBuffer_, LOCAL_CAPACITY);
+    memcpy(localBuffer_, str.localBuffer_, LOCAL_CAPACITY);
+    memcpy(str.localBuffer_, temp, LOCAL_CAPACITY);
+
     Urho3D::Swap(length_, str.length_);
     Urho3D::Swap(capacity_, str.capacity_);
-    Urho3D::Swap(buffer_, str.buffer_);
 }
 
 String String::Substring(unsigned pos) const
@@ -493,7 +522,7 @@ String String::Substring(unsigned pos) const
     {
         String ret;
         ret.Resize(length_ - pos);
-        CopyChars(ret.buffer_, buffer_ + pos, ret.length_);
+        CopyChars(ret.Buffer(), Buffer() + pos, ret.length_);
 
         return ret;
     }
@@ -509,7 +538,7 @@ String String::Substring(unsigned pos, unsigned length) const
         if (pos + length > length_)
             length = length_ - pos;
         ret.Resize(length);
-        CopyChars(ret.buffer_, buffer_ + pos, ret.length_);
+        CopyChars(ret.Buffer(), Buffer() + pos, ret.length_);
 
         return ret;
     }
@@ -524,14 +553,14 @@ String String::Trimmed() const
 
     while (trimStart < trimEnd)
     {
-        char c = buffer_[trimStart];
+        char c = Buffer()[trimStart];
         if (c != ' ' && c != 9)
             break;
         ++trimStart;
     }
     while (trimEnd > trimStart)
     {
-        char c = buffer_[trimEnd - 1];
+        char c = Buffer()[trimEnd - 1];
         if (c != ' ' && c != 9)
             break;
         --trimEnd;
@@ -544,7 +573,7 @@ String String::ToLower() const
 {
     String ret(*this);
     for (unsigned i = 0; i < ret.length_; ++i)
-        ret[i] = (char)tolower(buffer_[i]);
+        ret[i] = (char)tolower(Buffer()[i]);
 
     return ret;
 }
@@ -553,7 +582,7 @@ String String::ToUpper() const
 {
     String ret(*this);
     for (unsigned i = 0; i < ret.length_; ++i)
-        ret[i] = (char)toupper(buffer_[i]);
+        ret[i] = (char)toupper(Buffer()[i]);
 
     return ret;
 }
@@ -574,7 +603,7 @@ unsigned String::Find(char c, unsigned startPos, bool caseSensitive) const
     {
         for (unsigned i = startPos; i < length_; ++i)
         {
-            if (buffer_[i] == c)
+            if (Buffer()[i] == c)
                 return i;
         }
     }
@@ -583,7 +612,7 @@ unsigned String::Find(char c, unsigned startPos, bool caseSensitive) const
         c = (char)tolower(c);
         for (unsigned i = startPos; i < length_; ++i)
         {
-            if (tolower(buffer_[i]) == c)
+            if (tolower(Buffer()[i]) == c)
                 return i;
         }
     }
@@ -596,13 +625,13 @@ unsigned String::Find(const String& str, unsigned startPos, bool caseSensitive)
     if (!str.length_ || str.length_ > length_)
         return NPOS;
 
-    char first = str.buffer_[0];
+    char first = str.Buffer()[0];
     if (!caseSensitive)
         first = (char)tolower(first);
 
     for (unsigned i = startPos; i <= length_ - str.length_; ++i)
     {
-        char c = buffer_[i];
+        char c = Buffer()[i];
         if (!caseSensitive)
             c = (char)tolower(c);
 
@@ -612,8 +641,8 @@ unsigned String::Find(const String& str, unsigned startPos, bool caseSensitive)
             bool found = true;
             for (unsigned j = 1; j < str.length_; ++j)
             {
-                c = buffer_[i + j];
-                char d = str.buffer_[j];
+                c = Buffer()[i + j];
+                char d = str.Buffer()[j];
                 if (!caseSensitive)
                 {
                     c = (char)tolower(c);
@@ -648,7 +677,7 @@ unsigned String::FindLast(char c, unsigned startPos, bool caseSensitive) const
     {
         for (unsigned i = startPos; i < length_; --i)
         {
-            if (buffer_[i] == c)
+            if (Buffer()[i] == c)
                 return i;
         }
     }
@@ -657,7 +686,7 @@ unsigned String::FindLast(char c, unsigned startPos, bool caseSensitive) const
         c = (char)tolower(c);
         for (unsigned i = startPos; i < length_; --i)
         {
-            if (tolower(buffer_[i]) == c)
+            if (tolower(Buffer()[i]) == c)
                 return i;
         }
     }
@@ -672,13 +701,13 @@ unsigned String::FindLast(const String& str, unsigned startPos, bool caseSensiti
     if (startPos > length_ - str.length_)
         startPos = length_ - str.length_;
 
-    char first = str.buffer_[0];
+    char first = str.Buffer()[0];
     if (!caseSensitive)
         first = (char)tolower(first);
 
     for (unsigned i = startPos; i < length_; --i)
     {
-        char c = buffer_[i];
+        char c = Buffer()[i];
         if (!caseSensitive)
             c = (char)tolower(c);
 
@@ -687,8 +716,8 @@ unsigned String::FindLast(const String& str, unsigned startPos, bool caseSensiti
             bool found = true;
             for (unsigned j = 1; j < str.length_; ++j)
             {
-                c = buffer_[i + j];
-                char d = str.buffer_[j];
+                c = Buffer()[i + j];
+                char d = str.Buffer()[j];
                 if (!caseSensitive)
                 {
                     c = (char)tolower(c);
@@ -781,10 +810,10 @@ unsigned String::LengthUTF8() const
 {
     unsigned ret = 0;
 
-    const char* src = buffer_;
+    const char* src = Buffer();
     if (!src)
         return ret;
-    const char* end = buffer_ + length_;
+    const char* end = Buffer() + length_;
 
     while (src < end)
     {
@@ -811,12 +840,12 @@ unsigned String::ByteOffsetUTF8(unsigned index) const
 
 unsigned String::NextUTF8Char(unsigned& byteOffset) const
 {
-    if (!buffer_)
+    if (!Buffer())
         return 0;
 
-    const char* src = buffer_ + byteOffset;
+    const char* src = Buffer() + byteOffset;
     unsigned ret = DecodeUTF8(src);
-    byteOffset = (unsigned)(src - buffer_);
+    byteOffset = (unsigned)(src - Buffer());
 
     return ret;
 }
@@ -1232,7 +1261,7 @@ void String::Replace(unsigned pos, unsigned length, const char* srcStart, unsign
     else
         Resize(length_ + delta);
 
-    CopyChars(buffer_ + pos, srcStart, srcLength);
+    CopyChars(Buffer() + pos, srcStart, srcLength);
 }
 
 WString::WString() :
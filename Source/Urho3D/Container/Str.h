@@ -85,7 +85,7 @@ public:
         buffer_(&endZero)
     {
         Resize(length);
-        CopyChars(buffer_, str, length);
+        CopyChars(Buffer(), str, length);
     }
 
     /// Construct from a null-terminated wide character array.
@@ -148,7 +148,7 @@ public:
     /// Destruct.
     ~String()
     {
-        if (capacity_)
+        if (capacity_ > LOCAL_CAPACITY)
             delete[] buffer_;
     }
 
@@ -156,7 +156,7 @@ public:
     String& operator =(const String& rhs)
     {
         Resize(rhs.length_);
-        CopyChars(buffer_, rhs.buffer_, rhs.length_);
+        CopyChars(Buffer(), rhs.Buffer(), rhs.length_);
 
         return *this;
     }
@@ -166,7 +166,7 @@ public:
     {
         unsigned rhsLength = CStringLength(rhs);
         Resize(rhsLength);
-        CopyChars(buffer_, rhs, rhsLength);
+        CopyChars(Buffer(), rhs, rhsLength);
 
         return *this;
     }
@@ -176,7 +176,7 @@ public:
     {
         unsigned oldLength = length_;
         Resize(length_ + rhs.length_);
-        CopyChars(buffer_ + oldLength, rhs.buffer_, rhs.length_);
+        CopyChars(Buffer() + oldLength, rhs.Buffer(), rhs.length_);
 
         return *this;
     }
@@ -187,7 +187,7 @@ public:
         unsigned rhsLength = CStringLength(rhs);
         unsigned oldLength = length_;
         Resize(length_ + rhsLength);
-        CopyChars(buffer_ + oldLength, rhs, rhsLength);
+        CopyChars(Buffer() + oldLength, rhs, rhsLength);
 
         return *this;
     }
@@ -197,7 +197,7 @@ public:
     {
         unsigned oldLength = length_;
         Resize(length_ + 1);
-        buffer_[oldLength] = rhs;
+        Buffer()[oldLength] = rhs;
 
         return *this;
     }
@@ -231,8 +231,8 @@ public:
     {
         String ret;
         ret.Resize(length_ + rhs.length_);
-        CopyChars(ret.buffer_, buffer_, length_);
-        CopyChars(ret.buffer_ + length_, rhs.buffer_, rhs.length_);
+        CopyChars(ret.Buffer(), Buffer(), length_);
+        CopyChars(ret.Buffer() + length_, rhs.Buffer(), rhs.length_);
 
         return ret;
     }
@@ -243,8 +243,8 @@ public:
         unsigned rhsLength = CStringLength(rhs);
         String ret;
         ret.Resize(length_ + rhsLength);
-        CopyChars(ret.buffer_, buffer_, length_);
-        CopyChars(ret.buffer_ + length_, rhs, rhsLength);
+        CopyChars(ret.Buffer(), Buffer(), length_);
+        CopyChars(ret.Buffer() + length_, rhs, rhsLength);
 
         return ret;
     }
@@ -286,28 +286,28 @@ public:
     char& operator [](unsigned index)
     {
         assert(index < length_);
-        return buffer_[index];
+        return Buffer()[index];
     }
 
     /// Return const char at index.
     const char& operator [](unsigned index) const
     {
         assert(index < length_);
-        return buffer_[index];
+        return Buffer()[index];
     }
 
     /// Return char at index.
     char& At(unsigned index)
     {
         assert(index < length_);
-        return buffer_[index];
+        return Buffer()[index];
     }
 
     /// Return const char at index.
     const char& At(unsigned index) const
     {
         assert(index < length_);
-        return buffer_[index];
+        return Buffer()[index];
     }
 
     /// Replace all occurrences of a character.
@@ -360,22 +360,22 @@ public:
     void Swap(String& str);
 
     /// Return iterator to the beginning.
-    Iterator Begin() { return Iterator(buffer_); }
+    Iterator Begin() { return Iterator(Buffer()); }
 
     /// Return const iterator to the beginning.
-    ConstIterator Begin() const { return ConstIterator(buffer_); }
+    ConstIterator Begin() const { return ConstIterator(Buffer()); }
 
     /// Return iterator to the end.
-    Iterator End() { return Iterator(buffer_ + length_); }
+    Iterator End() { return Iterator(Buffer() + length_); }
 
     /// Return const iterator to the end.
-    ConstIterator End() const { return ConstIterator(buffer_ + length_); }
+    ConstIterator End() const { return ConstIterator(Buffer() + length_); }
 
     /// Return first char, or 0 if empty.
-    char Front() const { return buffer_[0]; }
+    char Front() const { return Buffer()[0]; }
 
     /// Return last char, or 0 if empty.
-    char Back() const { return length_ ? buffer_[length_ - 1] : buffer_[0]; }
+    char Back() const { return length_ ? Buffer()[length_ - 1] : Buffer()[0]; }
 
     /// Return a substring from position to end.
     String Substring(unsigned pos) const;
@@ -405,7 +405,7 @@ public:
     bool EndsWith(const String& str, bool caseSensitive = true) const;
 
     /// Return the C string.
-    const char* CString() const { return buffer_; }
+    const char* CString() const { return Buffer(); }
 
     /// Return length.
     unsigned Length() const { return length_; }
@@ -452,7 +452,7 @@ public:
     unsigned ToHash() const
     {
         unsigned hash = 0;
-        const char* ptr = buffer_;
+        const char* ptr = Buffer();
         while (*ptr)
         {
             hash = *ptr + (hash << 6) + (hash << 16) - hash;
@@ -504,15 +504,20 @@ public:
     static const unsigned NPOS = 0xffffffff;
     /// Initial dynamic allocation size.
     static const unsigned MIN_CAPACITY = 8;
+    /// Size of the local buffer for short strings, including the end zero. Kept small on 32-bit platforms so that a ResourceRef still fits in a Variant.
+    static const unsigned LOCAL_CAPACITY = sizeof(void*) >= 8 ? 16 : sizeof(void*);
     /// Empty string.
     static const String EMPTY;
 
 private:
+    /// Return the character buffer, which is either the local buffer, a heap buffer or the end zero.
+    char* Buffer() const { return capacity_ == LOCAL_CAPACITY ? const_cast<char*>(localBuffer_) : buffer_; }
+
     /// Move a range of characters within the string.
     void MoveRange(unsigned dest, unsigned src, unsigned count)
     {
         if (count)
-            memmove(buffer_ + dest, buffer_ + src, count);
+            memmove(Buffer() + dest, Buffer() + src, count);
     }
 
     /// Copy chars from one buffer to another.
@@ -537,10 +542,15 @@ private:
 
     /// String length.
     unsigned length_;
-    /// Capacity, zero if buffer not allocated.
+    /// Capacity, zero if buffer not allocated, or LOCAL_CAPACITY if the local buffer is in use.
     unsigned capacity_;
-    /// String buffer, null if not allocated.
-    char* buffer_;
+    union
+    {
+        /// Heap-allocated string buffer, or the end zero if not allocated.
+        char* buffer_;
+        /// Local buffer for short strings. No pointer to it is stored, so strings can still be moved with a block memory copy, as script arrays do.
+        char localBuffer_[LOCAL_CAPACITY];
+    };
 
     /// End zero for empty strings.
     static char endZero;
@@ -49,6 +49,64 @@ static const unsigned AM_NODEIDVECTOR = 0x40;
 
 class Serializable;
 
+/// Network replication encoding of an attribute value.
+enum NetworkEncodingType
+{
+    /// Full precision variant data.
+    NE_DEFAULT = 0,
+    /// Float, Vector2, Vector3 or Vector4 components quantized to a range.
+    NE_QUANTIZED,
+    /// Rotation quaternion sent as its three smallest components.
+    NE_SMALLESTTHREE,
+    /// Bool, enum or non-negative int packed into a fixed number of bits.
+    NE_BITS,
+    /// Int sent as a zigzag encoded variable-length value.
+    NE_VARINT
+};
+
+/// Network replication encoding parameters of an attribute.
+struct NetworkEncoding
+{
+    /// Construct as full precision.
+    NetworkEncoding() :
+        type_(NE_DEFAULT),
+        min_(0.0f),
+        max_(0.0f),
+        numBits_(0)
+    {
+    }
+
+    /// Construct with type and number of bits. Zero bits uses 12 bits per component for smallest-three quaternions, and the bool or enum value range for bit-packed values.
+    NetworkEncoding(NetworkEncodingType type, unsigned numBits = 0) :
+        type_(type),
+        min_(0.0f),
+        max_(0.0f),
+        numBits_(numBits)
+    {
+    }
+
+    /// Construct quantized with value range and the largest allowed error. Uses at most 24 bits per component.
+    NetworkEncoding(float min, float max, float precision) :
+        type_(NE_QUANTIZED),
+        min_(min),
+        max_(max),
+        numBits_(1)
+    {
+        float steps = precision > 0.0f ? (max - min) / precision : 16777215.0f;
+        while (numBits_ < 24 && (float)((1u << numBits_) - 1) < steps)
+            ++numBits_;
+    }
+
+    /// Encoding type.
+    NetworkEncodingType type_;
+    /// Minimum value for quantization.
+    float min_;
+    /// Maximum value for quantization.
+    float max_;
+    /// Number of bits per value or component.
+    unsigned numBits_;
+};
+
 /// Abstract base class for invoking attribute accessors.
 class URHO3D_API AttributeAccessor : public RefCounted
 {
@@ -76,6 +134,7 @@ struct AttributeInfo
     AttributeInfo(VariantType type, const char* name, size_t offset, const Variant& defaultValue, unsigned mode) :
         type_(type),
         name_(name),
+        nameHash_(name),
         offset_((unsigned)offset),
         enumNames_(0),
         defaultValue_(defaultValue),
@@ -88,6 +147,7 @@ struct AttributeInfo
     AttributeInfo(const char* name, size_t offset, const char** enumNames, const Variant& defaultValue, unsigned mode) :
         type_(VAR_INT),
         name_(name),
+        nameHash_(name),
         offset_((unsigned)offset),
         enumNames_(enumNames),
         defaultValue_(defaultValue),
@@ -100,6 +160,7 @@ struct AttributeInfo
     AttributeInfo(VariantType type, const char* name, AttributeAccessor* accessor, const Variant& defaultValue, unsigned mode) :
         type_(type),
         name_(name),
+        nameHash_(name),
         offset_(0),
         enumNames_(0),
         accessor_(accessor),
@@ -114,6 +175,7 @@ struct AttributeInfo
         unsigned mode) :
         type_(VAR_INT),
         name_(name),
+        nameHash_(name),
         offset_(0),
         enumNames_(enumNames),
         accessor_(accessor),
@@ -127,6 +189,8 @@ struct AttributeInfo
     VariantType type_;
     /// Name.
     String name_;
+    /// Name hash for lookup by name. Must be updated along with the name.
+    StringHash nameHash_;
     /// Byte offset from start of object.
     unsigned offset_;
     /// Enum names.
@@ -139,6 +203,8 @@ struct AttributeInfo
     unsigned mode_;
     /// Attribute data pointer if elsewhere than in the Serializable.
     void* ptr_;
+    /// Network replication encoding.
+    NetworkEncoding netEncoding_;
 };
 
 }
@@ -53,6 +53,70 @@ void RemoveNamedAttribute(HashMap<StringHash, Vector<AttributeInfo> >& attribute
         attributes.Erase(i);
 }
 
+void SetNamedAttributeNetworkEncoding(HashMap<StringHash, Vector<AttributeInfo> >& attributes, StringHash objectType,
+    const char* name, const NetworkEncoding& encoding)
+{
+    HashMap<StringHash, Vector<AttributeInfo> >::Iterator i = attributes.Find(objectType);
+    if (i == attributes.End())
+        return;
+
+    Vector<AttributeInfo>& infos = i->second_;
+
+    for (Vector<AttributeInfo>::Iterator j = infos.Begin(); j != infos.End(); ++j)
+    {
+        if (!j->name_.Compare(name, true))
+        {
+            j->netEncoding_ = encoding;
+            break;
+        }
+    }
+}
+
+void EventReceiverGroup::EndSendEvent()
+{
+    assert(inSend_ > 0);
+    --inSend_;
+
+    if (inSend_ == 0 && dirty_)
+    {
+        // Compact the holes left by receivers removed during send in one pass, preserving order
+        unsigned j = 0;
+        for (unsigned i = 0; i < receivers_.Size(); ++i)
+        {
+            if (receivers_[i])
+                receivers_[j++] = receivers_[i];
+        }
+        receivers_.Resize(j);
+        dirty_ = false;
+    }
+}
+
+void EventReceiverGroup::Remove(Object* object)
+{
+    if (inSend_ > 0)
+    {
+        PODVector<Object*>::Iterator i = receivers_.Find(object);
+        if (i != receivers_.End())
+        {
+            (*i) = 0;
+            dirty_ = true;
+        }
+    }
+    else
+        receivers_.Remove(object);
+}
+
+bool EventReceiverGroup::Empty() const
+{
+    for (PODVector<Object*>::ConstIterator i = receivers_.Begin(); i != receivers_.End(); ++i)
+    {
+        if (*i)
+            return false;
+    }
+
+    return true;
+}
+
 Context::Context() :
     eventHandler_(0)
 {
@@ -155,6 +219,73 @@ void Context::UpdateAttributeDefaultValue(StringHash objectType, const char* nam
         info->defaultValue_ = defaultValue;
 }
 
+void Context::SetAttributeNetworkEncoding(StringHash objectType, const char* name, const NetworkEncoding& encoding)
+{
+    AttributeInfo* info = GetAttribute(objectType, name);
+    if (!info)
+        return;
+
+    NetworkEncoding finalEncoding = encoding;
+    bool supported = true;
+
+    switch (encoding.type_)
+    {
+    case NE_QUANTIZED:
+        supported = info->type_ == VAR_FLOAT || info->type_ == VAR_VECTOR2 || info->type_ == VAR_VECTOR3 ||
+            info->type_ == VAR_VECTOR4;
+        if (!finalEncoding.numBits_ || finalEncoding.numBits_ > 24)
+            finalEncoding.numBits_ = 24;
+        break;
+
+    case NE_SMALLESTTHREE:
+        supported = info->type_ == VAR_QUATERNION;
+        if (!finalEncoding.numBits_)
+            finalEncoding.numBits_ = 12;
+        else if (finalEncoding.numBits_ > 24)
+            finalEncoding.numBits_ = 24;
+        break;
+
+    case NE_BITS:
+        supported = info->type_ == VAR_BOOL || info->type_ == VAR_INT;
+        if (info->type_ == VAR_BOOL)
+            finalEncoding.numBits_ = 1;
+        else if (!encoding.numBits_)
+        {
+            // Derive the bit count from the enum value range
+            unsigned numValues = 0;
+            if (info->enumNames_)
+            {
+                while (info->enumNames_[numValues])
+                    ++numValues;
+            }
+            finalEncoding.numBits_ = 1;
+            while (finalEncoding.numBits_ < 32 && (1u << finalEncoding.numBits_) < numValues)
+                ++finalEncoding.numBits_;
+            supported = numValues > 0;
+        }
+        else if (finalEncoding.numBits_ > 32)
+            finalEncoding.numBits_ = 32;
+        break;
+
+    case NE_VARINT:
+        supported = info->type_ == VAR_INT;
+        break;
+
+    default:
+        break;
+    }
+
+    if (!supported)
+    {
+        URHO3D_LOGWARNING("Unsupported network encoding for attribute " + String(name) + " of type " +
+            Variant::GetTypeName(info->type_) + " in class " + GetTypeName(objectType));
+        return;
+    }
+
+    SetNamedAttributeNetworkEncoding(attributes_, objectType, name, finalEncoding);
+    SetNamedAttributeNetworkEncoding(networkAttributes_, objectType, name, finalEncoding);
+}
+
 VariantMap& Context::GetEventDataMap()
 {
     unsigned nestingLevel = eventSenders_.Size();
@@ -232,23 +363,33 @@ AttributeInfo* Context::GetAttribute(StringHash objectType, const char* name)
 
 void Context::AddEventReceiver(Object* receiver, StringHash eventType)
 {
-    eventReceivers_[eventType].Insert(receiver);
+    SharedPtr<EventReceiverGroup>& group = eventReceivers_[eventType];
+    if (!group)
+        group = new EventReceiverGroup();
+    group->Add(receiver);
 }
 
 void Context::AddEventReceiver(Object* receiver, Object* sender, StringHash eventType)
 {
-    specificEventReceivers_[sender][eventType].Insert(receiver);
+    SharedPtr<EventReceiverGroup>& group = specificEventReceivers_[sender][eventType];
+    if (!group)
+        group = new EventReceiverGroup();
+    group->Add(receiver);
 }
 
 void Context::RemoveEventSender(Object* sender)
 {
-    HashMap<Object*, HashMap<StringHash, HashSet<Object*> > >::Iterator i = specificEventReceivers_.Find(sender);
+    FlatHashMap<Object*, FlatHashMap<StringHash, SharedPtr<EventReceiverGroup> > >::Iterator i = specificEventReceivers_.Find(sender);
     if (i != specificEventReceivers_.End())
     {
-        for (HashMap<StringHash, HashSet<Object*> >::Iterator j = i->second_.Begin(); j != i->second_.End(); ++j)
+        for (FlatHashMap<StringHash, SharedPtr<EventReceiverGroup> >::Iterator j = i->second_.Begin(); j != i->second_.End(); ++j)
         {
-            for (HashSet<Object*>::Iterator k = j->second_.Begin(); k != j->second_.End(); ++k)
-                (*k)->RemoveEventSender(sender);
+            PODVector<Object*>& receivers = j->second_->receivers_;
+            for (PODVector<Object*>::Iterator k = receivers.Begin(); k != receivers.End(); ++k)
+            {
+                if (*k)
+                    (*k)->RemoveEventSender(sender);
+            }
         }
         specificEventReceivers_.Erase(i);
     }
@@ -256,16 +397,16 @@ void Context::RemoveEventSender(Object* sender)
 
 void Context::RemoveEventReceiver(Object* receiver, StringHash eventType)
 {
-    HashSet<Object*>* group = GetEventReceivers(eventType);
+    EventReceiverGroup* group = GetEventReceivers(eventType);
     if (group)
-        group->Erase(receiver);
+        group->Remove(receiver);
 }
 
 void Context::RemoveEventReceiver(Object* receiver, Object* sender, StringHash eventType)
 {
-    HashSet<Object*>* group = GetEventReceivers(sender, eventType);
+    EventReceiverGroup* group = GetEventReceivers(sender, eventType);
     if (group)
-        group->Erase(receiver);
+        group->Remove(receiver);
 }
 
 }
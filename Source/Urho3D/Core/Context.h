@@ -24,11 +24,51 @@
 
 #include "../Core/Attribute.h"
 #include "../Core/Object.h"
+#include "../Container/FlatHashMap.h"
 #include "../Container/HashSet.h"
 
 namespace Urho3D
 {
 
+/// Tracking structure for event receivers. Stored as a flat array so that sending an event does not need to walk a hash set. Receivers removed during sending leave null holes that are compacted once the outermost send finishes.
+class URHO3D_API EventReceiverGroup : public RefCounted
+{
+public:
+    /// Construct.
+    EventReceiverGroup() :
+        inSend_(0),
+        dirty_(false)
+    {
+    }
+
+    /// Begin event send. When receivers are removed during send, group has to be cleaned up afterward.
+    void BeginSendEvent() { ++inSend_; }
+
+    /// End event send. Clean up if necessary.
+    void EndSendEvent();
+
+    /// Add receiver. Same receiver must not be double-added.
+    void Add(Object* object) { receivers_.Push(object); }
+
+    /// Remove receiver. Leave holes during send, which requires later cleanup.
+    void Remove(Object* object);
+
+    /// Return whether contains a receiver. Holes are never reported.
+    bool Contains(Object* object) const { return object && receivers_.Contains(object); }
+
+    /// Return whether has no receivers. Holes are not counted.
+    bool Empty() const;
+
+    /// Receivers. May contain holes during sending.
+    PODVector<Object*> receivers_;
+
+private:
+    /// "In send" recursion counter.
+    unsigned inSend_;
+    /// Cleanup required flag.
+    bool dirty_;
+};
+
 /// Urho3D execution context. Provides access to subsystems, object factories and attributes, and event receivers.
 class URHO3D_API Context : public RefCounted
 {
@@ -56,6 +96,8 @@ public:
     void RemoveAttribute(StringHash objectType, const char* name);
     /// Update object attribute's default value.
     void UpdateAttributeDefaultValue(StringHash objectType, const char* name, const Variant& defaultValue);
+    /// Set object attribute's network replication encoding. Must be set identically on the server and the clients.
+    void SetAttributeNetworkEncoding(StringHash objectType, const char* name, const NetworkEncoding& encoding);
     /// Return a preallocated map for event data. Used for optimization to avoid constant re-allocation of event data maps.
     VariantMap& GetEventDataMap();
 
@@ -75,6 +117,8 @@ public:
     template <class T, class U> void CopyBaseAttributes();
     /// Template version of updating an object attribute's default value.
     template <class T> void UpdateAttributeDefaultValue(const char* name, const Variant& defaultValue);
+    /// Template version of setting an object attribute's network replication encoding.
+    template <class T> void SetAttributeNetworkEncoding(const char* name, const NetworkEncoding& encoding);
 
     /// Return subsystem by type.
     Object* GetSubsystem(StringHash type) const;
@@ -121,23 +165,23 @@ public:
     const HashMap<StringHash, Vector<AttributeInfo> >& GetAllAttributes() const { return attributes_; }
 
     /// Return event receivers for a sender and event type, or null if they do not exist.
-    HashSet<Object*>* GetEventReceivers(Object* sender, StringHash eventType)
+    EventReceiverGroup* GetEventReceivers(Object* sender, StringHash eventType)
     {
-        HashMap<Object*, HashMap<StringHash, HashSet<Object*> > >::Iterator i = specificEventReceivers_.Find(sender);
+        FlatHashMap<Object*, FlatHashMap<StringHash, SharedPtr<EventReceiverGroup> > >::Iterator i = specificEventReceivers_.Find(sender);
         if (i != specificEventReceivers_.End())
         {
-            HashMap<StringHash, HashSet<Object*> >::Iterator j = i->second_.Find(eventType);
-            return j != i->second_.End() ? &j->second_ : 0;
+            FlatHashMap<StringHash, SharedPtr<EventReceiverGroup> >::Iterator j = i->second_.Find(eventType);
+            return j != i->second_.End() ? j->second_.Get() : 0;
         }
         else
             return 0;
     }
 
     /// Return event receivers for an event type, or null if they do not exist.
-    HashSet<Object*>* GetEventReceivers(StringHash eventType)
+    EventReceiverGroup* GetEventReceivers(StringHash eventType)
     {
-        HashMap<StringHash, HashSet<Object*> >::Iterator i = eventReceivers_.Find(eventType);
-        return i != eventReceivers_.End() ? &i->second_ : 0;
+        FlatHashMap<StringHash, SharedPtr<EventReceiverGroup> >::Iterator i = eventReceivers_.Find(eventType);
+        return i != eventReceivers_.End() ? i->second_.Get() : 0;
     }
 
 private:
@@ -170,9 +214,9 @@ private:
     /// Network replication attribute descriptions per object type.
     HashMap<StringHash, Vector<AttributeInfo> > networkAttributes_;
     /// Event receivers for non-specific events.
-    HashMap<StringHash, HashSet<Object*> > eventReceivers_;
+    FlatHashMap<StringHash, SharedPtr<EventReceiverGroup> > eventReceivers_;
     /// Event receivers for specific senders' events.
-    HashMap<Object*, HashMap<StringHash, HashSet<Object*> > > specificEventReceivers_;
+    FlatHashMap<Object*, FlatHashMap<StringHash, SharedPtr<EventReceiverGroup> > > specificEventReceivers_;
     /// Event sender stack.
     PODVector<Object*> eventSenders_;
     /// Event data stack.
@@ -207,4 +251,9 @@ template <class T> void Context::UpdateAttributeDefaultValue(const char* name, c
     UpdateAttributeDefaultValue(T::GetTypeStatic(), name, defaultValue);
 }
 
+template <class T> void Context::SetAttributeNetworkEncoding(const char* name, const NetworkEncoding& encoding)
+{
+    SetAttributeNetworkEncoding(T::GetTypeStatic(), name, encoding);
+}
+
 }
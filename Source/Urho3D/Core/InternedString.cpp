@@ -0,0 +1,78 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Core/InternedString.h"
+#include "../Core/Mutex.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Return the global interned string table. Constructed on first use so that interned strings may also be created during static initialization.
+static HashMap<String, StringHash>& GetInternedStrings()
+{
+    static HashMap<String, StringHash> strings;
+    return strings;
+}
+
+/// Return the mutex guarding the interned string table.
+static Mutex& GetInternedStringsMutex()
+{
+    static Mutex mutex;
+    return mutex;
+}
+
+InternedString::InternedString(const String& str) :
+    entry_(Intern(str))
+{
+}
+
+InternedString::InternedString(const char* str) :
+    entry_(Intern(String(str)))
+{
+}
+
+unsigned InternedString::GetNumInternedStrings()
+{
+    MutexLock lock(GetInternedStringsMutex());
+    return GetInternedStrings().Size();
+}
+
+const HashMap<String, StringHash>::KeyValue* InternedString::Intern(const String& str)
+{
+    if (str.Empty())
+        return 0;
+
+    MutexLock lock(GetInternedStringsMutex());
+    HashMap<String, StringHash>& strings = GetInternedStrings();
+
+    HashMap<String, StringHash>::Iterator i = strings.Find(str);
+    if (i == strings.End())
+        i = strings.Insert(MakePair(str, StringHash(str)));
+
+    return &(*i);
+}
+
+}
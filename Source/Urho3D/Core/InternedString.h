@@ -0,0 +1,82 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Container/HashMap.h"
+#include "../Container/Str.h"
+#include "../Math/StringHash.h"
+
+namespace Urho3D
+{
+
+/// Immutable string stored once in a global table, along with its precomputed StringHash. Copying and comparing interned strings only copies and compares a pointer, and retrieving the hash does not rehash. The table is thread-safe and interned strings are never freed, so only intern names that recur, such as attribute and resource names.
+class URHO3D_API InternedString
+{
+public:
+    /// Construct empty.
+    InternedString() :
+        entry_(0)
+    {
+    }
+
+    /// Construct by interning a string.
+    explicit InternedString(const String& str);
+    /// Construct by interning a C string.
+    explicit InternedString(const char* str);
+
+    /// Test for equality with another interned string.
+    bool operator ==(const InternedString& rhs) const { return entry_ == rhs.entry_; }
+
+    /// Test for inequality with another interned string.
+    bool operator !=(const InternedString& rhs) const { return entry_ != rhs.entry_; }
+
+    /// Test if less than another interned string. Orders by table address, not alphabetically.
+    bool operator <(const InternedString& rhs) const { return entry_ < rhs.entry_; }
+
+    /// Return the string.
+    const String& GetString() const { return entry_ ? entry_->first_ : String::EMPTY; }
+
+    /// Return the string as a C string.
+    const char* CString() const { return GetString().CString(); }
+
+    /// Return the precomputed hash of the string.
+    StringHash GetHash() const { return entry_ ? entry_->second_ : StringHash::ZERO; }
+
+    /// Return whether is empty.
+    bool Empty() const { return GetString().Empty(); }
+
+    /// Return hash value for HashSet & HashMap.
+    unsigned ToHash() const { return MakeHash(entry_); }
+
+    /// Return number of strings in the global table.
+    static unsigned GetNumInternedStrings();
+
+private:
+    /// Look up or add a string in the global table.
+    static const HashMap<String, StringHash>::KeyValue* Intern(const String& str);
+
+    /// Entry in the global table. Table nodes never move, so the pointer stays valid.
+    const HashMap<String, StringHash>::KeyValue* entry_;
+};
+
+}
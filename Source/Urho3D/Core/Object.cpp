@@ -72,7 +72,8 @@ bool TypeInfo::IsTypeOf(const TypeInfo* typeInfo) const
 }
 
 Object::Object(Context* context) :
-    context_(context)
+    context_(context),
+    numSpecificHandlers_(0)
 {
     assert(context_);
 }
@@ -87,38 +88,23 @@ void Object::OnEvent(Object* sender, StringHash eventType, VariantMap& eventData
 {
     // Make a copy of the context pointer in case the object is destroyed during event handler invocation
     Context* context = context_;
-    EventHandler* specific = 0;
-    EventHandler* nonSpecific = 0;
+    EventHandler* handler = 0;
 
-    EventHandler* handler = eventHandlers_.First();
-    while (handler)
-    {
-        if (handler->GetEventType() == eventType)
-        {
-            if (!handler->GetSender())
-                nonSpecific = handler;
-            else if (handler->GetSender() == sender)
-            {
-                specific = handler;
-                break;
-            }
-        }
-        handler = eventHandlers_.Next(handler);
-    }
+    // Specific event handlers have priority, so check for them first. The handler list only needs to be walked if any exist
+    if (sender && numSpecificHandlers_)
+        handler = FindSpecificEventHandler(sender, eventType);
 
-    // Specific event handlers have priority, so if found, invoke first
-    if (specific)
+    if (!handler)
     {
-        context->SetEventHandler(specific);
-        specific->Invoke(eventData);
-        context->SetEventHandler(0);
-        return;
+        FlatHashMap<StringHash, EventHandler*>::ConstIterator i = eventHandlerIndex_.Find(eventType);
+        if (i != eventHandlerIndex_.End())
+            handler = i->second_;
     }
 
-    if (nonSpecific)
+    if (handler)
     {
-        context->SetEventHandler(nonSpecific);
-        nonSpecific->Invoke(eventData);
+        context->SetEventHandler(handler);
+        handler->Invoke(eventData);
         context->SetEventHandler(0);
     }
 }
@@ -153,11 +139,11 @@ void Object::SubscribeToEvent(StringHash eventType, EventHandler* handler)
     EventHandler* previous;
     EventHandler* oldHandler = FindSpecificEventHandler(0, eventType, &previous);
     if (oldHandler)
-        eventHandlers_.Erase(oldHandler, previous);
-
-    eventHandlers_.InsertFront(handler);
+        RemoveEventHandler(oldHandler, previous);
+    else
+        context_->AddEventReceiver(this, eventType);
 
-    context_->AddEventReceiver(this, eventType);
+    AddEventHandler(handler);
 }
 
 void Object::SubscribeToEvent(Object* sender, StringHash eventType, EventHandler* handler)
@@ -174,11 +160,11 @@ void Object::SubscribeToEvent(Object* sender, StringHash eventType, EventHandler
     EventHandler* previous;
     EventHandler* oldHandler = FindSpecificEventHandler(sender, eventType, &previous);
     if (oldHandler)
-        eventHandlers_.Erase(oldHandler, previous);
-
-    eventHandlers_.InsertFront(handler);
+        RemoveEventHandler(oldHandler, previous);
+    else
+        context_->AddEventReceiver(this, sender, eventType);
 
-    context_->AddEventReceiver(this, sender, eventType);
+    AddEventHandler(handler);
 }
 
 void Object::UnsubscribeFromEvent(StringHash eventType)
@@ -193,7 +179,7 @@ void Object::UnsubscribeFromEvent(StringHash eventType)
                 context_->RemoveEventReceiver(this, handler->GetSender(), eventType);
             else
                 context_->RemoveEventReceiver(this, eventType);
-            eventHandlers_.Erase(handler, previous);
+            RemoveEventHandler(handler, previous);
         }
         else
             break;
@@ -210,7 +196,7 @@ void Object::UnsubscribeFromEvent(Object* sender, StringHash eventType)
     if (handler)
     {
         context_->RemoveEventReceiver(this, handler->GetSender(), eventType);
-        eventHandlers_.Erase(handler, previous);
+        RemoveEventHandler(handler, previous);
     }
 }
 
@@ -226,7 +212,7 @@ void Object::UnsubscribeFromEvents(Object* sender)
         if (handler)
         {
             context_->RemoveEventReceiver(this, handler->GetSender(), handler->GetEventType());
-            eventHandlers_.Erase(handler, previous);
+            RemoveEventHandler(handler, previous);
         }
         else
             break;
@@ -244,7 +230,7 @@ void Object::UnsubscribeFromAllEvents()
                 context_->RemoveEventReceiver(this, handler->GetSender(), handler->GetEventType());
             else
                 context_->RemoveEventReceiver(this, handler->GetEventType());
-            eventHandlers_.Erase(handler);
+            RemoveEventHandler(handler, 0);
         }
         else
             break;
@@ -267,7 +253,7 @@ void Object::UnsubscribeFromAllEventsExcept(const PODVector<StringHash>& excepti
             else
                 context_->RemoveEventReceiver(this, handler->GetEventType());
 
-            eventHandlers_.Erase(handler, previous);
+            RemoveEventHandler(handler, previous);
         }
         else
             previous = handler;
@@ -294,95 +280,71 @@ void Object::SendEvent(StringHash eventType, VariantMap& eventData)
     // Make a weak pointer to self to check for destruction during event handling
     WeakPtr<Object> self(this);
     Context* context = context_;
-    HashSet<Object*> processed;
 
     context->BeginSendEvent(this);
 
+    // Receivers the event has been sent to through the specific group. Recorded as they are invoked, so that changes to
+    // the specific group during the send cannot cause double or missed delivery in the non-specific group
+    PODVector<Object*> processed;
+
     // Check first the specific event receivers
-    const HashSet<Object*>* group = context->GetEventReceivers(this, eventType);
-    if (group)
+    // Note: the groups are held alive with shared pointers, as the specific group may get destroyed along with the sender
+    SharedPtr<EventReceiverGroup> specificGroup(context->GetEventReceivers(this, eventType));
+    if (specificGroup)
     {
-        for (HashSet<Object*>::ConstIterator i = group->Begin(); i != group->End();)
+        specificGroup->BeginSendEvent();
+
+        // Receivers added during the send are not invoked until the next send
+        const unsigned numReceivers = specificGroup->receivers_.Size();
+        for (unsigned i = 0; i < numReceivers; ++i)
         {
-            HashSet<Object*>::ConstIterator current = i++;
-            Object* receiver = *current;
-            Object* next = 0;
-            if (i != group->End())
-                next = *i;
+            Object* receiver = specificGroup->receivers_[i];
+            // Holes may exist if receivers were removed during send
+            if (!receiver)
+                continue;
 
-            unsigned oldSize = group->Size();
+            processed.Push(receiver);
             receiver->OnEvent(this, eventType, eventData);
 
             // If self has been destroyed as a result of event handling, exit
             if (self.Expired())
             {
+                specificGroup->EndSendEvent();
                 context->EndSendEvent();
                 return;
             }
-
-            // If group has changed size during iteration (removed/added subscribers) try to recover
-            /// \todo This is not entirely foolproof, as a subscriber could have been added to make up for the removed one
-            if (group->Size() != oldSize)
-                i = group->Find(next);
-
-            processed.Insert(receiver);
         }
+
+        specificGroup->EndSendEvent();
     }
 
     // Then the non-specific receivers
-    group = context->GetEventReceivers(eventType);
+    SharedPtr<EventReceiverGroup> group(context->GetEventReceivers(eventType));
     if (group)
     {
-        if (processed.Empty())
-        {
-            for (HashSet<Object*>::ConstIterator i = group->Begin(); i != group->End();)
-            {
-                HashSet<Object*>::ConstIterator current = i++;
-                Object* receiver = *current;
-                Object* next = 0;
-                if (i != group->End())
-                    next = *i;
-
-                unsigned oldSize = group->Size();
-                receiver->OnEvent(this, eventType, eventData);
-
-                if (self.Expired())
-                {
-                    context->EndSendEvent();
-                    return;
-                }
-
-                if (group->Size() != oldSize)
-                    i = group->Find(next);
-            }
-        }
-        else
+        group->BeginSendEvent();
+
+        // If there were specific receivers, check that the event is not sent doubly to them. There are typically only a
+        // few, so a linear search is cheaper than building a hash set
+        bool checkProcessed = !processed.Empty();
+        const unsigned numReceivers = group->receivers_.Size();
+        for (unsigned i = 0; i < numReceivers; ++i)
         {
-            // If there were specific receivers, check that the event is not sent doubly to them
-            for (HashSet<Object*>::ConstIterator i = group->Begin(); i != group->End();)
+            Object* receiver = group->receivers_[i];
+            if (!receiver || (checkProcessed && processed.Contains(receiver)))
+                continue;
+
+            receiver->OnEvent(this, eventType, eventData);
+
+            if (self.Expired())
             {
-                HashSet<Object*>::ConstIterator current = i++;
-                Object* receiver = *current;
-                Object* next = 0;
-                if (i != group->End())
-                    next = *i;
-
-                if (!processed.Contains(receiver))
-                {
-                    unsigned oldSize = group->Size();
-                    receiver->OnEvent(this, eventType, eventData);
-
-                    if (self.Expired())
-                    {
-                        context->EndSendEvent();
-                        return;
-                    }
-
-                    if (group->Size() != oldSize)
-                        i = group->Find(next);
-                }
+                group->EndSendEvent();
+                context->EndSendEvent();
+                return;
             }
         }
+
+        group->EndSendEvent();
     }
 
     context->EndSendEvent();
@@ -497,7 +459,7 @@ void Object::RemoveEventSender(Object* sender)
         if (handler->GetSender() == sender)
         {
             EventHandler* next = eventHandlers_.Next(handler);
-            eventHandlers_.Erase(handler, previous);
+            RemoveEventHandler(handler, previous);
             handler = next;
         }
         else
@@ -508,4 +470,24 @@ void Object::RemoveEventSender(Object* sender)
     }
 }
 
+void Object::AddEventHandler(EventHandler* handler)
+{
+    eventHandlers_.InsertFront(handler);
+
+    if (handler->GetSender())
+        ++numSpecificHandlers_;
+    else
+        eventHandlerIndex_[handler->GetEventType()] = handler;
+}
+
+void Object::RemoveEventHandler(EventHandler* handler, EventHandler* previous)
+{
+    if (handler->GetSender())
+        --numSpecificHandlers_;
+    else
+        eventHandlerIndex_.Erase(handler->GetEventType());
+
+    eventHandlers_.Erase(handler, previous);
+}
+
 }
@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include "../Container/FlatHashMap.h"
 #include "../Container/LinkedList.h"
 #include "../Core/Variant.h"
 
@@ -165,9 +166,17 @@ private:
     EventHandler* FindSpecificEventHandler(Object* sender, StringHash eventType, EventHandler** previous = 0) const;
     /// Remove event handlers related to a specific sender.
     void RemoveEventSender(Object* sender);
+    /// Add an event handler to the list and the lookup index.
+    void AddEventHandler(EventHandler* handler);
+    /// Remove and delete an event handler, keeping the lookup index in sync.
+    void RemoveEventHandler(EventHandler* handler, EventHandler* previous);
 
     /// Event handlers. Sender is null for non-specific handlers.
     LinkedList<EventHandler> eventHandlers_;
+    /// Non-specific event handlers by event type, to avoid walking the handler list on every received event.
+    FlatHashMap<StringHash, EventHandler*> eventHandlerIndex_;
+    /// Number of event handlers with a specific sender. When zero, the specific handler search can be skipped.
+    unsigned numSpecificHandlers_;
 };
 
 template <class T> T* Object::GetSubsystem() const { return static_cast<T*>(GetSubsystem(T::GetTypeStatic())); }
@@ -321,9 +330,9 @@ private:
 };
 
 /// Describe an event's hash ID and begin a namespace in which to define its parameters.
-#define URHO3D_EVENT(eventID, eventName) static const Urho3D::StringHash eventID(#eventName); namespace eventName
+#define URHO3D_EVENT(eventID, eventName) static URHO3D_HASH_CONSTEXPR const Urho3D::StringHash eventID(URHO3D_HASH_LITERAL(#eventName)); namespace eventName
 /// Describe an event's parameter hash ID. Should be used inside an event namespace.
-#define URHO3D_PARAM(paramID, paramName) static const Urho3D::StringHash paramID(#paramName)
+#define URHO3D_PARAM(paramID, paramName) static URHO3D_HASH_CONSTEXPR const Urho3D::StringHash paramID(URHO3D_HASH_LITERAL(#paramName))
 /// Convenience macro to construct an EventHandler that points to a receiver object and its member function.
 #define URHO3D_HANDLER(className, function) (new Urho3D::EventHandlerImpl<className>(this, &className::function))
 /// Convenience macro to construct an EventHandler that points to a receiver object and its member function, and also defines a userdata pointer.
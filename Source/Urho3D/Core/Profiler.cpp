@@ -24,6 +24,7 @@
 
 #include "../Core/CoreEvents.h"
 #include "../Core/Profiler.h"
+#include "../IO/Serializer.h"
 
 #include <cstdio>
 
@@ -35,21 +36,85 @@ namespace Urho3D
 static const int LINE_MAX_LENGTH = 256;
 static const int NAME_MAX_LENGTH = 30;
 
+#ifdef _MSC_VER
+#define PROFILER_THREAD_LOCAL __declspec(thread)
+#else
+#define PROFILER_THREAD_LOCAL __thread
+#endif
+
+/// Profiling data of the calling thread.
+static PROFILER_THREAD_LOCAL ProfilerThread* currentThread = 0;
+/// ID of the profiler which owns the calling thread's profiling data. Checked before dereferencing the data, as the owning profiler may have been destroyed.
+static PROFILER_THREAD_LOCAL unsigned currentProfilerId = 0;
+/// Profiler ID counter.
+static unsigned nextProfilerId = 0;
+
 Profiler::Profiler(Context* context) :
     Object(context),
-    current_(0),
-    root_(0),
+    mainThread_(0),
+    id_(++nextProfilerId),
+    traceBufferSize_(0),
+    traceEnabled_(false),
     intervalFrames_(0),
     totalFrames_(0)
 {
-    root_ = new ProfilerBlock(0, "Root");
-    current_ = root_;
+    mainThread_ = new ProfilerThread("Root");
+    threads_.Push(mainThread_);
 }
 
 Profiler::~Profiler()
 {
-    delete root_;
-    root_ = 0;
+    for (unsigned i = 0; i < threads_.Size(); ++i)
+        delete threads_[i];
+    threads_.Clear();
+    mainThread_ = 0;
+}
+
+void Profiler::BeginBlock(const char* name)
+{
+    ProfilerThread* thread = GetThreadData();
+
+    // The main thread may be reading or resetting the tree at the same time
+    MutexLock lock(thread->mutex_);
+
+    ProfilerBlock* block = thread->current_->GetChild(name);
+    thread->current_ = block;
+    block->Begin();
+
+    if (traceEnabled_)
+    {
+        if (thread->events_.Empty())
+            thread->events_.Resize(traceBufferSize_);
+
+        ProfilerEvent& event = thread->events_[thread->numEvents_ % thread->events_.Size()];
+        event.block_ = block;
+        event.time_ = traceTimer_.GetUSec(false);
+        event.begin_ = true;
+        ++thread->numEvents_;
+    }
+}
+
+void Profiler::EndBlock()
+{
+    ProfilerThread* thread = GetThreadData();
+
+    MutexLock lock(thread->mutex_);
+
+    if (thread->current_ != thread->root_)
+    {
+        ProfilerBlock* block = thread->current_;
+        block->End();
+        thread->current_ = block->parent_;
+
+        if (traceEnabled_ && !thread->events_.Empty())
+        {
+            ProfilerEvent& event = thread->events_[thread->numEvents_ % thread->events_.Size()];
+            event.block_ = block;
+            event.time_ = traceTimer_.GetUSec(false);
+            event.begin_ = false;
+            ++thread->numEvents_;
+        }
+    }
 }
 
 void Profiler::BeginFrame()
@@ -62,24 +127,132 @@ void Profiler::BeginFrame()
 
 void Profiler::EndFrame()
 {
-    if (current_ != root_)
+    if (mainThread_->current_ != mainThread_->root_)
     {
         EndBlock();
         ++intervalFrames_;
         ++totalFrames_;
         if (!totalFrames_)
             ++totalFrames_;
-        root_->EndFrame();
-        current_ = root_;
+
+        // Other threads' blocks are also accumulated per main thread frame. Their timing is updated under the same lock
+        MutexLock lock(threadsMutex_);
+        for (unsigned i = 0; i < threads_.Size(); ++i)
+        {
+            MutexLock threadLock(threads_[i]->mutex_);
+            threads_[i]->root_->EndFrame();
+        }
+
+        mainThread_->current_ = mainThread_->root_;
     }
 }
 
 void Profiler::BeginInterval()
 {
-    root_->BeginInterval();
+    MutexLock lock(threadsMutex_);
+    for (unsigned i = 0; i < threads_.Size(); ++i)
+    {
+        MutexLock threadLock(threads_[i]->mutex_);
+        threads_[i]->root_->BeginInterval();
+    }
+
     intervalFrames_ = 0;
 }
 
+void Profiler::SetTraceEnabled(bool enable, unsigned eventsPerThread)
+{
+    if (enable == traceEnabled_)
+        return;
+
+    if (enable)
+    {
+        traceBufferSize_ = Max((int)eventsPerThread, 1);
+        traceTimer_.Reset();
+
+        // Clear previously recorded events. The buffers are reallocated by their threads on the next event
+        MutexLock lock(threadsMutex_);
+        for (unsigned i = 0; i < threads_.Size(); ++i)
+        {
+            MutexLock threadLock(threads_[i]->mutex_);
+            threads_[i]->events_.Clear();
+            threads_[i]->numEvents_ = 0;
+        }
+    }
+
+    traceEnabled_ = enable;
+}
+
+bool Profiler::SaveTrace(Serializer& dest) const
+{
+    String output("{\"traceEvents\":[\n");
+    bool first = true;
+    char line[LINE_MAX_LENGTH];
+
+    MutexLock lock(threadsMutex_);
+
+    for (unsigned i = 0; i < threads_.Size(); ++i)
+    {
+        ProfilerThread* thread = threads_[i];
+        MutexLock threadLock(thread->mutex_);
+
+        if (!first)
+            output += ",\n";
+        first = false;
+        sprintf(line, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", i,
+            thread == mainThread_ ? "Main thread" : thread->root_->name_);
+        output += String(line);
+
+        unsigned bufferSize = thread->events_.Size();
+        if (!bufferSize)
+            continue;
+
+        // If the ring buffer has wrapped, start from the oldest event. Skip end events whose begin has been overwritten
+        unsigned numEvents = thread->numEvents_;
+        unsigned start = numEvents > bufferSize ? numEvents - bufferSize : 0;
+        unsigned depth = 0;
+
+        for (unsigned j = start; j < numEvents; ++j)
+        {
+            const ProfilerEvent& event = thread->events_[j % bufferSize];
+            if (event.begin_)
+                ++depth;
+            else if (depth)
+                --depth;
+            else
+                continue;
+
+            // Block names are identifiers or resource type names, so they need no escaping
+            sprintf(line, ",\n{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%lld,\"pid\":1,\"tid\":%u}", event.block_->name_,
+                event.begin_ ? "B" : "E", event.time_, i);
+            output += String(line);
+        }
+    }
+
+    output += "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    return dest.Write(output.CString(), output.Length()) == output.Length();
+}
+
+ProfilerThread* Profiler::GetThreadData()
+{
+    if (currentProfilerId == id_)
+        return currentThread;
+
+    ProfilerThread* thread;
+    if (Thread::IsMainThread())
+        thread = mainThread_;
+    else
+    {
+        MutexLock lock(threadsMutex_);
+        thread = new ProfilerThread(("Thread " + String(threads_.Size())).CString());
+        threads_.Push(thread);
+    }
+
+    currentThread = thread;
+    currentProfilerId = id_;
+    return thread;
+}
+
 String Profiler::PrintData(bool showUnused, bool showTotal, unsigned maxDepth) const
 {
     String output;
@@ -95,7 +268,20 @@ String Profiler::PrintData(bool showUnused, bool showTotal, unsigned maxDepth) c
     if (!maxDepth)
         maxDepth = 1;
 
-    PrintData(root_, output, 0, maxDepth, showUnused, showTotal);
+    PrintData(mainThread_->root_, output, 0, maxDepth, showUnused, showTotal);
+
+    // Print other threads with their root block as the heading
+    MutexLock lock(threadsMutex_);
+    for (unsigned i = 0; i < threads_.Size(); ++i)
+    {
+        ProfilerThread* thread = threads_[i];
+        if (thread != mainThread_)
+        {
+            MutexLock threadLock(thread->mutex_);
+            output += "\n" + String(thread->root_->name_) + "\n";
+            PrintData(thread->root_, output, 0, maxDepth, showUnused, showTotal);
+        }
+    }
 
     return output;
 }
@@ -111,8 +297,8 @@ void Profiler::PrintData(ProfilerBlock* block, String& output, unsigned depth, u
     if (depth >= maxDepth)
         return;
 
-    // Do not print the root block as it does not collect any actual data
-    if (block != root_)
+    // Do not print the root blocks as they do not collect any actual data
+    if (block->parent_)
     {
         if (showUnused || block->intervalCount_ || (showTotal && block->totalCount_))
         {
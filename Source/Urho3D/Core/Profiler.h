@@ -23,12 +23,15 @@
 #pragma once
 
 #include "../Container/Str.h"
+#include "../Core/Mutex.h"
 #include "../Core/Thread.h"
 #include "../Core/Timer.h"
 
 namespace Urho3D
 {
 
+class Serializer;
+
 /// Profiling data for one block in the profiling tree.
 class URHO3D_API ProfilerBlock
 {
@@ -36,6 +39,7 @@ public:
     /// Construct with the specified parent block and name.
     ProfilerBlock(ProfilerBlock* parent, const char* name) :
         name_(0),
+        namePtr_(name),
         time_(0),
         maxTime_(0),
         count_(0),
@@ -119,15 +123,32 @@ public:
             (*i)->BeginInterval();
     }
     
-    /// Return child block with the specified name.
-    ProfilerBlock* GetChild(const char* name)
+    /// Return child block with the specified name, or null if not found.
+    ProfilerBlock* FindChild(const char* name)
     {
+        // Names are usually string literals, so compare the pointers first and only then the actual strings
+        for (PODVector<ProfilerBlock*>::Iterator i = children_.Begin(); i != children_.End(); ++i)
+        {
+            if ((*i)->namePtr_ == name)
+                return *i;
+        }
+        
         for (PODVector<ProfilerBlock*>::Iterator i = children_.Begin(); i != children_.End(); ++i)
         {
             if (!String::Compare((*i)->name_, name, true))
                 return *i;
         }
         
+        return 0;
+    }
+    
+    /// Return child block with the specified name. Create if not found.
+    ProfilerBlock* GetChild(const char* name)
+    {
+        ProfilerBlock* child = FindChild(name);
+        if (child)
+            return child;
+        
         ProfilerBlock* newBlock = new ProfilerBlock(this, name);
         children_.Push(newBlock);
         
@@ -136,6 +157,8 @@ public:
     
     /// Block name.
     char* name_;
+    /// Name pointer the block was created with. Only used for comparison, not dereferenced.
+    const char* namePtr_;
     /// High-resolution timer for measuring the block duration.
     HiresTimer timer_;
     /// Time on current frame.
@@ -168,7 +191,49 @@ public:
     unsigned totalCount_;
 };
 
-/// Hierarchical performance profiler subsystem.
+/// Profiling event in a thread's trace buffer.
+struct ProfilerEvent
+{
+    /// Profiling block.
+    ProfilerBlock* block_;
+    /// Time in microseconds since the trace was enabled.
+    long long time_;
+    /// Whether the block was begun or ended.
+    bool begin_;
+};
+
+/// Profiling data of one thread. The block tree and trace buffer are written by the thread itself, and read and reset at frame end by the main thread, so both lock the mutex.
+class URHO3D_API ProfilerThread
+{
+public:
+    /// Construct with a name for the root block.
+    ProfilerThread(const char* name) :
+        root_(new ProfilerBlock(0, name)),
+        numEvents_(0)
+    {
+        current_ = root_;
+    }
+
+    /// Destruct.
+    ~ProfilerThread()
+    {
+        delete root_;
+        root_ = 0;
+    }
+
+    /// Root profiling block.
+    ProfilerBlock* root_;
+    /// Current profiling block.
+    ProfilerBlock* current_;
+    /// Ring buffer of trace events. Allocated when the first event is recorded.
+    PODVector<ProfilerEvent> events_;
+    /// Number of trace events recorded in total. Modulo the buffer size gives the next write position.
+    volatile unsigned numEvents_;
+    /// Mutex for accessing the block tree and the trace buffer.
+    Mutex mutex_;
+};
+
+/// Hierarchical performance profiler subsystem. Blocks are profiled per thread, and optionally recorded into per-thread trace buffers that can be saved in the Chrome tracing format.
 class URHO3D_API Profiler : public Object
 {
     URHO3D_OBJECT(Profiler, Object);
@@ -179,29 +244,10 @@ public:
     /// Destruct.
     virtual ~Profiler();
     
-    /// Begin timing a profiling block.
-    void BeginBlock(const char* name)
-    {
-        // Profiler supports only the main thread currently
-        if (!Thread::IsMainThread())
-            return;
-        
-        current_ = current_->GetChild(name);
-        current_->Begin();
-    }
-    
-    /// End timing the current profiling block.
-    void EndBlock()
-    {
-        if (!Thread::IsMainThread())
-            return;
-        
-        if (current_ != root_)
-        {
-            current_->End();
-            current_ = current_->parent_;
-        }
-    }
+    /// Begin timing a profiling block. Can be called from any thread.
+    void BeginBlock(const char* name);
+    /// End timing the current profiling block. Can be called from any thread.
+    void EndBlock();
     
     /// Begin the profiling frame. Called by HandleBeginFrame().
     void BeginFrame();
@@ -209,22 +255,40 @@ public:
     void EndFrame();
     /// Begin a new interval.
     void BeginInterval();
+    /// Enable or disable recording of block begin and end events into per-thread ring buffers with the specified number of events per thread. Enabling clears previously recorded events.
+    void SetTraceEnabled(bool enable, unsigned eventsPerThread = 65536);
+    /// Save the recorded trace events in the Chrome tracing JSON format. Should be called from the main thread while worker threads are idle, for example between frames. Return true if successful.
+    bool SaveTrace(Serializer& dest) const;
     
-    /// Return profiling data as text output.
+    /// Return profiling data as text output. Blocks profiled in other threads than the main thread are listed per thread after the main thread blocks.
     String PrintData(bool showUnused = false, bool showTotal = false, unsigned maxDepth = M_MAX_UNSIGNED) const;
-    /// Return the current profiling block.
-    const ProfilerBlock* GetCurrentBlock() { return current_; }
-    /// Return the root profiling block.
-    const ProfilerBlock* GetRootBlock() { return root_; }
+    /// Return the current profiling block of the main thread.
+    const ProfilerBlock* GetCurrentBlock() { return mainThread_->current_; }
+    /// Return the root profiling block of the main thread.
+    const ProfilerBlock* GetRootBlock() { return mainThread_->root_; }
+    /// Return whether trace events are being recorded.
+    bool IsTraceEnabled() const { return traceEnabled_; }
     
 private:
+    /// Return the profiling data of the calling thread. Create if not created yet.
+    ProfilerThread* GetThreadData();
     /// Return profiling data as text output for a specified profiling block.
     void PrintData(ProfilerBlock* block, String& output, unsigned depth, unsigned maxDepth, bool showUnused, bool showTotal) const;
     
-    /// Current profiling block.
-    ProfilerBlock* current_;
-    /// Root profiling block.
-    ProfilerBlock* root_;
+    /// Main thread profiling data.
+    ProfilerThread* mainThread_;
+    /// Profiling data of all threads that have profiled blocks, including the main thread.
+    PODVector<ProfilerThread*> threads_;
+    /// Mutex for adding threads.
+    mutable Mutex threadsMutex_;
+    /// Timer for trace event timestamps.
+    HiresTimer traceTimer_;
+    /// Unique ID of this profiler, to detect stale thread-local data.
+    unsigned id_;
+    /// Trace buffer size per thread.
+    unsigned traceBufferSize_;
+    /// Trace recording flag.
+    volatile bool traceEnabled_;
     /// Frames in the current interval.
     unsigned intervalFrames_;
     /// Total frames.
@@ -31,6 +31,159 @@
 namespace Urho3D
 {
 
+/// Band of work items with equal priority inside a work deque.
+struct WorkBand
+{
+    /// Construct.
+    WorkBand(unsigned priority = 0) :
+        priority_(priority),
+        head_(0)
+    {
+    }
+
+    /// Return number of items in the band.
+    unsigned Size() const { return items_.Size() - head_; }
+
+    /// Priority of the items.
+    unsigned priority_;
+    /// Index of the oldest item still in the band.
+    unsigned head_;
+    /// Work items, oldest first.
+    PODVector<WorkItem*> items_;
+};
+
+/// Prioritized double-ended queue of work items owned by one thread. The owner takes the newest items from the back, while other threads steal the oldest items from the front.
+class WorkDeque : public RefCounted
+{
+public:
+    /// Construct.
+    WorkDeque() :
+        size_(0),
+        topPriority_(0)
+    {
+    }
+
+    /// Add a work item.
+    void Push(WorkItem* item)
+    {
+        MutexLock lock(mutex_);
+
+        // Bands are kept in descending priority order and are not removed when they become empty, so that
+        // their storage gets reused on the next frame
+        unsigned i = 0;
+        while (i < bands_.Size() && bands_[i].priority_ > item->priority_)
+            ++i;
+        if (i == bands_.Size() || bands_[i].priority_ != item->priority_)
+            bands_.Insert(i, WorkBand(item->priority_));
+
+        bands_[i].items_.Push(item);
+        ++size_;
+        UpdateTopPriority();
+    }
+
+    /// Take the highest priority work item that has at least the specified priority. Return null if none.
+    WorkItem* Pop(unsigned minPriority, bool steal)
+    {
+        MutexLock lock(mutex_);
+
+        for (unsigned i = 0; i < bands_.Size(); ++i)
+        {
+            WorkBand& band = bands_[i];
+            if (band.priority_ < minPriority)
+                break;
+            if (!band.Size())
+                continue;
+
+            WorkItem* item;
+            if (steal)
+                item = band.items_[band.head_++];
+            else
+            {
+                item = band.items_.Back();
+                band.items_.Pop();
+            }
+
+            if (!band.Size())
+            {
+                band.items_.Clear();
+                band.head_ = 0;
+            }
+
+            --size_;
+            UpdateTopPriority();
+            return item;
+        }
+
+        return 0;
+    }
+
+    /// Remove a work item that has not been taken yet. Return true if found.
+    bool Remove(WorkItem* item)
+    {
+        MutexLock lock(mutex_);
+
+        for (unsigned i = 0; i < bands_.Size(); ++i)
+        {
+            WorkBand& band = bands_[i];
+            if (band.priority_ != item->priority_)
+                continue;
+
+            for (unsigned j = band.head_; j < band.items_.Size(); ++j)
+            {
+                if (band.items_[j] == item)
+                {
+                    band.items_.Erase(j);
+                    if (!band.Size())
+                    {
+                        band.items_.Clear();
+                        band.head_ = 0;
+                    }
+
+                    --size_;
+                    UpdateTopPriority();
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    /// Wake up the owning thread if it is parked, or make it skip the next park.
+    void Wake() { wakeEvent_.Set(); }
+
+    /// Park the owning thread until woken up.
+    void Park() { wakeEvent_.Wait(); }
+
+    /// Number of queued items. May be read without locking as a hint.
+    volatile unsigned size_;
+    /// Highest priority of the queued items. May be read without locking as a hint.
+    volatile unsigned topPriority_;
+
+private:
+    /// Update the highest priority hint. Called with the mutex held.
+    void UpdateTopPriority()
+    {
+        for (unsigned i = 0; i < bands_.Size(); ++i)
+        {
+            if (bands_[i].Size())
+            {
+                topPriority_ = bands_[i].priority_;
+                return;
+            }
+        }
+
+        topPriority_ = 0;
+    }
+
+    /// Priority bands in descending order.
+    Vector<WorkBand> bands_;
+    /// Deque mutex. Contended only when another thread steals.
+    Mutex mutex_;
+    /// Event the owning thread parks on when there is no work.
+    Condition wakeEvent_;
+};
+
 /// Worker thread managed by the work queue.
 class WorkerThread : public Thread, public RefCounted
 {
@@ -62,22 +215,28 @@ private:
 
 WorkQueue::WorkQueue(Context* context) :
     Object(context),
+    waitPriority_(0),
+    nextDeque_(0),
     shutDown_(false),
-    pausing_(false),
     paused_(false),
+    waiting_(false),
+    waitingItems_(false),
     completing_(false),
     tolerance_(10),
     lastSize_(0),
     maxNonThreadedWorkMs_(5)
 {
+    // Create the main thread's deque, which holds all work when there are no worker threads
+    deques_.Push(SharedPtr<WorkDeque>(new WorkDeque()));
+
     SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(WorkQueue, HandleBeginFrame));
 }
 
 WorkQueue::~WorkQueue()
 {
-    // Stop the worker threads. First make sure they are not waiting for work items
+    // Stop the worker threads. First make sure they are not parked waiting for work items
     shutDown_ = true;
-    Resume();
+    WakeAllWorkers();
 
     for (unsigned i = 0; i < threads_.Size(); ++i)
         threads_[i]->Stop();
@@ -91,15 +250,15 @@ void WorkQueue::CreateThreads(unsigned numThreads)
     if (!threads_.Empty())
         return;
 
-    // Start threads in paused mode
-    Pause();
-
+    // Create all deques and threads before starting any, as the threads access the deques
     for (unsigned i = 0; i < numThreads; ++i)
     {
-        SharedPtr<WorkerThread> thread(new WorkerThread(this, i + 1));
-        thread->Run();
-        threads_.Push(thread);
+        deques_.Push(SharedPtr<WorkDeque>(new WorkDeque()));
+        threads_.Push(SharedPtr<WorkerThread>(new WorkerThread(this, i + 1)));
     }
+
+    for (unsigned i = 0; i < threads_.Size(); ++i)
+        threads_[i]->Run();
 #else
     URHO3D_LOGERROR("Can not create worker threads as threading is disabled");
 #endif
@@ -123,6 +282,11 @@ SharedPtr<WorkItem> WorkQueue::GetFreeItem()
 }
 
 void WorkQueue::AddWorkItem(SharedPtr<WorkItem> item)
+{
+    AddWorkItem(item, PODVector<WorkItem*>());
+}
+
+void WorkQueue::AddWorkItem(SharedPtr<WorkItem> item, const PODVector<WorkItem*>& predecessors)
 {
     if (!item)
     {
@@ -137,30 +301,73 @@ void WorkQueue::AddWorkItem(SharedPtr<WorkItem> item)
     // Clear completed flag in case item is reused
     workItems_.Push(item);
     item->completed_ = false;
+    item->added_ = true;
 
-    // Make sure worker threads' list is safe to modify
-    if (threads_.Size() && !paused_)
-        queueMutex_.Acquire();
-
-    // Find position for new item
-    if (queue_.Empty())
-        queue_.Push(item);
-    else
     {
-        for (List<WorkItem*>::Iterator i = queue_.Begin(); i != queue_.End(); ++i)
+        MutexLock lock(pendingMutex_);
+        ++pendingItems_[item->priority_];
+
+        // Register as a dependent of the predecessors that have not completed yet. The item is queued by the thread that
+        // completes the last of them
+        item->numPendingPredecessors_ = 0;
+        for (unsigned i = 0; i < predecessors.Size(); ++i)
         {
-            if ((*i)->priority_ <= item->priority_)
+            WorkItem* predecessor = predecessors[i];
+            if (!predecessor)
+                continue;
+
+            // A purged pooled item has been reset and would never complete, so waiting for it would hang
+            if (!predecessor->added_)
             {
-                queue_.Insert(i, item);
-                break;
+                if (!predecessor->completed_)
+                    URHO3D_LOGERROR("Ignoring work item predecessor that has not been added to the queue or has been purged");
+                continue;
+            }
+
+            if (!predecessor->completed_)
+            {
+                predecessor->dependents_.Push(item);
+                ++item->numPendingPredecessors_;
             }
         }
+
+        if (item->numPendingPredecessors_)
+            return;
     }
 
+    QueueItem(item, 0);
+}
+
+void WorkQueue::AddWorkItems(void* start, unsigned count, unsigned elementSize, unsigned grainSize,
+    void (*workFunction)(const WorkItem*, unsigned), void* aux, unsigned priority, PODVector<WorkItem*>* items)
+{
+    if (!count)
+        return;
+
+    // Without worker threads execute the whole range as one item. Otherwise split into a few items per thread so that
+    // stealing can balance uneven work, but not smaller than the grain size
+    unsigned elementsPerItem = count;
     if (threads_.Size())
     {
-        queueMutex_.Release();
-        paused_ = false;
+        unsigned numItems = (threads_.Size() + 1) * 4;
+        elementsPerItem = (count + numItems - 1) / numItems;
+        if (elementsPerItem < grainSize)
+            elementsPerItem = grainSize;
+    }
+
+    unsigned char* data = reinterpret_cast<unsigned char*>(start);
+    for (unsigned i = 0; i < count; i += elementsPerItem)
+    {
+        SharedPtr<WorkItem> item = GetFreeItem();
+        item->priority_ = priority;
+        item->workFunction_ = workFunction;
+        item->aux_ = aux;
+        item->start_ = data + i * elementSize;
+        item->end_ = data + (count - i > elementsPerItem ? i + elementsPerItem : count) * elementSize;
+        AddWorkItem(item);
+
+        if (items)
+            items->Push(item);
     }
 }
 
@@ -169,18 +376,21 @@ bool WorkQueue::RemoveWorkItem(SharedPtr<WorkItem> item)
     if (!item)
         return false;
 
-    MutexLock lock(queueMutex_);
-
     // Can only remove successfully if the item was not yet taken by threads for execution
-    List<WorkItem*>::Iterator i = queue_.Find(item.Get());
-    if (i != queue_.End())
+    for (unsigned i = 0; i < deques_.Size(); ++i)
     {
-        List<SharedPtr<WorkItem> >::Iterator j = workItems_.Find(item);
-        if (j != workItems_.End())
+        if (deques_[i]->Remove(item.Get()))
         {
-            queue_.Erase(i);
-            ReturnToPool(item);
-            workItems_.Erase(j);
+            List<SharedPtr<WorkItem> >::Iterator j = workItems_.Find(item);
+            if (j != workItems_.End())
+            {
+                // Dependents of a removed item no longer need to wait for it
+                ReleaseDependents(item, 0);
+                DecrementPending(item->priority_);
+                item->added_ = false;
+                ReturnToPool(item);
+                workItems_.Erase(j);
+            }
             return true;
         }
     }
@@ -190,23 +400,13 @@ bool WorkQueue::RemoveWorkItem(SharedPtr<WorkItem> item)
 
 unsigned WorkQueue::RemoveWorkItems(const Vector<SharedPtr<WorkItem> >& items)
 {
-    MutexLock lock(queueMutex_);
     unsigned removed = 0;
 
     for (Vector<SharedPtr<WorkItem> >::ConstIterator i = items.Begin(); i != items.End(); ++i)
     {
-        List<WorkItem*>::Iterator j = queue_.Find(i->Get());
-        if (j != queue_.End())
-        {
-            List<SharedPtr<WorkItem> >::Iterator k = workItems_.Find(*i);
-            if (k != workItems_.End())
-            {
-                queue_.Erase(j);
-                ReturnToPool(*k);
-                workItems_.Erase(k);
-                ++removed;
-            }
-        }
+        SharedPtr<WorkItem> item = *i;
+        if (RemoveWorkItem(item))
+            ++removed;
     }
 
     return removed;
@@ -214,23 +414,15 @@ unsigned WorkQueue::RemoveWorkItems(const Vector<SharedPtr<WorkItem> >& items)
 
 void WorkQueue::Pause()
 {
-    if (!paused_)
-    {
-        pausing_ = true;
-
-        queueMutex_.Acquire();
-        paused_ = true;
-
-        pausing_ = false;
-    }
+    paused_ = true;
 }
 
 void WorkQueue::Resume()
 {
     if (paused_)
     {
-        queueMutex_.Release();
         paused_ = false;
+        WakeAllWorkers();
     }
 }
 
@@ -243,94 +435,245 @@ void WorkQueue::Complete(unsigned priority)
     {
         Resume();
 
-        // Take work items also in the main thread until queue empty or no high-priority items anymore
-        while (!queue_.Empty())
-        {
-            queueMutex_.Acquire();
-            if (!queue_.Empty() && queue_.Front()->priority_ >= priority)
-            {
-                WorkItem* item = queue_.Front();
-                queue_.PopFront();
-                queueMutex_.Release();
-                item->workFunction_(item, 0);
-                item->completed_ = true;
-            }
-            else
-            {
-                queueMutex_.Release();
-                break;
-            }
-        }
+        // Take work items also in the main thread until no high-priority items remain queued
+        while (WorkItem* item = TakeItem(0, priority))
+            ExecuteItem(item, 0);
 
-        // Wait for threaded work to complete
-        while (!IsCompleted(priority))
+        // Wait for threaded work to complete. The worker finishing the last item of sufficient priority signals the event
+        pendingMutex_.Acquire();
+        waitPriority_ = priority;
+        waiting_ = true;
+        while (GetNumPending(priority))
         {
+            pendingMutex_.Release();
+            completeEvent_.Wait();
+            pendingMutex_.Acquire();
         }
-
-        // If no work at all remaining, pause worker threads by leaving the mutex locked
-        if (queue_.Empty())
-            Pause();
+        waiting_ = false;
+        pendingMutex_.Release();
     }
     else
     {
         // No worker threads: ensure all high-priority items are completed in the main thread
-        while (!queue_.Empty() && queue_.Front()->priority_ >= priority)
-        {
-            WorkItem* item = queue_.Front();
-            queue_.PopFront();
-            item->workFunction_(item, 0);
-            item->completed_ = true;
-        }
+        while (WorkItem* item = TakeItem(0, priority))
+            ExecuteItem(item, 0);
     }
 
     PurgeCompleted(priority);
     completing_ = false;
 }
 
-bool WorkQueue::IsCompleted(unsigned priority) const
+void WorkQueue::Complete(const PODVector<WorkItem*>& items)
 {
-    for (List<SharedPtr<WorkItem> >::ConstIterator i = workItems_.Begin(); i != workItems_.End(); ++i)
+    if (items.Empty())
+        return;
+
+    unsigned priority = M_MAX_UNSIGNED;
+    for (unsigned i = 0; i < items.Size(); ++i)
+    {
+        if (items[i]->priority_ < priority)
+            priority = items[i]->priority_;
+    }
+
+    bool wasCompleting = completing_;
+    completing_ = true;
+    Resume();
+
+    for (;;)
     {
-        if ((*i)->priority_ >= priority && !(*i)->completed_)
-            return false;
+        // Check for completion under the pending mutex, so that a completion after the check wakes up the wait below
+        pendingMutex_.Acquire();
+        unsigned numCompleted = 0;
+        while (numCompleted < items.Size() && items[numCompleted]->completed_)
+            ++numCompleted;
+        waitingItems_ = numCompleted < items.Size();
+        pendingMutex_.Release();
+
+        if (!waitingItems_)
+            break;
+
+        // Help with work of sufficient priority, which also includes the items themselves unless already taken
+        if (WorkItem* item = TakeItem(0, priority))
+            ExecuteItem(item, 0);
+        else if (threads_.Size())
+            completeEvent_.Wait();
+        else
+        {
+            URHO3D_LOGERROR("Work items can not be completed as their predecessors are not queued");
+            waitingItems_ = false;
+            break;
+        }
+    }
+
+    for (List<SharedPtr<WorkItem> >::Iterator i = workItems_.Begin(); i != workItems_.End();)
+    {
+        if ((*i)->completed_ && items.Contains(i->Get()))
+        {
+            PurgeItem(*i);
+            i = workItems_.Erase(i);
+        }
+        else
+            ++i;
     }
 
-    return true;
+    completing_ = wasCompleting;
+}
+
+bool WorkQueue::IsCompleted(unsigned priority) const
+{
+    MutexLock lock(pendingMutex_);
+    return GetNumPending(priority) == 0;
 }
 
 void WorkQueue::ProcessItems(unsigned threadIndex)
 {
-    bool wasActive = false;
+    WorkDeque* deque = deques_[threadIndex];
 
     for (;;)
     {
         if (shutDown_)
             return;
 
-        if (pausing_ && !wasActive)
-            Time::Sleep(0);
-        else
+        WorkItem* item = paused_ ? 0 : TakeItem(threadIndex, 0);
+        if (item)
         {
-            queueMutex_.Acquire();
-            if (!queue_.Empty())
+            // If more work remains queued, wake up the next thread so that it can steal it
+            for (unsigned i = 0; i < deques_.Size(); ++i)
             {
-                wasActive = true;
-
-                WorkItem* item = queue_.Front();
-                queue_.PopFront();
-                queueMutex_.Release();
-                item->workFunction_(item, threadIndex);
-                item->completed_ = true;
+                if (deques_[i]->size_)
+                {
+                    WakeWorker(threadIndex % threads_.Size() + 1);
+                    break;
+                }
             }
-            else
-            {
-                wasActive = false;
 
-                queueMutex_.Release();
-                Time::Sleep(0);
+            ExecuteItem(item, threadIndex);
+        }
+        else
+            deque->Park();
+    }
+}
+
+void WorkQueue::QueueItem(WorkItem* item, unsigned threadIndex)
+{
+    if (threads_.Size())
+    {
+        // A worker thread keeps the items it releases in its own deque for locality. From the main thread, distribute the
+        // items round-robin to the worker threads' deques. Idle threads will steal from the others
+        unsigned index = threadIndex;
+        if (!index)
+        {
+            nextDeque_ = nextDeque_ % threads_.Size() + 1;
+            index = nextDeque_;
+            paused_ = false;
+        }
+
+        deques_[index]->Push(item);
+        deques_[index]->Wake();
+    }
+    else
+        deques_[0]->Push(item);
+}
+
+WorkItem* WorkQueue::TakeItem(unsigned threadIndex, unsigned minPriority)
+{
+    unsigned numDeques = deques_.Size();
+
+    for (;;)
+    {
+        // Find the deque with the highest priority work, preferring the own deque and then the nearest ones
+        unsigned bestIndex = M_MAX_UNSIGNED;
+        unsigned bestPriority = 0;
+
+        for (unsigned i = 0; i < numDeques; ++i)
+        {
+            unsigned index = (threadIndex + i) % numDeques;
+            WorkDeque* deque = deques_[index];
+            if (!deque->size_)
+                continue;
+
+            unsigned topPriority = deque->topPriority_;
+            if (topPriority >= minPriority && (bestIndex == M_MAX_UNSIGNED || topPriority > bestPriority))
+            {
+                bestIndex = index;
+                bestPriority = topPriority;
             }
         }
+
+        if (bestIndex == M_MAX_UNSIGNED)
+            return 0;
+
+        // The hints may be stale if another thread took the item first; in that case search again
+        WorkItem* item = deques_[bestIndex]->Pop(minPriority, bestIndex != threadIndex);
+        if (item)
+            return item;
+    }
+}
+
+void WorkQueue::ExecuteItem(WorkItem* item, unsigned threadIndex)
+{
+    item->workFunction_(item, threadIndex);
+
+    // Set the completed flag under the pending mutex, so that the main thread can not purge and reuse the item
+    // before the pending count has been decremented
+    MutexLock lock(pendingMutex_);
+    item->completed_ = true;
+    ReleaseDependents(item, threadIndex);
+    DecrementPending(item->priority_);
+
+    if (waitingItems_)
+        completeEvent_.Set();
+}
+
+void WorkQueue::ReleaseDependents(WorkItem* item, unsigned threadIndex)
+{
+    MutexLock lock(pendingMutex_);
+
+    for (unsigned i = 0; i < item->dependents_.Size(); ++i)
+    {
+        WorkItem* dependent = item->dependents_[i];
+        if (!--dependent->numPendingPredecessors_)
+            QueueItem(dependent, threadIndex);
     }
+
+    item->dependents_.Clear();
+}
+
+void WorkQueue::DecrementPending(unsigned priority)
+{
+    MutexLock lock(pendingMutex_);
+
+    HashMap<unsigned, unsigned>::Iterator i = pendingItems_.Find(priority);
+    if (i != pendingItems_.End() && i->second_)
+        --i->second_;
+
+    if (waiting_ && priority >= waitPriority_ && !GetNumPending(waitPriority_))
+        completeEvent_.Set();
+}
+
+void WorkQueue::WakeWorker(unsigned threadIndex)
+{
+    if (threadIndex && threadIndex < deques_.Size())
+        deques_[threadIndex]->Wake();
+}
+
+void WorkQueue::WakeAllWorkers()
+{
+    for (unsigned i = 1; i < deques_.Size(); ++i)
+        deques_[i]->Wake();
+}
+
+unsigned WorkQueue::GetNumPending(unsigned priority) const
+{
+    unsigned pending = 0;
+
+    for (HashMap<unsigned, unsigned>::ConstIterator i = pendingItems_.Begin(); i != pendingItems_.End(); ++i)
+    {
+        if (i->first_ >= priority)
+            pending += i->second_;
+    }
+
+    return pending;
 }
 
 void WorkQueue::PurgeCompleted(unsigned priority)
@@ -342,16 +685,7 @@ void WorkQueue::PurgeCompleted(unsigned priority)
     {
         if ((*i)->completed_ && (*i)->priority_ >= priority)
         {
-            if ((*i)->sendEvent_)
-            {
-                using namespace WorkItemCompleted;
-
-                VariantMap& eventData = GetEventDataMap();
-                eventData[P_ITEM] = i->Get();
-                SendEvent(E_WORKITEMCOMPLETED, eventData);
-            }
-
-            ReturnToPool(*i);
+            PurgeItem(*i);
             i = workItems_.Erase(i);
         }
         else
@@ -359,6 +693,20 @@ void WorkQueue::PurgeCompleted(unsigned priority)
     }
 }
 
+void WorkQueue::PurgeItem(SharedPtr<WorkItem>& item)
+{
+    if (item->sendEvent_)
+    {
+        using namespace WorkItemCompleted;
+
+        VariantMap& eventData = GetEventDataMap();
+        eventData[P_ITEM] = item.Get();
+        SendEvent(E_WORKITEMCOMPLETED, eventData);
+    }
+
+    item->added_ = false;
+    ReturnToPool(item);
+}
 void WorkQueue::PurgePool()
 {
     unsigned currentSize = poolItems_.Size();
@@ -387,6 +735,9 @@ void WorkQueue::ReturnToPool(SharedPtr<WorkItem>& item)
         item->priority_ = M_MAX_UNSIGNED;
         item->sendEvent_ = false;
         item->completed_ = false;
+        item->added_ = false;
+        item->numPendingPredecessors_ = 0;
+        item->dependents_.Clear();
 
         poolItems_.Push(item);
     }
@@ -395,18 +746,18 @@ void WorkQueue::ReturnToPool(SharedPtr<WorkItem>& item)
 void WorkQueue::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
 {
     // If no worker threads, complete low-priority work here
-    if (threads_.Empty() && !queue_.Empty())
+    if (threads_.Empty() && deques_[0]->size_)
     {
         URHO3D_PROFILE(CompleteWorkNonthreaded);
 
         HiresTimer timer;
 
-        while (!queue_.Empty() && timer.GetUSec(false) < maxNonThreadedWorkMs_ * 1000)
+        while (timer.GetUSec(false) < maxNonThreadedWorkMs_ * 1000)
         {
-            WorkItem* item = queue_.Front();
-            queue_.PopFront();
-            item->workFunction_(item, 0);
-            item->completed_ = true;
+            WorkItem* item = TakeItem(0, 0);
+            if (!item)
+                break;
+            ExecuteItem(item, 0);
         }
     }
 
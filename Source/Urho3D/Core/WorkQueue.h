@@ -22,7 +22,9 @@
 
 #pragma once
 
+#include "../Container/HashMap.h"
 #include "../Container/List.h"
+#include "../Core/Condition.h"
 #include "../Core/Mutex.h"
 #include "../Core/Object.h"
 
@@ -36,6 +38,7 @@ URHO3D_EVENT(E_WORKITEMCOMPLETED, WorkItemCompleted)
 }
 
 class WorkerThread;
+class WorkDeque;
 
 /// Work queue item.
 struct WorkItem : public RefCounted
@@ -48,7 +51,9 @@ public:
         priority_(0),
         sendEvent_(false),
         completed_(false),
-        pooled_(false)
+        pooled_(false),
+        added_(false),
+        numPendingPredecessors_(0)
     {
     }
 
@@ -69,6 +74,12 @@ public:
 
 private:
     bool pooled_;
+    /// Whether the item has been added to the queue and not yet purged or removed.
+    bool added_;
+    /// Number of predecessor work items that have not completed yet.
+    unsigned numPendingPredecessors_;
+    /// Work items waiting for this item to complete.
+    PODVector<WorkItem*> dependents_;
 };
 
 /// Work queue subsystem for multithreading.
@@ -90,16 +101,36 @@ public:
     SharedPtr<WorkItem> GetFreeItem();
     /// Add a work item and resume worker threads.
     void AddWorkItem(SharedPtr<WorkItem> item);
+    /// Add a work item that will be started only after the predecessor work items have completed. The predecessors must have been added to the queue and not yet purged by Complete(), otherwise they are ignored with an error. Until it is started, the item can not be removed.
+    void AddWorkItem(SharedPtr<WorkItem> item, const PODVector<WorkItem*>& predecessors);
+    /// Split a range of elements into work items of at least grainSize elements each and add them to the queue without waiting. The work function receives each subrange in start_ and end_. Optionally return the added items, for example to use them as predecessors.
+    void AddWorkItems(void* start, unsigned count, unsigned elementSize, unsigned grainSize, void (*workFunction)(const WorkItem*, unsigned),
+        void* aux = 0, unsigned priority = M_MAX_UNSIGNED, PODVector<WorkItem*>* items = 0);
     /// Remove a work item before it has started executing. Return true if successfully removed.
     bool RemoveWorkItem(SharedPtr<WorkItem> item);
     /// Remove a number of work items before they have started executing. Return the number of items successfully removed.
     unsigned RemoveWorkItems(const Vector<SharedPtr<WorkItem> >& items);
-    /// Pause worker threads.
+    /// Pause worker threads. They will not take new work items until resumed or a new work item is added.
     void Pause();
     /// Resume worker threads.
     void Resume();
-    /// Finish all queued work which has at least the specified priority. Main thread will also execute priority work. Pause worker threads if no more work remains.
+    /// Execute a work function over a range of elements in worker threads and the main thread, split into work items of at least grainSize elements each, and wait for completion. Other queued work is not waited for or purged.
+    template <class T> void ParallelFor(T* begin, T* end, unsigned grainSize, void (*workFunction)(const WorkItem*, unsigned), void* aux = 0)
+    {
+        PODVector<WorkItem*> items;
+        AddWorkItems(begin, (unsigned)(end - begin), sizeof(T), grainSize, workFunction, aux, M_MAX_UNSIGNED, &items);
+        Complete(items);
+    }
+    /// Execute a work function over all elements of a vector in worker threads and the main thread, and wait for completion.
+    template <class T> void ParallelFor(PODVector<T>& elements, unsigned grainSize, void (*workFunction)(const WorkItem*, unsigned), void* aux = 0)
+    {
+        if (!elements.Empty())
+            ParallelFor(&elements.Front(), &elements.Front() + elements.Size(), grainSize, workFunction, aux);
+    }
+    /// Finish all queued work which has at least the specified priority. Main thread will also execute priority work, and then waits without spinning until the worker threads are done.
     void Complete(unsigned priority);
+    /// Finish the specified work items, which must have been added to the queue, and purge them. Main thread will also execute work that has at least their priority. Other work items are not purged.
+    void Complete(const PODVector<WorkItem*>& items);
 
     /// Set the pool telerance before it starts deleting pool items.
     void SetTolerance(int tolerance) { tolerance_ = tolerance; }
@@ -124,8 +155,26 @@ public:
 private:
     /// Process work items until shut down. Called by the worker threads.
     void ProcessItems(unsigned threadIndex);
+    /// Push a work item that is ready to execute to a deque. Called from the main thread, or from the thread that completed the item's last predecessor.
+    void QueueItem(WorkItem* item, unsigned threadIndex);
+    /// Take the highest priority work item that has at least the specified priority, first from the thread's own deque, then by stealing from the other deques. Return null if none available.
+    WorkItem* TakeItem(unsigned threadIndex, unsigned minPriority);
+    /// Execute a work item taken from a deque, signal its completion and queue any dependent items that became ready.
+    void ExecuteItem(WorkItem* item, unsigned threadIndex);
+    /// Queue the dependent items of a completed or removed work item whose predecessors have now all completed.
+    void ReleaseDependents(WorkItem* item, unsigned threadIndex);
+    /// Decrement the pending count of a priority and wake up the main thread if it is waiting for that priority to complete.
+    void DecrementPending(unsigned priority);
+    /// Wake up one parked worker thread, starting the search from the specified thread index.
+    void WakeWorker(unsigned threadIndex);
+    /// Wake up all worker threads.
+    void WakeAllWorkers();
+    /// Return number of work items that have at least the specified priority and have not finished yet.
+    unsigned GetNumPending(unsigned priority) const;
     /// Purge completed work items which have at least the specified priority, and send completion events as necessary.
     void PurgeCompleted(unsigned priority);
+    /// Purge a completed work item and send completion event if necessary.
+    void PurgeItem(SharedPtr<WorkItem>& item);
     /// Purge the pool to reduce allocation where its unneeded.
     void PurgePool();
     /// Return a work item to the pool.
@@ -135,20 +184,30 @@ private:
 
     /// Worker threads.
     Vector<SharedPtr<WorkerThread> > threads_;
+    /// Work deques, one per thread. Index 0 belongs to the main thread and is used when there are no worker threads.
+    Vector<SharedPtr<WorkDeque> > deques_;
     /// Work item pool for reuse to cut down on allocation. The bool is a flag for item pooling and whether it is available or not.
     List<SharedPtr<WorkItem> > poolItems_;
     /// Work item collection. Accessed only by the main thread.
     List<SharedPtr<WorkItem> > workItems_;
-    /// Work item prioritized queue for worker threads. Pointers are guaranteed to be valid (point to workItems.)
-    List<WorkItem*> queue_;
-    /// Worker queue mutex.
-    Mutex queueMutex_;
+    /// Number of queued or executing work items per priority. Used as a completion fence so that waiting does not need to scan the work items.
+    HashMap<unsigned, unsigned> pendingItems_;
+    /// Pending items mutex.
+    mutable Mutex pendingMutex_;
+    /// Event for the main thread waiting in Complete().
+    Condition completeEvent_;
+    /// Priority the main thread is waiting on in Complete().
+    unsigned waitPriority_;
+    /// Deque to receive the next work item from the main thread. Items are distributed round-robin to the worker threads.
+    unsigned nextDeque_;
     /// Shutting down flag.
     volatile bool shutDown_;
-    /// Pausing flag. Indicates the worker threads should not contend for the queue mutex.
-    volatile bool pausing_;
-    /// Paused flag. Indicates the queue mutex being locked to prevent worker threads using up CPU time.
-    bool paused_;
+    /// Paused flag. Indicates the worker threads should not take new work items.
+    volatile bool paused_;
+    /// Main thread waiting for completion flag.
+    volatile bool waiting_;
+    /// Main thread waiting for specific work items flag.
+    volatile bool waitingItems_;
     /// Completing work in the main thread flag.
     bool completing_;
     /// Tolerance for the shared pool before it begins to deallocate.
@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include "../Container/FlatHashMap.h"
 #include "../Container/Ptr.h"
 #include "../Graphics/Drawable.h"
 #include "../Graphics/Material.h"
@@ -247,7 +248,7 @@ public:
     bool IsEmpty() const { return batches_.Empty() && batchGroups_.Empty(); }
 
     /// Instanced draw calls.
-    HashMap<BatchGroupKey, BatchGroup> batchGroups_;
+    FlatHashMap<BatchGroupKey, BatchGroup> batchGroups_;
     /// Shader remapping table for 2-pass state and distance sort.
     HashMap<unsigned, unsigned> shaderRemapping_;
     /// Material remapping table for 2-pass state and distance sort.
@@ -342,6 +342,8 @@ protected:
     bool zoneDirty_;
     /// Octree octant.
     Octant* octant_;
+    /// Index in the octant's drawable list.
+    unsigned octantIndex_;
     /// Current zone.
     Zone* zone_;
     /// View mask.
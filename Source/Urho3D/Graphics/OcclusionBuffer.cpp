@@ -43,8 +43,17 @@ static const unsigned CLIPMASK_Z_NEG = 0x20;
 void DrawOcclusionBatchWork(const WorkItem* item, unsigned threadIndex)
 {
     OcclusionBuffer* buffer = reinterpret_cast<OcclusionBuffer*>(item->aux_);
-    OcclusionBatch& batch = *reinterpret_cast<OcclusionBatch*>(item->start_);
-    buffer->DrawBatch(batch, threadIndex);
+    OcclusionBatch* start = reinterpret_cast<OcclusionBatch*>(item->start_);
+    OcclusionBatch* end = reinterpret_cast<OcclusionBatch*>(item->end_);
+
+    while (start != end)
+        buffer->DrawBatch(*start++, threadIndex);
+}
+
+void MergeOcclusionBuffersWork(const WorkItem* item, unsigned threadIndex)
+{
+    OcclusionBuffer* buffer = reinterpret_cast<OcclusionBuffer*>(item->aux_);
+    buffer->MergeBuffers((int)(size_t)item->start_, (int)(size_t)item->end_);
 }
 
 OcclusionBuffer::OcclusionBuffer(Context* context) :
@@ -219,19 +228,31 @@ void OcclusionBuffer::DrawTriangles()
         // Threaded
         WorkQueue* queue = GetSubsystem<WorkQueue>();
 
-        for (Vector<OcclusionBatch>::Iterator i = batches_.Begin(); i != batches_.End(); ++i)
+        // Each batch is drawn into the work buffer of the thread executing it. Batches vary a lot in cost, so execute one
+        // batch per work item to let idle threads steal the rest
+        PODVector<WorkItem*> items;
+        if (batches_.Size())
+        {
+            queue->AddWorkItems(&batches_.Front(), batches_.Size(), sizeof(OcclusionBatch), 1, DrawOcclusionBatchWork, this,
+                M_MAX_UNSIGNED, &items);
+        }
+
+        // Merge the thread work buffers in horizontal slices once all batches have been drawn
+        PODVector<WorkItem*> drawItems = items;
+        unsigned numSlices = queue->GetNumThreads() + 1;
+        for (unsigned i = 0; i < numSlices; ++i)
         {
             SharedPtr<WorkItem> item = queue->GetFreeItem();
             item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = DrawOcclusionBatchWork;
+            item->workFunction_ = MergeOcclusionBuffersWork;
             item->aux_ = this;
-            item->start_ = &(*i);
-            queue->AddWorkItem(item);
+            item->start_ = (void*)(size_t)(height_ * i / numSlices);
+            item->end_ = (void*)(size_t)(height_ * (i + 1) / numSlices);
+            queue->AddWorkItem(item, drawItems);
+            items.Push(item);
         }
 
-        queue->Complete(M_MAX_UNSIGNED);
-
-        MergeBuffers();
+        queue->Complete(items);
         depthHierarchyDirty_ = true;
     }
 
@@ -994,7 +1015,7 @@ void OcclusionBuffer::DrawTriangle2D(const Vector3* vertices, bool clockwise, un
     }
 }
 
-void OcclusionBuffer::MergeBuffers()
+void OcclusionBuffer::MergeBuffers(int startRow, int endRow)
 {
     URHO3D_PROFILE(MergeBuffers);
 
@@ -1003,9 +1024,9 @@ void OcclusionBuffer::MergeBuffers()
         if (!buffers_[i].used_)
             continue;
 
-        int* src = buffers_[i].data_;
-        int* dest = buffers_[0].data_;
-        int count = width_ * height_;
+        int* src = buffers_[i].data_ + startRow * width_;
+        int* dest = buffers_[0].data_ + startRow * width_;
+        int count = (endRow - startRow) * width_;
 
         while (count--)
         {
@@ -154,6 +154,8 @@ public:
 
     /// Draw a batch. Called internally.
     void DrawBatch(const OcclusionBatch& batch, unsigned threadIndex);
+    /// Merge a range of rows of the thread work buffers into the first buffer. Called internally.
+    void MergeBuffers(int startRow, int endRow);
 
 private:
     /// Apply modelview transform to vertex.
@@ -174,8 +176,6 @@ private:
     void DrawTriangle2D(const Vector3* vertices, bool clockwise, unsigned threadIndex);
     /// Clear a thread work buffer.
     void ClearBuffer(unsigned threadIndex);
-    /// Merge thread work buffers into the first buffer.
-    void MergeBuffers();
 
     /// Highest-level buffer data per thread.
     Vector<OcclusionBufferData> buffers_;
@@ -45,6 +45,12 @@ namespace Urho3D
 
 static const float DEFAULT_OCTREE_SIZE = 1000.0f;
 static const int DEFAULT_OCTREE_LEVELS = 8;
+static const unsigned DRAWABLES_PER_WORK_ITEM = 16;
+static const float DEFAULT_OCTREE_LOOSENESS = 2.0f;
+static const float MIN_OCTREE_LOOSENESS = 1.25f;
+static const float MAX_OCTREE_LOOSENESS = 4.0f;
+static const unsigned TARGET_SKIP = M_MAX_UNSIGNED;
+static const unsigned TARGET_STAY = M_MAX_UNSIGNED - 1;
 
 extern const char* SUBSYSTEM_CATEGORY;
 
@@ -63,6 +69,81 @@ void UpdateDrawablesWork(const WorkItem* item, unsigned threadIndex)
     }
 }
 
+void FindDrawableTargetsWork(const WorkItem* item, unsigned threadIndex)
+{
+    Octree* octree = reinterpret_cast<Octree*>(item->aux_);
+    Drawable** start = reinterpret_cast<Drawable**>(item->start_);
+    Drawable** end = reinterpret_cast<Drawable**>(item->end_);
+    unsigned index = (unsigned)(start - &octree->drawableUpdates_[0]);
+    unsigned* target = &octree->drawableTargets_[index];
+    const BoundingBox* box = &octree->drawableUpdateBoxes_[index];
+
+    while (start != end)
+        *target++ = octree->GetTargetDepth(*start++, *box++);
+}
+
+/// Return the bounding box of a child octant.
+static BoundingBox GetChildBox(const BoundingBox& box, unsigned index)
+{
+    Vector3 newMin = box.min_;
+    Vector3 newMax = box.max_;
+    Vector3 oldCenter = box.Center();
+
+    if (index & 1)
+        newMin.x_ = oldCenter.x_;
+    else
+        newMax.x_ = oldCenter.x_;
+
+    if (index & 2)
+        newMin.y_ = oldCenter.y_;
+    else
+        newMax.y_ = oldCenter.y_;
+
+    if (index & 4)
+        newMin.z_ = oldCenter.z_;
+    else
+        newMax.z_ = oldCenter.z_;
+
+    return BoundingBox(newMin, newMax);
+}
+
+/// Return the index of the child octant a point belongs to.
+static unsigned GetChildIndex(const Vector3& center, const Vector3& point)
+{
+    unsigned x = point.x_ < center.x_ ? 0 : 1;
+    unsigned y = point.y_ < center.y_ ? 0 : 2;
+    unsigned z = point.z_ < center.z_ ? 0 : 4;
+    return x + y + z;
+}
+
+/// Check if a drawable object's bounding box should be inserted to an octant instead of one of its children.
+static bool CheckDrawableFit(const BoundingBox& box, const BoundingBox& octantBox, const Vector3& halfSize, unsigned level,
+    unsigned numLevels, float looseness)
+{
+    Vector3 boxSize = box.Size();
+    // Child octant culling boxes extend past the child bounds by this fraction of this octant's half size
+    float childExpand = (looseness - 1.0f) * 0.5f;
+
+    // If max split level, size always OK, otherwise check that box fits a child octant's culling box
+    if (level >= numLevels || boxSize.x_ >= 2.0f * childExpand * halfSize.x_ || boxSize.y_ >= 2.0f * childExpand * halfSize.y_ ||
+        boxSize.z_ >= 2.0f * childExpand * halfSize.z_)
+        return true;
+    // Also check if the box can not fit a child octant's culling box, in that case size OK (must insert here)
+    else
+    {
+        if (box.min_.x_ <= octantBox.min_.x_ - childExpand * halfSize.x_ ||
+            box.max_.x_ >= octantBox.max_.x_ + childExpand * halfSize.x_ ||
+            box.min_.y_ <= octantBox.min_.y_ - childExpand * halfSize.y_ ||
+            box.max_.y_ >= octantBox.max_.y_ + childExpand * halfSize.y_ ||
+            box.min_.z_ <= octantBox.min_.z_ - childExpand * halfSize.z_ ||
+            box.max_.z_ >= octantBox.max_.z_ + childExpand * halfSize.z_)
+            return true;
+    }
+
+    // Bounding box too small, should create a child octant
+    return false;
+}
+
 inline bool CompareRayQueryResults(const RayQueryResult& lhs, const RayQueryResult& rhs)
 {
     return lhs.distance_ < rhs.distance_;
@@ -75,7 +156,8 @@ Octant::Octant(const BoundingBox& box, unsigned level, Octant* parent, Octree* r
     root_(root),
     index_(index)
 {
-    Initialize(box);
+    // The root octant is constructed before the octree, so it starts with the default looseness
+    Initialize(box, parent ? root->GetLooseness() : DEFAULT_OCTREE_LOOSENESS);
 
     for (unsigned i = 0; i < NUM_OCTANTS; ++i)
         children_[i] = 0;
@@ -88,11 +170,11 @@ Octant::~Octant()
         // Remove the drawables (if any) from this octant to the root octant
         for (PODVector<Drawable*>::Iterator i = drawables_.Begin(); i != drawables_.End(); ++i)
         {
-            (*i)->SetOctant(root_);
-            root_->drawables_.Push(*i);
+            root_->PushDrawable(*i);
             root_->QueueUpdate(*i);
         }
         drawables_.Clear();
+        drawableBoxes_.Clear();
         numDrawables_ = 0;
     }
 
@@ -105,26 +187,7 @@ Octant* Octant::GetOrCreateChild(unsigned index)
     if (children_[index])
         return children_[index];
 
-    Vector3 newMin = worldBoundingBox_.min_;
-    Vector3 newMax = worldBoundingBox_.max_;
-    Vector3 oldCenter = worldBoundingBox_.Center();
-
-    if (index & 1)
-        newMin.x_ = oldCenter.x_;
-    else
-        newMax.x_ = oldCenter.x_;
-
-    if (index & 2)
-        newMin.y_ = oldCenter.y_;
-    else
-        newMax.y_ = oldCenter.y_;
-
-    if (index & 4)
-        newMin.z_ = oldCenter.z_;
-    else
-        newMax.z_ = oldCenter.z_;
-
-    children_[index] = new Octant(BoundingBox(newMin, newMax), level_ + 1, this, root_, index);
+    children_[index] = new Octant(GetChildBox(worldBoundingBox_, index), level_ + 1, this, root_, index);
     return children_[index];
 }
 
@@ -148,49 +211,39 @@ void Octant::InsertDrawable(Drawable* drawable)
         insertHere = CheckDrawableFit(box);
 
     if (insertHere)
-    {
-        Octant* oldOctant = drawable->octant_;
-        if (oldOctant != this)
-        {
-            // Add first, then remove, because drawable count going to zero deletes the octree branch in question
-            AddDrawable(drawable);
-            if (oldOctant)
-                oldOctant->RemoveDrawable(drawable, false);
-        }
-    }
+        InsertDrawableHere(drawable, box);
     else
-    {
-        Vector3 boxCenter = box.Center();
-        unsigned x = boxCenter.x_ < center_.x_ ? 0 : 1;
-        unsigned y = boxCenter.y_ < center_.y_ ? 0 : 2;
-        unsigned z = boxCenter.z_ < center_.z_ ? 0 : 4;
+        GetOrCreateChild(GetChildIndex(center_, box.Center()))->InsertDrawable(drawable);
+}
 
-        GetOrCreateChild(x + y + z)->InsertDrawable(drawable);
-    }
+void Octant::InsertDrawable(Drawable* drawable, const BoundingBox& box, unsigned depth)
+{
+    Octant* octant = this;
+    Vector3 boxCenter = box.Center();
+
+    for (unsigned i = 0; i < depth; ++i)
+        octant = octant->GetOrCreateChild(GetChildIndex(octant->center_, boxCenter));
+
+    octant->InsertDrawableHere(drawable, box);
 }
 
 bool Octant::CheckDrawableFit(const BoundingBox& box) const
 {
-    Vector3 boxSize = box.Size();
-
-    // If max split level, size always OK, otherwise check that box is at least half size of octant
-    if (level_ >= root_->GetNumLevels() || boxSize.x_ >= halfSize_.x_ || boxSize.y_ >= halfSize_.y_ ||
-        boxSize.z_ >= halfSize_.z_)
-        return true;
-    // Also check if the box can not fit a child octant's culling box, in that case size OK (must insert here)
-    else
-    {
-        if (box.min_.x_ <= worldBoundingBox_.min_.x_ - 0.5f * halfSize_.x_ ||
-            box.max_.x_ >= worldBoundingBox_.max_.x_ + 0.5f * halfSize_.x_ ||
-            box.min_.y_ <= worldBoundingBox_.min_.y_ - 0.5f * halfSize_.y_ ||
-            box.max_.y_ >= worldBoundingBox_.max_.y_ + 0.5f * halfSize_.y_ ||
-            box.min_.z_ <= worldBoundingBox_.min_.z_ - 0.5f * halfSize_.z_ ||
-            box.max_.z_ >= worldBoundingBox_.max_.z_ + 0.5f * halfSize_.z_)
-            return true;
-    }
+    return Urho3D::CheckDrawableFit(box, worldBoundingBox_, halfSize_, level_, root_->GetNumLevels(), root_->GetLooseness());
+}
 
-    // Bounding box too small, should create a child octant
-    return false;
+void Octant::UpdateDrawableBox(unsigned index, const BoundingBox& box)
+{
+    DrawableBoxBlock& block = drawableBoxes_[index / DRAWABLE_BOX_BLOCK_SIZE];
+    unsigned lane = index % DRAWABLE_BOX_BLOCK_SIZE;
+
+    block.minX_[lane] = box.min_.x_;
+    block.minY_[lane] = box.min_.y_;
+    block.minZ_[lane] = box.min_.z_;
+    block.maxX_[lane] = box.max_.x_;
+    block.maxY_[lane] = box.max_.y_;
+    block.maxZ_[lane] = box.max_.z_;
+    block.dirtyMask_ &= ~(1 << lane);
 }
 
 void Octant::ResetRoot()
@@ -222,12 +275,77 @@ void Octant::DrawDebugGeometry(DebugRenderer* debug, bool depthTest)
     }
 }
 
-void Octant::Initialize(const BoundingBox& box)
+void Octant::Initialize(const BoundingBox& box, float looseness)
 {
     worldBoundingBox_ = box;
     center_ = box.Center();
     halfSize_ = 0.5f * box.Size();
-    cullingBox_ = BoundingBox(worldBoundingBox_.min_ - halfSize_, worldBoundingBox_.max_ + halfSize_);
+    Vector3 expand = (looseness - 1.0f) * halfSize_;
+    cullingBox_ = BoundingBox(worldBoundingBox_.min_ - expand, worldBoundingBox_.max_ + expand);
+}
+
+void Octant::InsertDrawableHere(Drawable* drawable, const BoundingBox& box)
+{
+    Octant* oldOctant = drawable->octant_;
+    if (oldOctant != this)
+    {
+        // Add first, then remove, because drawable count going to zero deletes the octree branch in question
+        unsigned oldIndex = drawable->octantIndex_;
+        AddDrawable(drawable);
+        if (oldOctant)
+            oldOctant->RemoveDrawableAt(oldIndex, false);
+    }
+
+    UpdateDrawableBox(drawable->octantIndex_, box);
+}
+
+void Octant::PushDrawable(Drawable* drawable)
+{
+    unsigned index = drawables_.Size();
+    drawable->SetOctant(this);
+    drawable->octantIndex_ = index;
+    drawables_.Push(drawable);
+
+    if (!(index % DRAWABLE_BOX_BLOCK_SIZE))
+        drawableBoxes_.Push(DrawableBoxBlock());
+
+    MarkDrawableBoxDirty(index);
+}
+
+void Octant::RemoveDrawableAt(unsigned index, bool resetOctant)
+{
+    Drawable* drawable = drawables_[index];
+    unsigned lastIndex = drawables_.Size() - 1;
+
+    if (index != lastIndex)
+    {
+        Drawable* lastDrawable = drawables_[lastIndex];
+        const DrawableBoxBlock& src = drawableBoxes_[lastIndex / DRAWABLE_BOX_BLOCK_SIZE];
+        DrawableBoxBlock& dest = drawableBoxes_[index / DRAWABLE_BOX_BLOCK_SIZE];
+        unsigned srcLane = lastIndex % DRAWABLE_BOX_BLOCK_SIZE;
+        unsigned destLane = index % DRAWABLE_BOX_BLOCK_SIZE;
+
+        dest.minX_[destLane] = src.minX_[srcLane];
+        dest.minY_[destLane] = src.minY_[srcLane];
+        dest.minZ_[destLane] = src.minZ_[srcLane];
+        dest.maxX_[destLane] = src.maxX_[srcLane];
+        dest.maxY_[destLane] = src.maxY_[srcLane];
+        dest.maxZ_[destLane] = src.maxZ_[srcLane];
+        dest.dirtyMask_ = (dest.dirtyMask_ & ~(1 << destLane)) | (((src.dirtyMask_ >> srcLane) & 1) << destLane);
+
+        drawables_[index] = lastDrawable;
+        lastDrawable->octantIndex_ = index;
+    }
+
+    drawables_.Pop();
+    if (!(lastIndex % DRAWABLE_BOX_BLOCK_SIZE))
+        drawableBoxes_.Pop();
+    else
+        drawableBoxes_[lastIndex / DRAWABLE_BOX_BLOCK_SIZE].dirtyMask_ &= ~(1 << (lastIndex % DRAWABLE_BOX_BLOCK_SIZE));
+
+    if (resetOctant)
+        drawable->SetOctant(0);
+    DecDrawableCount();
 }
 
 void Octant::GetDrawablesInternal(OctreeQuery& query, bool inside) const
@@ -248,7 +366,7 @@ void Octant::GetDrawablesInternal(OctreeQuery& query, bool inside) const
     {
         Drawable** start = const_cast<Drawable**>(&drawables_[0]);
         Drawable** end = start + drawables_.Size();
-        query.TestDrawables(start, end, inside);
+        query.TestDrawableBlocks(start, end, &drawableBoxes_[0], inside);
     }
 
     for (unsigned i = 0; i < NUM_OCTANTS; ++i)
@@ -315,7 +433,8 @@ void Octant::GetDrawablesOnlyInternal(RayOctreeQuery& query, PODVector<Drawable*
 Octree::Octree(Context* context) :
     Component(context),
     Octant(BoundingBox(-DEFAULT_OCTREE_SIZE, DEFAULT_OCTREE_SIZE), 0, 0, this),
-    numLevels_(DEFAULT_OCTREE_LEVELS)
+    numLevels_(DEFAULT_OCTREE_LEVELS),
+    looseness_(DEFAULT_OCTREE_LOOSENESS)
 {
     // If the engine is running headless, subscribe to RenderUpdate events for manually updating the octree
     // to allow raycasts and animation update
@@ -341,12 +460,14 @@ void Octree::RegisterObject(Context* context)
     URHO3D_ATTRIBUTE("Bounding Box Min", Vector3, worldBoundingBox_.min_, defaultBoundsMin, AM_DEFAULT);
     URHO3D_ATTRIBUTE("Bounding Box Max", Vector3, worldBoundingBox_.max_, defaultBoundsMax, AM_DEFAULT);
     URHO3D_ATTRIBUTE("Number of Levels", int, numLevels_, DEFAULT_OCTREE_LEVELS, AM_DEFAULT);
+    URHO3D_ATTRIBUTE("Looseness", float, looseness_, DEFAULT_OCTREE_LOOSENESS, AM_DEFAULT);
 }
 
 void Octree::OnSetAttribute(const AttributeInfo& attr, const Variant& src)
 {
     // If any of the (size) attributes change, resize the octree
     Serializable::OnSetAttribute(attr, src);
+    looseness_ = Clamp(looseness_, MIN_OCTREE_LOOSENESS, MAX_OCTREE_LOOSENESS);
     SetSize(worldBoundingBox_, numLevels_);
 }
 
@@ -368,11 +489,23 @@ void Octree::SetSize(const BoundingBox& box, unsigned numLevels)
     for (unsigned i = 0; i < NUM_OCTANTS; ++i)
         DeleteChild(i);
 
-    Initialize(box);
+    Initialize(box, looseness_);
     numDrawables_ = drawables_.Size();
     numLevels_ = (unsigned)Max((int)numLevels, 1);
 }
 
+void Octree::SetLooseness(float looseness)
+{
+    looseness = Clamp(looseness, MIN_OCTREE_LOOSENESS, MAX_OCTREE_LOOSENESS);
+    if (looseness != looseness_)
+    {
+        looseness_ = looseness;
+        // Octant culling boxes change, so rebuild the octree
+        SetSize(worldBoundingBox_, numLevels_);
+        MarkNetworkUpdate();
+    }
+}
+
 void Octree::Update(const FrameInfo& frame)
 {
     // Let drawables update themselves before reinsertion. This can be used for animation
@@ -386,30 +519,7 @@ void Octree::Update(const FrameInfo& frame)
         WorkQueue* queue = GetSubsystem<WorkQueue>();
         scene->BeginThreadedUpdate();
 
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = Max((int)(drawableUpdates_.Size() / numWorkItems), 1);
-
-        PODVector<Drawable*>::Iterator start = drawableUpdates_.Begin();
-        // Create a work item for each thread
-        for (int i = 0; i < numWorkItems; ++i)
-        {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = UpdateDrawablesWork;
-            item->aux_ = const_cast<FrameInfo*>(&frame);
-
-            PODVector<Drawable*>::Iterator end = drawableUpdates_.End();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
-
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
-
-            start = end;
-        }
-
-        queue->Complete(M_MAX_UNSIGNED);
+        queue->ParallelFor(drawableUpdates_, DRAWABLES_PER_WORK_ITEM, UpdateDrawablesWork, const_cast<FrameInfo*>(&frame));
         scene->EndThreadedUpdate();
     }
 
@@ -431,21 +541,49 @@ void Octree::Update(const FrameInfo& frame)
     {
         URHO3D_PROFILE(ReinsertToOctree);
 
-        for (PODVector<Drawable*>::Iterator i = drawableUpdates_.Begin(); i != drawableUpdates_.End(); ++i)
+        // Update the world bounding boxes in the main thread, as they are updated lazily from the scene nodes, and a
+        // drawable may read another's box. Drop duplicate entries at the same time
+        unsigned numUpdates = 0;
+        drawableUpdateBoxes_.Resize(drawableUpdates_.Size());
+        for (unsigned i = 0; i < drawableUpdates_.Size(); ++i)
         {
-            Drawable* drawable = *i;
-            drawable->updateQueued_ = false;
-            Octant* octant = drawable->GetOctant();
-            const BoundingBox& box = drawable->GetWorldBoundingBox();
+            Drawable* drawable = drawableUpdates_[i];
+            if (drawable && drawable->updateQueued_)
+            {
+                drawable->updateQueued_ = false;
+                drawableUpdates_[numUpdates] = drawable;
+                drawableUpdateBoxes_[numUpdates] = drawable->GetWorldBoundingBox();
+                ++numUpdates;
+            }
+        }
+        drawableUpdates_.Resize(numUpdates);
+        drawableUpdateBoxes_.Resize(numUpdates);
+
+        // Find the target octants in worker threads, as that only reads the octree and the calculated boxes. Then move
+        // the drawables in the main thread
+        drawableTargets_.Resize(numUpdates);
+        GetSubsystem<WorkQueue>()->ParallelFor(drawableUpdates_, DRAWABLES_PER_WORK_ITEM, FindDrawableTargetsWork, this);
+
+        for (unsigned i = 0; i < numUpdates; ++i)
+        {
+            Drawable* drawable = drawableUpdates_[i];
+            unsigned target = drawableTargets_[i];
+            if (target == TARGET_SKIP)
+                continue;
 
-            // Skip if no octant or does not belong to this octree anymore
+            // Check the current octant again, as moving an earlier drawable may have deleted an emptied octant
+            Octant* octant = drawable->GetOctant();
+            const BoundingBox& box = drawableUpdateBoxes_[i];
             if (!octant || octant->GetRoot() != this)
                 continue;
-            // Skip if still fits the current octant
-            if (drawable->IsOccludee() && octant->GetCullingBox().IsInside(box) == INSIDE && octant->CheckDrawableFit(box))
+            // If still fits the current octant, just refresh the packed bounding box used for culling
+            if (target == TARGET_STAY)
+            {
+                octant->UpdateDrawableBox(drawable->octantIndex_, box);
                 continue;
+            }
 
-            InsertDrawable(drawable);
+            InsertDrawable(drawable, box, target);
 
 #ifdef _DEBUG
             // Verify that the drawable will be culled correctly
@@ -462,6 +600,34 @@ void Octree::Update(const FrameInfo& frame)
     drawableUpdates_.Clear();
 }
 
+unsigned Octree::GetTargetDepth(Drawable* drawable, const BoundingBox& box) const
+{
+    Octant* octant = drawable->GetOctant();
+
+    // Skip if no octant or does not belong to this octree anymore
+    if (!octant || octant->GetRoot() != this)
+        return TARGET_SKIP;
+    // Skip if still fits the current octant
+    if (drawable->IsOccludee() && octant->GetCullingBox().IsInside(box) == INSIDE && octant->CheckDrawableFit(box))
+        return TARGET_STAY;
+    // Insert all non-occludees to the root, so that octant occlusion does not hide them. Also insert to root if outside its bounds
+    if (!drawable->IsOccludee() || cullingBox_.IsInside(box) != INSIDE)
+        return 0;
+
+    // Descend the same way as InsertDrawable(), but without creating octants
+    BoundingBox octantBox = worldBoundingBox_;
+    Vector3 boxCenter = box.Center();
+    unsigned level = 0;
+
+    while (!Urho3D::CheckDrawableFit(box, octantBox, 0.5f * octantBox.Size(), level, numLevels_, looseness_))
+    {
+        octantBox = GetChildBox(octantBox, GetChildIndex(octantBox.Center(), boxCenter));
+        ++level;
+    }
+
+    return level;
+}
+
 void Octree::AddManualDrawable(Drawable* drawable)
 {
     if (!drawable || drawable->GetOctant())
@@ -538,15 +704,26 @@ void Octree::RaycastSingle(RayOctreeQuery& query) const
 void Octree::QueueUpdate(Drawable* drawable)
 {
     Scene* scene = GetScene();
-    if (scene && scene->IsThreadedUpdate())
+    Octant* octant = drawable->GetOctant();
+    // Drawables may also be queued from worker threads during view preparation, when their bounding box depends on the camera
+    if ((scene && scene->IsThreadedUpdate()) || !Thread::IsMainThread())
     {
         MutexLock lock(octreeMutex_);
+        // Another thread may have queued the same drawable meanwhile
+        if (drawable->updateQueued_)
+            return;
         drawableUpdates_.Push(drawable);
+        if (octant)
+            octant->MarkDrawableBoxDirty(drawable->octantIndex_);
+        drawable->updateQueued_ = true;
     }
     else
+    {
         drawableUpdates_.Push(drawable);
-
-    drawable->updateQueued_ = true;
+        if (octant)
+            octant->MarkDrawableBoxDirty(drawable->octantIndex_);
+        drawable->updateQueued_ = true;
+    }
 }
 
 void Octree::CancelUpdate(Drawable* drawable)
@@ -50,26 +50,40 @@ public:
     void DeleteChild(unsigned index);
     /// Insert a drawable object by checking for fit recursively.
     void InsertDrawable(Drawable* drawable);
+    /// Insert a drawable object to a descendant octant at a precalculated depth, creating octants as necessary. Called internally.
+    void InsertDrawable(Drawable* drawable, const BoundingBox& box, unsigned depth);
     /// Check if a drawable object fits.
     bool CheckDrawableFit(const BoundingBox& box) const;
 
     /// Add a drawable object to this octant.
     void AddDrawable(Drawable* drawable)
     {
-        drawable->SetOctant(this);
-        drawables_.Push(drawable);
+        PushDrawable(drawable);
         IncDrawableCount();
     }
 
     /// Remove a drawable object from this octant.
     void RemoveDrawable(Drawable* drawable, bool resetOctant = true)
     {
-        if (drawables_.Remove(drawable))
+        unsigned index = drawable->octantIndex_;
+        if (index >= drawables_.Size() || drawables_[index] != drawable)
         {
-            if (resetOctant)
-                drawable->SetOctant(0);
-            DecDrawableCount();
+            PODVector<Drawable*>::ConstIterator i = drawables_.Find(drawable);
+            if (i == drawables_.End())
+                return;
+            index = (unsigned)(i - drawables_.Begin());
         }
+
+        RemoveDrawableAt(index, resetOctant);
+    }
+
+    /// Update the packed world bounding box of a drawable object in this octant. Called internally.
+    void UpdateDrawableBox(unsigned index, const BoundingBox& box);
+
+    /// Mark the packed world bounding box of a drawable object in this octant out of date. Called internally.
+    void MarkDrawableBoxDirty(unsigned index)
+    {
+        drawableBoxes_[index / DRAWABLE_BOX_BLOCK_SIZE].dirtyMask_ |= 1 << (index % DRAWABLE_BOX_BLOCK_SIZE);
     }
 
     /// Return world-space bounding box.
@@ -99,8 +113,14 @@ public:
     void DrawDebugGeometry(DebugRenderer* debug, bool depthTest);
 
 protected:
-    /// Initialize bounding box.
-    void Initialize(const BoundingBox& box);
+    /// Initialize bounding box. Looseness is the size of the culling box relative to the octant.
+    void Initialize(const BoundingBox& box, float looseness);
+    /// Insert a drawable object to this octant, removing it from its previous octant.
+    void InsertDrawableHere(Drawable* drawable, const BoundingBox& box);
+    /// Append a drawable object to the drawable list without changing the drawable count. Its packed bounding box starts out of date.
+    void PushDrawable(Drawable* drawable);
+    /// Remove a drawable object by list index, moving the last drawable into its place.
+    void RemoveDrawableAt(unsigned index, bool resetOctant);
     /// Return drawable objects by a query, called internally.
     void GetDrawablesInternal(OctreeQuery& query, bool inside) const;
     /// Return drawable objects by a ray query, called internally.
@@ -138,6 +158,8 @@ protected:
     BoundingBox cullingBox_;
     /// Drawable objects.
     PODVector<Drawable*> drawables_;
+    /// Packed world bounding boxes of the drawable objects, in the same order.
+    PODVector<DrawableBoxBlock> drawableBoxes_;
     /// Child octants.
     Octant* children_[NUM_OCTANTS];
     /// World bounding box center.
@@ -160,6 +182,7 @@ protected:
 class URHO3D_API Octree : public Component, public Octant
 {
     friend void RaycastDrawablesWork(const WorkItem* item, unsigned threadIndex);
+    friend void FindDrawableTargetsWork(const WorkItem* item, unsigned threadIndex);
 
     URHO3D_OBJECT(Octree, Component);
 
@@ -178,6 +201,8 @@ public:
 
     /// Set size and maximum subdivision levels. If octree is not empty, drawable objects will be temporarily moved to the root.
     void SetSize(const BoundingBox& box, unsigned numLevels);
+    /// Set size of octant culling boxes relative to the octants, between 1.25 and 4. Default 2. A looser octree culls less tightly, but moving drawables need to be reinserted less often.
+    void SetLooseness(float looseness);
     /// Update and reinsert drawable objects.
     void Update(const FrameInfo& frame);
     /// Add a drawable manually.
@@ -195,6 +220,9 @@ public:
     /// Return subdivision levels.
     unsigned GetNumLevels() const { return numLevels_; }
 
+    /// Return octant culling box size relative to the octants.
+    float GetLooseness() const { return looseness_; }
+
     /// Mark drawable object as requiring an update and a reinsertion.
     void QueueUpdate(Drawable* drawable);
     /// Cancel drawable object's update.
@@ -205,17 +233,25 @@ public:
 private:
     /// Handle render update in case of headless execution.
     void HandleRenderUpdate(StringHash eventType, VariantMap& eventData);
+    /// Return the depth of the octant a queued drawable object with the specified world bounding box should move to, or a special value if it stays or is skipped. Does not modify the octree or the drawable.
+    unsigned GetTargetDepth(Drawable* drawable, const BoundingBox& box) const;
 
     /// Drawable objects that require update.
     PODVector<Drawable*> drawableUpdates_;
     /// Drawable objects that require reinsertion.
     PODVector<Drawable*> drawableReinsertions_;
+    /// World bounding boxes of the drawable objects that require update, calculated before reinsertion.
+    PODVector<BoundingBox> drawableUpdateBoxes_;
+    /// Target octant depths of the drawable objects that require update, calculated before reinsertion.
+    PODVector<unsigned> drawableTargets_;
     /// Mutex for octree reinsertions.
     Mutex octreeMutex_;
     /// Ray query temporary list of drawables.
     mutable PODVector<Drawable*> rayQueryDrawables_;
     /// Subdivision level.
     unsigned numLevels_;
+    /// Octant culling box size relative to the octants.
+    float looseness_;
 };
 
 }
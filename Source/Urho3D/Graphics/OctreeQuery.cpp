@@ -24,11 +24,174 @@
 
 #include "../Graphics/OctreeQuery.h"
 
+#ifdef URHO3D_SSE
+#include <xmmintrin.h>
+#endif
+
 #include "../DebugNew.h"
 
 namespace Urho3D
 {
 
+/// Maximum number of drawables collected from packed box blocks before passing them on for the per-drawable test.
+static const unsigned DRAWABLE_BATCH_SIZE = 64;
+
+/// Return bitmask of drawables in a packed box block that are (partially) inside a frustum. Same arithmetic as Frustum::IsInsideFast().
+static unsigned TestBoxBlock(const Frustum& frustum, const DrawableBoxBlock& block)
+{
+#ifdef URHO3D_SSE
+    __m128 minX = _mm_loadu_ps(block.minX_);
+    __m128 minY = _mm_loadu_ps(block.minY_);
+    __m128 minZ = _mm_loadu_ps(block.minZ_);
+    __m128 half = _mm_set1_ps(0.5f);
+    __m128 centerX = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(block.maxX_), minX), half);
+    __m128 centerY = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(block.maxY_), minY), half);
+    __m128 centerZ = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(block.maxZ_), minZ), half);
+    __m128 edgeX = _mm_sub_ps(centerX, minX);
+    __m128 edgeY = _mm_sub_ps(centerY, minY);
+    __m128 edgeZ = _mm_sub_ps(centerZ, minZ);
+    __m128 outside = _mm_setzero_ps();
+
+    for (unsigned i = 0; i < NUM_FRUSTUM_PLANES; ++i)
+    {
+        const Plane& plane = frustum.planes_[i];
+        __m128 dist = _mm_mul_ps(_mm_set1_ps(plane.normal_.x_), centerX);
+        dist = _mm_add_ps(dist, _mm_mul_ps(_mm_set1_ps(plane.normal_.y_), centerY));
+        dist = _mm_add_ps(dist, _mm_mul_ps(_mm_set1_ps(plane.normal_.z_), centerZ));
+        dist = _mm_add_ps(dist, _mm_set1_ps(plane.d_));
+        __m128 absDist = _mm_mul_ps(_mm_set1_ps(plane.absNormal_.x_), edgeX);
+        absDist = _mm_add_ps(absDist, _mm_mul_ps(_mm_set1_ps(plane.absNormal_.y_), edgeY));
+        absDist = _mm_add_ps(absDist, _mm_mul_ps(_mm_set1_ps(plane.absNormal_.z_), edgeZ));
+
+        outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, _mm_sub_ps(_mm_setzero_ps(), absDist)));
+        if (_mm_movemask_ps(outside) == 0xf)
+            return 0;
+    }
+
+    return (unsigned)~_mm_movemask_ps(outside) & 0xf;
+#else
+    unsigned mask = 0;
+
+    for (unsigned i = 0; i < DRAWABLE_BOX_BLOCK_SIZE; ++i)
+    {
+        Vector3 center((block.maxX_[i] + block.minX_[i]) * 0.5f, (block.maxY_[i] + block.minY_[i]) * 0.5f,
+            (block.maxZ_[i] + block.minZ_[i]) * 0.5f);
+        Vector3 edge(center.x_ - block.minX_[i], center.y_ - block.minY_[i], center.z_ - block.minZ_[i]);
+        bool inside = true;
+
+        for (unsigned j = 0; j < NUM_FRUSTUM_PLANES; ++j)
+        {
+            const Plane& plane = frustum.planes_[j];
+            if (plane.normal_.DotProduct(center) + plane.d_ < -plane.absNormal_.DotProduct(edge))
+            {
+                inside = false;
+                break;
+            }
+        }
+
+        if (inside)
+            mask |= 1 << i;
+    }
+
+    return mask;
+#endif
+}
+
+#ifdef URHO3D_SSE
+/// Return per-lane distance from a sphere center coordinate to a box slab, or zero if inside the slab.
+static inline __m128 SlabDistance(__m128 center, __m128 min, __m128 max)
+{
+    __m128 below = _mm_cmplt_ps(center, min);
+    __m128 above = _mm_cmpgt_ps(center, max);
+    return _mm_or_ps(_mm_and_ps(below, _mm_sub_ps(center, min)),
+        _mm_andnot_ps(below, _mm_and_ps(above, _mm_sub_ps(center, max))));
+}
+#else
+/// Return distance from a sphere center coordinate to a box slab, or zero if inside the slab.
+static inline float SlabDistance(float center, float min, float max)
+{
+    if (center < min)
+        return center - min;
+    else if (center > max)
+        return center - max;
+    else
+        return 0.0f;
+}
+#endif
+
+/// Return bitmask of drawables in a packed box block that are (partially) inside a sphere. Same arithmetic as Sphere::IsInsideFast().
+static unsigned TestBoxBlock(const Sphere& sphere, const DrawableBoxBlock& block)
+{
+    float radiusSquared = sphere.radius_ * sphere.radius_;
+
+#ifdef URHO3D_SSE
+    __m128 x = SlabDistance(_mm_set1_ps(sphere.center_.x_), _mm_loadu_ps(block.minX_), _mm_loadu_ps(block.maxX_));
+    __m128 y = SlabDistance(_mm_set1_ps(sphere.center_.y_), _mm_loadu_ps(block.minY_), _mm_loadu_ps(block.maxY_));
+    __m128 z = SlabDistance(_mm_set1_ps(sphere.center_.z_), _mm_loadu_ps(block.minZ_), _mm_loadu_ps(block.maxZ_));
+    __m128 distSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+
+    return (unsigned)~_mm_movemask_ps(_mm_cmpge_ps(distSquared, _mm_set1_ps(radiusSquared))) & 0xf;
+#else
+    unsigned mask = 0;
+
+    for (unsigned i = 0; i < DRAWABLE_BOX_BLOCK_SIZE; ++i)
+    {
+        float x = SlabDistance(sphere.center_.x_, block.minX_[i], block.maxX_[i]);
+        float y = SlabDistance(sphere.center_.y_, block.minY_[i], block.maxY_[i]);
+        float z = SlabDistance(sphere.center_.z_, block.minZ_[i], block.maxZ_[i]);
+        if (!(x * x + y * y + z * z >= radiusSquared))
+            mask |= 1 << i;
+    }
+
+    return mask;
+#endif
+}
+
+/// Cull drawables against a volume using their packed bounding boxes, then pass the survivors to the query's per-drawable
+/// test as already inside. Drawables with out of date packed boxes are passed on to be tested individually.
+template <class T> static void CullDrawableBlocks(OctreeQuery& query, const T& volume, Drawable** start, Drawable** end,
+    const DrawableBoxBlock* blocks)
+{
+    Drawable* passed[DRAWABLE_BATCH_SIZE];
+    Drawable* untested[DRAWABLE_BATCH_SIZE];
+    unsigned numPassed = 0;
+    unsigned numUntested = 0;
+
+    while (start != end)
+    {
+        const DrawableBoxBlock& block = *blocks++;
+        unsigned count = (unsigned)(end - start);
+        if (count > DRAWABLE_BOX_BLOCK_SIZE)
+            count = DRAWABLE_BOX_BLOCK_SIZE;
+        unsigned insideMask = TestBoxBlock(volume, block) & ~block.dirtyMask_;
+
+        for (unsigned i = 0; i < count; ++i)
+        {
+            if (insideMask & (1 << i))
+                passed[numPassed++] = start[i];
+            else if (block.dirtyMask_ & (1 << i))
+                untested[numUntested++] = start[i];
+        }
+        start += count;
+
+        if (numPassed > DRAWABLE_BATCH_SIZE - DRAWABLE_BOX_BLOCK_SIZE)
+        {
+            query.TestDrawables(passed, passed + numPassed, true);
+            numPassed = 0;
+        }
+        if (numUntested > DRAWABLE_BATCH_SIZE - DRAWABLE_BOX_BLOCK_SIZE)
+        {
+            query.TestDrawables(untested, untested + numUntested, false);
+            numUntested = 0;
+        }
+    }
+
+    if (numPassed)
+        query.TestDrawables(passed, passed + numPassed, true);
+    if (numUntested)
+        query.TestDrawables(untested, untested + numUntested, false);
+}
+
 Intersection PointOctreeQuery::TestOctant(const BoundingBox& box, bool inside)
 {
     if (inside)
@@ -73,6 +236,14 @@ void SphereOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool ins
     }
 }
 
+void SphereOctreeQuery::TestDrawableBlocks(Drawable** start, Drawable** end, const DrawableBoxBlock* blocks, bool inside)
+{
+    if (inside)
+        TestDrawables(start, end, true);
+    else
+        CullDrawableBlocks(*this, sphere_, start, end, blocks);
+}
+
 Intersection BoxOctreeQuery::TestOctant(const BoundingBox& box, bool inside)
 {
     if (inside)
@@ -117,6 +288,14 @@ void FrustumOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool in
     }
 }
 
+void FrustumOctreeQuery::TestDrawableBlocks(Drawable** start, Drawable** end, const DrawableBoxBlock* blocks, bool inside)
+{
+    if (inside)
+        TestDrawables(start, end, true);
+    else
+        CullDrawableBlocks(*this, frustum_, start, end, blocks);
+}
+
 
 Intersection AllContentOctreeQuery::TestOctant(const BoundingBox& box, bool inside)
 {
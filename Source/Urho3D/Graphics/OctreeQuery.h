@@ -34,6 +34,28 @@ namespace Urho3D
 class Drawable;
 class Node;
 
+/// Number of drawables in a packed bounding box block.
+static const unsigned DRAWABLE_BOX_BLOCK_SIZE = 4;
+
+/// World bounding boxes of consecutive drawables in an octant, packed as structure-of-arrays for batched culling.
+struct DrawableBoxBlock
+{
+    /// Minimum X coordinates.
+    float minX_[DRAWABLE_BOX_BLOCK_SIZE];
+    /// Minimum Y coordinates.
+    float minY_[DRAWABLE_BOX_BLOCK_SIZE];
+    /// Minimum Z coordinates.
+    float minZ_[DRAWABLE_BOX_BLOCK_SIZE];
+    /// Maximum X coordinates.
+    float maxX_[DRAWABLE_BOX_BLOCK_SIZE];
+    /// Maximum Y coordinates.
+    float maxY_[DRAWABLE_BOX_BLOCK_SIZE];
+    /// Maximum Z coordinates.
+    float maxZ_[DRAWABLE_BOX_BLOCK_SIZE];
+    /// Bitmask of drawables whose packed bounding box is out of date and which must be tested individually.
+    unsigned dirtyMask_;
+};
+
 /// Base class for octree queries.
 class URHO3D_API OctreeQuery
 {
@@ -55,6 +77,11 @@ public:
     virtual Intersection TestOctant(const BoundingBox& box, bool inside) = 0;
     /// Intersection test for drawables.
     virtual void TestDrawables(Drawable** start, Drawable** end, bool inside) = 0;
+    /// Intersection test for drawables of an octant, with their world bounding boxes packed into blocks. By default tests each drawable with TestDrawables().
+    virtual void TestDrawableBlocks(Drawable** start, Drawable** end, const DrawableBoxBlock* blocks, bool inside)
+    {
+        TestDrawables(start, end, inside);
+    }
 
     /// Result vector reference.
     PODVector<Drawable*>& result_;
@@ -107,6 +134,8 @@ public:
     virtual Intersection TestOctant(const BoundingBox& box, bool inside);
     /// Intersection test for drawables.
     virtual void TestDrawables(Drawable** start, Drawable** end, bool inside);
+    /// Batched intersection test for drawables with packed bounding boxes.
+    virtual void TestDrawableBlocks(Drawable** start, Drawable** end, const DrawableBoxBlock* blocks, bool inside);
 
     /// Sphere.
     Sphere sphere_;
@@ -149,6 +178,8 @@ public:
     virtual Intersection TestOctant(const BoundingBox& box, bool inside);
     /// Intersection test for drawables.
     virtual void TestDrawables(Drawable** start, Drawable** end, bool inside);
+    /// Batched intersection test for drawables with packed bounding boxes.
+    virtual void TestDrawableBlocks(Drawable** start, Drawable** end, const DrawableBoxBlock* blocks, bool inside);
 
     /// Frustum.
     Frustum frustum_;
@@ -54,6 +54,8 @@
 namespace Urho3D
 {
 
+static const unsigned DRAWABLES_PER_WORK_ITEM = 32;
+
 static const Vector3* directions[] =
 {
     &Vector3::RIGHT,
@@ -238,9 +240,11 @@ void CheckVisibilityWork(const WorkItem* item, unsigned threadIndex)
 void ProcessLightWork(const WorkItem* item, unsigned threadIndex)
 {
     View* view = reinterpret_cast<View*>(item->aux_);
-    LightQueryResult* query = reinterpret_cast<LightQueryResult*>(item->start_);
+    LightQueryResult* start = reinterpret_cast<LightQueryResult*>(item->start_);
+    LightQueryResult* end = reinterpret_cast<LightQueryResult*>(item->end_);
 
-    view->ProcessLight(*query, threadIndex);
+    while (start != end)
+        view->ProcessLight(*start++, threadIndex);
 }
 
 void UpdateDrawableGeometriesWork(const WorkItem* item, unsigned threadIndex)
@@ -889,30 +893,7 @@ void View::GetDrawables()
             result.maxZ_ = 0.0f;
         }
 
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = tempDrawables.Size() / numWorkItems;
-
-        PODVector<Drawable*>::Iterator start = tempDrawables.Begin();
-        // Create a work item for each thread
-        for (int i = 0; i < numWorkItems; ++i)
-        {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = CheckVisibilityWork;
-            item->aux_ = this;
-
-            PODVector<Drawable*>::Iterator end = tempDrawables.End();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
-
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
-
-            start = end;
-        }
-
-        queue->Complete(M_MAX_UNSIGNED);
+        queue->ParallelFor(tempDrawables, DRAWABLES_PER_WORK_ITEM, CheckVisibilityWork, this);
     }
 
     // Combine lights, geometries & scene Z range from the threads
@@ -978,21 +959,14 @@ void View::ProcessLights()
     lightQueryResults_.Resize(lights_.Size());
 
     for (unsigned i = 0; i < lightQueryResults_.Size(); ++i)
-    {
-        SharedPtr<WorkItem> item = queue->GetFreeItem();
-        item->priority_ = M_MAX_UNSIGNED;
-        item->workFunction_ = ProcessLightWork;
-        item->aux_ = this;
-
-        LightQueryResult& query = lightQueryResults_[i];
-        query.light_ = lights_[i];
+        lightQueryResults_[i].light_ = lights_[i];
 
-        item->start_ = &query;
-        queue->AddWorkItem(item);
+    // Process each light in its own work item, and ensure all lights have been processed before proceeding
+    if (lightQueryResults_.Size())
+    {
+        queue->ParallelFor(&lightQueryResults_.Front(), &lightQueryResults_.Front() + lightQueryResults_.Size(), 1,
+            ProcessLightWork, this);
     }
-
-    // Ensure all lights have been processed before proceeding
-    queue->Complete(M_MAX_UNSIGNED);
 }
 
 void View::GetLightBatches()
@@ -1329,26 +1303,9 @@ void View::UpdateGeometries()
                 }
             }
 
-            int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-            int drawablesPerItem = threadedGeometries_.Size() / numWorkItems;
-
-            PODVector<Drawable*>::Iterator start = threadedGeometries_.Begin();
-            for (int i = 0; i < numWorkItems; ++i)
-            {
-                PODVector<Drawable*>::Iterator end = threadedGeometries_.End();
-                if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                    end = start + drawablesPerItem;
-
-                SharedPtr<WorkItem> item = queue->GetFreeItem();
-                item->priority_ = M_MAX_UNSIGNED;
-                item->workFunction_ = UpdateDrawableGeometriesWork;
-                item->aux_ = const_cast<FrameInfo*>(&frame_);
-                item->start_ = &(*start);
-                item->end_ = &(*end);
-                queue->AddWorkItem(item);
-
-                start = end;
-            }
+            // Do not wait here, as the main thread has its own geometry updates to do in the meanwhile
+            queue->AddWorkItems(&threadedGeometries_.Front(), threadedGeometries_.Size(), sizeof(Drawable*), DRAWABLES_PER_WORK_ITEM,
+                UpdateDrawableGeometriesWork, const_cast<FrameInfo*>(&frame_));
         }
 
         // While the work queue is processed, update non-threaded geometries
@@ -2801,7 +2758,7 @@ void View::AddBatchToQueue(BatchQueue& batchQueue, Batch& batch, Technique* tech
     {
         BatchGroupKey key(batch);
 
-        HashMap<BatchGroupKey, BatchGroup>::Iterator i = batchQueue.batchGroups_.Find(key);
+        FlatHashMap<BatchGroupKey, BatchGroup>::Iterator i = batchQueue.batchGroups_.Find(key);
         if (i == batchQueue.batchGroups_.End())
         {
             // Create a new group based on the batch
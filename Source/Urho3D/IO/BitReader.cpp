@@ -0,0 +1,151 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../IO/BitReader.h"
+#include "../Math/Quaternion.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Maximum absolute value of a quaternion component that is not the largest.
+static const float SMALLEST_THREE_RANGE = 0.707107f;
+
+BitReader::BitReader(Deserializer& source) :
+    Deserializer(source.GetSize() > source.GetPosition() ? source.GetSize() - source.GetPosition() : 0),
+    source_(source),
+    startPosition_(source.GetPosition()),
+    current_(0),
+    bitsLeft_(0)
+{
+}
+
+unsigned BitReader::Read(void* dest, unsigned size)
+{
+    if (!bitsLeft_)
+    {
+        if (size > size_ - position_)
+            size = size_ - position_;
+        unsigned read = source_.Read(dest, size);
+        position_ += read;
+        return read;
+    }
+
+    unsigned char* bytes = (unsigned char*)dest;
+    unsigned read = 0;
+    while (read < size && GetNumBitsLeft() >= 8)
+        bytes[read++] = (unsigned char)ReadBits(8);
+    return read;
+}
+
+unsigned BitReader::Seek(unsigned position)
+{
+    if (position > size_)
+        position = size_;
+
+    position_ = source_.Seek(startPosition_ + position) - startPosition_;
+    current_ = 0;
+    bitsLeft_ = 0;
+    return position_;
+}
+
+unsigned BitReader::ReadBits(unsigned numBits)
+{
+    unsigned value = 0;
+    unsigned shift = 0;
+
+    while (numBits)
+    {
+        if (!bitsLeft_)
+        {
+            if (position_ >= size_)
+                break;
+            current_ = source_.ReadUByte();
+            ++position_;
+            bitsLeft_ = 8;
+        }
+
+        unsigned count = bitsLeft_ < numBits ? bitsLeft_ : numBits;
+        value |= ((unsigned)(current_ >> (8 - bitsLeft_)) & ((1u << count) - 1)) << shift;
+        shift += count;
+        numBits -= count;
+        bitsLeft_ -= count;
+    }
+
+    return value;
+}
+
+bool BitReader::ReadBit()
+{
+    return ReadBits(1) != 0;
+}
+
+unsigned BitReader::ReadVarUInt()
+{
+    unsigned value = 0;
+    for (unsigned shift = 0; shift < 35; shift += 7)
+    {
+        unsigned group = ReadBits(8);
+        value |= (group & 0x7f) << shift;
+        if (!(group & 0x80))
+            break;
+    }
+
+    return value;
+}
+
+int BitReader::ReadVarInt()
+{
+    unsigned value = ReadVarUInt();
+    return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
+float BitReader::ReadQuantizedFloat(float min, float max, unsigned numBits)
+{
+    unsigned maxValue = (1u << numBits) - 1;
+    return min + (max - min) * (float)ReadBits(numBits) / (float)maxValue;
+}
+
+Quaternion BitReader::ReadSmallestThreeQuaternion(unsigned numBits)
+{
+    unsigned largest = ReadBits(2);
+    float components[4];
+    float sumSquares = 0.0f;
+
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        if (i != largest)
+        {
+            components[i] = ReadQuantizedFloat(-SMALLEST_THREE_RANGE, SMALLEST_THREE_RANGE, numBits);
+            sumSquares += components[i] * components[i];
+        }
+    }
+
+    components[largest] = sqrtf(Max(1.0f - sumSquares, 0.0f));
+    return Quaternion(components).Normalized();
+}
+
+}
@@ -0,0 +1,70 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../IO/Deserializer.h"
+
+namespace Urho3D
+{
+
+/// Bit-level stream reader on top of another stream, reading the format written by BitWriter. Only consumes the source bytes that contain the bits read.
+class URHO3D_API BitReader : public Deserializer
+{
+public:
+    /// Construct with source stream. The size is the remaining size of the source.
+    BitReader(Deserializer& source);
+
+    /// Read bytes from the stream. Return number of bytes actually read.
+    virtual unsigned Read(void* dest, unsigned size);
+    /// Set position in bytes from the current position of the source at construction. Discards the partially read byte.
+    virtual unsigned Seek(unsigned position);
+
+    /// Read bits into the low bits of a value, up to 32. Missing bits at the end of the stream read as zero.
+    unsigned ReadBits(unsigned numBits);
+    /// Read a single bit.
+    bool ReadBit();
+    /// Read an unsigned integer written with BitWriter::WriteVarUInt().
+    unsigned ReadVarUInt();
+    /// Read a signed integer written with BitWriter::WriteVarInt().
+    int ReadVarInt();
+    /// Read a quantized float.
+    float ReadQuantizedFloat(float min, float max, unsigned numBits);
+    /// Read a quaternion written as its three smallest components.
+    Quaternion ReadSmallestThreeQuaternion(unsigned numBits);
+
+    /// Return number of unread bits.
+    unsigned GetNumBitsLeft() const { return (size_ - position_) * 8 + bitsLeft_; }
+
+private:
+    /// Source stream.
+    Deserializer& source_;
+    /// Position of the source at construction.
+    unsigned startPosition_;
+    /// Partially read byte.
+    unsigned char current_;
+    /// Number of unread bits in the partially read byte.
+    unsigned bitsLeft_;
+};
+
+}
@@ -0,0 +1,148 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../IO/BitWriter.h"
+#include "../Math/Quaternion.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Maximum absolute value of a quaternion component that is not the largest.
+static const float SMALLEST_THREE_RANGE = 0.707107f;
+
+BitWriter::BitWriter(Serializer& dest) :
+    dest_(dest),
+    current_(0),
+    bitPosition_(0),
+    numBits_(0)
+{
+}
+
+BitWriter::~BitWriter()
+{
+    Flush();
+}
+
+unsigned BitWriter::Write(const void* data, unsigned size)
+{
+    if (!bitPosition_)
+    {
+        unsigned written = dest_.Write(data, size);
+        numBits_ += written * 8;
+        return written;
+    }
+
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (unsigned i = 0; i < size; ++i)
+        WriteBits(bytes[i], 8);
+    return size;
+}
+
+void BitWriter::WriteBits(unsigned value, unsigned numBits)
+{
+    while (numBits)
+    {
+        unsigned count = 8 - bitPosition_;
+        if (count > numBits)
+            count = numBits;
+
+        current_ |= (unsigned char)((value & ((1u << count) - 1)) << bitPosition_);
+        value >>= count;
+        numBits -= count;
+        numBits_ += count;
+        bitPosition_ += count;
+
+        if (bitPosition_ == 8)
+        {
+            dest_.WriteUByte(current_);
+            current_ = 0;
+            bitPosition_ = 0;
+        }
+    }
+}
+
+void BitWriter::WriteBit(bool value)
+{
+    WriteBits(value ? 1 : 0, 1);
+}
+
+void BitWriter::WriteVarUInt(unsigned value)
+{
+    do
+    {
+        unsigned group = value & 0x7f;
+        value >>= 7;
+        WriteBits(value ? group | 0x80 : group, 8);
+    }
+    while (value);
+}
+
+void BitWriter::WriteVarInt(int value)
+{
+    WriteVarUInt(((unsigned)value << 1) ^ (unsigned)(value >> 31));
+}
+
+void BitWriter::WriteQuantizedFloat(float value, float min, float max, unsigned numBits)
+{
+    unsigned maxValue = (1u << numBits) - 1;
+    float t = max > min ? Clamp((value - min) / (max - min), 0.0f, 1.0f) : 0.0f;
+    WriteBits((unsigned)(t * (float)maxValue + 0.5f), numBits);
+}
+
+void BitWriter::WriteSmallestThreeQuaternion(const Quaternion& value, unsigned numBits)
+{
+    Quaternion normalized = value.Normalized();
+    const float* components = normalized.Data();
+
+    unsigned largest = 0;
+    for (unsigned i = 1; i < 4; ++i)
+    {
+        if (Abs(components[i]) > Abs(components[largest]))
+            largest = i;
+    }
+
+    // The quaternion and its negation are the same rotation, so flip the sign to make the omitted component positive
+    float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+    WriteBits(largest, 2);
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        if (i != largest)
+            WriteQuantizedFloat(components[i] * sign, -SMALLEST_THREE_RANGE, SMALLEST_THREE_RANGE, numBits);
+    }
+}
+
+void BitWriter::Flush()
+{
+    if (bitPosition_)
+    {
+        dest_.WriteUByte(current_);
+        current_ = 0;
+        bitPosition_ = 0;
+    }
+}
+
+}
@@ -0,0 +1,72 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../IO/Serializer.h"
+
+namespace Urho3D
+{
+
+/// Bit-level stream writer on top of another stream. Whole bytes written at byte boundaries are passed through as is, so the output only differs from the destination stream's own format where partial bit values are written.
+class URHO3D_API BitWriter : public Serializer
+{
+public:
+    /// Construct with destination stream.
+    BitWriter(Serializer& dest);
+    /// Destruct. Write the remaining bits.
+    virtual ~BitWriter();
+
+    /// Write bytes to the stream. Return number of bytes actually written.
+    virtual unsigned Write(const void* data, unsigned size);
+
+    /// Write the low bits of a value, up to 32.
+    void WriteBits(unsigned value, unsigned numBits);
+    /// Write a single bit.
+    void WriteBit(bool value);
+    /// Write an unsigned integer in groups of 7 bits, each followed by a continuation bit.
+    void WriteVarUInt(unsigned value);
+    /// Write a signed integer as a zigzag encoded variable-length value.
+    void WriteVarInt(int value);
+    /// Write a float quantized to a range using the specified number of bits, up to 24.
+    void WriteQuantizedFloat(float value, float min, float max, unsigned numBits);
+    /// Write a rotation quaternion as its three smallest components using the specified number of bits for each.
+    void WriteSmallestThreeQuaternion(const Quaternion& value, unsigned numBits);
+    /// Write the remaining partial byte, padded with zero bits.
+    void Flush();
+
+    /// Return number of bits written, excluding padding.
+    unsigned GetNumBits() const { return numBits_; }
+
+private:
+    /// Destination stream.
+    Serializer& dest_;
+    /// Partially written byte.
+    unsigned char current_;
+    /// Number of bits used in the partially written byte.
+    unsigned bitPosition_;
+    /// Number of bits written.
+    unsigned numBits_;
+};
+
+}
@@ -55,6 +55,15 @@ unsigned DecompressData(void* dest, const void* src, unsigned destSize)
         return (unsigned)LZ4_decompress_fast((const char*)src, (char*)dest, destSize);
 }
 
+unsigned DecompressDataSafe(void* dest, const void* src, unsigned srcSize, unsigned maxDestSize)
+{
+    if (!dest || !src || !srcSize || !maxDestSize)
+        return 0;
+
+    int destSize = LZ4_decompress_safe((const char*)src, (char*)dest, srcSize, maxDestSize);
+    return destSize > 0 ? (unsigned)destSize : 0;
+}
+
 bool CompressStream(Serializer& dest, Deserializer& src)
 {
     unsigned srcSize = src.GetSize() - src.GetPosition();
@@ -41,6 +41,8 @@ URHO3D_API unsigned EstimateCompressBound(unsigned srcSize);
 URHO3D_API unsigned CompressData(void* dest, const void* src, unsigned srcSize);
 /// Uncompress data using the LZ4 algorithm. The uncompressed data size must be known. Return the number of compressed data bytes consumed.
 URHO3D_API unsigned DecompressData(void* dest, const void* src, unsigned destSize);
+/// Uncompress data of known compressed size using the LZ4 algorithm, without reading or writing outside the buffers. Safe to use on untrusted data. Return the uncompressed data size, or 0 if the data is malformed or does not fit the destination.
+URHO3D_API unsigned DecompressDataSafe(void* dest, const void* src, unsigned srcSize, unsigned maxDestSize);
 /// Compress a source stream (from current position to the end) to the destination stream using the LZ4 algorithm. Return true on success.
 URHO3D_API bool CompressStream(Serializer& dest, Deserializer& src);
 /// Decompress a compressed source stream produced using CompressStream() to the destination stream. Return true on success.
@@ -23,6 +23,8 @@
 #include "../Precompiled.h"
 
 #include "../Core/Profiler.h"
+#include "../Core/Thread.h"
+#include "../Core/WorkQueue.h"
 #include "../IO/File.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
@@ -60,6 +62,30 @@ const char* APK = "/apk/";
 static const unsigned READ_BUFFER_SIZE = 32768;
 #endif
 static const unsigned SKIP_BUFFER_SIZE = 1024;
+/// Size of the header preceding each compressed block.
+static const unsigned BLOCK_HEADER_SIZE = 4;
+/// Minimum number of whole compressed blocks in a read to decompress them in worker threads.
+static const unsigned MIN_PARALLEL_BLOCKS = 4;
+
+/// Compressed block decompression task.
+struct DecompressBlockTask
+{
+    /// Compressed data.
+    const unsigned char* source_;
+    /// Destination for the decompressed data.
+    unsigned char* dest_;
+    /// Decompressed size.
+    unsigned size_;
+};
+
+static void DecompressBlocksWork(const WorkItem* item, unsigned threadIndex)
+{
+    DecompressBlockTask* start = reinterpret_cast<DecompressBlockTask*>(item->start_);
+    DecompressBlockTask* end = reinterpret_cast<DecompressBlockTask*>(item->end_);
+
+    for (DecompressBlockTask* task = start; task < end; ++task)
+        LZ4_decompress_fast((const char*)task->source_, (char*)task->dest_, task->size_);
+}
 
 File::File(Context* context) :
     Object(context),
@@ -74,7 +100,10 @@ File::File(Context* context) :
     checksum_(0),
     compressed_(false),
     readSyncNeeded_(false),
-    writeSyncNeeded_(false)
+    writeSyncNeeded_(false),
+    mappedData_(0),
+    mappedOffset_(0),
+    blockSize_(0)
 {
 }
 
@@ -91,7 +120,10 @@ File::File(Context* context, const String& fileName, FileMode mode) :
     checksum_(0),
     compressed_(false),
     readSyncNeeded_(false),
-    writeSyncNeeded_(false)
+    writeSyncNeeded_(false),
+    mappedData_(0),
+    mappedOffset_(0),
+    blockSize_(0)
 {
     Open(fileName, mode);
 }
@@ -109,7 +141,10 @@ File::File(Context* context, PackageFile* package, const String& fileName) :
     checksum_(0),
     compressed_(false),
     readSyncNeeded_(false),
-    writeSyncNeeded_(false)
+    writeSyncNeeded_(false),
+    mappedData_(0),
+    mappedOffset_(0),
+    blockSize_(0)
 {
     Open(package, fileName);
 }
@@ -223,15 +258,24 @@ bool File::Open(PackageFile* package, const String& fileName)
     if (!entry)
         return false;
 
+    if (package->IsMemoryMapped())
+    {
+        // Read from the mapping instead of opening a file handle
+        mappedPackage_ = package;
+        mappedData_ = package->GetMappedData() + entry->offset_;
+    }
+    else
+    {
 #ifdef _WIN32
-    handle_ = _wfopen(GetWideNativePath(package->GetName()).CString(), L"rb");
+        handle_ = _wfopen(GetWideNativePath(package->GetName()).CString(), L"rb");
 #else
-    handle_ = fopen(GetNativePath(package->GetName()).CString(), "rb");
+        handle_ = fopen(GetNativePath(package->GetName()).CString(), "rb");
 #endif
-    if (!handle_)
-    {
-        URHO3D_LOGERROR("Could not open package file " + fileName);
-        return false;
+        if (!handle_)
+        {
+            URHO3D_LOGERROR("Could not open package file " + fileName);
+            return false;
+        }
     }
 
     fileName_ = fileName;
@@ -243,18 +287,26 @@ bool File::Open(PackageFile* package, const String& fileName)
     compressed_ = package->IsCompressed();
     readSyncNeeded_ = false;
     writeSyncNeeded_ = false;
+    mappedOffset_ = 0;
 
-    fseek((FILE*)handle_, offset_, SEEK_SET);
+    blockSize_ = package->GetBlockSize();
+    const unsigned* blockOffsets = package->GetBlockOffsets(*entry);
+    if (blockOffsets)
+    {
+        blockOffsets_.Resize((size_ + blockSize_ - 1) / blockSize_ + 1);
+        memcpy(&blockOffsets_[0], blockOffsets, blockOffsets_.Size() * sizeof(unsigned));
+    }
+    else
+        blockOffsets_.Clear();
+
+    if (handle_)
+        fseek((FILE*)handle_, offset_, SEEK_SET);
     return true;
 }
 
 unsigned File::Read(void* dest, unsigned size)
 {
-#ifdef ANDROID
-    if (!handle_ && !assetHandle_)
-#else
-    if (!handle_)
-#endif
+    if (!IsOpen())
     {
         // Do not log the error further here to prevent spamming the stderr stream
         return 0;
@@ -306,8 +358,24 @@ unsigned File::Read(void* dest, unsigned size)
         {
             if (!readBuffer_ || readBufferOffset_ >= readBufferSize_)
             {
-                unsigned char blockHeaderBytes[4];
-                fread(blockHeaderBytes, sizeof blockHeaderBytes, 1, (FILE*)handle_);
+                // When many whole blocks are read at once, decompress them directly to the destination in parallel
+                unsigned blocksSize = ReadBlocks(destPtr, sizeLeft);
+                if (blocksSize)
+                {
+                    destPtr += blocksSize;
+                    sizeLeft -= blocksSize;
+                    position_ += blocksSize;
+                    continue;
+                }
+
+                unsigned char blockHeaderBytes[BLOCK_HEADER_SIZE];
+                if (mappedData_)
+                {
+                    memcpy(blockHeaderBytes, mappedData_ + mappedOffset_, sizeof blockHeaderBytes);
+                    mappedOffset_ += sizeof blockHeaderBytes;
+                }
+                else
+                    fread(blockHeaderBytes, sizeof blockHeaderBytes, 1, (FILE*)handle_);
 
                 MemoryBuffer blockHeader(&blockHeaderBytes[0], sizeof blockHeaderBytes);
                 unsigned unpackedSize = blockHeader.ReadUShort();
@@ -315,13 +383,26 @@ unsigned File::Read(void* dest, unsigned size)
 
                 if (!readBuffer_)
                 {
-                    readBuffer_ = new unsigned char[unpackedSize];
-                    inputBuffer_ = new unsigned char[LZ4_compressBound(unpackedSize)];
+                    // With a block index reading can start from any block, so reserve space for a full block
+                    readBuffer_ = new unsigned char[blockSize_ ? blockSize_ : unpackedSize];
+                    // When memory mapped, the compressed data is decompressed directly from the mapping
+                    if (!mappedData_)
+                        inputBuffer_ = new unsigned char[LZ4_compressBound(blockSize_ ? blockSize_ : unpackedSize)];
                 }
 
                 /// \todo Handle errors
-                fread(inputBuffer_.Get(), packedSize, 1, (FILE*)handle_);
-                LZ4_decompress_fast((const char*)inputBuffer_.Get(), (char*)readBuffer_.Get(), unpackedSize);
+                const unsigned char* packedData;
+                if (mappedData_)
+                {
+                    packedData = mappedData_ + mappedOffset_;
+                    mappedOffset_ += packedSize;
+                }
+                else
+                {
+                    fread(inputBuffer_.Get(), packedSize, 1, (FILE*)handle_);
+                    packedData = inputBuffer_.Get();
+                }
+                LZ4_decompress_fast((const char*)packedData, (char*)readBuffer_.Get(), unpackedSize);
 
                 readBufferSize_ = unpackedSize;
                 readBufferOffset_ = 0;
@@ -338,6 +419,13 @@ unsigned File::Read(void* dest, unsigned size)
         return size;
     }
 
+    if (mappedData_)
+    {
+        memcpy(dest, mappedData_ + position_, size);
+        position_ += size;
+        return size;
+    }
+
     // Need to reassign the position due to internal buffering when transitioning from writing to reading
     if (readSyncNeeded_)
     {
@@ -361,11 +449,7 @@ unsigned File::Read(void* dest, unsigned size)
 
 unsigned File::Seek(unsigned position)
 {
-#ifdef ANDROID
-    if (!handle_ && !assetHandle_)
-#else
-    if (!handle_)
-#endif
+    if (!IsOpen())
     {
         // Do not log the error further here to prevent spamming the stderr stream
         return 0;
@@ -387,28 +471,48 @@ unsigned File::Seek(unsigned position)
 #endif
     if (compressed_)
     {
+        if (blockSize_)
+        {
+            // Seek within the currently decompressed block if possible
+            unsigned blockStart = position_ - readBufferOffset_;
+            if (readBufferSize_ && position >= blockStart && position <= blockStart + readBufferSize_)
+            {
+                readBufferOffset_ = position - blockStart;
+                position_ = position;
+                return position_;
+            }
+
+            // Otherwise go to the start of the block containing the position using the block index, then skip from there
+            unsigned block = position / blockSize_;
+            SetCompressedOffset(blockOffsets_[block]);
+            position_ = block * blockSize_;
+            readBufferOffset_ = 0;
+            readBufferSize_ = 0;
+        }
         // Start over from the beginning
-        if (position == 0)
+        else if (position == 0)
         {
             position_ = 0;
             readBufferOffset_ = 0;
             readBufferSize_ = 0;
-            fseek((FILE*)handle_, offset_, SEEK_SET);
+            SetCompressedOffset(0);
         }
-        // Skip bytes
-        else if (position >= position_)
+        else if (position < position_)
         {
-            unsigned char skipBuffer[SKIP_BUFFER_SIZE];
-            while (position > position_)
-                Read(skipBuffer, (unsigned)Min((int)position - position_, (int)SKIP_BUFFER_SIZE));
+            URHO3D_LOGERROR("Seeking backward in a compressed file without a block index is not supported");
+            return position_;
         }
-        else
-            URHO3D_LOGERROR("Seeking backward in a compressed file is not supported");
+
+        // Skip bytes
+        unsigned char skipBuffer[SKIP_BUFFER_SIZE];
+        while (position > position_)
+            Read(skipBuffer, (unsigned)Min((int)position - position_, (int)SKIP_BUFFER_SIZE));
 
         return position_;
     }
 
-    fseek((FILE*)handle_, position + offset_, SEEK_SET);
+    if (handle_)
+        fseek((FILE*)handle_, position + offset_, SEEK_SET);
     position_ = position;
     readSyncNeeded_ = false;
     writeSyncNeeded_ = false;
@@ -497,10 +601,15 @@ void File::Close()
     readBuffer_.Reset();
     inputBuffer_.Reset();
 
-    if (handle_)
+    if (handle_ || mappedData_)
     {
-        fclose((FILE*)handle_);
-        handle_ = 0;
+        if (handle_)
+        {
+            fclose((FILE*)handle_);
+            handle_ = 0;
+        }
+        mappedPackage_.Reset();
+        mappedData_ = 0;
         position_ = 0;
         size_ = 0;
         offset_ = 0;
@@ -519,12 +628,80 @@ void File::SetName(const String& name)
     fileName_ = name;
 }
 
+void File::SetCompressedOffset(unsigned offset)
+{
+    if (mappedData_)
+        mappedOffset_ = offset;
+    else
+        fseek((FILE*)handle_, offset_ + offset, SEEK_SET);
+}
+
+unsigned File::ReadBlocks(unsigned char* dest, unsigned size)
+{
+    // Work items can only be queued and waited for in the main thread
+    if (!blockSize_ || size < MIN_PARALLEL_BLOCKS * blockSize_ || !Thread::IsMainThread())
+        return 0;
+    WorkQueue* queue = GetSubsystem<WorkQueue>();
+    if (!queue || !queue->GetNumThreads() || queue->IsCompleting())
+        return 0;
+
+    // Decompress only whole blocks. The last block of the file may be shorter than the block size
+    unsigned firstBlock = position_ / blockSize_;
+    unsigned endBlock = position_ + size >= size_ ? blockOffsets_.Size() - 1 : (position_ + size) / blockSize_;
+    unsigned numBlocks = endBlock - firstBlock;
+    if (numBlocks < MIN_PARALLEL_BLOCKS)
+        return 0;
+
+    URHO3D_PROFILE(DecompressBlocks);
+
+    unsigned packedStart = blockOffsets_[firstBlock];
+    unsigned packedSize = blockOffsets_[endBlock] - packedStart;
+    SharedArrayPtr<unsigned char> packedBuffer;
+    const unsigned char* packedData;
+
+    if (mappedData_)
+    {
+        packedData = mappedData_ + packedStart;
+        mappedOffset_ = blockOffsets_[endBlock];
+    }
+    else
+    {
+        packedBuffer = new unsigned char[packedSize];
+        if (fread(packedBuffer.Get(), packedSize, 1, (FILE*)handle_) != 1)
+        {
+            // Return to the block where the read began and let the sequential read handle the error
+            SetCompressedOffset(packedStart);
+            return 0;
+        }
+        packedData = packedBuffer.Get();
+    }
+
+    PODVector<DecompressBlockTask> tasks(numBlocks);
+    for (unsigned i = 0; i < numBlocks; ++i)
+    {
+        unsigned block = firstBlock + i;
+        DecompressBlockTask& task = tasks[i];
+        task.source_ = packedData + blockOffsets_[block] - packedStart + BLOCK_HEADER_SIZE;
+        task.dest_ = dest + i * blockSize_;
+        task.size_ = block * blockSize_ + blockSize_ <= size_ ? blockSize_ : size_ - block * blockSize_;
+    }
+
+    queue->ParallelFor(tasks, 1, DecompressBlocksWork);
+
+    // The read buffer no longer holds the current block
+    readBufferOffset_ = 0;
+    readBufferSize_ = 0;
+
+    unsigned endPosition = endBlock * blockSize_;
+    return (endPosition < size_ ? endPosition : size_) - position_;
+}
+
 bool File::IsOpen() const
 {
 #ifdef ANDROID
-        return handle_ != 0 || assetHandle_ != 0;
+        return handle_ != 0 || assetHandle_ != 0 || mappedData_ != 0;
 #else
-    return handle_ != 0;
+    return handle_ != 0 || mappedData_ != 0;
 #endif
 }
 
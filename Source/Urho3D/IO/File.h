@@ -108,7 +108,15 @@ public:
     /// Return whether the file originates from a package.
     bool IsPackaged() const { return offset_ != 0; }
 
+    /// Return the file contents without copying when reading an uncompressed file from a memory mapped package, otherwise null.
+    const unsigned char* GetMappedData() const { return compressed_ ? 0 : mappedData_; }
+
 private:
+    /// Set the read position within the compressed data of a packaged file.
+    void SetCompressedOffset(unsigned offset);
+    /// Decompress whole blocks of a file with a block index directly to the destination using worker threads, if the read is large enough. Return number of bytes read, or 0 if not possible.
+    unsigned ReadBlocks(unsigned char* dest, unsigned size);
+
     /// File name.
     String fileName_;
     /// Open mode.
@@ -137,6 +145,16 @@ private:
     bool readSyncNeeded_;
     /// Synchronization needed before write -flag.
     bool writeSyncNeeded_;
+    /// Memory mapped package being read from. Kept alive while the file is open.
+    SharedPtr<PackageFile> mappedPackage_;
+    /// File contents within a memory mapped package.
+    const unsigned char* mappedData_;
+    /// Read position within memory mapped compressed data.
+    unsigned mappedOffset_;
+    /// Compressed data block offsets followed by the end offset, if the package has a block index.
+    PODVector<unsigned> blockOffsets_;
+    /// Compressed data block size, 0 if no block index.
+    unsigned blockSize_;
 };
 
 }
@@ -248,7 +248,9 @@ void FileWatcher::ThreadFunction()
             {
                 FILE_NOTIFY_INFORMATION* record = (FILE_NOTIFY_INFORMATION*)&buffer[offset];
                 
-                if (record->Action == FILE_ACTION_MODIFIED || record->Action == FILE_ACTION_RENAMED_NEW_NAME)
+                if (record->Action == FILE_ACTION_MODIFIED || record->Action == FILE_ACTION_ADDED ||
+                    record->Action == FILE_ACTION_REMOVED || record->Action == FILE_ACTION_RENAMED_OLD_NAME ||
+                    record->Action == FILE_ACTION_RENAMED_NEW_NAME)
                 {
                     String fileName;
                     const wchar_t* src = record->FileName;
@@ -284,7 +286,7 @@ void FileWatcher::ThreadFunction()
 
             if (event->len > 0)
             {
-                if (event->mask & IN_MODIFY || event->mask & IN_MOVE)
+                if (event->mask & (IN_MODIFY | IN_MOVE | IN_CREATE | IN_DELETE))
                 {
                     String fileName;
                     fileName = dirHandle_[event->wd] + event->name;
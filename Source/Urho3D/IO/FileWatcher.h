@@ -33,7 +33,7 @@ namespace Urho3D
 
 class FileSystem;
 
-/// Watches a directory and its subdirectories for files being modified.
+/// Watches a directory and its subdirectories for files being modified, created or removed.
 class URHO3D_API FileWatcher : public Object, public Thread
 {
     URHO3D_OBJECT(FileWatcher, Object);
@@ -23,9 +23,20 @@
 #include "../Precompiled.h"
 
 #include "../IO/File.h"
+#include "../IO/FileSystem.h"
 #include "../IO/Log.h"
 #include "../IO/PackageFile.h"
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "../DebugNew.h"
+
 namespace Urho3D
 {
 
@@ -33,24 +44,35 @@ PackageFile::PackageFile(Context* context) :
     Object(context),
     totalSize_(0),
     checksum_(0),
-    compressed_(false)
+    blockSize_(0),
+    compressed_(false),
+    mappedData_(0)
+#ifdef _WIN32
+    , mappingHandle_(0)
+#endif
 {
 }
 
-PackageFile::PackageFile(Context* context, const String& fileName, unsigned startOffset) :
+PackageFile::PackageFile(Context* context, const String& fileName, unsigned startOffset, bool memoryMap) :
     Object(context),
     totalSize_(0),
     checksum_(0),
-    compressed_(false)
+    blockSize_(0),
+    compressed_(false),
+    mappedData_(0)
+#ifdef _WIN32
+    , mappingHandle_(0)
+#endif
 {
-    Open(fileName, startOffset);
+    Open(fileName, startOffset, memoryMap);
 }
 
 PackageFile::~PackageFile()
 {
+    UnmapMemory();
 }
 
-bool PackageFile::Open(const String& fileName, unsigned startOffset)
+bool PackageFile::Open(const String& fileName, unsigned startOffset, bool memoryMap)
 {
 #ifdef ANDROID
     if (URHO3D_IS_ASSET(fileName))
@@ -67,7 +89,7 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
     // Check ID, then read the directory
     file->Seek(startOffset);
     String id = file->ReadFileID();
-    if (id != "UPAK" && id != "ULZ4")
+    if (id != "UPAK" && id != "ULZ4" && id != "ULZI")
     {
         // If start offset has not been explicitly specified, also try to read package size from the end of file
         // to know how much we must rewind to find the package start
@@ -84,21 +106,34 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
             }
         }
 
-        if (id != "UPAK" && id != "ULZ4")
+        if (id != "UPAK" && id != "ULZ4" && id != "ULZI")
         {
             URHO3D_LOGERROR(fileName + " is not a valid package file");
             return false;
         }
     }
 
+    // Release the mapping of a previously opened package
+    UnmapMemory();
+
     fileName_ = fileName;
     nameHash_ = fileName_;
     totalSize_ = file->GetSize();
-    compressed_ = id == "ULZ4";
+    compressed_ = id == "ULZ4" || id == "ULZI";
+    entries_.Clear();
+    blockOffsets_.Clear();
 
     unsigned numFiles = file->ReadUInt();
     checksum_ = file->ReadUInt();
 
+    // Compressed packages with a block index store the block size and the offsets of each file's compressed blocks
+    blockSize_ = id == "ULZI" ? file->ReadUInt() : 0;
+    if (id == "ULZI" && (!blockSize_ || blockSize_ > 65535))
+    {
+        URHO3D_LOGERROR(fileName + " has an invalid compressed block size");
+        return false;
+    }
+
     for (unsigned i = 0; i < numFiles; ++i)
     {
         String entryName = file->ReadString();
@@ -106,7 +141,19 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
         newEntry.offset_ = file->ReadUInt() + startOffset;
         newEntry.size_ = file->ReadUInt();
         newEntry.checksum_ = file->ReadUInt();
-        if (!compressed_ && newEntry.offset_ + newEntry.size_ > totalSize_)
+        newEntry.firstBlock_ = blockOffsets_.Size();
+
+        // Size of the file data within the package, unknown for compressed files without a block index
+        unsigned dataSize = newEntry.size_;
+        if (blockSize_)
+        {
+            unsigned numBlocks = (newEntry.size_ + blockSize_ - 1) / blockSize_;
+            for (unsigned j = 0; j <= numBlocks; ++j)
+                blockOffsets_.Push(file->ReadUInt());
+            dataSize = blockOffsets_.Back();
+        }
+
+        if ((!compressed_ || blockSize_) && newEntry.offset_ + dataSize > totalSize_)
         {
             URHO3D_LOGERROR("File entry " + entryName + " outside package file");
             return false;
@@ -115,6 +162,9 @@ bool PackageFile::Open(const String& fileName, unsigned startOffset)
             entries_[entryName] = newEntry;
     }
 
+    if (memoryMap && !MapMemory())
+        URHO3D_LOGWARNING("Could not memory map package file " + fileName + ", using file handles instead");
+
     return true;
 }
 
@@ -161,4 +211,70 @@ const PackageEntry* PackageFile::GetEntry(const String& fileName) const
     return 0;
 }
 
+const unsigned char* PackageFile::GetEntryData(const String& fileName) const
+{
+    if (!mappedData_ || compressed_)
+        return 0;
+
+    const PackageEntry* entry = GetEntry(fileName);
+    return entry ? mappedData_ + entry->offset_ : 0;
+}
+
+bool PackageFile::MapMemory()
+{
+    if (!totalSize_)
+        return false;
+
+#ifdef _WIN32
+    HANDLE fileHandle = CreateFileW(GetWideNativePath(fileName_).CString(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, 0);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+        return false;
+
+    // The mapping object keeps the file open, so the file handle can be closed right away
+    HANDLE mappingHandle = CreateFileMappingW(fileHandle, 0, PAGE_READONLY, 0, 0, 0);
+    CloseHandle(fileHandle);
+    if (!mappingHandle)
+        return false;
+
+    void* data = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (!data)
+    {
+        CloseHandle(mappingHandle);
+        return false;
+    }
+
+    mappingHandle_ = mappingHandle;
+#else
+    int fd = open(GetNativePath(fileName_).CString(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    // The mapping stays valid after the descriptor is closed
+    void* data = mmap(0, totalSize_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+#endif
+
+    mappedData_ = (const unsigned char*)data;
+    return true;
+}
+
+void PackageFile::UnmapMemory()
+{
+    if (!mappedData_)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(mappedData_);
+    CloseHandle((HANDLE)mappingHandle_);
+    mappingHandle_ = 0;
+#else
+    munmap((void*)mappedData_, totalSize_);
+#endif
+
+    mappedData_ = 0;
+}
+
 }
@@ -36,6 +36,8 @@ struct PackageEntry
     unsigned size_;
     /// File checksum.
     unsigned checksum_;
+    /// Index of the first compressed block offset in the package block index.
+    unsigned firstBlock_;
 };
 
 /// Stores files of a directory tree sequentially for convenient access.
@@ -47,16 +49,18 @@ public:
     /// Construct.
     PackageFile(Context* context);
     /// Construct and open.
-    PackageFile(Context* context, const String& fileName, unsigned startOffset = 0);
+    PackageFile(Context* context, const String& fileName, unsigned startOffset = 0, bool memoryMap = false);
     /// Destruct.
     virtual ~PackageFile();
 
-    /// Open the package file. Return true if successful.
-    bool Open(const String& fileName, unsigned startOffset = 0);
+    /// Open the package file. Optionally map the package file to memory, so that files are read from the mapping instead of opening a file handle for each. Falls back to file handles if mapping fails. Return true if successful.
+    bool Open(const String& fileName, unsigned startOffset = 0, bool memoryMap = false);
     /// Check if a file exists within the package file. This will be case-insensitive on Windows and case-sensitive on other platforms.
     bool Exists(const String& fileName) const;
     /// Return the file entry corresponding to the name, or null if not found. This will be case-insensitive on Windows and case-sensitive on other platforms.
     const PackageEntry* GetEntry(const String& fileName) const;
+    /// Return the contents of a file in a memory mapped, uncompressed package without copying, or null if not available. Can be wrapped in a read-only MemoryBuffer. Valid as long as the package file exists.
+    const unsigned char* GetEntryData(const String& fileName) const;
 
     /// Return all file entries.
     const HashMap<String, PackageEntry>& GetEntries() const { return entries_; }
@@ -79,12 +83,31 @@ public:
     /// Return whether the files are compressed.
     bool IsCompressed() const { return compressed_; }
 
+    /// Return the uncompressed size of the compressed data blocks if the package has a block index for random access, or 0 if not.
+    unsigned GetBlockSize() const { return blockSize_; }
+
+    /// Return the offsets of the compressed data blocks of a file relative to the file offset, followed by the end offset of the compressed data, or null if the package has no block index.
+    const unsigned* GetBlockOffsets(const PackageEntry& entry) const { return blockSize_ ? &blockOffsets_[entry.firstBlock_] : 0; }
+
+    /// Return whether the package file is memory mapped.
+    bool IsMemoryMapped() const { return mappedData_ != 0; }
+
+    /// Return the memory mapped package file contents, or null if not memory mapped.
+    const unsigned char* GetMappedData() const { return mappedData_; }
+
     /// Return list of file names in the package.
     const Vector<String> GetEntryNames() const { return entries_.Keys(); }
 
 private:
+    /// Map the package file to memory. Return true if successful.
+    bool MapMemory();
+    /// Release the memory mapping.
+    void UnmapMemory();
+
     /// File entries.
     HashMap<String, PackageEntry> entries_;
+    /// Compressed data block offsets of all files.
+    PODVector<unsigned> blockOffsets_;
     /// File name.
     String fileName_;
     /// Package file name hash.
@@ -93,8 +116,16 @@ private:
     unsigned totalSize_;
     /// Package file checksum.
     unsigned checksum_;
+    /// Compressed data block size, 0 if no block index.
+    unsigned blockSize_;
     /// Compressed flag.
     bool compressed_;
+    /// Memory mapped package file contents.
+    const unsigned char* mappedData_;
+#ifdef _WIN32
+    /// File mapping object handle.
+    void* mappingHandle_;
+#endif
 };
 
 }
@@ -554,6 +554,7 @@ void LuaScriptInstance::GetScriptAttributes()
         AttributeInfo info;
         info.mode_ = AM_FILE;
         info.name_ = names[i];
+        info.nameHash_ = names[i];
         info.ptr_ = (void*)0xffffffff;
 
         switch (type)
@@ -24,6 +24,8 @@
 
 #include "../Math/Frustum.h"
 
+#include <cstring>
+
 #include "../DebugNew.h"
 
 namespace Urho3D
@@ -73,6 +75,9 @@ Frustum& Frustum::operator =(const Frustum& rhs)
         planes_[i] = rhs.planes_[i];
     for (unsigned i = 0; i < NUM_FRUSTUM_VERTICES; ++i)
         vertices_[i] = rhs.vertices_[i];
+#ifdef URHO3D_SSE
+    memcpy(planeData_, rhs.planeData_, sizeof planeData_);
+#endif
 
     return *this;
 }
@@ -208,6 +213,31 @@ void Frustum::UpdatePlanes()
         }
     }
 
+#ifdef URHO3D_SSE
+    for (unsigned i = 0; i < NUM_FRUSTUM_PLANE_BLOCKS * 4; ++i)
+    {
+        float* data = planeData_[i >> 2] + (i & 3);
+        if (i < NUM_FRUSTUM_PLANES)
+        {
+            const Plane& plane = planes_[i];
+            data[0] = plane.normal_.x_;
+            data[4] = plane.normal_.y_;
+            data[8] = plane.normal_.z_;
+            data[12] = plane.d_;
+            data[16] = plane.absNormal_.x_;
+            data[20] = plane.absNormal_.y_;
+            data[24] = plane.absNormal_.z_;
+        }
+        else
+        {
+            // Padding plane that every point is on the positive side of
+            data[0] = data[4] = data[8] = 0.0f;
+            data[12] = M_INFINITY;
+            data[16] = data[20] = data[24] = 0.0f;
+        }
+    }
+#endif
+
 }
 
 }
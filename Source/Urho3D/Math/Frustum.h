@@ -28,6 +28,10 @@
 #include "../Math/Rect.h"
 #include "../Math/Sphere.h"
 
+#ifdef URHO3D_SSE
+#include <xmmintrin.h>
+#endif
+
 namespace Urho3D
 {
 
@@ -44,6 +48,10 @@ enum FrustumPlane
 
 static const unsigned NUM_FRUSTUM_PLANES = 6;
 static const unsigned NUM_FRUSTUM_VERTICES = 8;
+#ifdef URHO3D_SSE
+/// Number of 4-plane blocks the frustum planes are packed into for SIMD tests.
+static const unsigned NUM_FRUSTUM_PLANE_BLOCKS = 2;
+#endif
 
 /// Convex constructed of 6 planes.
 class URHO3D_API Frustum
@@ -87,6 +95,24 @@ public:
     /// Test if a sphere is inside, outside or intersects.
     Intersection IsInside(const Sphere& sphere) const
     {
+#ifdef URHO3D_SSE
+        __m128 cx = _mm_set1_ps(sphere.center_.x_);
+        __m128 cy = _mm_set1_ps(sphere.center_.y_);
+        __m128 cz = _mm_set1_ps(sphere.center_.z_);
+        __m128 radius = _mm_set1_ps(sphere.radius_);
+        __m128 negRadius = _mm_set1_ps(-sphere.radius_);
+        __m128 intersects = _mm_setzero_ps();
+
+        for (unsigned i = 0; i < NUM_FRUSTUM_PLANE_BLOCKS; ++i)
+        {
+            __m128 dist = PlaneDistances(i, cx, cy, cz);
+            if (_mm_movemask_ps(_mm_cmplt_ps(dist, negRadius)))
+                return OUTSIDE;
+            intersects = _mm_or_ps(intersects, _mm_cmplt_ps(dist, radius));
+        }
+
+        return _mm_movemask_ps(intersects) ? INTERSECTS : INSIDE;
+#else
         bool allInside = true;
         for (unsigned i = 0; i < NUM_FRUSTUM_PLANES; ++i)
         {
@@ -98,11 +124,26 @@ public:
         }
 
         return allInside ? INSIDE : INTERSECTS;
+#endif
     }
 
     /// Test if a sphere if (partially) inside or outside.
     Intersection IsInsideFast(const Sphere& sphere) const
     {
+#ifdef URHO3D_SSE
+        __m128 cx = _mm_set1_ps(sphere.center_.x_);
+        __m128 cy = _mm_set1_ps(sphere.center_.y_);
+        __m128 cz = _mm_set1_ps(sphere.center_.z_);
+        __m128 negRadius = _mm_set1_ps(-sphere.radius_);
+
+        for (unsigned i = 0; i < NUM_FRUSTUM_PLANE_BLOCKS; ++i)
+        {
+            if (_mm_movemask_ps(_mm_cmplt_ps(PlaneDistances(i, cx, cy, cz), negRadius)))
+                return OUTSIDE;
+        }
+
+        return INSIDE;
+#else
         for (unsigned i = 0; i < NUM_FRUSTUM_PLANES; ++i)
         {
             if (planes_[i].Distance(sphere.center_) < -sphere.radius_)
@@ -110,6 +151,7 @@ public:
         }
 
         return INSIDE;
+#endif
     }
 
     /// Test if a bounding box is inside, outside or intersects.
@@ -117,6 +159,26 @@ public:
     {
         Vector3 center = box.Center();
         Vector3 edge = center - box.min_;
+#ifdef URHO3D_SSE
+        __m128 cx = _mm_set1_ps(center.x_);
+        __m128 cy = _mm_set1_ps(center.y_);
+        __m128 cz = _mm_set1_ps(center.z_);
+        __m128 ex = _mm_set1_ps(edge.x_);
+        __m128 ey = _mm_set1_ps(edge.y_);
+        __m128 ez = _mm_set1_ps(edge.z_);
+        __m128 intersects = _mm_setzero_ps();
+
+        for (unsigned i = 0; i < NUM_FRUSTUM_PLANE_BLOCKS; ++i)
+        {
+            __m128 dist = PlaneDistances(i, cx, cy, cz);
+            __m128 absDist = PlaneAbsDistances(i, ex, ey, ez);
+            if (_mm_movemask_ps(_mm_cmplt_ps(dist, _mm_sub_ps(_mm_setzero_ps(), absDist))))
+                return OUTSIDE;
+            intersects = _mm_or_ps(intersects, _mm_cmplt_ps(dist, absDist));
+        }
+
+        return _mm_movemask_ps(intersects) ? INTERSECTS : INSIDE;
+#else
         bool allInside = true;
 
         for (unsigned i = 0; i < NUM_FRUSTUM_PLANES; ++i)
@@ -132,6 +194,7 @@ public:
         }
 
         return allInside ? INSIDE : INTERSECTS;
+#endif
     }
 
     /// Test if a bounding box is (partially) inside or outside.
@@ -139,6 +202,23 @@ public:
     {
         Vector3 center = box.Center();
         Vector3 edge = center - box.min_;
+#ifdef URHO3D_SSE
+        __m128 cx = _mm_set1_ps(center.x_);
+        __m128 cy = _mm_set1_ps(center.y_);
+        __m128 cz = _mm_set1_ps(center.z_);
+        __m128 ex = _mm_set1_ps(edge.x_);
+        __m128 ey = _mm_set1_ps(edge.y_);
+        __m128 ez = _mm_set1_ps(edge.z_);
+
+        for (unsigned i = 0; i < NUM_FRUSTUM_PLANE_BLOCKS; ++i)
+        {
+            __m128 absDist = PlaneAbsDistances(i, ex, ey, ez);
+            if (_mm_movemask_ps(_mm_cmplt_ps(PlaneDistances(i, cx, cy, cz), _mm_sub_ps(_mm_setzero_ps(), absDist))))
+                return OUTSIDE;
+        }
+
+        return INSIDE;
+#else
 
         for (unsigned i = 0; i < NUM_FRUSTUM_PLANES; ++i)
         {
@@ -151,6 +231,7 @@ public:
         }
 
         return INSIDE;
+#endif
     }
 
     /// Return distance of a point to the frustum, or 0 if inside.
@@ -177,6 +258,31 @@ public:
     Plane planes_[NUM_FRUSTUM_PLANES];
     /// Frustum vertices.
     Vector3 vertices_[NUM_FRUSTUM_VERTICES];
+
+#ifdef URHO3D_SSE
+private:
+    /// Return signed distances of a point, given as splatted coordinates, to a block of 4 planes.
+    __m128 PlaneDistances(unsigned block, __m128 x, __m128 y, __m128 z) const
+    {
+        const float* data = planeData_[block];
+        __m128 dist = _mm_mul_ps(_mm_loadu_ps(data), x);
+        dist = _mm_add_ps(dist, _mm_mul_ps(_mm_loadu_ps(data + 4), y));
+        dist = _mm_add_ps(dist, _mm_mul_ps(_mm_loadu_ps(data + 8), z));
+        return _mm_add_ps(dist, _mm_loadu_ps(data + 12));
+    }
+
+    /// Return projected radii of a box half-size, given as splatted coordinates, against a block of 4 planes.
+    __m128 PlaneAbsDistances(unsigned block, __m128 x, __m128 y, __m128 z) const
+    {
+        const float* data = planeData_[block];
+        __m128 dist = _mm_mul_ps(_mm_loadu_ps(data + 16), x);
+        dist = _mm_add_ps(dist, _mm_mul_ps(_mm_loadu_ps(data + 20), y));
+        return _mm_add_ps(dist, _mm_mul_ps(_mm_loadu_ps(data + 24), z));
+    }
+
+    /// Planes transposed into blocks of 4 (normal x, y, z, d, absolute normal x, y, z), with the unused slots always passing.
+    float planeData_[NUM_FRUSTUM_PLANE_BLOCKS][28];
+#endif
 };
 
 }
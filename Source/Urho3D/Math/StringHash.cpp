@@ -24,6 +24,10 @@
 
 #include "../Math/MathDefs.h"
 #include "../Math/StringHash.h"
+#ifdef URHO3D_HASH_DEBUG
+#include "../Container/HashMap.h"
+#include "../Core/Mutex.h"
+#endif
 
 #include <cstdio>
 
@@ -34,14 +38,48 @@ namespace Urho3D
 
 const StringHash StringHash::ZERO;
 
+#ifdef URHO3D_HASH_DEBUG
+/// Return the reverse lookup registry of hashed strings.
+static HashMap<unsigned, String>& GetHashRegistry()
+{
+    static HashMap<unsigned, String> registry;
+    return registry;
+}
+
+/// Return the mutex guarding the reverse lookup registry.
+static Mutex& GetHashRegistryMutex()
+{
+    static Mutex registryMutex;
+    return registryMutex;
+}
+
+/// Record the string a hash was calculated from.
+static void RegisterHash(unsigned value, const char* str)
+{
+    if (!value)
+        return;
+
+    MutexLock lock(GetHashRegistryMutex());
+    HashMap<unsigned, String>& registry = GetHashRegistry();
+    if (!registry.Contains(value))
+        registry[value] = str;
+}
+#endif
+
 StringHash::StringHash(const char* str) :
     value_(Calculate(str))
 {
+#ifdef URHO3D_HASH_DEBUG
+    RegisterHash(value_, str);
+#endif
 }
 
 StringHash::StringHash(const String& str) :
     value_(Calculate(str.CString()))
 {
+#ifdef URHO3D_HASH_DEBUG
+    RegisterHash(value_, str.CString());
+#endif
 }
 
 unsigned StringHash::Calculate(const char* str)
@@ -54,8 +92,7 @@ unsigned StringHash::Calculate(const char* str)
     while (*str)
     {
         // Perform the actual hashing as case-insensitive
-        char c = *str;
-        hash = SDBMHash(hash, (unsigned char)tolower(c));
+        hash = HashChar(hash, *str);
         ++str;
     }
 
@@ -69,4 +106,16 @@ String StringHash::ToString() const
     return String(tempBuffer);
 }
 
+String StringHash::Reverse() const
+{
+#ifdef URHO3D_HASH_DEBUG
+    MutexLock lock(GetHashRegistryMutex());
+    HashMap<unsigned, String>& registry = GetHashRegistry();
+    HashMap<unsigned, String>::ConstIterator i = registry.Find(value_);
+    return i != registry.End() ? i->second_ : String::EMPTY;
+#else
+    return String::EMPTY;
+#endif
+}
+
 }
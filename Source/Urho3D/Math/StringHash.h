@@ -24,6 +24,19 @@
 
 #include "../Container/Str.h"
 
+// Hash string literals at compile time when the compiler supports constexpr, unless the reverse lookup registry is in use
+#if defined(URHO3D_CXX11) && !defined(URHO3D_HASH_DEBUG) && (!defined(_MSC_VER) || _MSC_VER >= 1900)
+#define URHO3D_CONSTEXPR_HASH
+#endif
+
+#ifdef URHO3D_CONSTEXPR_HASH
+#define URHO3D_HASH_CONSTEXPR constexpr
+#define URHO3D_HASH_LITERAL(str) Urho3D::StringHash::FromLiteral(str)
+#else
+#define URHO3D_HASH_CONSTEXPR
+#define URHO3D_HASH_LITERAL(str) Urho3D::StringHash(str)
+#endif
+
 namespace Urho3D
 {
 
@@ -32,19 +45,19 @@ class URHO3D_API StringHash
 {
 public:
     /// Construct with zero value.
-    StringHash() :
+    URHO3D_HASH_CONSTEXPR StringHash() :
         value_(0)
     {
     }
 
     /// Copy-construct from another hash.
-    StringHash(const StringHash& rhs) :
+    URHO3D_HASH_CONSTEXPR StringHash(const StringHash& rhs) :
         value_(rhs.value_)
     {
     }
 
     /// Construct with an initial value.
-    explicit StringHash(unsigned value) :
+    explicit URHO3D_HASH_CONSTEXPR StringHash(unsigned value) :
         value_(value)
     {
     }
@@ -92,7 +105,7 @@ public:
     operator bool() const { return value_ != 0; }
 
     /// Return hash value.
-    unsigned Value() const { return value_; }
+    URHO3D_HASH_CONSTEXPR unsigned Value() const { return value_; }
 
     /// Return as string.
     String ToString() const;
@@ -100,9 +113,32 @@ public:
     /// Return hash value for HashSet & HashMap.
     unsigned ToHash() const { return value_; }
 
+    /// Return the string the hash was calculated from, or empty if unknown. Only available when built with URHO3D_HASH_DEBUG.
+    String Reverse() const;
+
     /// Calculate hash value case-insensitively from a C string.
     static unsigned Calculate(const char* str);
 
+#ifdef URHO3D_CONSTEXPR_HASH
+    /// Return hash of a string literal, calculated case-insensitively at compile time when used to initialize a constexpr variable. Use the URHO3D_HASH_LITERAL macro, which falls back to the runtime calculation without constexpr support.
+    template <unsigned N> static constexpr StringHash FromLiteral(const char (&str)[N])
+    {
+        return StringHash(CalculateConstexpr(str, 0));
+    }
+
+    /// Calculate hash value case-insensitively from a C string at compile time. Produces the same value as Calculate(). Recursive as required by C++11 constexpr, so it should not be evaluated at runtime.
+    static constexpr unsigned CalculateConstexpr(const char* str, unsigned hash)
+    {
+        return (str && *str) ? CalculateConstexpr(str + 1, HashChar(hash, *str)) : hash;
+    }
+#endif
+
+    /// Fold one character into the hash value. Lowercases ASCII only so that the result does not depend on the locale.
+    static URHO3D_HASH_CONSTEXPR unsigned HashChar(unsigned hash, char c)
+    {
+        return (unsigned)(unsigned char)(c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c) + (hash << 6) + (hash << 16) - hash;
+    }
+
     /// Zero hash.
     static const StringHash ZERO;
 
@@ -23,17 +23,20 @@
 #include "../Precompiled.h"
 
 #include "../Core/Profiler.h"
+#include "../IO/Compression.h"
 #include "../IO/File.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
 #include "../IO/MemoryBuffer.h"
 #include "../IO/PackageFile.h"
 #include "../Network/Connection.h"
+#include "../Network/InterestGrid.h"
 #include "../Network/Network.h"
 #include "../Network/NetworkEvents.h"
 #include "../Network/NetworkPriority.h"
 #include "../Network/Protocol.h"
 #include "../Resource/ResourceCache.h"
+#include "../Scene/InterpolatedTransform.h"
 #include "../Scene/Scene.h"
 #include "../Scene/SceneEvents.h"
 #include "../Scene/SmoothedTransform.h"
@@ -46,17 +49,133 @@ namespace Urho3D
 {
 
 static const int STATS_INTERVAL_MSEC = 2000;
+static const unsigned MAX_SNAPSHOTS = 64;
+
+/// Set the bits of all network attributes.
+static void SetAllAttributeBits(DirtyBits& bits, const Vector<AttributeInfo>* attributes)
+{
+    unsigned numAttributes = attributes ? attributes->Size() : 0;
+    for (unsigned i = 0; i < numAttributes; ++i)
+        bits.Set(i);
+}
+
+/// Write a snapshot record as the run-length encoded XOR difference to its baseline record, preceded by the record size.
+static void WriteRecordDelta(Serializer& dest, const PODVector<unsigned char>& record, const PODVector<unsigned char>* baseRecord)
+{
+    unsigned size = record.Size();
+    unsigned baseSize = baseRecord ? baseRecord->Size() : 0;
+    dest.WriteVLE(size + 1);
+
+    unsigned i = 0;
+    while (i < size)
+    {
+        // Each run is a number of bytes unchanged from the baseline followed by a number of changed bytes
+        unsigned zeros = 0;
+        while (i + zeros < size && i + zeros < baseSize && record[i + zeros] == baseRecord->At(i + zeros))
+            ++zeros;
+        unsigned literals = 0;
+        while (i + zeros + literals < size && (i + zeros + literals >= baseSize ||
+            record[i + zeros + literals] != baseRecord->At(i + zeros + literals)))
+            ++literals;
+
+        dest.WriteVLE(zeros);
+        dest.WriteVLE(literals);
+        i += zeros;
+        for (unsigned j = 0; j < literals; ++j, ++i)
+            dest.WriteUByte(i < baseSize ? (unsigned char)(record[i] ^ baseRecord->At(i)) : record[i]);
+    }
+}
+
+/// Read a snapshot record written with WriteRecordDelta(). Return true on success.
+static bool ReadRecordDelta(Deserializer& source, PODVector<unsigned char>& record, const PODVector<unsigned char>* baseRecord,
+    unsigned size)
+{
+    unsigned baseSize = baseRecord ? baseRecord->Size() : 0;
+    record.Resize(size);
+
+    unsigned i = 0;
+    while (i < size)
+    {
+        unsigned zeros = source.ReadVLE();
+        unsigned literals = source.ReadVLE();
+        if ((!zeros && !literals) || i + zeros + literals > size || i + zeros > baseSize)
+            return false;
+
+        for (unsigned j = 0; j < zeros; ++j, ++i)
+            record[i] = baseRecord->At(i);
+        for (unsigned j = 0; j < literals; ++j, ++i)
+            record[i] = i < baseSize ? (unsigned char)(source.ReadUByte() ^ baseRecord->At(i)) : source.ReadUByte();
+    }
+
+    return true;
+}
+
+/// Calculate the checksum of the start of a file, with the same hash as File::GetChecksum().
+static unsigned GetFilePrefixChecksum(File* file, unsigned size)
+{
+    unsigned char block[1024];
+    unsigned checksum = 0;
+
+    file->Seek(0);
+    while (size)
+    {
+        unsigned readSize = size < sizeof block ? size : sizeof block;
+        if (file->Read(block, readSize) != readSize)
+            break;
+        for (unsigned i = 0; i < readSize; ++i)
+            checksum = SDBMHash(checksum, block[i]);
+        size -= readSize;
+    }
+
+    return checksum;
+}
+
+/// Start a new snapshot message part at the last written record if the current part became too large.
+static void SplitSnapshotPart(const VectorBuffer& data, PODVector<unsigned>& parts, unsigned recordStart)
+{
+    unsigned partStart = parts.Size() ? parts.Back() : 0;
+    if (data.GetSize() - partStart > SNAPSHOT_PART_SIZE && recordStart > partStart)
+        parts.Push(recordStart);
+}
+
+PendingSnapshot::PendingSnapshot() :
+    sequence_(0),
+    baseline_(0),
+    numParts_(0),
+    timeStamp_(0)
+{
+}
 
 PackageDownload::PackageDownload() :
-    totalFragments_(0),
+    fileSize_(0),
+    receivedBytes_(0),
+    requestedOffset_(0),
     checksum_(0),
     initiated_(false)
 {
 }
 
 PackageUpload::PackageUpload() :
-    fragment_(0),
-    totalFragments_(0)
+    offset_(0),
+    startOffset_(0),
+    ackedOffset_(0)
+{
+}
+
+RemoteEventStats::RemoteEventStats() :
+    events_(0),
+    coalescedEvents_(0),
+    batches_(0),
+    bytes_(0),
+    bytesSaved_(0)
+{
+}
+
+PackageTransferStats::PackageTransferStats() :
+    bytes_(0),
+    compressedBytes_(0),
+    resumedBytes_(0),
+    bytesPerSec_(0.0f)
 {
 }
 
@@ -64,20 +183,33 @@ Connection::Connection(Context* context, bool isClient, kNet::SharedPtr<kNet::Me
     Object(context),
     timeStamp_(0),
     connection_(connection),
+    interestGrid_(0),
+    snapshotSequence_(0),
+    ackedSnapshot_(0),
+    packageRateBytes_(0),
+    recordTime_(0),
     sendMode_(OPSM_NONE),
     isClient_(isClient),
     connectPending_(false),
     sceneLoaded_(false),
-    logStatistics_(false)
+    logStatistics_(false),
+    bufferMessages_(false),
+    interestActive_(false),
+    snapshotMode_(false)
 {
     sceneState_.connection_ = this;
 
     // Store address and port now for accurate logging (kNet may already have destroyed the socket on disconnection,
     // in which case we would log a zero address:port on disconnect)
-    kNet::EndPoint endPoint = connection_->RemoteEndPoint();
-    ///\todo Not IPv6-capable.
-    address_ = Urho3D::ToString("%d.%d.%d.%d", endPoint.ip[0], endPoint.ip[1], endPoint.ip[2], endPoint.ip[3]);
-    port_ = endPoint.port;
+    if (connection_)
+    {
+        kNet::EndPoint endPoint = connection_->RemoteEndPoint();
+        ///\todo Not IPv6-capable.
+        address_ = Urho3D::ToString("%d.%d.%d.%d", endPoint.ip[0], endPoint.ip[1], endPoint.ip[2], endPoint.ip[3]);
+        port_ = endPoint.port;
+    }
+    else
+        port_ = 0;
 }
 
 Connection::~Connection()
@@ -107,6 +239,33 @@ void Connection::SendMessage(int msgID, bool reliable, bool inOrder, const unsig
         return;
     }
 
+    if (bufferMessages_)
+    {
+        BufferedMessage buffered;
+        buffered.msgID_ = msgID;
+        buffered.reliable_ = reliable;
+        buffered.inOrder_ = inOrder;
+        buffered.contentID_ = contentID;
+        buffered.offset_ = bufferedData_.GetSize();
+        buffered.size_ = numBytes;
+        bufferedData_.Write(data, numBytes);
+        bufferedMessages_.Push(buffered);
+        return;
+    }
+
+    if (recordFile_)
+    {
+        unsigned char flags = RECORD_OUTBOUND;
+        if (reliable)
+            flags |= RECORD_RELIABLE;
+        if (inOrder)
+            flags |= RECORD_INORDER;
+        WriteRecord(msgID, flags, data, numBytes, contentID);
+    }
+
+    if (!connection_)
+        return;
+
     kNet::NetworkMessage* msg = connection_->StartNewMessage((unsigned long)msgID, numBytes);
     if (!msg)
     {
@@ -126,12 +285,7 @@ void Connection::SendMessage(int msgID, bool reliable, bool inOrder, const unsig
 
 void Connection::SendRemoteEvent(StringHash eventType, bool inOrder, const VariantMap& eventData)
 {
-    RemoteEvent queuedEvent;
-    queuedEvent.senderID_ = 0;
-    queuedEvent.eventType_ = eventType;
-    queuedEvent.eventData_ = eventData;
-    queuedEvent.inOrder_ = inOrder;
-    remoteEvents_.Push(queuedEvent);
+    QueueRemoteEvent(0, eventType, inOrder, eventData);
 }
 
 void Connection::SendRemoteEvent(Node* node, StringHash eventType, bool inOrder, const VariantMap& eventData)
@@ -152,12 +306,7 @@ void Connection::SendRemoteEvent(Node* node, StringHash eventType, bool inOrder,
         return;
     }
 
-    RemoteEvent queuedEvent;
-    queuedEvent.senderID_ = node->GetID();
-    queuedEvent.eventType_ = eventType;
-    queuedEvent.eventData_ = eventData;
-    queuedEvent.inOrder_ = inOrder;
-    remoteEvents_.Push(queuedEvent);
+    QueueRemoteEvent(node->GetID(), eventType, inOrder, eventData);
 }
 
 void Connection::SetScene(Scene* newScene)
@@ -170,6 +319,11 @@ void Connection::SetScene(Scene* newScene)
 
     scene_ = newScene;
     sceneLoaded_ = false;
+    interestNodes_.Clear();
+    dependencyScopes_.Clear();
+    interestActive_ = false;
+    ResetSnapshots();
+    snapshotMode_ = false;
     UnsubscribeFromEvent(E_ASYNCLOADFINISHED);
 
     if (!scene_)
@@ -192,6 +346,7 @@ void Connection::SetScene(Scene* newScene)
             msg_.WriteUInt(package->GetTotalSize());
             msg_.WriteUInt(package->GetChecksum());
         }
+        msg_.WriteVLE(PROTOCOL_VERSION);
         SendMessage(MSG_LOADSCENE, true, true, msg_);
     }
     else
@@ -238,14 +393,66 @@ void Connection::SetLogStatistics(bool enable)
 
 void Connection::Disconnect(int waitMSec)
 {
-    connection_->Disconnect(waitMSec);
+    if (connection_)
+        connection_->Disconnect(waitMSec);
 }
 
 void Connection::SendServerUpdate()
+{
+    PrepareServerUpdate();
+    BuildServerUpdate();
+    ApplyReplicationStateChanges();
+    BuildServerSnapshot();
+    SendBufferedMessages();
+}
+
+void Connection::PrepareServerUpdate()
+{
+    interestGrid_ = 0;
+
+    if (!scene_ || !sceneLoaded_)
+        return;
+
+    InterestGrid* grid = scene_->GetComponent<InterestGrid>();
+    bool interestActive = grid && grid->IsActive();
+    if (interestActive != interestActive_)
+    {
+        // Interest management was toggled: check all replicated nodes to create or remove them as necessary
+        interestActive_ = interestActive;
+        interestNodes_.Clear();
+        dependencyScopes_.Clear();
+        scene_->GetChildren(scopeChangedNodes_, true);
+        for (PODVector<Node*>::ConstIterator i = scopeChangedNodes_.Begin(); i != scopeChangedNodes_.End(); ++i)
+        {
+            if ((*i)->GetID() < FIRST_LOCAL_ID)
+                sceneState_.dirtyNodes_.Insert((*i)->GetID());
+        }
+    }
+    if (interestActive)
+        interestGrid_ = grid;
+
+    bool snapshotMode = scene_->GetSnapshotReplication();
+    if (snapshotMode != snapshotMode_)
+    {
+        // Start snapshots from a full state. When switching back to delta updates, resend all attributes, as the client
+        // may have missed changes that were only included in unacknowledged snapshots
+        snapshotMode_ = snapshotMode;
+        ResetSnapshots();
+        if (!snapshotMode)
+            MarkAllAttributesDirty();
+    }
+}
+
+void Connection::BuildServerUpdate()
 {
     if (!scene_ || !sceneLoaded_)
         return;
 
+    bufferMessages_ = true;
+
+    if (interestGrid_)
+        UpdateInterestScope();
+
     // Always check the root node (scene) first so that the scene-wide components get sent first,
     // and all other replicated nodes get added to the dirty set for sending the initial state
     unsigned sceneID = scene_->GetID();
@@ -261,6 +468,79 @@ void Connection::SendServerUpdate()
         unsigned nodeID = nodesToProcess_.Front();
         ProcessNode(nodeID);
     }
+
+    bufferMessages_ = false;
+}
+
+void Connection::ApplyReplicationStateChanges()
+{
+    // The replication state lists of the scene objects and the weak references to them are shared between connections.
+    // Modify them only in the main thread to not touch the non-atomic reference counts from worker threads
+    for (PODVector<ReplicationStateChange>::ConstIterator i = replicationStateChanges_.Begin();
+         i != replicationStateChanges_.End(); ++i)
+    {
+        NodeReplicationState* nodeState = i->nodeState_;
+        ComponentReplicationState* componentState = i->componentState_;
+
+        if (i->object_)
+        {
+            if (componentState)
+            {
+                Component* component = static_cast<Component*>(i->object_);
+                componentState->component_ = component;
+                component->AddReplicationState(componentState);
+            }
+            else
+            {
+                Node* node = static_cast<Node*>(i->object_);
+                nodeState->node_ = node;
+                node->AddReplicationState(nodeState);
+            }
+        }
+        else if (componentState)
+            nodeState->componentStates_.Erase(i->id_);
+        else
+        {
+            for (HashMap<unsigned, ComponentReplicationState>::Iterator j = nodeState->componentStates_.Begin();
+                 j != nodeState->componentStates_.End(); ++j)
+            {
+                Component* component = j->second_.component_;
+                if (component)
+                    component->RemoveReplicationState(&j->second_);
+            }
+            Node* node = nodeState->node_;
+            if (node)
+                node->RemoveReplicationState(nodeState);
+            sceneState_.nodeStates_.Erase(i->id_);
+        }
+    }
+
+    replicationStateChanges_.Clear();
+}
+
+void Connection::BuildServerSnapshot()
+{
+    // In snapshot mode the attributes of all replicated nodes are sent in a snapshot after the reliable structural changes
+    if (!scene_ || !sceneLoaded_ || !snapshotMode_)
+        return;
+    // The send rate is limited. While earlier messages are still queued, a new snapshot would only wait behind them and
+    // delay the next one further
+    if (connection_ && connection_->NumOutboundMessagesPending())
+        return;
+
+    bufferMessages_ = true;
+    BuildSnapshot();
+    bufferMessages_ = false;
+}
+
+void Connection::SendBufferedMessages()
+{
+    const unsigned char* data = bufferedData_.GetData();
+    for (PODVector<BufferedMessage>::ConstIterator i = bufferedMessages_.Begin(); i != bufferedMessages_.End(); ++i)
+        SendMessage(i->msgID_, i->reliable_, i->inOrder_, data + i->offset_, i->size_, i->contentID_);
+
+    bufferedMessages_.Clear();
+    bufferedData_.Clear();
 }
 
 void Connection::SendClientUpdate()
@@ -290,62 +570,101 @@ void Connection::SendRemoteEvents()
     {
         statsTimer_.Reset();
         char statsBuffer[256];
-        sprintf(statsBuffer, "RTT %.3f ms Pkt in %d Pkt out %d Data in %.3f KB/s Data out %.3f KB/s", connection_->RoundTripTime(),
-            (int)connection_->PacketsInPerSec(),
-            (int)connection_->PacketsOutPerSec(), connection_->BytesInPerSec() / 1000.0f, connection_->BytesOutPerSec() / 1000.0f);
+        sprintf(statsBuffer, "RTT %.3f ms Pkt in %d Pkt out %d Data in %.3f KB/s Data out %.3f KB/s", GetRoundTripTime(),
+            (int)GetPacketsInPerSec(), (int)GetPacketsOutPerSec(), GetBytesInPerSec() / 1000.0f, GetBytesOutPerSec() / 1000.0f);
         URHO3D_LOGINFO(statsBuffer);
-    }
-#endif
 
-    if (remoteEvents_.Empty())
-        return;
-
-    URHO3D_PROFILE(SendRemoteEvents);
+        if (isClient_)
+        {
+            sprintf(statsBuffer, "Updates encoded %u reused %u Bytes encoded %.3f KB reused %.3f KB Time saved %.3f ms",
+                encodeStats_.encodedUpdates_, encodeStats_.reusedUpdates_, encodeStats_.encodedBytes_ / 1000.0,
+                encodeStats_.reusedBytes_ / 1000.0, encodeStats_.reusedTime_ / 1000.0);
+            URHO3D_LOGINFO(statsBuffer);
+        }
 
-    for (Vector<RemoteEvent>::ConstIterator i = remoteEvents_.Begin(); i != remoteEvents_.End(); ++i)
-    {
-        msg_.Clear();
-        if (!i->senderID_)
+        if (remoteEventStats_.events_)
         {
-            msg_.WriteStringHash(i->eventType_);
-            msg_.WriteVariantMap(i->eventData_);
-            SendMessage(MSG_REMOTEEVENT, true, i->inOrder_, msg_);
+            sprintf(statsBuffer, "Remote events %u coalesced %u Batches %u Data %.3f KB saved %.3f KB", remoteEventStats_.events_,
+                remoteEventStats_.coalescedEvents_, remoteEventStats_.batches_, remoteEventStats_.bytes_ / 1000.0,
+                remoteEventStats_.bytesSaved_ / 1000.0);
+            URHO3D_LOGINFO(statsBuffer);
         }
-        else
+
+        if (!uploads_.Empty() || !downloads_.Empty())
         {
-            msg_.WriteNetID(i->senderID_);
-            msg_.WriteStringHash(i->eventType_);
-            msg_.WriteVariantMap(i->eventData_);
-            SendMessage(MSG_REMOTENODEEVENT, true, i->inOrder_, msg_);
+            sprintf(statsBuffer, "Package data %.3f KB/s Transferred %.3f KB compressed %.3f KB resumed %.3f KB",
+                packageStats_.bytesPerSec_ / 1000.0f, packageStats_.bytes_ / 1000.0, packageStats_.compressedBytes_ / 1000.0,
+                packageStats_.resumedBytes_ / 1000.0);
+            URHO3D_LOGINFO(statsBuffer);
         }
     }
+#endif
+
+    if (remoteEvents_.Empty())
+        return;
+
+    URHO3D_PROFILE(SendRemoteEvents);
 
+    // Send in-order and unordered events as separate messages
+    SendRemoteEventBatch(true);
+    SendRemoteEventBatch(false);
     remoteEvents_.Clear();
 }
 
 void Connection::SendPackages()
 {
-    while (!uploads_.Empty() && connection_->NumOutboundMessagesPending() < 1000)
+    if (uploads_.Empty())
+        return;
+
+    Network* network = GetSubsystem<Network>();
+    unsigned fragmentSize = network->GetPackageFragmentSize();
+    unsigned windowSize = fragmentSize * network->GetPackageWindowSize();
+    bool compress = network->GetPackageCompression();
+
+    packageBuffer_.Resize(fragmentSize);
+    if (compress)
+        compressBuffer_.Resize(EstimateCompressBound(fragmentSize));
+
+    // Send fragments from each upload in turn, until all uploads are either finished or waiting for acknowledgements
+    bool sent = true;
+    while (sent && (!connection_ || connection_->NumOutboundMessagesPending() < 1000))
     {
-        unsigned char buffer[PACKAGE_FRAGMENT_SIZE];
+        sent = false;
 
-        for (HashMap<StringHash, PackageUpload>::Iterator i = uploads_.Begin(); i != uploads_.End();)
+        for (HashMap<StringHash, PackageUpload>::Iterator i = uploads_.Begin(); i != uploads_.End(); ++i)
         {
-            HashMap<StringHash, PackageUpload>::Iterator current = i++;
-            PackageUpload& upload = current->second_;
-            unsigned fragmentSize =
-                (unsigned)Min((int)(upload.file_->GetSize() - upload.file_->GetPosition()), (int)PACKAGE_FRAGMENT_SIZE);
-            upload.file_->Read(buffer, fragmentSize);
+            PackageUpload& upload = i->second_;
+            unsigned fileSize = upload.file_->GetSize();
+            if (upload.offset_ >= fileSize || upload.offset_ - upload.ackedOffset_ >= windowSize)
+                continue;
+
+            unsigned size = fileSize - upload.offset_;
+            if (size > fragmentSize)
+                size = fragmentSize;
+            upload.file_->Seek(upload.offset_);
+            upload.file_->Read(&packageBuffer_[0], size);
 
             msg_.Clear();
-            msg_.WriteStringHash(current->first_);
-            msg_.WriteUInt(upload.fragment_++);
-            msg_.Write(buffer, fragmentSize);
+            msg_.WriteStringHash(i->first_);
+            msg_.WriteUInt(upload.offset_);
+            msg_.WriteUInt(upload.startOffset_);
+            msg_.WriteVLE(size);
+
+            // The fragment is sent uncompressed if compression does not reduce its size. The client can tell a compressed
+            // fragment from its data being shorter than the uncompressed size
+            unsigned compressedSize = compress ? CompressData(&compressBuffer_[0], &packageBuffer_[0], size) : 0;
+            if (compressedSize && compressedSize < size)
+                msg_.Write(&compressBuffer_[0], compressedSize);
+            else
+            {
+                msg_.Write(&packageBuffer_[0], size);
+                compressedSize = size;
+            }
             SendMessage(MSG_PACKAGEDATA, true, false, msg_);
 
-            // Check if upload finished
-            if (upload.fragment_ == upload.totalFragments_)
-                uploads_.Erase(current);
+            upload.offset_ += size;
+            UpdatePackageStats(size, compressedSize);
+            sent = true;
         }
     }
 }
@@ -407,6 +726,7 @@ bool Connection::ProcessMessage(int msgID, MemoryBuffer& msg)
 
     case MSG_REQUESTPACKAGE:
     case MSG_PACKAGEDATA:
+    case MSG_PACKAGEACK:
         ProcessPackageDownload(msgID, msg);
         break;
 
@@ -431,6 +751,7 @@ bool Connection::ProcessMessage(int msgID, MemoryBuffer& msg)
 
     case MSG_REMOTEEVENT:
     case MSG_REMOTENODEEVENT:
+    case MSG_REMOTEEVENTBATCH:
         ProcessRemoteEvent(msgID, msg);
         break;
 
@@ -438,6 +759,14 @@ bool Connection::ProcessMessage(int msgID, MemoryBuffer& msg)
         ProcessPackageInfo(msgID, msg);
         break;
 
+    case MSG_SNAPSHOT:
+        ProcessSnapshot(msgID, msg);
+        break;
+
+    case MSG_SNAPSHOTACK:
+        ProcessSnapshotAck(msgID, msg);
+        break;
+
     default:
         processed = false;
         break;
@@ -446,6 +775,40 @@ bool Connection::ProcessMessage(int msgID, MemoryBuffer& msg)
     return processed;
 }
 
+bool Connection::StartRecording(const String& fileName)
+{
+    StopRecording();
+
+    SharedPtr<File> file(new File(context_, fileName, FILE_WRITE));
+    if (!file->IsOpen())
+        return false;
+
+    // Write the file ID and connection type. Records of the messages follow
+    file->WriteFileID("UREC");
+    file->WriteBool(isClient_);
+
+    recordFile_ = file;
+    recordTimer_.Reset();
+    recordTime_ = 0;
+    URHO3D_LOGINFO("Recording messages of connection " + ToString() + " to " + fileName);
+    return true;
+}
+
+void Connection::StopRecording()
+{
+    if (recordFile_)
+    {
+        recordFile_->Close();
+        recordFile_.Reset();
+    }
+}
+
+void Connection::RecordMessage(int msgID, const unsigned char* data, unsigned numBytes)
+{
+    if (recordFile_)
+        WriteRecord(msgID, 0, data, numBytes, 0);
+}
+
 void Connection::ProcessLoadScene(int msgID, MemoryBuffer& msg)
 {
     if (IsClient())
@@ -463,9 +826,10 @@ void Connection::ProcessLoadScene(int msgID, MemoryBuffer& msg)
     // Store the scene file name we need to eventually load
     sceneFileName_ = msg.ReadString();
 
-    // Clear previous pending latest data and package downloads if any
+    // Clear previous pending latest data, snapshots and package downloads if any
     nodeLatestData_.Clear();
     componentLatestData_.Clear();
+    ResetSnapshots();
     downloads_.Clear();
 
     // In case we have joined other scenes in this session, remove first all downloaded package files from the resource system
@@ -481,8 +845,26 @@ void Connection::ProcessLoadScene(int msgID, MemoryBuffer& msg)
             cache->RemovePackageFile(package, true);
     }
 
-    // Now check which packages we have in the resource cache or in the download cache, and which we need to download
+    // Check the protocol version after the package list before downloading anything. Older servers do not send it
     unsigned numPackages = msg.ReadVLE();
+    unsigned packagesPosition = msg.GetPosition();
+    for (unsigned i = 0; i < numPackages && !msg.IsEof(); ++i)
+    {
+        msg.ReadString();
+        msg.ReadUInt();
+        msg.ReadUInt();
+    }
+    unsigned version = msg.IsEof() ? 0 : msg.ReadVLE();
+    if (version != PROTOCOL_VERSION)
+    {
+        URHO3D_LOGERROR("Server uses network protocol version " + String(version) + ", expected " + String(PROTOCOL_VERSION));
+        OnSceneLoadFailed();
+        Disconnect();
+        return;
+    }
+    msg.Seek(packagesPosition);
+
+    // Now check which packages we have in the resource cache or in the download cache, and which we need to download
     if (!RequestNeededPackages(numPackages, msg))
     {
         OnSceneLoadFailed();
@@ -530,8 +912,11 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             {
                 // Add initially to the root level. May be moved as we receive the parent attribute
                 node = scene_->CreateChild(nodeID, REPLICATED);
-                // Create smoothed transform component
-                node->CreateComponent<SmoothedTransform>(LOCAL);
+                // Create smoothed or interpolated transform component
+                if (scene_->GetNetworkInterpolation())
+                    node->CreateComponent<InterpolatedTransform>(LOCAL);
+                else
+                    node->CreateComponent<SmoothedTransform>(LOCAL);
             }
 
             // Read initial attributes, then snap the motion smoothing immediately to the end
@@ -539,6 +924,12 @@ void Connection::ProcessSceneUpdate(int msgID, MemoryBuffer& msg)
             SmoothedTransform* transform = node->GetComponent<SmoothedTransform>();
             if (transform)
                 transform->Update(1.0f, 0.0f);
+            else
+            {
+                InterpolatedTransform* interpolated = node->GetComponent<InterpolatedTransform>();
+                if (interpolated)
+                    interpolated->Snap();
+            }
 
             // Read initial user variables
             unsigned numVars = msg.ReadVLE();
@@ -727,6 +1118,9 @@ void Connection::ProcessPackageDownload(int msgID, MemoryBuffer& msg)
         else
         {
             String name = msg.ReadString();
+            // Offset to resume an interrupted download from, followed by the checksum of the data the client already has
+            unsigned offset = msg.ReadUInt();
+            unsigned prefixChecksum = offset ? msg.ReadUInt() : 0;
 
             if (!scene_)
             {
@@ -744,27 +1138,49 @@ void Connection::ProcessPackageDownload(int msgID, MemoryBuffer& msg)
                 {
                     StringHash nameHash(name);
 
-                    // Do not restart upload if already exists
-                    if (uploads_.Contains(nameHash))
+                    // If the upload already exists, the client has requested again after losing data. Restart from the
+                    // requested offset
+                    HashMap<StringHash, PackageUpload>::Iterator j = uploads_.Find(nameHash);
+                    if (j == uploads_.End())
                     {
-                        URHO3D_LOGWARNING("Received a request for package " + name + " already in transfer");
-                        return;
+                        // Try to open the file now
+                        SharedPtr<File> file(new File(context_, packageFullName));
+                        if (!file->IsOpen())
+                        {
+                            URHO3D_LOGERROR("Failed to transmit package file " + name);
+                            SendPackageError(name);
+                            return;
+                        }
+
+                        j = uploads_.Insert(MakePair(nameHash, PackageUpload()));
+                        j->second_.file_ = file;
                     }
 
-                    // Try to open the file now
-                    SharedPtr<File> file(new File(context_, packageFullName));
-                    if (!file->IsOpen())
+                    PackageUpload& upload = j->second_;
+                    if (offset >= upload.file_->GetSize())
+                        offset = 0;
+                    // Send from the start if the client's partial data differs from the package, for example after the
+                    // package has changed. The client sees it from the start offset sent with the fragments
+                    if (offset && GetFilePrefixChecksum(upload.file_, offset) != prefixChecksum)
                     {
-                        URHO3D_LOGERROR("Failed to transmit package file " + name);
-                        SendPackageError(name);
-                        return;
+                        URHO3D_LOGWARNING("Partial package file " + name + " of client " + ToString() +
+                                          " does not match, transmitting from the start");
+                        offset = 0;
                     }
+                    upload.offset_ = offset;
+                    upload.startOffset_ = offset;
+                    upload.ackedOffset_ = offset;
 
-                    URHO3D_LOGINFO("Transmitting package file " + name + " to client " + ToString());
+                    if (offset)
+                    {
+                        URHO3D_LOGINFO("Resuming transmission of package file " + name + " to client " + ToString() + " from offset " +
+                                       String(offset));
+                        packageStats_.resumedBytes_ += offset;
+                    }
+                    else
+                        URHO3D_LOGINFO("Transmitting package file " + name + " to client " + ToString());
 
-                    uploads_[nameHash].file_ = file;
-                    uploads_[nameHash].fragment_ = 0;
-                    uploads_[nameHash].totalFragments_ = (file->GetSize() + PACKAGE_FRAGMENT_SIZE - 1) / PACKAGE_FRAGMENT_SIZE;
+                    SendPackages();
                     return;
                 }
             }
@@ -801,53 +1217,96 @@ void Connection::ProcessPackageDownload(int msgID, MemoryBuffer& msg)
                 return;
             }
 
-            // If file has not yet been opened, try to open now. Prepend the checksum to the filename to allow multiple versions
+            // Disregard data for a download not yet started
             if (!download.file_)
+                return;
+
+            unsigned offset = msg.ReadUInt();
+            unsigned startOffset = msg.ReadUInt();
+            unsigned size = msg.ReadVLE();
+            unsigned dataSize = msg.GetSize() - msg.GetPosition();
+            if (!size || size > MAX_PACKAGE_FRAGMENT_SIZE || size > download.fileSize_ || offset > download.fileSize_ - size ||
+                dataSize > size)
+            {
+                URHO3D_LOGERROR("Received malformed data for package " + download.name_);
+                OnPackageDownloadFailed(download.name_);
+                return;
+            }
+
+            if (startOffset != download.requestedOffset_)
             {
-                download.file_ = new File(context_,
-                    GetSubsystem<Network>()->GetPackageCacheDir() + ToStringHex(download.checksum_) + "_" + download.name_,
-                    FILE_WRITE);
+                // Disregard fragments of an earlier transfer
+                if (startOffset)
+                    return;
+
+                // The server sends from the start if the partial file did not match its package. Discard the partial data
+                URHO3D_LOGWARNING("Partial data of package " + download.name_ + " did not match the server, downloading from the start");
+                packageStats_.resumedBytes_ -= download.requestedOffset_;
+                download.file_->Open(download.file_->GetName(), FILE_WRITE);
                 if (!download.file_->IsOpen())
                 {
                     OnPackageDownloadFailed(download.name_);
                     return;
                 }
+                download.receivedBytes_ = 0;
+                download.requestedOffset_ = 0;
+                download.pendingFragments_.Clear();
             }
 
-            // Write the fragment data to the proper index
-            unsigned char buffer[PACKAGE_FRAGMENT_SIZE];
-            unsigned index = msg.ReadUInt();
-            unsigned fragmentSize = msg.GetSize() - msg.GetPosition();
-
-            msg.Read(buffer, fragmentSize);
-            download.file_->Seek(index * PACKAGE_FRAGMENT_SIZE);
-            download.file_->Write(buffer, fragmentSize);
-            download.receivedFragments_.Insert(index);
+            // Disregard fragments received already, which may be resent after requesting the download again
+            if (offset < download.receivedBytes_ || download.pendingFragments_.Contains(offset))
+                return;
 
-            // Check if all fragments received
-            if (download.receivedFragments_.Size() == download.totalFragments_)
+            // Fragments shorter than their uncompressed size are compressed
+            PODVector<unsigned char>& fragment = download.pendingFragments_[offset];
+            fragment.Resize(size);
+            if (dataSize < size)
             {
-                URHO3D_LOGINFO("Package " + download.name_ + " downloaded successfully");
+                // The data comes from the network, so decompress within its bounds and check the uncompressed size
+                if (DecompressDataSafe(&fragment[0], msg.GetData() + msg.GetPosition(), dataSize, size) != size)
+                {
+                    URHO3D_LOGERROR("Failed to decompress data for package " + download.name_);
+                    OnPackageDownloadFailed(download.name_);
+                    return;
+                }
+            }
+            else
+                msg.Read(&fragment[0], size);
+
+            UpdatePackageStats(size, dataSize);
+            WritePackageFragments(i);
+        }
+        break;
+
+    case MSG_PACKAGEACK:
+        if (!IsClient())
+        {
+            URHO3D_LOGWARNING("Received unexpected PackageAck message from server");
+            return;
+        }
+        else
+        {
+            StringHash nameHash = msg.ReadStringHash();
+            unsigned receivedBytes = msg.ReadUInt();
 
-                // Instantiate the package and add to the resource system, as we will need it to load the scene
-                download.file_->Close();
-                GetSubsystem<ResourceCache>()->AddPackageFile(download.file_->GetName(), 0);
+            HashMap<StringHash, PackageUpload>::Iterator i = uploads_.Find(nameHash);
+            if (i == uploads_.End())
+                return;
 
-                // Then start the next download if there are more
-                downloads_.Erase(i);
-                if (downloads_.Empty())
-                    OnPackagesReady();
-                else
-                {
-                    PackageDownload& nextDownload = downloads_.Begin()->second_;
+            PackageUpload& upload = i->second_;
+            // Acknowledgements are sent unordered, so disregard any older than the latest
+            if (receivedBytes > upload.ackedOffset_ && receivedBytes <= upload.offset_)
+                upload.ackedOffset_ = receivedBytes;
 
-                    URHO3D_LOGINFO("Requesting package " + nextDownload.name_ + " from server");
-                    msg_.Clear();
-                    msg_.WriteString(nextDownload.name_);
-                    SendMessage(MSG_REQUESTPACKAGE, true, true, msg_);
-                    nextDownload.initiated_ = true;
-                }
+            // Check if upload finished, else send more fragments as the window allows
+            if (upload.ackedOffset_ >= upload.file_->GetSize())
+            {
+                uploads_.Erase(i);
+                if (uploads_.Empty() && downloads_.Empty())
+                    UpdatePackageStats(0, 0);
             }
+            else
+                SendPackages();
         }
         break;
 
@@ -865,6 +1324,16 @@ void Connection::ProcessIdentity(int msgID, MemoryBuffer& msg)
 
     identity_ = msg.ReadVariantMap();
 
+    // Clients older than the protocol version do not send it
+    unsigned version = msg.IsEof() ? 0 : msg.ReadVLE();
+    if (version != PROTOCOL_VERSION)
+    {
+        URHO3D_LOGERROR("Client " + ToString() + " uses network protocol version " + String(version) + ", expected " +
+                        String(PROTOCOL_VERSION));
+        Disconnect();
+        return;
+    }
+
     using namespace ClientIdentity;
 
     VariantMap eventData = identity_;
@@ -938,54 +1407,200 @@ void Connection::ProcessSceneLoaded(int msgID, MemoryBuffer& msg)
 
 void Connection::ProcessRemoteEvent(int msgID, MemoryBuffer& msg)
 {
-    using namespace RemoteEventData;
-
     if (msgID == MSG_REMOTEEVENT)
     {
         StringHash eventType = msg.ReadStringHash();
-        if (!GetSubsystem<Network>()->CheckRemoteEvent(eventType))
-        {
-            URHO3D_LOGWARNING("Discarding not allowed remote event " + eventType.ToString());
-            return;
-        }
-
         VariantMap eventData = msg.ReadVariantMap();
-        eventData[P_CONNECTION] = this;
-        SendEvent(eventType, eventData);
+        DispatchRemoteEvent(0, eventType, eventData);
     }
-    else
+    else if (msgID == MSG_REMOTENODEEVENT)
     {
-        if (!scene_)
-        {
-            URHO3D_LOGERROR("Can not receive remote node event without an assigned scene");
-            return;
-        }
-
         unsigned nodeID = msg.ReadNetID();
         StringHash eventType = msg.ReadStringHash();
-        if (!GetSubsystem<Network>()->CheckRemoteEvent(eventType))
-        {
-            URHO3D_LOGWARNING("Discarding not allowed remote event " + eventType.ToString());
-            return;
-        }
-
         VariantMap eventData = msg.ReadVariantMap();
-        Node* sender = scene_->GetNode(nodeID);
-        if (!sender)
+        DispatchRemoteEvent(nodeID, eventType, eventData);
+    }
+    else
+    {
+        Network* network = GetSubsystem<Network>();
+        unsigned numEvents = msg.ReadVLE();
+        VariantMap eventData;
+
+        while (numEvents-- && !msg.IsEof())
         {
-            URHO3D_LOGWARNING("Missing sender for remote node event, discarding");
-            return;
+            unsigned header = msg.ReadVLE();
+            StringHash eventType = msg.ReadStringHash();
+            unsigned size = msg.ReadVLE();
+            unsigned end = msg.GetPosition() + size;
+            if (end > msg.GetSize())
+            {
+                URHO3D_LOGERROR("Received malformed RemoteEventBatch message");
+                return;
+            }
+
+            // Each event's data is preceded by its size, so that an event that can not be parsed is skipped
+            MemoryBuffer data(msg.GetData() + msg.GetPosition(), size);
+            msg.Seek(end);
+            eventData.Clear();
+
+            if (header & 1)
+            {
+                const RemoteEventSchema* schema = network->GetRemoteEventSchema(eventType);
+                if (!schema)
+                {
+                    URHO3D_LOGERROR("No schema registered for remote event " + eventType.ToString() + ", discarding it");
+                    continue;
+                }
+                for (unsigned i = 0; i < schema->keys_.Size(); ++i)
+                    eventData[schema->keys_[i]] = data.ReadVariant(schema->types_[i]);
+            }
+            else
+                eventData = data.ReadVariantMap();
+
+            DispatchRemoteEvent(header >> 1, eventType, eventData);
         }
-        eventData[P_CONNECTION] = this;
-        sender->SendEvent(eventType, eventData);
     }
 }
 
-kNet::MessageConnection* Connection::GetMessageConnection() const
+void Connection::QueueRemoteEvent(unsigned senderID, StringHash eventType, bool inOrder, const VariantMap& eventData)
 {
-    return const_cast<kNet::MessageConnection*>(connection_.ptr());
-}
-
+    // When coalescing, only the latest event of the same type and sender is sent. Remove the earlier one so that the
+    // latest keeps its place in the send order
+    if (GetSubsystem<Network>()->GetRemoteEventCoalescing(eventType))
+    {
+        for (Vector<RemoteEvent>::Iterator i = remoteEvents_.Begin(); i != remoteEvents_.End(); ++i)
+        {
+            if (i->eventType_ == eventType && i->senderID_ == senderID && i->inOrder_ == inOrder)
+            {
+                // Count the bytes the replaced event would have needed on its own
+                VectorBuffer replaced;
+                replaced.WriteStringHash(eventType);
+                replaced.WriteVariantMap(i->eventData_);
+                remoteEventStats_.bytesSaved_ += replaced.GetSize() + (senderID ? 3 : 0);
+                ++remoteEventStats_.coalescedEvents_;
+                remoteEvents_.Erase(i);
+                break;
+            }
+        }
+    }
+
+    RemoteEvent queuedEvent;
+    queuedEvent.senderID_ = senderID;
+    queuedEvent.eventType_ = eventType;
+    queuedEvent.eventData_ = eventData;
+    queuedEvent.inOrder_ = inOrder;
+    remoteEvents_.Push(queuedEvent);
+}
+
+void Connection::SendRemoteEventBatch(bool inOrder)
+{
+    unsigned numEvents = 0;
+    for (Vector<RemoteEvent>::ConstIterator i = remoteEvents_.Begin(); i != remoteEvents_.End(); ++i)
+    {
+        if (i->inOrder_ == inOrder)
+            ++numEvents;
+    }
+    if (!numEvents)
+        return;
+
+    Network* network = GetSubsystem<Network>();
+    // Size of the same events sent as individual remote event messages
+    unsigned long long separateBytes = 0;
+    VectorBuffer data;
+
+    msg_.Clear();
+    msg_.WriteVLE(numEvents);
+
+    for (Vector<RemoteEvent>::ConstIterator i = remoteEvents_.Begin(); i != remoteEvents_.End(); ++i)
+    {
+        if (i->inOrder_ != inOrder)
+            continue;
+
+        const VariantMap& eventData = i->eventData_;
+        const RemoteEventSchema* schema = network->GetRemoteEventSchema(i->eventType_);
+
+        // Use the schema only if the event data matches it exactly
+        if (schema && eventData.Size() == schema->keys_.Size())
+        {
+            for (unsigned j = 0; j < schema->keys_.Size(); ++j)
+            {
+                VariantMap::ConstIterator k = eventData.Find(schema->keys_[j]);
+                if (k == eventData.End() || k->second_.GetType() != schema->types_[j])
+                {
+                    schema = 0;
+                    break;
+                }
+            }
+        }
+        else
+            schema = 0;
+
+        data.Clear();
+        if (schema)
+        {
+            for (unsigned j = 0; j < schema->keys_.Size(); ++j)
+                data.WriteVariantData(eventData.Find(schema->keys_[j])->second_);
+            // Each key is otherwise written as a hash and a type byte, preceded by the count
+            unsigned count = schema->keys_.Size();
+            separateBytes += (count < 0x80 ? 1 : (count < 0x4000 ? 2 : (count < 0x200000 ? 3 : 4))) + 5 * count;
+        }
+        else
+            data.WriteVariantMap(eventData);
+
+        msg_.WriteVLE((i->senderID_ << 1) | (schema ? 1 : 0));
+        msg_.WriteStringHash(i->eventType_);
+        msg_.WriteVLE(data.GetSize());
+        msg_.Write(data.GetData(), data.GetSize());
+
+        separateBytes += 4 + data.GetSize() + (i->senderID_ ? 3 : 0);
+    }
+
+    SendMessage(MSG_REMOTEEVENTBATCH, true, inOrder, msg_);
+
+    remoteEventStats_.events_ += numEvents;
+    ++remoteEventStats_.batches_;
+    remoteEventStats_.bytes_ += msg_.GetSize();
+    if (separateBytes > msg_.GetSize())
+        remoteEventStats_.bytesSaved_ += separateBytes - msg_.GetSize();
+}
+
+void Connection::DispatchRemoteEvent(unsigned senderID, StringHash eventType, VariantMap& eventData)
+{
+    using namespace RemoteEventData;
+
+    if (!GetSubsystem<Network>()->CheckRemoteEvent(eventType))
+    {
+        URHO3D_LOGWARNING("Discarding not allowed remote event " + eventType.ToString());
+        return;
+    }
+
+    eventData[P_CONNECTION] = this;
+
+    if (!senderID)
+        SendEvent(eventType, eventData);
+    else
+    {
+        if (!scene_)
+        {
+            URHO3D_LOGERROR("Can not receive remote node event without an assigned scene");
+            return;
+        }
+
+        Node* sender = scene_->GetNode(senderID);
+        if (!sender)
+        {
+            URHO3D_LOGWARNING("Missing sender for remote node event, discarding");
+            return;
+        }
+        sender->SendEvent(eventType, eventData);
+    }
+}
+
+kNet::MessageConnection* Connection::GetMessageConnection() const
+{
+    return const_cast<kNet::MessageConnection*>(connection_.ptr());
+}
+
 Scene* Connection::GetScene() const
 {
     return scene_;
@@ -993,37 +1608,37 @@ Scene* Connection::GetScene() const
 
 bool Connection::IsConnected() const
 {
-    return connection_->GetConnectionState() == kNet::ConnectionOK;
+    return connection_ ? connection_->GetConnectionState() == kNet::ConnectionOK : false;
 }
 
 float Connection::GetRoundTripTime() const
 {
-    return connection_->RoundTripTime();
+    return connection_ ? connection_->RoundTripTime() : 0.0f;
 }
 
 float Connection::GetLastHeardTime() const
 {
-    return connection_->LastHeardTime();
+    return connection_ ? connection_->LastHeardTime() : 0.0f;
 }
 
 float Connection::GetBytesInPerSec() const
 {
-    return connection_->BytesInPerSec();
+    return connection_ ? connection_->BytesInPerSec() : 0.0f;
 }
 
 float Connection::GetBytesOutPerSec() const
 {
-    return connection_->BytesOutPerSec();
+    return connection_ ? connection_->BytesOutPerSec() : 0.0f;
 }
 
 float Connection::GetPacketsInPerSec() const
 {
-    return connection_->PacketsInPerSec();
+    return connection_ ? connection_->PacketsInPerSec() : 0.0f;
 }
 
 float Connection::GetPacketsOutPerSec() const
 {
-    return connection_->PacketsOutPerSec();
+    return connection_ ? connection_->PacketsOutPerSec() : 0.0f;
 }
 
 String Connection::ToString() const
@@ -1051,7 +1666,7 @@ float Connection::GetDownloadProgress() const
     for (HashMap<StringHash, PackageDownload>::ConstIterator i = downloads_.Begin(); i != downloads_.End(); ++i)
     {
         if (i->second_.initiated_)
-            return (float)i->second_.receivedFragments_.Size() / (float)i->second_.totalFragments_;
+            return i->second_.fileSize_ ? (float)i->second_.receivedBytes_ / (float)i->second_.fileSize_ : 0.0f;
     }
     return 1.0f;
 }
@@ -1122,7 +1737,20 @@ void Connection::ProcessNode(unsigned nodeID)
             // would be enough. However, this may be better due to the client not possibly having updated parenting
             // information at the time of receiving this message
             SendMessage(MSG_REMOVENODE, true, true, msg_);
-            sceneState_.nodeStates_.Erase(nodeID);
+
+            AddReplicationStateChange(&i->second_, 0, 0, nodeID);
+            dependencyScopes_.Erase(nodeID);
+        }
+        else if (interestGrid_ && !IsInScope(node))
+        {
+            // The node left the interest scope: remove it from the client and stop tracking it
+            msg_.Clear();
+            msg_.WriteNetID(nodeID);
+            SendMessage(MSG_REMOVENODE, true, true, msg_);
+
+            AddReplicationStateChange(&i->second_, 0, 0, nodeID);
+            dependencyScopes_.Erase(nodeID);
+            sceneState_.dirtyNodes_.Erase(nodeID);
         }
         else
             ProcessExistingNode(node, i->second_);
@@ -1131,11 +1759,12 @@ void Connection::ProcessNode(unsigned nodeID)
     {
         // Replication state not found: this is a new node
         Node* node = scene_->GetNode(nodeID);
-        if (node)
+        if (node && (!interestGrid_ || IsInScope(node)))
             ProcessNewNode(node);
         else
         {
-            // Did not find the new node (may have been created, then removed immediately): erase from dirty set.
+            // Did not find the new node (may have been created, then removed immediately), or it is outside the
+            // interest scope: erase from dirty set. It will be marked dirty again when entering the scope
             sceneState_.dirtyNodes_.Erase(nodeID);
         }
     }
@@ -1144,6 +1773,8 @@ void Connection::ProcessNode(unsigned nodeID)
 void Connection::ProcessNewNode(Node* node)
 {
     // Process depended upon nodes first, if they are dirty
+    if (interestGrid_)
+        UpdateDependencyScope(node);
     const PODVector<Node*>& dependencyNodes = node->GetDependencyNodes();
     for (PODVector<Node*>::ConstIterator i = dependencyNodes.Begin(); i != dependencyNodes.End(); ++i)
     {
@@ -1158,11 +1789,10 @@ void Connection::ProcessNewNode(Node* node)
     NodeReplicationState& nodeState = sceneState_.nodeStates_[node->GetID()];
     nodeState.connection_ = this;
     nodeState.sceneState_ = &sceneState_;
-    nodeState.node_ = node;
-    node->AddReplicationState(&nodeState);
+    AddReplicationStateChange(&nodeState, 0, node, node->GetID());
 
     // Write node's attributes
-    node->WriteInitialDeltaUpdate(msg_, timeStamp_);
+    node->WriteInitialDeltaUpdate(msg_, timeStamp_, &encodeStats_);
 
     // Write node's user variables
     const VariantMap& vars = node->GetVars();
@@ -1186,12 +1816,11 @@ void Connection::ProcessNewNode(Node* node)
         ComponentReplicationState& componentState = nodeState.componentStates_[component->GetID()];
         componentState.connection_ = this;
         componentState.nodeState_ = &nodeState;
-        componentState.component_ = component;
-        component->AddReplicationState(&componentState);
+        AddReplicationStateChange(&nodeState, &componentState, component, component->GetID());
 
         msg_.WriteStringHash(component->GetType());
         msg_.WriteNetID(component->GetID());
-        component->WriteInitialDeltaUpdate(msg_, timeStamp_);
+        component->WriteInitialDeltaUpdate(msg_, timeStamp_, &encodeStats_);
     }
 
     SendMessage(MSG_CREATENODE, true, true, msg_);
@@ -1203,6 +1832,8 @@ void Connection::ProcessNewNode(Node* node)
 void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState)
 {
     // Process depended upon nodes first, if they are dirty
+    if (interestGrid_)
+        UpdateDependencyScope(node);
     const PODVector<Node*>& dependencyNodes = node->GetDependencyNodes();
     for (PODVector<Node*>::ConstIterator i = dependencyNodes.Begin(); i != dependencyNodes.End(); ++i)
     {
@@ -1211,14 +1842,23 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
             ProcessNode(nodeID);
     }
 
-    // Check from the interest management component, if exists, whether should update
-    /// \todo Searching for the component is a potential CPU hotspot. It should be cached
-    NetworkPriority* priority = node->GetComponent<NetworkPriority>();
-    if (priority && (!priority->GetAlwaysUpdateOwner() || node->GetOwner() != this))
+    if (snapshotMode_)
     {
-        float distance = (node->GetWorldPosition() - position_).Length();
-        if (!priority->CheckUpdate(distance, nodeState.priorityAcc_))
-            return;
+        // Attribute and variable changes are sent in the snapshot
+        nodeState.dirtyAttributes_.ClearAll();
+        nodeState.dirtyVars_.Clear();
+    }
+    else
+    {
+        // Check from the interest management component, if exists, whether should update
+        /// \todo Searching for the component is a potential CPU hotspot. It should be cached
+        NetworkPriority* priority = node->GetComponent<NetworkPriority>();
+        if (priority && (!priority->GetAlwaysUpdateOwner() || node->GetOwner() != this))
+        {
+            float distance = (node->GetWorldPosition() - position_).Length();
+            if (!priority->CheckUpdate(distance, nodeState.priorityAcc_))
+                return;
+        }
     }
 
     // Check if attributes have changed
@@ -1242,7 +1882,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
         {
             msg_.Clear();
             msg_.WriteNetID(node->GetID());
-            node->WriteLatestDataUpdate(msg_, timeStamp_);
+            node->WriteLatestDataUpdate(msg_, timeStamp_, &encodeStats_);
 
             SendMessage(MSG_NODELATESTDATA, true, false, msg_, node->GetID());
         }
@@ -1252,7 +1892,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
         {
             msg_.Clear();
             msg_.WriteNetID(node->GetID());
-            node->WriteDeltaUpdate(msg_, nodeState.dirtyAttributes_, timeStamp_);
+            node->WriteDeltaUpdate(msg_, nodeState.dirtyAttributes_, timeStamp_, &encodeStats_);
 
             // Write changed variables
             msg_.WriteVLE(nodeState.dirtyVars_.Size());
@@ -1281,7 +1921,8 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
         }
     }
 
-    // Check for removed or changed components
+    // Check for removed or changed components. Removed component states are erased only after the update is built
+    unsigned numComponentStates = nodeState.componentStates_.Size();
     for (HashMap<unsigned, ComponentReplicationState>::Iterator i = nodeState.componentStates_.Begin();
          i != nodeState.componentStates_.End();)
     {
@@ -1295,8 +1936,12 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
             msg_.WriteNetID(current->first_);
 
             SendMessage(MSG_REMOVECOMPONENT, true, true, msg_);
-            nodeState.componentStates_.Erase(current);
+
+            AddReplicationStateChange(&nodeState, &componentState, 0, current->first_);
+            --numComponentStates;
         }
+        else if (snapshotMode_)
+            componentState.dirtyAttributes_.ClearAll();
         else
         {
             // Existing component. Check if attributes have changed
@@ -1320,7 +1965,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 {
                     msg_.Clear();
                     msg_.WriteNetID(component->GetID());
-                    component->WriteLatestDataUpdate(msg_, timeStamp_);
+                    component->WriteLatestDataUpdate(msg_, timeStamp_, &encodeStats_);
 
                     SendMessage(MSG_COMPONENTLATESTDATA, true, false, msg_, component->GetID());
                 }
@@ -1330,7 +1975,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 {
                     msg_.Clear();
                     msg_.WriteNetID(component->GetID());
-                    component->WriteDeltaUpdate(msg_, componentState.dirtyAttributes_, timeStamp_);
+                    component->WriteDeltaUpdate(msg_, componentState.dirtyAttributes_, timeStamp_, &encodeStats_);
 
                     SendMessage(MSG_COMPONENTDELTAUPDATE, true, true, msg_);
 
@@ -1341,7 +1986,7 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
     }
 
     // Check for new components
-    if (nodeState.componentStates_.Size() != node->GetNumNetworkComponents())
+    if (numComponentStates != node->GetNumNetworkComponents())
     {
         const Vector<SharedPtr<Component> >& components = node->GetComponents();
         for (unsigned i = 0; i < components.Size(); ++i)
@@ -1358,14 +2003,13 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
                 ComponentReplicationState& componentState = nodeState.componentStates_[component->GetID()];
                 componentState.connection_ = this;
                 componentState.nodeState_ = &nodeState;
-                componentState.component_ = component;
-                component->AddReplicationState(&componentState);
+                AddReplicationStateChange(&nodeState, &componentState, component, component->GetID());
 
                 msg_.Clear();
                 msg_.WriteNetID(node->GetID());
                 msg_.WriteStringHash(component->GetType());
                 msg_.WriteNetID(component->GetID());
-                component->WriteInitialDeltaUpdate(msg_, timeStamp_);
+                component->WriteInitialDeltaUpdate(msg_, timeStamp_, &encodeStats_);
 
                 SendMessage(MSG_CREATECOMPONENT, true, true, msg_);
             }
@@ -1376,6 +2020,544 @@ void Connection::ProcessExistingNode(Node* node, NodeReplicationState& nodeState
     sceneState_.dirtyNodes_.Erase(node->GetID());
 }
 
+void Connection::UpdateInterestScope()
+{
+    interestGrid_->GetNodes(interestQueryResult_, position_);
+
+    newInterestNodes_.Clear();
+    for (PODVector<Node*>::ConstIterator i = interestQueryResult_.Begin(); i != interestQueryResult_.End(); ++i)
+        AddInterestNode(*i);
+
+    // Keep the nodes that the replicated nodes depend on in the scope even if outside the radius
+    for (HashMap<unsigned, PODVector<unsigned> >::ConstIterator i = dependencyScopes_.Begin(); i != dependencyScopes_.End(); ++i)
+    {
+        for (PODVector<unsigned>::ConstIterator j = i->second_.Begin(); j != i->second_.End(); ++j)
+        {
+            Node* node = scene_->GetNode(*j);
+            if (node)
+                AddInterestNode(node);
+        }
+    }
+
+    // The remaining nodes left the scope
+    for (HashSet<unsigned>::ConstIterator i = interestNodes_.Begin(); i != interestNodes_.End(); ++i)
+    {
+        Node* node = scene_->GetNode(*i);
+        if (node)
+            MarkScopeChanged(node);
+    }
+
+    interestNodes_.Swap(newInterestNodes_);
+}
+
+void Connection::AddInterestNode(Node* node)
+{
+    unsigned nodeID = node->GetID();
+    if (nodeID >= FIRST_LOCAL_ID || newInterestNodes_.Contains(nodeID))
+        return;
+
+    newInterestNodes_.Insert(nodeID);
+    // If was not within the scope on the previous update, the node entered it
+    if (!interestNodes_.Erase(nodeID))
+        MarkScopeChanged(node);
+}
+
+void Connection::UpdateDependencyScope(Node* node)
+{
+    unsigned nodeID = node->GetID();
+    HashMap<unsigned, PODVector<unsigned> >::Iterator i = dependencyScopes_.Find(nodeID);
+    PODVector<unsigned>* scopeNodes = 0;
+    if (i != dependencyScopes_.End())
+    {
+        scopeNodes = &i->second_;
+        scopeNodes->Clear();
+    }
+
+    // The depended upon nodes must exist on the client. Bring them into the scope by adding their ancestors that have a
+    // NetworkPriority component
+    Scene* scene = scene_;
+    const PODVector<Node*>& dependencyNodes = node->GetDependencyNodes();
+    for (PODVector<Node*>::ConstIterator j = dependencyNodes.Begin(); j != dependencyNodes.End(); ++j)
+    {
+        bool entered = false;
+        for (Node* current = *j; current && current != scene; current = current->GetParent())
+        {
+            unsigned currentID = current->GetID();
+            if (currentID >= FIRST_LOCAL_ID || !current->GetComponent<NetworkPriority>())
+                continue;
+
+            if (!scopeNodes)
+                scopeNodes = &dependencyScopes_[nodeID];
+            scopeNodes->Push(currentID);
+            if (!interestNodes_.Contains(currentID))
+            {
+                interestNodes_.Insert(currentID);
+                MarkScopeChanged(current);
+                entered = true;
+            }
+        }
+
+        // Process the node during this update, even if it was already found to be out of scope
+        if (entered)
+            nodesToProcess_.Insert((*j)->GetID());
+    }
+
+    if (scopeNodes && scopeNodes->Empty())
+        dependencyScopes_.Erase(nodeID);
+}
+
+void Connection::MarkScopeChanged(Node* node)
+{
+    sceneState_.dirtyNodes_.Insert(node->GetID());
+
+    node->GetChildren(scopeChangedNodes_, true);
+    for (PODVector<Node*>::ConstIterator i = scopeChangedNodes_.Begin(); i != scopeChangedNodes_.End(); ++i)
+    {
+        if ((*i)->GetID() < FIRST_LOCAL_ID)
+            sceneState_.dirtyNodes_.Insert((*i)->GetID());
+    }
+}
+
+bool Connection::IsInScope(Node* node) const
+{
+    // The node and all its ancestors with a NetworkPriority component must be within the interest radius, or owned by
+    // this connection
+    Scene* scene = scene_;
+    while (node && node != scene)
+    {
+        if (node->GetOwner() != this && !interestNodes_.Contains(node->GetID()) && node->GetComponent<NetworkPriority>())
+            return false;
+        node = node->GetParent();
+    }
+
+    return true;
+}
+
+void Connection::AddReplicationStateChange(NodeReplicationState* nodeState, ComponentReplicationState* componentState,
+    Serializable* object, unsigned id)
+{
+    ReplicationStateChange change;
+    change.nodeState_ = nodeState;
+    change.componentState_ = componentState;
+    change.object_ = object;
+    change.id_ = id;
+    replicationStateChanges_.Push(change);
+}
+
+void Connection::BuildSnapshot()
+{
+    // The client will not use snapshots older than the last acknowledged one as baselines anymore
+    while (snapshots_.Size() && (snapshots_.Front().sequence_ < ackedSnapshot_ || snapshots_.Size() >= MAX_SNAPSHOTS))
+        snapshots_.PopFront();
+
+    const NetworkSnapshot* previous = snapshots_.Size() ? &snapshots_.Back() : 0;
+    const NetworkSnapshot* baseline = 0;
+    for (List<NetworkSnapshot>::ConstIterator i = snapshots_.Begin(); i != snapshots_.End(); ++i)
+    {
+        if (i->sequence_ == ackedSnapshot_)
+        {
+            baseline = &(*i);
+            break;
+        }
+    }
+
+    snapshots_.Push(NetworkSnapshot());
+    NetworkSnapshot& snapshot = snapshots_.Back();
+    snapshot.sequence_ = ++snapshotSequence_;
+
+    snapshotData_.Clear();
+    snapshotParts_.Clear();
+
+    for (HashMap<unsigned, NodeReplicationState>::Iterator i = sceneState_.nodeStates_.Begin();
+         i != sceneState_.nodeStates_.End(); ++i)
+    {
+        Node* node = i->second_.node_;
+        if (!node)
+            continue;
+
+        WriteSnapshotRecord(node, i->second_);
+        const PODVector<unsigned char>& data = snapshotRecord_.GetBuffer();
+
+        // Share the record with the previous snapshot if unchanged, so that the history does not copy all node states
+        SharedPtr<SnapshotRecord>& record = snapshot.records_[i->first_];
+        if (previous)
+        {
+            HashMap<unsigned, SharedPtr<SnapshotRecord> >::ConstIterator j = previous->records_.Find(i->first_);
+            if (j != previous->records_.End() && j->second_->data_ == data)
+                record = j->second_;
+        }
+        if (!record)
+        {
+            record = new SnapshotRecord();
+            record->data_ = data;
+        }
+
+        // Send only the records that differ from the baseline
+        const PODVector<unsigned char>* baseRecord = 0;
+        if (baseline)
+        {
+            HashMap<unsigned, SharedPtr<SnapshotRecord> >::ConstIterator j = baseline->records_.Find(i->first_);
+            if (j != baseline->records_.End())
+            {
+                if (j->second_ == record || j->second_->data_ == data)
+                    continue;
+                baseRecord = &j->second_->data_;
+            }
+        }
+
+        unsigned recordStart = snapshotData_.GetSize();
+        snapshotData_.WriteNetID(i->first_);
+        WriteRecordDelta(snapshotData_, data, baseRecord);
+        SplitSnapshotPart(snapshotData_, snapshotParts_, recordStart);
+    }
+
+    // Nodes that were in the baseline but are no longer replicated are sent with zero size
+    if (baseline)
+    {
+        for (HashMap<unsigned, SharedPtr<SnapshotRecord> >::ConstIterator i = baseline->records_.Begin();
+             i != baseline->records_.End(); ++i)
+        {
+            if (!snapshot.records_.Contains(i->first_))
+            {
+                unsigned recordStart = snapshotData_.GetSize();
+                snapshotData_.WriteNetID(i->first_);
+                snapshotData_.WriteVLE(0);
+                SplitSnapshotPart(snapshotData_, snapshotParts_, recordStart);
+            }
+        }
+    }
+
+    snapshotParts_.Push(snapshotData_.GetSize());
+
+    // Send each part as a separate unreliable message. Also an unchanged snapshot is sent, so that the client
+    // acknowledges it and the baseline advances
+    unsigned numParts = snapshotParts_.Size();
+    for (unsigned i = 0; i < numParts; ++i)
+    {
+        unsigned start = i ? snapshotParts_[i - 1] : 0;
+        unsigned end = snapshotParts_[i];
+
+        msg_.Clear();
+        msg_.WriteUInt(snapshot.sequence_);
+        msg_.WriteUInt(baseline ? baseline->sequence_ : 0);
+        msg_.WriteUByte(timeStamp_);
+        msg_.WriteVLE(i);
+        msg_.WriteVLE(numParts);
+        if (end > start)
+            msg_.Write(snapshotData_.GetData() + start, end - start);
+
+        SendMessage(MSG_SNAPSHOT, false, false, msg_);
+    }
+}
+
+void Connection::WriteSnapshotRecord(Node* node, NodeReplicationState& nodeState)
+{
+    snapshotRecord_.Clear();
+
+    // Write all attributes. The timestamps are written as zero to keep unchanged records identical; the client fills
+    // in the timestamp of the snapshot
+    DirtyBits attributeBits;
+    SetAllAttributeBits(attributeBits, node->GetNetworkAttributes());
+    node->WriteDeltaUpdate(snapshotRecord_, attributeBits, 0, &encodeStats_);
+
+    const VariantMap& vars = node->GetVars();
+    snapshotRecord_.WriteVLE(vars.Size());
+    for (VariantMap::ConstIterator i = vars.Begin(); i != vars.End(); ++i)
+    {
+        snapshotRecord_.WriteStringHash(i->first_);
+        snapshotRecord_.WriteVariant(i->second_);
+    }
+
+    // Write the components already created on the client, each preceded by its data size
+    const Vector<SharedPtr<Component> >& components = node->GetComponents();
+    unsigned numComponents = 0;
+    for (unsigned i = 0; i < components.Size(); ++i)
+    {
+        if (nodeState.componentStates_.Contains(components[i]->GetID()))
+            ++numComponents;
+    }
+
+    snapshotRecord_.WriteVLE(numComponents);
+    for (unsigned i = 0; i < components.Size(); ++i)
+    {
+        Component* component = components[i];
+        if (!nodeState.componentStates_.Contains(component->GetID()))
+            continue;
+
+        snapshotRecord_.WriteNetID(component->GetID());
+        unsigned sizePosition = snapshotRecord_.GetPosition();
+        snapshotRecord_.WriteUInt(0);
+
+        attributeBits.ClearAll();
+        SetAllAttributeBits(attributeBits, component->GetNetworkAttributes());
+        component->WriteDeltaUpdate(snapshotRecord_, attributeBits, 0, &encodeStats_);
+
+        unsigned endPosition = snapshotRecord_.GetPosition();
+        snapshotRecord_.Seek(sizePosition);
+        snapshotRecord_.WriteUInt(endPosition - sizePosition - sizeof(unsigned));
+        snapshotRecord_.Seek(endPosition);
+    }
+}
+
+void Connection::ProcessSnapshot(int msgID, MemoryBuffer& msg)
+{
+    if (IsClient())
+    {
+        URHO3D_LOGWARNING("Received unexpected Snapshot message from client " + ToString());
+        return;
+    }
+
+    if (!scene_)
+        return;
+
+    unsigned sequence = msg.ReadUInt();
+    unsigned baseline = msg.ReadUInt();
+    unsigned char timeStamp = msg.ReadUByte();
+    unsigned partIndex = msg.ReadVLE();
+    unsigned numParts = msg.ReadVLE();
+
+    // Ignore snapshots older than the last applied one, and parts of an older snapshot than the one being received
+    if (sequence <= snapshotSequence_ || sequence < pendingSnapshot_.sequence_ || partIndex >= numParts)
+        return;
+
+    const NetworkSnapshot* baselineSnapshot = 0;
+    if (baseline)
+    {
+        for (List<NetworkSnapshot>::ConstIterator i = snapshots_.Begin(); i != snapshots_.End(); ++i)
+        {
+            if (i->sequence_ == baseline)
+            {
+                baselineSnapshot = &(*i);
+                break;
+            }
+        }
+
+        // Can not decode without the baseline. The server will send against a newer baseline once it receives an acknowledgement
+        if (!baselineSnapshot)
+            return;
+    }
+
+    if (sequence != pendingSnapshot_.sequence_)
+    {
+        pendingSnapshot_.sequence_ = sequence;
+        pendingSnapshot_.baseline_ = baseline;
+        pendingSnapshot_.numParts_ = numParts;
+        pendingSnapshot_.timeStamp_ = timeStamp;
+        pendingSnapshot_.receivedParts_.Clear();
+        pendingSnapshot_.records_.Clear();
+        pendingSnapshot_.removedNodes_.Clear();
+    }
+    else if (pendingSnapshot_.receivedParts_.Contains(partIndex))
+        return;
+
+    while (!msg.IsEof())
+    {
+        unsigned nodeID = msg.ReadNetID();
+        unsigned size = msg.ReadVLE();
+        if (!size)
+        {
+            pendingSnapshot_.removedNodes_.Push(nodeID);
+            continue;
+        }
+
+        const PODVector<unsigned char>* baseRecord = 0;
+        if (baselineSnapshot)
+        {
+            HashMap<unsigned, SharedPtr<SnapshotRecord> >::ConstIterator i = baselineSnapshot->records_.Find(nodeID);
+            if (i != baselineSnapshot->records_.End())
+                baseRecord = &i->second_->data_;
+        }
+
+        SharedPtr<SnapshotRecord>& record = pendingSnapshot_.records_[nodeID];
+        if (!record)
+            record = new SnapshotRecord();
+        if (!ReadRecordDelta(msg, record->data_, baseRecord, size - 1))
+        {
+            URHO3D_LOGWARNING("Discarding malformed Snapshot message");
+            // Make sure the snapshot does not complete
+            pendingSnapshot_.numParts_ = M_MAX_UNSIGNED;
+            return;
+        }
+    }
+
+    pendingSnapshot_.receivedParts_.Insert(partIndex);
+    if (pendingSnapshot_.receivedParts_.Size() == pendingSnapshot_.numParts_)
+        CompleteSnapshot();
+}
+
+void Connection::ProcessSnapshotAck(int msgID, MemoryBuffer& msg)
+{
+    if (!IsClient())
+    {
+        URHO3D_LOGWARNING("Received unexpected SnapshotAck message from server");
+        return;
+    }
+
+    unsigned sequence = msg.ReadUInt();
+    if (sequence > ackedSnapshot_ && sequence <= snapshotSequence_)
+        ackedSnapshot_ = sequence;
+}
+
+void Connection::CompleteSnapshot()
+{
+    // The baseline is looked up before removing older snapshots, as it is the oldest one the server still uses
+    unsigned baseline = pendingSnapshot_.baseline_;
+    List<NetworkSnapshot>::ConstIterator baselineSnapshot = snapshots_.End();
+    if (baseline)
+    {
+        for (List<NetworkSnapshot>::ConstIterator i = snapshots_.Begin(); i != snapshots_.End(); ++i)
+        {
+            if (i->sequence_ == baseline)
+            {
+                baselineSnapshot = i;
+                break;
+            }
+        }
+    }
+    else
+    {
+        // A full snapshot is sent when starting or after losing the baseline: apply all nodes again
+        appliedRecords_.Clear();
+    }
+
+    snapshots_.Push(NetworkSnapshot());
+    NetworkSnapshot& snapshot = snapshots_.Back();
+    snapshot.sequence_ = pendingSnapshot_.sequence_;
+    snapshotSequence_ = snapshot.sequence_;
+
+    // Records not sent are unchanged from the baseline. They are shared with it instead of copied
+    if (baselineSnapshot != snapshots_.End())
+        snapshot.records_ = baselineSnapshot->records_;
+    for (PODVector<unsigned>::ConstIterator i = pendingSnapshot_.removedNodes_.Begin(); i != pendingSnapshot_.removedNodes_.End(); ++i)
+        snapshot.records_.Erase(*i);
+    for (HashMap<unsigned, SharedPtr<SnapshotRecord> >::ConstIterator i = pendingSnapshot_.records_.Begin();
+         i != pendingSnapshot_.records_.End(); ++i)
+        snapshot.records_[i->first_] = i->second_;
+
+    // The server will not use snapshots older than this baseline anymore
+    while (snapshots_.Size() > 1 && (snapshots_.Front().sequence_ < baseline || snapshots_.Size() > MAX_SNAPSHOTS))
+        snapshots_.PopFront();
+
+    // Apply the node states that differ from the last applied ones. A node or component may not exist yet if its creation
+    // message has not arrived, in which case the state is applied again on the next snapshot
+    for (HashMap<unsigned, SharedPtr<SnapshotRecord> >::ConstIterator i = snapshot.records_.Begin(); i != snapshot.records_.End(); ++i)
+    {
+        Node* node = scene_->GetNode(i->first_);
+        if (!node)
+            continue;
+
+        HashMap<unsigned, SharedPtr<SnapshotRecord> >::Iterator j = appliedRecords_.Find(i->first_);
+        if (j != appliedRecords_.End() && (j->second_ == i->second_ || j->second_->data_ == i->second_->data_))
+            continue;
+
+        if (ApplySnapshotRecord(node, i->second_->data_, pendingSnapshot_.timeStamp_))
+            appliedRecords_[i->first_] = i->second_;
+        else if (j != appliedRecords_.End())
+            appliedRecords_.Erase(j);
+    }
+
+    for (HashMap<unsigned, SharedPtr<SnapshotRecord> >::Iterator i = appliedRecords_.Begin(); i != appliedRecords_.End();)
+    {
+        if (!snapshot.records_.Contains(i->first_))
+            i = appliedRecords_.Erase(i);
+        else
+            ++i;
+    }
+
+    pendingSnapshot_.receivedParts_.Clear();
+    pendingSnapshot_.records_.Clear();
+    pendingSnapshot_.removedNodes_.Clear();
+
+    msg_.Clear();
+    msg_.WriteUInt(snapshot.sequence_);
+    SendMessage(MSG_SNAPSHOTACK, false, false, msg_, SNAPSHOTACK_CONTENT_ID);
+}
+
+bool Connection::ApplySnapshotRecord(Node* node, const PODVector<unsigned char>& record, unsigned char timeStamp)
+{
+    if (record.Empty())
+        return false;
+
+    // Work on a copy to fill in the timestamps, which are written as zero on the server
+    snapshotRecord_.SetData(record);
+    unsigned char* data = snapshotRecord_.GetModifiableData();
+    data[0] = timeStamp;
+
+    node->ReadDeltaUpdate(snapshotRecord_);
+    // ApplyAttributes() is deliberately skipped, as Node has no attributes that require late applying.
+    // Furthermore it would propagate to components and child nodes, which is not desired in this case
+    unsigned numVars = snapshotRecord_.ReadVLE();
+    while (numVars)
+    {
+        StringHash key = snapshotRecord_.ReadStringHash();
+        node->SetVar(key, snapshotRecord_.ReadVariant());
+        --numVars;
+    }
+
+    bool complete = true;
+    unsigned numComponents = snapshotRecord_.ReadVLE();
+    while (numComponents)
+    {
+        --numComponents;
+
+        unsigned componentID = snapshotRecord_.ReadNetID();
+        unsigned size = snapshotRecord_.ReadUInt();
+        unsigned start = snapshotRecord_.GetPosition();
+        if (!size || start + size > snapshotRecord_.GetSize())
+            return false;
+
+        Component* component = scene_->GetComponent(componentID);
+        if (component && component->GetNode() == node)
+        {
+            data[start] = timeStamp;
+            component->ReadDeltaUpdate(snapshotRecord_);
+            component->ApplyAttributes();
+        }
+        else
+            complete = false;
+
+        snapshotRecord_.Seek(start + size);
+    }
+
+    return complete;
+}
+
+void Connection::MarkAllAttributesDirty()
+{
+    for (HashMap<unsigned, NodeReplicationState>::Iterator i = sceneState_.nodeStates_.Begin();
+         i != sceneState_.nodeStates_.End(); ++i)
+    {
+        NodeReplicationState& nodeState = i->second_;
+        Node* node = nodeState.node_;
+        if (!node)
+            continue;
+
+        SetAllAttributeBits(nodeState.dirtyAttributes_, node->GetNetworkAttributes());
+        const VariantMap& vars = node->GetVars();
+        for (VariantMap::ConstIterator j = vars.Begin(); j != vars.End(); ++j)
+            nodeState.dirtyVars_.Insert(j->first_);
+
+        for (HashMap<unsigned, ComponentReplicationState>::Iterator j = nodeState.componentStates_.Begin();
+             j != nodeState.componentStates_.End(); ++j)
+        {
+            Component* component = j->second_.component_;
+            if (component)
+                SetAllAttributeBits(j->second_.dirtyAttributes_, component->GetNetworkAttributes());
+        }
+
+        nodeState.markedDirty_ = true;
+        sceneState_.dirtyNodes_.Insert(i->first_);
+    }
+}
+
+void Connection::ResetSnapshots()
+{
+    snapshots_.Clear();
+    pendingSnapshot_ = PendingSnapshot();
+    appliedRecords_.Clear();
+    ackedSnapshot_ = 0;
+}
+
 bool Connection::RequestNeededPackages(unsigned numPackages, MemoryBuffer& msg)
 {
     ResourceCache* cache = GetSubsystem<ResourceCache>();
@@ -1455,17 +2637,154 @@ void Connection::RequestPackage(const String& name, unsigned fileSize, unsigned
 
     PackageDownload& download = downloads_[nameHash];
     download.name_ = name;
-    download.totalFragments_ = (fileSize + PACKAGE_FRAGMENT_SIZE - 1) / PACKAGE_FRAGMENT_SIZE;
+    download.fileSize_ = fileSize;
     download.checksum_ = checksum;
 
     // Start download now only if no existing downloads, else wait for the existing ones to finish
     if (downloads_.Size() == 1)
+        StartPackageDownload(download);
+}
+
+void Connection::StartPackageDownload(PackageDownload& download)
+{
+    // Data is received to a partial file first, which is renamed once complete. Prepend the checksum to the filename to allow
+    // multiple versions
+    String fileName = GetSubsystem<Network>()->GetPackageCacheDir() + ToStringHex(download.checksum_) + "_" + download.name_ +
+        ".part";
+
+    // If a partial file exists from an interrupted download, resume after the data already received. The file only ever
+    // contains data received contiguously from the start of the package
+    unsigned receivedBytes = 0;
+    if (GetSubsystem<FileSystem>()->FileExists(fileName))
     {
-        URHO3D_LOGINFO("Requesting package " + name + " from server");
-        msg_.Clear();
-        msg_.WriteString(name);
-        SendMessage(MSG_REQUESTPACKAGE, true, true, msg_);
-        download.initiated_ = true;
+        download.file_ = new File(context_, fileName, FILE_READWRITE);
+        if (download.file_->IsOpen())
+            receivedBytes = download.file_->GetSize();
+        // Start over if the partial file is not shorter than the package, as its contents can not be trusted
+        if (receivedBytes >= download.fileSize_)
+        {
+            download.file_.Reset();
+            receivedBytes = 0;
+        }
+    }
+    if (!download.file_)
+        download.file_ = new File(context_, fileName, FILE_WRITE);
+
+    download.initiated_ = true;
+    if (!download.file_->IsOpen())
+    {
+        OnPackageDownloadFailed(download.name_);
+        return;
+    }
+
+    // The server checks the partial data against the package before resuming
+    unsigned prefixChecksum = receivedBytes ? GetFilePrefixChecksum(download.file_, receivedBytes) : 0;
+    download.file_->Seek(receivedBytes);
+    download.receivedBytes_ = receivedBytes;
+    download.requestedOffset_ = receivedBytes;
+    download.pendingFragments_.Clear();
+
+    if (receivedBytes)
+    {
+        URHO3D_LOGINFO("Resuming download of package " + download.name_ + " from server at offset " + String(receivedBytes));
+        packageStats_.resumedBytes_ += receivedBytes;
+    }
+    else
+        URHO3D_LOGINFO("Requesting package " + download.name_ + " from server");
+
+    msg_.Clear();
+    msg_.WriteString(download.name_);
+    msg_.WriteUInt(receivedBytes);
+    if (receivedBytes)
+        msg_.WriteUInt(prefixChecksum);
+    SendMessage(MSG_REQUESTPACKAGE, true, true, msg_);
+}
+
+void Connection::WritePackageFragments(HashMap<StringHash, PackageDownload>::Iterator i)
+{
+    PackageDownload& download = i->second_;
+    unsigned receivedBytes = download.receivedBytes_;
+
+    // Append the fragments that continue the data in the file. Fragments received out of order wait for the missing ones
+    for (;;)
+    {
+        HashMap<unsigned, PODVector<unsigned char> >::Iterator j = download.pendingFragments_.Find(download.receivedBytes_);
+        if (j == download.pendingFragments_.End())
+            break;
+
+        download.file_->Write(&j->second_[0], j->second_.Size());
+        download.receivedBytes_ += j->second_.Size();
+        download.pendingFragments_.Erase(j);
+    }
+
+    if (download.receivedBytes_ == receivedBytes)
+        return;
+
+    // Acknowledge the contiguous data, which also allows the server to send more
+    msg_.Clear();
+    msg_.WriteStringHash(i->first_);
+    msg_.WriteUInt(download.receivedBytes_);
+    // Each package has its own content ID, so that the acknowledgements of different packages do not replace each other
+    SendMessage(MSG_PACKAGEACK, true, false, msg_, i->first_.Value());
+
+    // Check if all data received
+    if (download.receivedBytes_ < download.fileSize_)
+        return;
+
+    download.file_->Close();
+    String partialName = download.file_->GetName();
+    String fileName = partialName.Substring(0, partialName.Length() - 5);
+
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    if (fileSystem->FileExists(fileName))
+        fileSystem->Delete(fileName);
+    if (!fileSystem->Rename(partialName, fileName))
+    {
+        OnPackageDownloadFailed(download.name_);
+        return;
+    }
+
+    URHO3D_LOGINFO("Package " + download.name_ + " downloaded successfully");
+
+    // Instantiate the package and add to the resource system, as we will need it to load the scene
+    GetSubsystem<ResourceCache>()->AddPackageFile(fileName, 0);
+
+    // Then start the next download if there are more
+    downloads_.Erase(i);
+    if (downloads_.Empty())
+    {
+        UpdatePackageStats(0, 0);
+        OnPackagesReady();
+    }
+    else
+        StartPackageDownload(downloads_.Begin()->second_);
+}
+
+void Connection::UpdatePackageStats(unsigned bytes, unsigned compressedBytes)
+{
+    packageStats_.bytes_ += bytes;
+    packageStats_.compressedBytes_ += compressedBytes;
+
+    // Zero bytes signals the end of transfers, after which the rate is measured anew
+    if (!bytes)
+    {
+        packageStats_.bytesPerSec_ = 0.0f;
+        packageRateBytes_ = 0;
+        packageRateTimer_.Reset();
+        return;
+    }
+
+    // Start measuring the rate from the first transferred bytes
+    if (!packageRateBytes_ && packageStats_.bytesPerSec_ == 0.0f)
+        packageRateTimer_.Reset();
+
+    packageRateBytes_ += bytes;
+    unsigned elapsed = packageRateTimer_.GetMSec(false);
+    if (elapsed >= 1000)
+    {
+        packageStats_.bytesPerSec_ = packageRateBytes_ * 1000.0f / elapsed;
+        packageRateBytes_ = 0;
+        packageRateTimer_.Reset();
     }
 }
 
@@ -1532,6 +2851,36 @@ void Connection::OnPackagesReady()
     }
 }
 
+void Connection::WriteRecord(int msgID, unsigned char flags, const unsigned char* data, unsigned numBytes, unsigned contentID)
+{
+    // Time is written as milliseconds since the previous record
+    unsigned time = recordTimer_.GetMSec(false);
+    unsigned delta = time - recordTime_;
+    recordTime_ = time;
+
+    if (contentID)
+        flags |= RECORD_CONTENTID;
+    if ((unsigned)msgID >= 0x20000000 || contentID >= 0x20000000)
+        flags |= RECORD_LONGID;
+
+    recordFile_->WriteVLE(delta < 0x20000000 ? delta : 0x1fffffff);
+    recordFile_->WriteUByte(flags);
+    if (flags & RECORD_LONGID)
+    {
+        recordFile_->WriteUInt((unsigned)msgID);
+        if (contentID)
+            recordFile_->WriteUInt(contentID);
+    }
+    else
+    {
+        recordFile_->WriteVLE((unsigned)msgID);
+        if (contentID)
+            recordFile_->WriteVLE(contentID);
+    }
+    recordFile_->WriteVLE(numBytes);
+    recordFile_->Write(data, numBytes);
+}
+
 void Connection::ProcessPackageInfo(int msgID, MemoryBuffer& msg)
 {
     if (!scene_)
@@ -23,6 +23,7 @@
 #pragma once
 
 #include "../Container/HashSet.h"
+#include "../Container/List.h"
 #include "../Core/Object.h"
 #include "../Core/Timer.h"
 #include "../Input/Controls.h"
@@ -40,6 +41,7 @@ namespace Urho3D
 {
 
 class File;
+class InterestGrid;
 class MemoryBuffer;
 class Node;
 class Scene;
@@ -65,14 +67,18 @@ struct PackageDownload
     /// Construct with defaults.
     PackageDownload();
 
-    /// Destination file.
+    /// Destination file. Contains the data received contiguously from the start of the package.
     SharedPtr<File> file_;
-    /// Already received fragments.
-    HashSet<unsigned> receivedFragments_;
+    /// Received fragments not yet written to the file, by file offset.
+    HashMap<unsigned, PODVector<unsigned char> > pendingFragments_;
     /// Package name.
     String name_;
-    /// Total number of fragments.
-    unsigned totalFragments_;
+    /// Package file size.
+    unsigned fileSize_;
+    /// Bytes written to the destination file.
+    unsigned receivedBytes_;
+    /// File offset requested from the server. Fragments sent from another start offset belong to an earlier transfer, or mean that the server did not accept the partial data.
+    unsigned requestedOffset_;
     /// Checksum.
     unsigned checksum_;
     /// Download initiated flag.
@@ -87,10 +93,120 @@ struct PackageUpload
 
     /// Source file.
     SharedPtr<File> file_;
-    /// Current fragment index.
-    unsigned fragment_;
-    /// Total number of fragments
-    unsigned totalFragments_;
+    /// File offset of the next fragment to send.
+    unsigned offset_;
+    /// File offset the transfer was started or resumed from. Sent with each fragment.
+    unsigned startOffset_;
+    /// Bytes acknowledged by the client.
+    unsigned ackedOffset_;
+};
+
+/// Package file transfer statistics.
+struct PackageTransferStats
+{
+    /// Construct with defaults.
+    PackageTransferStats();
+
+    /// Package file bytes sent or received.
+    unsigned long long bytes_;
+    /// Fragment data bytes sent or received, after compression.
+    unsigned long long compressedBytes_;
+    /// Package file bytes not transferred due to resuming interrupted downloads.
+    unsigned long long resumedBytes_;
+    /// Package file bytes sent or received per second during an ongoing transfer.
+    float bytesPerSec_;
+};
+
+/// Remote event sending statistics.
+struct RemoteEventStats
+{
+    /// Construct with defaults.
+    RemoteEventStats();
+
+    /// Remote events sent.
+    unsigned events_;
+    /// Remote events replaced by a later event of the same type and sender before being sent.
+    unsigned coalescedEvents_;
+    /// Remote event batch messages sent.
+    unsigned batches_;
+    /// Remote event data bytes sent.
+    unsigned long long bytes_;
+    /// Bytes saved by coalescing and schema encoding compared to sending each event separately with a full VariantMap, excluding per-message transport overhead.
+    unsigned long long bytesSaved_;
+};
+
+/// Outgoing message buffered during a threaded server update.
+struct BufferedMessage
+{
+    /// Message ID.
+    int msgID_;
+    /// Reliable flag.
+    bool reliable_;
+    /// In order flag.
+    bool inOrder_;
+    /// Content ID.
+    unsigned contentID_;
+    /// Offset of message data in the buffer.
+    unsigned offset_;
+    /// Message data size.
+    unsigned size_;
+};
+
+/// Replication state change recorded during a threaded server update, to be applied in the main thread.
+struct ReplicationStateChange
+{
+    /// Node replication state.
+    NodeReplicationState* nodeState_;
+    /// Component replication state, or null if the change concerns the node state.
+    ComponentReplicationState* componentState_;
+    /// Node or component to link the new state to, or null to remove the state.
+    Serializable* object_;
+    /// Node or component ID.
+    unsigned id_;
+};
+
+/// Encoded node state in a snapshot. Shared between the snapshots in which the node state is unchanged.
+struct SnapshotRecord : public RefCounted
+{
+    /// Encoded data.
+    PODVector<unsigned char> data_;
+};
+
+/// Encoded state of the scene nodes replicated to a client at one server update. Used as a delta baseline in snapshot replication.
+struct NetworkSnapshot
+{
+    /// Construct with defaults.
+    NetworkSnapshot() :
+        sequence_(0)
+    {
+    }
+
+    /// Sequence number.
+    unsigned sequence_;
+    /// Encoded node states by node ID.
+    HashMap<unsigned, SharedPtr<SnapshotRecord> > records_;
+};
+
+/// Partially received snapshot on the client.
+struct PendingSnapshot
+{
+    /// Construct with defaults.
+    PendingSnapshot();
+
+    /// Sequence number.
+    unsigned sequence_;
+    /// Sequence number of the baseline snapshot, or 0 if none.
+    unsigned baseline_;
+    /// Total number of message parts.
+    unsigned numParts_;
+    /// Controls timestamp of the server update.
+    unsigned char timeStamp_;
+    /// Already received message parts.
+    HashSet<unsigned> receivedParts_;
+    /// Node states changed from the baseline by node ID.
+    HashMap<unsigned, SharedPtr<SnapshotRecord> > records_;
+    /// Nodes removed since the baseline.
+    PODVector<unsigned> removedNodes_;
 };
 
 /// Send modes for observer position/rotation. Activated by the client setting either position or rotation.
@@ -107,7 +223,7 @@ class URHO3D_API Connection : public Object
     URHO3D_OBJECT(Connection, Object);
 
 public:
-    /// Construct with context and kNet message connection pointers.
+    /// Construct with context and kNet message connection pointers. The kNet connection may be null for replaying recorded messages, in which case sent messages are only recorded.
     Connection(Context* context, bool isClient, kNet::SharedPtr<kNet::MessageConnection> connection);
     /// Destruct.
     ~Connection();
@@ -116,9 +232,9 @@ public:
     void SendMessage(int msgID, bool reliable, bool inOrder, const VectorBuffer& msg, unsigned contentID = 0);
     /// Send a message.
     void SendMessage(int msgID, bool reliable, bool inOrder, const unsigned char* data, unsigned numBytes, unsigned contentID = 0);
-    /// Send a remote event.
+    /// Send a remote event. Remote events are sent batched on the next network update. If coalescing has been enabled for the event type, replaces a queued event of the same type.
     void SendRemoteEvent(StringHash eventType, bool inOrder, const VariantMap& eventData = Variant::emptyVariantMap);
-    /// Send a remote event with the specified node as sender.
+    /// Send a remote event with the specified node as sender. If coalescing has been enabled for the event type, replaces a queued event of the same type and sender.
     void SendRemoteEvent(Node* node, StringHash eventType, bool inOrder, const VariantMap& eventData = Variant::emptyVariantMap);
     /// Assign scene. On the server, this will cause the client to load it.
     void SetScene(Scene* newScene);
@@ -138,16 +254,32 @@ public:
     void Disconnect(int waitMSec = 0);
     /// Send scene update messages. Called by Network.
     void SendServerUpdate();
+    /// Prepare the scene for building update messages in a worker thread. Called by Network in the main thread.
+    void PrepareServerUpdate();
+    /// Build scene update messages into the outgoing message buffer. Called by Network, possibly from a worker thread. The scene must not be modified meanwhile.
+    void BuildServerUpdate();
+    /// Link created replication states to their scene objects and remove stale ones after BuildServerUpdate(). Called by Network in the main thread.
+    void ApplyReplicationStateChanges();
+    /// Build the snapshot message into the outgoing message buffer if snapshot replication is active. Called by Network after ApplyReplicationStateChanges(), possibly from a worker thread.
+    void BuildServerSnapshot();
+    /// Send messages buffered during BuildServerUpdate(). Called by Network in the main thread.
+    void SendBufferedMessages();
     /// Send latest controls from the client. Called by Network.
     void SendClientUpdate();
     /// Send queued remote events. Called by Network.
     void SendRemoteEvents();
-    /// Send package files to client. Called by network.
+    /// Send package file fragments to client, up to the unacknowledged fragment limit. Called by Network, and when the client acknowledges received data.
     void SendPackages();
     /// Process pending latest data for nodes and components.
     void ProcessPendingLatestData();
     /// Process a message from the server or client. Called by Network.
     bool ProcessMessage(int msgID, MemoryBuffer& msg);
+    /// Start recording sent and received messages with timestamps to a file. Return true if successful.
+    bool StartRecording(const String& fileName);
+    /// Stop recording messages.
+    void StopRecording();
+    /// Record a received message. Called by Network.
+    void RecordMessage(int msgID, const unsigned char* data, unsigned numBytes);
 
     /// Return the kNet message connection.
     kNet::MessageConnection* GetMessageConnection() const;
@@ -185,6 +317,9 @@ public:
     /// Return whether to log data in/out statistics.
     bool GetLogStatistics() const { return logStatistics_; }
 
+    /// Return whether messages are being recorded.
+    bool IsRecording() const { return recordFile_.NotNull(); }
+
     /// Return remote address.
     String GetAddress() const { return address_; }
 
@@ -209,6 +344,18 @@ public:
     /// Return packets sent per second.
     float GetPacketsOutPerSec() const;
 
+    /// Return number of scene nodes currently replicated to the client. With an InterestGrid component in the scene, this is limited to the nodes in the client's interest scope.
+    unsigned GetNumScopedNodes() const { return sceneState_.nodeStates_.Size(); }
+
+    /// Return statistics of encoding scene updates, including the bytes and time saved by reusing updates already encoded for other connections.
+    const NetworkEncodeStats& GetEncodeStats() const { return encodeStats_; }
+
+    /// Return package file transfer statistics.
+    const PackageTransferStats& GetPackageStats() const { return packageStats_; }
+
+    /// Return remote event sending statistics.
+    const RemoteEventStats& GetRemoteEventStats() const { return remoteEventStats_; }
+
     /// Return an address:port string.
     String ToString() const;
     /// Return number of package downloads remaining.
@@ -249,18 +396,59 @@ private:
     void ProcessSceneLoaded(int msgID, MemoryBuffer& msg);
     /// Process a remote event message from the client or server. Called by Network.
     void ProcessRemoteEvent(int msgID, MemoryBuffer& msg);
+    /// Queue a remote event, coalescing it with an already queued one if enabled for the event type.
+    void QueueRemoteEvent(unsigned senderID, StringHash eventType, bool inOrder, const VariantMap& eventData);
+    /// Write queued remote events with the specified ordering into one message and send it.
+    void SendRemoteEventBatch(bool inOrder);
+    /// Send a received remote event locally if it is allowed.
+    void DispatchRemoteEvent(unsigned senderID, StringHash eventType, VariantMap& eventData);
+    /// Process a snapshot message from the server. Called by Network.
+    void ProcessSnapshot(int msgID, MemoryBuffer& msg);
+    /// Process a snapshot acknowledgement from the client. Called by Network.
+    void ProcessSnapshotAck(int msgID, MemoryBuffer& msg);
     /// Process a node for sending a network update. Recurses to process depended on node(s) first.
     void ProcessNode(unsigned nodeID);
     /// Process a node that the client has not yet received.
     void ProcessNewNode(Node* node);
     /// Process a node that the client has already received.
     void ProcessExistingNode(Node* node, NodeReplicationState& nodeState);
+    /// Update the nodes within the interest radius and mark nodes entering or leaving the scope dirty.
+    void UpdateInterestScope();
+    /// Add a node to the interest scope being built, and mark it dirty if it entered the scope.
+    void AddInterestNode(Node* node);
+    /// Update the nodes kept in the interest scope because a replicated node depends on them, and process those that entered the scope during the current update.
+    void UpdateDependencyScope(Node* node);
+    /// Mark a node and its replicated children dirty after an interest scope change.
+    void MarkScopeChanged(Node* node);
+    /// Return whether a node is in the interest scope of the client.
+    bool IsInScope(Node* node) const;
+    /// Record a replication state to be linked to a node or component, or removed if the object is null.
+    void AddReplicationStateChange(NodeReplicationState* nodeState, ComponentReplicationState* componentState,
+        Serializable* object, unsigned id);
+    /// Encode the replicated nodes into a new snapshot and send it delta compressed against the last acknowledged snapshot.
+    void BuildSnapshot();
+    /// Encode the full replicated state of a node.
+    void WriteSnapshotRecord(Node* node, NodeReplicationState& nodeState);
+    /// Assemble a fully received snapshot, apply the changed node states and acknowledge it to the server.
+    void CompleteSnapshot();
+    /// Apply an encoded node state. Return true if the node and all its components were found.
+    bool ApplySnapshotRecord(Node* node, const PODVector<unsigned char>& record, unsigned char timeStamp);
+    /// Mark all attributes of the replicated nodes and components dirty after switching from snapshot replication back to delta updates.
+    void MarkAllAttributesDirty();
+    /// Reset snapshot replication state.
+    void ResetSnapshots();
     /// Process a SyncPackagesInfo message from server.
     void ProcessPackageInfo(int msgID, MemoryBuffer& msg);
     /// Check a package list received from server and initiate package downloads as necessary. Return true on success, or false if failed to initialze downloads (cache dir not set)
     bool RequestNeededPackages(unsigned numPackages, MemoryBuffer& msg);
     /// Initiate a package download.
     void RequestPackage(const String& name, unsigned fileSize, unsigned checksum);
+    /// Open the destination file of a package download and request the data not yet received from the server.
+    void StartPackageDownload(PackageDownload& download);
+    /// Write received package fragments which continue the downloaded data, and acknowledge them to the server. Finish the download if complete.
+    void WritePackageFragments(HashMap<StringHash, PackageDownload>::Iterator i);
+    /// Update package transfer statistics.
+    void UpdatePackageStats(unsigned bytes, unsigned compressedBytes);
     /// Send an error reply for a package download.
     void SendPackageError(const String& name);
     /// Handle scene load failure on the server or client.
@@ -269,6 +457,8 @@ private:
     void OnPackageDownloadFailed(const String& name);
     /// Handle all packages loaded successfully. Also called directly on MSG_LOADSCENE if there are none.
     void OnPackagesReady();
+    /// Write a sent or received message to the recording file.
+    void WriteRecord(int msgID, unsigned char flags, const unsigned char* data, unsigned numBytes, unsigned contentID);
 
     /// kNet message connection.
     kNet::SharedPtr<kNet::MessageConnection> connection_;
@@ -286,18 +476,72 @@ private:
     HashMap<unsigned, PODVector<unsigned char> > componentLatestData_;
     /// Node ID's to process during a replication update.
     HashSet<unsigned> nodesToProcess_;
+    /// Interest management component of the scene during a server update, or null if interest management is not active.
+    InterestGrid* interestGrid_;
+    /// ID's of nodes with a NetworkPriority component within the interest radius.
+    HashSet<unsigned> interestNodes_;
+    /// ID's of nodes within the interest radius on the current update.
+    HashSet<unsigned> newInterestNodes_;
+    /// ID's of nodes with a NetworkPriority component kept in the interest scope, by the ID of the replicated node depending on them.
+    HashMap<unsigned, PODVector<unsigned> > dependencyScopes_;
+    /// Nodes returned by the interest grid query.
+    PODVector<Node*> interestQueryResult_;
+    /// Children of a node whose interest scope changed.
+    PODVector<Node*> scopeChangedNodes_;
     /// Reusable message buffer.
     VectorBuffer msg_;
+    /// Data of buffered outgoing messages.
+    VectorBuffer bufferedData_;
+    /// Buffered outgoing messages.
+    PODVector<BufferedMessage> bufferedMessages_;
+    /// Replication state changes to apply after building the server update.
+    PODVector<ReplicationStateChange> replicationStateChanges_;
     /// Queued remote events.
     Vector<RemoteEvent> remoteEvents_;
+    /// Sent snapshots not older than the last acknowledged one on the server, or fully received snapshots usable as baselines on the client. Oldest first.
+    List<NetworkSnapshot> snapshots_;
+    /// Partially received snapshot on the client.
+    PendingSnapshot pendingSnapshot_;
+    /// Node states last applied from snapshots on the client.
+    HashMap<unsigned, SharedPtr<SnapshotRecord> > appliedRecords_;
+    /// Encoded snapshot records being sent.
+    VectorBuffer snapshotData_;
+    /// End offsets of the snapshot message parts being sent.
+    PODVector<unsigned> snapshotParts_;
+    /// Reusable buffer for encoding or applying a snapshot record.
+    VectorBuffer snapshotRecord_;
+    /// Scene update encoding statistics.
+    NetworkEncodeStats encodeStats_;
+    /// Package file transfer statistics.
+    PackageTransferStats packageStats_;
+    /// Remote event sending statistics.
+    RemoteEventStats remoteEventStats_;
+    /// Reusable buffer for a package file fragment being sent.
+    PODVector<unsigned char> packageBuffer_;
+    /// Reusable buffer for a compressed package file fragment.
+    PODVector<unsigned char> compressBuffer_;
     /// Scene file to load once all packages (if any) have been downloaded.
     String sceneFileName_;
     /// Statistics timer.
     Timer statsTimer_;
+    /// Package transfer rate timer.
+    Timer packageRateTimer_;
+    /// Message recording file.
+    SharedPtr<File> recordFile_;
+    /// Message recording timer.
+    Timer recordTimer_;
     /// Remote endpoint address.
     String address_;
     /// Remote endpoint port.
     unsigned short port_;
+    /// Last snapshot sequence number sent on the server, or applied on the client.
+    unsigned snapshotSequence_;
+    /// Last snapshot sequence number acknowledged by the client.
+    unsigned ackedSnapshot_;
+    /// Package file bytes transferred since the transfer rate timer was reset.
+    unsigned packageRateBytes_;
+    /// Time of the last recorded message in milliseconds.
+    unsigned recordTime_;
     /// Observer position for interest management.
     Vector3 position_;
     /// Observer rotation for interest management.
@@ -312,6 +556,12 @@ private:
     bool sceneLoaded_;
     /// Show statistics flag.
     bool logStatistics_;
+    /// Buffer outgoing messages flag.
+    bool bufferMessages_;
+    /// Interest management active flag.
+    bool interestActive_;
+    /// Snapshot replication active flag.
+    bool snapshotMode_;
 };
 
 }
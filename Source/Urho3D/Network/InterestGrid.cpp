@@ -0,0 +1,222 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Container/Sort.h"
+#include "../Core/Context.h"
+#include "../Network/InterestGrid.h"
+#include "../Network/NetworkPriority.h"
+#include "../Scene/Node.h"
+#include "../Scene/Scene.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+extern const char* NETWORK_CATEGORY;
+
+static const float DEFAULT_INTEREST_RADIUS = 100.0f;
+static const int CELL_BITS = 21;
+static const int CELL_OFFSET = 1 << (CELL_BITS - 1);
+static const unsigned long long CELL_MASK = (1ULL << CELL_BITS) - 1;
+
+static bool CompareEntries(const InterestGridEntry& lhs, const InterestGridEntry& rhs)
+{
+    return lhs.cell_ < rhs.cell_;
+}
+
+static int GetCellCoordinate(float value, float cellSize)
+{
+    // Clamp to the representable range; far away cells may share keys, which is harmless as distances are checked
+    float cell = floorf(value / cellSize);
+    return (int)Clamp(cell, -(float)CELL_OFFSET, (float)(CELL_OFFSET - 1));
+}
+
+InterestGrid::InterestGrid(Context* context) :
+    Component(context),
+    interestRadius_(DEFAULT_INTEREST_RADIUS)
+{
+}
+
+InterestGrid::~InterestGrid()
+{
+    RemoveNetworkPriorities();
+}
+
+void InterestGrid::RegisterObject(Context* context)
+{
+    context->RegisterFactory<InterestGrid>(NETWORK_CATEGORY);
+
+    URHO3D_ACCESSOR_ATTRIBUTE("Is Enabled", IsEnabled, SetEnabled, bool, true, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Interest Radius", GetInterestRadius, SetInterestRadius, float, DEFAULT_INTEREST_RADIUS, AM_DEFAULT);
+}
+
+void InterestGrid::SetInterestRadius(float radius)
+{
+    interestRadius_ = Max(radius, 0.0f);
+    MarkNetworkUpdate();
+}
+
+void InterestGrid::Update()
+{
+    entries_.Clear();
+    if (!IsActive())
+        return;
+
+    for (PODVector<NetworkPriority*>::ConstIterator i = priorities_.Begin(); i != priorities_.End(); ++i)
+    {
+        (*i)->interestEntry_ = M_MAX_UNSIGNED;
+        Node* node = (*i)->GetNode();
+        if (!node)
+            continue;
+
+        InterestGridEntry entry;
+        entry.position_ = node->GetWorldPosition();
+        entry.cell_ = GetCell(GetCellCoordinate(entry.position_.x_, interestRadius_),
+            GetCellCoordinate(entry.position_.y_, interestRadius_), GetCellCoordinate(entry.position_.z_, interestRadius_));
+        entry.node_ = node;
+        entry.priority_ = *i;
+        entries_.Push(entry);
+    }
+
+    Sort(entries_.Begin(), entries_.End(), CompareEntries);
+
+    for (unsigned i = 0; i < entries_.Size(); ++i)
+        entries_[i].priority_->interestEntry_ = i;
+}
+
+void InterestGrid::AddNetworkPriority(NetworkPriority* priority)
+{
+    if (priority->interestGrid_ == this)
+        return;
+    if (priority->interestGrid_)
+        priority->interestGrid_->RemoveNetworkPriority(priority);
+
+    priority->interestGrid_ = this;
+    priority->interestIndex_ = priorities_.Size();
+    priorities_.Push(priority);
+}
+
+void InterestGrid::RemoveNetworkPriority(NetworkPriority* priority)
+{
+    if (priority->interestGrid_ != this)
+        return;
+
+    // Swap with the last to erase in constant time
+    unsigned index = priority->interestIndex_;
+    NetworkPriority* last = priorities_.Back();
+    priorities_[index] = last;
+    last->interestIndex_ = index;
+    priorities_.Pop();
+
+    // Do not leave a dangling node pointer in the grid, but keep the other entries until the next update
+    if (priority->interestEntry_ < entries_.Size())
+    {
+        entries_[priority->interestEntry_].node_ = 0;
+        entries_[priority->interestEntry_].priority_ = 0;
+    }
+
+    priority->interestGrid_ = 0;
+    priority->interestIndex_ = M_MAX_UNSIGNED;
+    priority->interestEntry_ = M_MAX_UNSIGNED;
+}
+
+void InterestGrid::GetNodes(PODVector<Node*>& dest, const Vector3& position) const
+{
+    dest.Clear();
+    if (entries_.Empty())
+        return;
+
+    // The cell size equals the interest radius, so the neighbouring cells contain all nodes within it
+    int cx = GetCellCoordinate(position.x_, interestRadius_);
+    int cy = GetCellCoordinate(position.y_, interestRadius_);
+    int cz = GetCellCoordinate(position.z_, interestRadius_);
+    float radiusSquared = interestRadius_ * interestRadius_;
+
+    for (int z = cz - 1; z <= cz + 1; ++z)
+    {
+        for (int y = cy - 1; y <= cy + 1; ++y)
+        {
+            for (int x = cx - 1; x <= cx + 1; ++x)
+            {
+                unsigned long long cell = GetCell(x, y, z);
+
+                // Binary search for the first entry of the cell
+                unsigned first = 0;
+                unsigned last = entries_.Size();
+                while (first < last)
+                {
+                    unsigned middle = (first + last) >> 1;
+                    if (entries_[middle].cell_ < cell)
+                        first = middle + 1;
+                    else
+                        last = middle;
+                }
+
+                for (unsigned i = first; i < entries_.Size() && entries_[i].cell_ == cell; ++i)
+                {
+                    if (entries_[i].node_ && (entries_[i].position_ - position).LengthSquared() <= radiusSquared)
+                        dest.Push(entries_[i].node_);
+                }
+            }
+        }
+    }
+}
+
+void InterestGrid::OnSceneSet(Scene* scene)
+{
+    RemoveNetworkPriorities();
+
+    if (scene)
+    {
+        // Pick up the NetworkPriority components that were created before this component
+        PODVector<NetworkPriority*> priorities;
+        scene->GetComponents<NetworkPriority>(priorities, true);
+        for (PODVector<NetworkPriority*>::ConstIterator i = priorities.Begin(); i != priorities.End(); ++i)
+            AddNetworkPriority(*i);
+    }
+}
+
+unsigned long long InterestGrid::GetCell(int x, int y, int z) const
+{
+    return (((unsigned long long)(x + CELL_OFFSET) & CELL_MASK) << (CELL_BITS * 2)) |
+           (((unsigned long long)(y + CELL_OFFSET) & CELL_MASK) << CELL_BITS) |
+           ((unsigned long long)(z + CELL_OFFSET) & CELL_MASK);
+}
+
+void InterestGrid::RemoveNetworkPriorities()
+{
+    for (PODVector<NetworkPriority*>::ConstIterator i = priorities_.Begin(); i != priorities_.End(); ++i)
+    {
+        (*i)->interestGrid_ = 0;
+        (*i)->interestIndex_ = M_MAX_UNSIGNED;
+        (*i)->interestEntry_ = M_MAX_UNSIGNED;
+    }
+
+    priorities_.Clear();
+    entries_.Clear();
+}
+
+}
@@ -0,0 +1,98 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Scene/Component.h"
+
+namespace Urho3D
+{
+
+class NetworkPriority;
+
+/// Node entry in the interest grid.
+struct InterestGridEntry
+{
+    /// Grid cell key.
+    unsigned long long cell_;
+    /// World position.
+    Vector3 position_;
+    /// Node, or null if the NetworkPriority component was removed after the last update.
+    Node* node_;
+    /// NetworkPriority component.
+    NetworkPriority* priority_;
+};
+
+/// %Network interest management component. When added to the scene, only nodes within the interest radius of a client's observer position are replicated to it, if they (or their ancestors) have a NetworkPriority component.
+class URHO3D_API InterestGrid : public Component
+{
+    URHO3D_OBJECT(InterestGrid, Component);
+
+public:
+    /// Construct.
+    InterestGrid(Context* context);
+    /// Destruct.
+    virtual ~InterestGrid();
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+
+    /// Set interest radius. Also used as the grid cell size. Zero disables interest management. Default 100.
+    void SetInterestRadius(float radius);
+    /// Rebuild the grid from the current node positions. Called by Network before sending server updates.
+    void Update();
+    /// Add a NetworkPriority component. Called by NetworkPriority.
+    void AddNetworkPriority(NetworkPriority* priority);
+    /// Remove a NetworkPriority component. Called by NetworkPriority.
+    void RemoveNetworkPriority(NetworkPriority* priority);
+
+    /// Return interest radius.
+    float GetInterestRadius() const { return interestRadius_; }
+
+    /// Return whether interest management is active.
+    bool IsActive() const { return interestRadius_ > 0.0f && IsEnabledEffective(); }
+
+    /// Return number of nodes with a NetworkPriority component.
+    unsigned GetNumNodes() const { return priorities_.Size(); }
+
+    /// Return nodes within the interest radius of a position, as of the last update. Safe to call from worker threads.
+    void GetNodes(PODVector<Node*>& dest, const Vector3& position) const;
+
+protected:
+    /// Handle scene being assigned.
+    virtual void OnSceneSet(Scene* scene);
+
+private:
+    /// Return grid cell key for a position.
+    unsigned long long GetCell(int x, int y, int z) const;
+    /// Remove all NetworkPriority components.
+    void RemoveNetworkPriorities();
+
+    /// NetworkPriority components in the scene.
+    PODVector<NetworkPriority*> priorities_;
+    /// Node entries sorted by grid cell.
+    PODVector<InterestGridEntry> entries_;
+    /// Interest radius.
+    float interestRadius_;
+};
+
+}
@@ -0,0 +1,582 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Container/Sort.h"
+#include "../Core/Context.h"
+#include "../Graphics/Drawable.h"
+#include "../Graphics/Octree.h"
+#include "../IO/Log.h"
+#include "../Network/LagCompensation.h"
+#include "../Network/Network.h"
+#ifdef URHO3D_PHYSICS
+#include "../Physics/PhysicsUtils.h"
+#include "../Physics/PhysicsWorld.h"
+#include "../Physics/RigidBody.h"
+#endif
+#include "../Scene/Node.h"
+#include "../Scene/Scene.h"
+
+#ifdef URHO3D_PHYSICS
+#include <Bullet/BulletDynamics/Dynamics/btDiscreteDynamicsWorld.h>
+#include <Bullet/BulletDynamics/Dynamics/btRigidBody.h>
+#endif
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+extern const char* NETWORK_CATEGORY;
+
+static const float DEFAULT_HISTORY_LENGTH = 1.0f;
+
+static bool CompareRewoundNodes(const RewoundNode& lhs, const RewoundNode& rhs)
+{
+    return lhs.depth_ < rhs.depth_;
+}
+
+template <class T> static void RemoveDuplicates(PODVector<T*>& values)
+{
+    Sort(values.Begin(), values.End());
+    unsigned count = 0;
+    for (unsigned i = 0; i < values.Size(); ++i)
+    {
+        if (!count || values[i] != values[count - 1])
+            values[count++] = values[i];
+    }
+    values.Resize(count);
+}
+
+static bool IsRecorded(Node* node)
+{
+    // Only nodes with something to hit are recorded
+    const Vector<SharedPtr<Component> >& components = node->GetComponents();
+    for (Vector<SharedPtr<Component> >::ConstIterator i = components.Begin(); i != components.End(); ++i)
+    {
+        if ((*i)->IsInstanceOf<Drawable>())
+            return true;
+#ifdef URHO3D_PHYSICS
+        if ((*i)->GetType() == RigidBody::GetTypeStatic())
+            return true;
+#endif
+    }
+
+    return false;
+}
+
+static void PushSample(TransformHistory& history, const TransformHistorySample& sample)
+{
+    unsigned capacity = history.samples_.Size();
+    if (history.count_ < capacity)
+        history.samples_[(history.first_ + history.count_++) % capacity] = sample;
+    else
+    {
+        // Overwrite the oldest sample
+        history.samples_[history.first_] = sample;
+        history.first_ = (history.first_ + 1) % capacity;
+    }
+}
+
+static void SampleHistory(const TransformHistory& history, float time, Vector3& position, Quaternion& rotation)
+{
+    const TransformHistorySample& oldest = history.GetSample(0);
+    const TransformHistorySample& newest = history.GetNewest();
+    if (time <= oldest.time_)
+    {
+        position = oldest.position_;
+        rotation = oldest.rotation_;
+        return;
+    }
+    if (time >= newest.time_)
+    {
+        position = newest.position_;
+        rotation = newest.rotation_;
+        return;
+    }
+
+    // Binary search for the first sample after the time. The oldest sample is known to be before it
+    unsigned low = 1;
+    unsigned high = history.count_ - 1;
+    while (low < high)
+    {
+        unsigned mid = (low + high) / 2;
+        if (history.GetSample(mid).time_ > time)
+            high = mid;
+        else
+            low = mid + 1;
+    }
+
+    const TransformHistorySample& prev = history.GetSample(low - 1);
+    const TransformHistorySample& next = history.GetSample(low);
+    float interval = next.time_ - prev.time_;
+    float t = interval > 0.0f ? (time - prev.time_) / interval : 1.0f;
+    position = prev.position_.Lerp(next.position_, t);
+    rotation = prev.rotation_.Slerp(next.rotation_, t);
+}
+
+LagCompensation::LagCompensation(Context* context) :
+    Component(context),
+    historyLength_(DEFAULT_HISTORY_LENGTH),
+    capacity_(0),
+    numCaptures_(0),
+    lastCaptureTime_(0.0f)
+{
+}
+
+LagCompensation::~LagCompensation()
+{
+    Restore();
+}
+
+void LagCompensation::RegisterObject(Context* context)
+{
+    context->RegisterFactory<LagCompensation>(NETWORK_CATEGORY);
+
+    URHO3D_ACCESSOR_ATTRIBUTE("Is Enabled", IsEnabled, SetEnabled, bool, true, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("History Length", GetHistoryLength, SetHistoryLength, float, DEFAULT_HISTORY_LENGTH, AM_DEFAULT);
+}
+
+void LagCompensation::SetHistoryLength(float length)
+{
+    historyLength_ = Max(length, 0.0f);
+    MarkNetworkUpdate();
+}
+
+void LagCompensation::Capture()
+{
+    Scene* scene = GetScene();
+    Network* network = GetSubsystem<Network>();
+    if (!scene || !network || !IsEnabledEffective())
+        return;
+
+    if (IsRewound())
+    {
+        URHO3D_LOGWARNING("Nodes still rewound on lag compensation capture, restoring");
+        Restore();
+    }
+
+    // Size the histories to hold the history length worth of updates, plus the sample before a node starts moving
+    unsigned capacity = (unsigned)ceilf(historyLength_ * network->GetUpdateFps()) + 2;
+    if (capacity != capacity_)
+    {
+        histories_.Clear();
+        clientTimeStamps_.Clear();
+        capacity_ = capacity;
+    }
+
+    float time = scene->GetElapsedTime();
+    ++numCaptures_;
+
+    const FlatHashMap<unsigned, Node*>& nodes = scene->GetReplicatedNodes();
+    for (FlatHashMap<unsigned, Node*>::ConstIterator i = nodes.Begin(); i != nodes.End(); ++i)
+    {
+        Node* node = i->second_;
+        if (node == scene || !node->IsEnabled() || !IsRecorded(node))
+            continue;
+
+        TransformHistory& history = histories_[i->first_];
+        if (history.samples_.Empty())
+            history.samples_.Resize(capacity_);
+
+        TransformHistorySample sample;
+        sample.time_ = time;
+        sample.position_ = node->GetWorldPosition();
+        sample.rotation_ = node->GetWorldRotation();
+
+        if (history.count_)
+        {
+            const TransformHistorySample& newest = history.GetNewest();
+            if (newest.position_.Equals(sample.position_) && newest.rotation_.Equals(sample.rotation_))
+            {
+                history.lastCapture_ = numCaptures_;
+                continue;
+            }
+
+            // If the node has been stationary, record that it still was on the previous capture, so that the motion is
+            // not interpolated over the whole stationary period
+            if (newest.time_ < lastCaptureTime_ && history.lastCapture_ == numCaptures_ - 1)
+            {
+                TransformHistorySample still = newest;
+                still.time_ = lastCaptureTime_;
+                PushSample(history, still);
+            }
+        }
+
+        PushSample(history, sample);
+        history.lastCapture_ = numCaptures_;
+    }
+
+    // Remove histories of nodes that have been removed or are no longer recorded
+    for (HashMap<unsigned, TransformHistory>::Iterator i = histories_.Begin(); i != histories_.End();)
+    {
+        if (i->second_.lastCapture_ != numCaptures_)
+            i = histories_.Erase(i);
+        else
+            ++i;
+    }
+
+    // Record the time stamps sent to the clients in this update
+    Vector<SharedPtr<Connection> > connections = network->GetClientConnections();
+    PODVector<Connection*> sceneConnections;
+    for (Vector<SharedPtr<Connection> >::ConstIterator i = connections.Begin(); i != connections.End(); ++i)
+    {
+        Connection* connection = *i;
+        if (connection->GetScene() != scene)
+            continue;
+
+        sceneConnections.Push(connection);
+        PODVector<ClientTimeStampSample>& samples = clientTimeStamps_[connection];
+        if (samples.Size() >= capacity_)
+            samples.Erase(0);
+
+        ClientTimeStampSample sample;
+        sample.time_ = time;
+        sample.timeStamp_ = connection->GetTimeStamp();
+        samples.Push(sample);
+    }
+
+    for (HashMap<Connection*, PODVector<ClientTimeStampSample> >::Iterator i = clientTimeStamps_.Begin();
+         i != clientTimeStamps_.End();)
+    {
+        if (!sceneConnections.Contains(i->first_))
+            i = clientTimeStamps_.Erase(i);
+        else
+            ++i;
+    }
+
+    lastCaptureTime_ = time;
+}
+
+bool LagCompensation::Rewind(float time)
+{
+    Restore();
+
+    Scene* scene = GetScene();
+    if (!scene)
+        return false;
+
+    for (HashMap<unsigned, TransformHistory>::ConstIterator i = histories_.Begin(); i != histories_.End(); ++i)
+    {
+        Node* node = scene->GetNode(i->first_);
+        if (node)
+            AddRewoundNode(node, i->second_, time);
+    }
+
+    return ApplyRewind();
+}
+
+bool LagCompensation::Rewind(float time, const PODVector<Node*>& nodes)
+{
+    Restore();
+
+    Scene* scene = GetScene();
+    if (!scene)
+        return false;
+
+    for (PODVector<Node*>::ConstIterator i = nodes.Begin(); i != nodes.End(); ++i)
+    {
+        Node* node = *i;
+        if (!node || node->GetScene() != scene)
+            continue;
+
+        HashMap<unsigned, TransformHistory>::ConstIterator j = histories_.Find(node->GetID());
+        if (j != histories_.End())
+            AddRewoundNode(node, j->second_, time);
+    }
+
+    return ApplyRewind();
+}
+
+void LagCompensation::Restore()
+{
+    if (rewoundNodes_.Empty())
+        return;
+
+    Scene* scene = GetScene();
+#ifdef URHO3D_PHYSICS
+    PhysicsWorld* physicsWorld = scene ? scene->GetComponent<PhysicsWorld>() : 0;
+    if (physicsWorld)
+        physicsWorld->SetApplyingTransforms(true);
+#endif
+
+    // Restore the original local transforms exactly, without marking the nodes for network update
+    if (scene)
+        scene->SetNetworkUpdateSuppressed(true);
+    for (PODVector<RewoundNode>::ConstIterator i = rewoundNodes_.Begin(); i != rewoundNodes_.End(); ++i)
+        i->node_->SetTransform(i->position_, i->rotation_);
+    if (scene)
+        scene->SetNetworkUpdateSuppressed(false);
+
+    for (PODVector<Drawable*>::ConstIterator i = drawables_.Begin(); i != drawables_.End(); ++i)
+    {
+        Octant* octant = (*i)->GetOctant();
+        if (octant)
+            octant->GetRoot()->InsertDrawable(*i);
+    }
+
+#ifdef URHO3D_PHYSICS
+    if (physicsWorld)
+    {
+        physicsWorld->SetApplyingTransforms(false);
+
+        // Restore the exact simulation transforms, which may differ from the interpolated node transforms
+        for (PODVector<RewoundBody>::ConstIterator i = rewoundBodies_.Begin(); i != rewoundBodies_.End(); ++i)
+        {
+            btRigidBody* body = i->body_->GetBody();
+            btTransform& worldTrans = body->getWorldTransform();
+            worldTrans.setRotation(ToBtQuaternion(i->rotation_));
+            worldTrans.setOrigin(ToBtVector3(i->position_));
+            if (body->getBroadphaseHandle())
+                physicsWorld->GetWorld()->updateSingleAabb(body);
+        }
+    }
+    rewoundBodies_.Clear();
+#endif
+
+    rewoundNodes_.Clear();
+    drawables_.Clear();
+}
+
+void LagCompensation::Raycast(RayOctreeQuery& query, float time)
+{
+    Octree* octree = GetScene() ? GetScene()->GetComponent<Octree>() : 0;
+    if (!octree)
+        return;
+
+    Rewind(time);
+    octree->Raycast(query);
+    Restore();
+}
+
+void LagCompensation::RaycastSingle(RayOctreeQuery& query, float time)
+{
+    Octree* octree = GetScene() ? GetScene()->GetComponent<Octree>() : 0;
+    if (!octree)
+        return;
+
+    Rewind(time);
+    octree->RaycastSingle(query);
+    Restore();
+}
+
+#ifdef URHO3D_PHYSICS
+void LagCompensation::RaycastSingle(PhysicsRaycastResult& result, const Ray& ray, float maxDistance, float time,
+    unsigned collisionMask)
+{
+    PhysicsWorld* physicsWorld = GetScene() ? GetScene()->GetComponent<PhysicsWorld>() : 0;
+    if (!physicsWorld)
+    {
+        result.body_ = 0;
+        return;
+    }
+
+    Rewind(time);
+    physicsWorld->RaycastSingle(result, ray, maxDistance, collisionMask);
+    Restore();
+}
+#endif
+
+bool LagCompensation::GetTransform(Node* node, float time, Vector3& position, Quaternion& rotation) const
+{
+    if (!node)
+        return false;
+
+    HashMap<unsigned, TransformHistory>::ConstIterator i = histories_.Find(node->GetID());
+    if (i == histories_.End() || !i->second_.count_)
+        return false;
+
+    SampleHistory(i->second_, time, position, rotation);
+    return true;
+}
+
+float LagCompensation::GetClientTime(Connection* connection, unsigned char timeStamp) const
+{
+    Scene* scene = GetScene();
+    if (!scene)
+        return 0.0f;
+
+    float delay = scene->GetNetworkInterpolation() ? scene->GetInterpolationDelay() : 0.0f;
+    HashMap<Connection*, PODVector<ClientTimeStampSample> >::ConstIterator i = clientTimeStamps_.Find(connection);
+    if (i == clientTimeStamps_.End() || i->second_.Empty())
+        return scene->GetElapsedTime() - delay;
+
+    // The time stamps wrap around, so compare their signed differences. The same time stamp is sent in several updates if
+    // the client's controls have not arrived in between, in which case the client is assumed to see the newest of them. If
+    // the time stamp falls between updates, interpolate
+    const PODVector<ClientTimeStampSample>& samples = i->second_;
+    for (unsigned j = samples.Size() - 1; j < samples.Size(); --j)
+    {
+        int diff = (signed char)(unsigned char)(samples[j].timeStamp_ - timeStamp);
+        if (diff > 0)
+            continue;
+
+        if (!diff || j == samples.Size() - 1)
+            return samples[j].time_ - delay;
+
+        int nextDiff = (signed char)(unsigned char)(samples[j + 1].timeStamp_ - timeStamp);
+        float t = (float)-diff / (float)(nextDiff - diff);
+        return Lerp(samples[j].time_, samples[j + 1].time_, t) - delay;
+    }
+
+    return samples.Front().time_ - delay;
+}
+
+float LagCompensation::GetEstimatedClientTime(Connection* connection) const
+{
+    Scene* scene = GetScene();
+    if (!scene)
+        return 0.0f;
+
+    // The controls were sent half a round trip ago, while seeing a state sent half a round trip before that
+    float time = scene->GetElapsedTime();
+    if (connection)
+        time -= connection->GetRoundTripTime() * 0.001f;
+    if (scene->GetNetworkInterpolation())
+        time -= scene->GetInterpolationDelay();
+
+    return time;
+}
+
+void LagCompensation::AddRewoundNode(Node* node, const TransformHistory& history, float time)
+{
+    if (!history.count_)
+        return;
+
+    RewoundNode entry;
+    entry.node_ = node;
+    entry.depth_ = 0;
+    for (Node* parent = node->GetParent(); parent; parent = parent->GetParent())
+        ++entry.depth_;
+    entry.position_ = node->GetPosition();
+    entry.rotation_ = node->GetRotation();
+    SampleHistory(history, time, entry.rewindPosition_, entry.rewindRotation_);
+    rewoundNodes_.Push(entry);
+}
+
+bool LagCompensation::ApplyRewind()
+{
+    if (rewoundNodes_.Empty())
+        return false;
+
+    // Move parents before children. Disable the rigid bodies' own transform handling, as they are updated below without
+    // waking them up, and do not mark the temporary transforms for network update
+    Sort(rewoundNodes_.Begin(), rewoundNodes_.End(), CompareRewoundNodes);
+
+    Scene* scene = GetScene();
+#ifdef URHO3D_PHYSICS
+    PhysicsWorld* physicsWorld = scene->GetComponent<PhysicsWorld>();
+    if (physicsWorld)
+        physicsWorld->SetApplyingTransforms(true);
+#endif
+    scene->SetNetworkUpdateSuppressed(true);
+
+    // Nodes already in the rewound transform, after their parents have been moved, are dropped
+    unsigned numMoved = 0;
+    for (unsigned i = 0; i < rewoundNodes_.Size(); ++i)
+    {
+        RewoundNode& entry = rewoundNodes_[i];
+        Node* node = entry.node_;
+        if (node->GetWorldPosition().Equals(entry.rewindPosition_) && node->GetWorldRotation().Equals(entry.rewindRotation_))
+            continue;
+
+        // The parent is already in its rewound transform
+        Vector3 position = entry.rewindPosition_;
+        Quaternion rotation = entry.rewindRotation_;
+        Node* parent = node->GetParent();
+        if (parent && parent != scene)
+        {
+            position = parent->GetWorldTransform().Inverse() * position;
+            rotation = parent->GetWorldRotation().Inverse() * rotation;
+        }
+        node->SetTransform(position, rotation);
+        rewoundNodes_[numMoved++] = entry;
+    }
+    rewoundNodes_.Resize(numMoved);
+    scene->SetNetworkUpdateSuppressed(false);
+
+#ifdef URHO3D_PHYSICS
+    if (physicsWorld)
+        physicsWorld->SetApplyingTransforms(false);
+#endif
+
+    if (rewoundNodes_.Empty())
+        return false;
+
+    // Reinsert the moved drawables into the octree immediately so that octree queries find them
+    PODVector<Drawable*> drawables;
+    for (PODVector<RewoundNode>::ConstIterator i = rewoundNodes_.Begin(); i != rewoundNodes_.End(); ++i)
+    {
+        i->node_->GetDerivedComponents<Drawable>(drawables, true);
+        drawables_.Push(drawables);
+    }
+    RemoveDuplicates(drawables_);
+
+    for (PODVector<Drawable*>::ConstIterator i = drawables_.Begin(); i != drawables_.End(); ++i)
+    {
+        Octant* octant = (*i)->GetOctant();
+        if (octant)
+            octant->GetRoot()->InsertDrawable(*i);
+    }
+
+#ifdef URHO3D_PHYSICS
+    if (physicsWorld)
+    {
+        PODVector<RigidBody*> bodies;
+        PODVector<RigidBody*> allBodies;
+        for (PODVector<RewoundNode>::ConstIterator i = rewoundNodes_.Begin(); i != rewoundNodes_.End(); ++i)
+        {
+            i->node_->GetComponents<RigidBody>(bodies, true);
+            allBodies.Push(bodies);
+        }
+        RemoveDuplicates(allBodies);
+
+        // Set the simulation transforms directly and update the broadphase bounds for raycasts
+        for (PODVector<RigidBody*>::ConstIterator i = allBodies.Begin(); i != allBodies.End(); ++i)
+        {
+            RigidBody* rigidBody = *i;
+            btRigidBody* body = rigidBody->GetBody();
+            if (!body)
+                continue;
+
+            btTransform& worldTrans = body->getWorldTransform();
+            RewoundBody entry;
+            entry.body_ = rigidBody;
+            entry.position_ = ToVector3(worldTrans.getOrigin());
+            entry.rotation_ = ToQuaternion(worldTrans.getRotation());
+            rewoundBodies_.Push(entry);
+
+            Node* node = rigidBody->GetNode();
+            Quaternion rotation = node->GetWorldRotation();
+            worldTrans.setRotation(ToBtQuaternion(rotation));
+            worldTrans.setOrigin(ToBtVector3(node->GetWorldPosition() + rotation * rigidBody->GetCenterOfMass()));
+            if (body->getBroadphaseHandle())
+                physicsWorld->GetWorld()->updateSingleAabb(body);
+        }
+    }
+#endif
+
+    return true;
+}
+
+}
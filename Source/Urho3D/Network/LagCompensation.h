@@ -0,0 +1,195 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Container/HashMap.h"
+#include "../Math/Quaternion.h"
+#include "../Scene/Component.h"
+
+namespace Urho3D
+{
+
+class Connection;
+class Drawable;
+class Ray;
+class RayOctreeQuery;
+#ifdef URHO3D_PHYSICS
+class RigidBody;
+struct PhysicsRaycastResult;
+#endif
+
+/// Recorded world transform of a replicated node.
+struct TransformHistorySample
+{
+    /// Scene elapsed time at capture.
+    float time_;
+    /// World position.
+    Vector3 position_;
+    /// World rotation.
+    Quaternion rotation_;
+};
+
+/// Ring buffer of recorded world transforms for one node. A sample is only added when the transform changes.
+struct TransformHistory
+{
+    /// Construct.
+    TransformHistory() :
+        first_(0),
+        count_(0),
+        lastCapture_(0)
+    {
+    }
+
+    /// Return sample by index, oldest first.
+    const TransformHistorySample& GetSample(unsigned index) const { return samples_[(first_ + index) % samples_.Size()]; }
+
+    /// Return the newest sample.
+    const TransformHistorySample& GetNewest() const { return GetSample(count_ - 1); }
+
+    /// Sample storage.
+    PODVector<TransformHistorySample> samples_;
+    /// Index of the oldest sample.
+    unsigned first_;
+    /// Number of samples.
+    unsigned count_;
+    /// Capture number when the node was last seen.
+    unsigned lastCapture_;
+};
+
+/// Time stamp sent to a client in a server update.
+struct ClientTimeStampSample
+{
+    /// Scene elapsed time at capture.
+    float time_;
+    /// Client controls time stamp echoed back in the update.
+    unsigned char timeStamp_;
+};
+
+/// Rewound node and its original transform.
+struct RewoundNode
+{
+    /// Node.
+    Node* node_;
+    /// Hierarchy depth.
+    unsigned depth_;
+    /// Original position in parent space.
+    Vector3 position_;
+    /// Original rotation in parent space.
+    Quaternion rotation_;
+    /// Rewound world position.
+    Vector3 rewindPosition_;
+    /// Rewound world rotation.
+    Quaternion rewindRotation_;
+};
+
+#ifdef URHO3D_PHYSICS
+/// Rewound rigid body and its original simulation transform.
+struct RewoundBody
+{
+    /// Rigid body.
+    RigidBody* body_;
+    /// Original position of the center of mass.
+    Vector3 position_;
+    /// Original rotation.
+    Quaternion rotation_;
+};
+#endif
+
+/// %Network lag compensation component. When added to the scene on the server, records the world transforms of replicated nodes that have a drawable or rigid body on each network update, and allows temporarily rewinding them to the state a client was seeing when performing an action, for raycasts against that state.
+class URHO3D_API LagCompensation : public Component
+{
+    URHO3D_OBJECT(LagCompensation, Component);
+
+public:
+    /// Construct.
+    LagCompensation(Context* context);
+    /// Destruct. Restore any rewound nodes.
+    virtual ~LagCompensation();
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+
+    /// Set history length in seconds. Default 1.
+    void SetHistoryLength(float length);
+    /// Record the current world transforms, and the time stamps sent to client connections. Called by Network before sending server updates.
+    void Capture();
+    /// Move all recorded nodes to their world transforms at a scene elapsed time. Return true if successful. Restore() must be called before the next capture or physics update.
+    bool Rewind(float time);
+    /// Move a set of recorded nodes to their world transforms at a scene elapsed time. Return true if successful.
+    bool Rewind(float time, const PODVector<Node*>& nodes);
+    /// Move rewound nodes back to their current world transforms.
+    void Restore();
+    /// Perform an octree raycast with all recorded nodes rewound to a scene elapsed time.
+    void Raycast(RayOctreeQuery& query, float time);
+    /// Perform an octree raycast for the closest hit with all recorded nodes rewound to a scene elapsed time.
+    void RaycastSingle(RayOctreeQuery& query, float time);
+#ifdef URHO3D_PHYSICS
+    /// Perform a physics world raycast for the closest hit with all recorded nodes rewound to a scene elapsed time.
+    void RaycastSingle(PhysicsRaycastResult& result, const Ray& ray, float maxDistance, float time, unsigned collisionMask = M_MAX_UNSIGNED);
+#endif
+
+    /// Return history length in seconds.
+    float GetHistoryLength() const { return historyLength_; }
+
+    /// Return number of recorded nodes.
+    unsigned GetNumNodes() const { return histories_.Size(); }
+
+    /// Return whether nodes are currently rewound.
+    bool IsRewound() const { return !rewoundNodes_.Empty(); }
+
+    /// Return the recorded world transform of a node at a scene elapsed time. Return false if the node has no history.
+    bool GetTransform(Node* node, float time, Vector3& position, Quaternion& rotation) const;
+    /// Return the scene elapsed time of the state a client connection was seeing, from the controls time stamp echoed back in the server update, as read on the client from a replicated node (Serializable::GetNetworkTimeStamp().) Accounts for the scene's network interpolation delay if enabled. Return the oldest recorded time if the time stamp is too old.
+    float GetClientTime(Connection* connection, unsigned char timeStamp) const;
+    /// Return an estimate of the scene elapsed time of the state a client connection was seeing when sending its latest controls, using the round trip time and the scene's network interpolation delay.
+    float GetEstimatedClientTime(Connection* connection) const;
+
+private:
+    /// Queue a node to be rewound, if it has history.
+    void AddRewoundNode(Node* node, const TransformHistory& history, float time);
+    /// Move the queued nodes to their rewound transforms, and update their drawables and rigid bodies.
+    bool ApplyRewind();
+
+    /// Recorded transform histories by node ID.
+    HashMap<unsigned, TransformHistory> histories_;
+    /// Time stamps sent to client connections.
+    HashMap<Connection*, PODVector<ClientTimeStampSample> > clientTimeStamps_;
+    /// Currently rewound nodes.
+    PODVector<RewoundNode> rewoundNodes_;
+    /// Drawables of the rewound nodes.
+    PODVector<Drawable*> drawables_;
+#ifdef URHO3D_PHYSICS
+    /// Rigid bodies of the rewound nodes.
+    PODVector<RewoundBody> rewoundBodies_;
+#endif
+    /// History length in seconds.
+    float historyLength_;
+    /// Samples per node history.
+    unsigned capacity_;
+    /// Capture counter.
+    unsigned numCaptures_;
+    /// Scene elapsed time of the last capture.
+    float lastCaptureTime_;
+};
+
+}
@@ -22,9 +22,11 @@
 
 #include "../Precompiled.h"
 
+#include "../Container/Sort.h"
 #include "../Core/Context.h"
 #include "../Core/CoreEvents.h"
 #include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
 #include "../Engine/EngineEvents.h"
 #include "../IO/FileSystem.h"
 #include "../Input/InputEvents.h"
@@ -32,6 +34,8 @@
 #include "../IO/Log.h"
 #include "../IO/MemoryBuffer.h"
 #include "../Network/HttpRequest.h"
+#include "../Network/InterestGrid.h"
+#include "../Network/LagCompensation.h"
 #include "../Network/Network.h"
 #include "../Network/NetworkEvents.h"
 #include "../Network/NetworkPriority.h"
@@ -53,7 +57,10 @@ Network::Network(Context* context) :
     simulatedLatency_(0),
     simulatedPacketLoss_(0.0f),
     updateInterval_(1.0f / (float)DEFAULT_UPDATE_FPS),
-    updateAcc_(0.0f)
+    updateAcc_(0.0f),
+    packageFragmentSize_(PACKAGE_FRAGMENT_SIZE),
+    packageWindowSize_(PACKAGE_WINDOW_SIZE),
+    packageCompression_(true)
 {
     network_ = new kNet::Network();
 
@@ -126,6 +133,9 @@ void Network::HandleMessage(kNet::MessageConnection* source, kNet::packet_id_t p
     Connection* connection = GetConnection(source);
     if (connection)
     {
+        if (connection->IsRecording())
+            connection->RecordMessage((int)msgId, (const unsigned char*)data, (unsigned)numBytes);
+
         MemoryBuffer msg(data, (unsigned)numBytes);
         if (connection->ProcessMessage((int)msgId, msg))
             return;
@@ -151,6 +161,16 @@ u32 Network::ComputeContentID(kNet::message_id_t msgId, const char* data, size_t
         // Return fixed content ID for controls
         return CONTROLS_CONTENT_ID;
 
+    case MSG_SNAPSHOTACK:
+        return SNAPSHOTACK_CONTENT_ID;
+
+    case MSG_PACKAGEACK:
+        {
+            // Return the package name hash, which is first in the message
+            MemoryBuffer msg(data, (unsigned)numBytes);
+            return msg.ReadStringHash().Value();
+        }
+
     case MSG_NODELATESTDATA:
     case MSG_COMPONENTLATESTDATA:
         {
@@ -375,11 +395,54 @@ void Network::UnregisterAllRemoteEvents()
     allowedRemoteEvents_.Clear();
 }
 
+void Network::RegisterRemoteEventSchema(StringHash eventType, const VariantMap& layout)
+{
+    // Sort the keys so that the order does not depend on how the layout map was built
+    PODVector<StringHash> keys;
+    for (VariantMap::ConstIterator i = layout.Begin(); i != layout.End(); ++i)
+        keys.Push(i->first_);
+    Sort(keys.Begin(), keys.End());
+
+    RemoteEventSchema& schema = remoteEventSchemas_[eventType];
+    schema.keys_ = keys;
+    schema.types_.Resize(keys.Size());
+    for (unsigned i = 0; i < keys.Size(); ++i)
+        schema.types_[i] = layout.Find(keys[i])->second_.GetType();
+}
+
+void Network::UnregisterRemoteEventSchema(StringHash eventType)
+{
+    remoteEventSchemas_.Erase(eventType);
+}
+
+void Network::SetRemoteEventCoalescing(StringHash eventType, bool enable)
+{
+    if (enable)
+        coalescedRemoteEvents_.Insert(eventType);
+    else
+        coalescedRemoteEvents_.Erase(eventType);
+}
+
 void Network::SetPackageCacheDir(const String& path)
 {
     packageCacheDir_ = AddTrailingSlash(path);
 }
 
+void Network::SetPackageFragmentSize(unsigned size)
+{
+    packageFragmentSize_ = size < 256 ? 256 : (size > MAX_PACKAGE_FRAGMENT_SIZE ? MAX_PACKAGE_FRAGMENT_SIZE : size);
+}
+
+void Network::SetPackageWindowSize(unsigned fragments)
+{
+    packageWindowSize_ = fragments ? fragments : 1;
+}
+
+void Network::SetPackageCompression(bool enable)
+{
+    packageCompression_ = enable;
+}
+
 void Network::SendPackageToClients(Scene* scene, PackageFile* package)
 {
     if (!scene)
@@ -450,6 +513,17 @@ bool Network::CheckRemoteEvent(StringHash eventType) const
     return allowedRemoteEvents_.Contains(eventType);
 }
 
+const RemoteEventSchema* Network::GetRemoteEventSchema(StringHash eventType) const
+{
+    HashMap<StringHash, RemoteEventSchema>::ConstIterator i = remoteEventSchemas_.Find(eventType);
+    return i != remoteEventSchemas_.End() ? &i->second_ : 0;
+}
+
+bool Network::GetRemoteEventCoalescing(StringHash eventType) const
+{
+    return coalescedRemoteEvents_.Contains(eventType);
+}
+
 void Network::Update(float timeStep)
 {
     URHO3D_PROFILE(UpdateNetwork);
@@ -481,6 +555,26 @@ void Network::Update(float timeStep)
         server->Process();
 }
 
+/// Build server update messages for a range of client connections. Called in worker threads.
+static void BuildServerUpdateWork(const WorkItem* item, unsigned threadIndex)
+{
+    Connection** start = reinterpret_cast<Connection**>(item->start_);
+    Connection** end = reinterpret_cast<Connection**>(item->end_);
+
+    while (start != end)
+        (*start++)->BuildServerUpdate();
+}
+
+/// Build server snapshot messages for a range of client connections. Called in worker threads.
+static void BuildServerSnapshotWork(const WorkItem* item, unsigned threadIndex)
+{
+    Connection** start = reinterpret_cast<Connection**>(item->start_);
+    Connection** end = reinterpret_cast<Connection**>(item->end_);
+
+    while (start != end)
+        (*start++)->BuildServerSnapshot();
+}
+
 void Network::PostUpdate(float timeStep)
 {
     URHO3D_PROFILE(PostUpdateNetwork);
@@ -511,19 +605,68 @@ void Network::PostUpdate(float timeStep)
                 }
 
                 for (HashSet<Scene*>::ConstIterator i = networkScenes_.Begin(); i != networkScenes_.End(); ++i)
+                {
                     (*i)->PrepareNetworkUpdate();
+
+                    // Update the cached world transforms of all replicated nodes, as the connections read them while
+                    // building the updates in worker threads and must not trigger the lazy update there
+                    const FlatHashMap<unsigned, Node*>& nodes = (*i)->GetReplicatedNodes();
+                    for (FlatHashMap<unsigned, Node*>::ConstIterator j = nodes.Begin(); j != nodes.End(); ++j)
+                        j->second_->GetWorldTransform();
+
+                    // Rebuild the interest management grid, if exists, from the current node positions
+                    InterestGrid* grid = (*i)->GetComponent<InterestGrid>();
+                    if (grid)
+                        grid->Update();
+
+                    // Record the node transforms sent in this update for lag compensation, if enabled
+                    LagCompensation* lagCompensation = (*i)->GetComponent<LagCompensation>();
+                    if (lagCompensation)
+                        lagCompensation->Capture();
+                }
             }
 
             {
                 URHO3D_PROFILE(SendServerUpdate);
 
-                // Then send server updates for each client connection
+                // Then build server updates for each client connection in worker threads. The scenes are only read during
+                // this, and the messages are buffered per connection to be sent afterward from the main thread
+                updateConnections_.Clear();
                 for (HashMap<kNet::MessageConnection*, SharedPtr<Connection> >::Iterator i = clientConnections_.Begin();
                      i != clientConnections_.End(); ++i)
                 {
-                    i->second_->SendServerUpdate();
-                    i->second_->SendRemoteEvents();
-                    i->second_->SendPackages();
+                    i->second_->PrepareServerUpdate();
+                    updateConnections_.Push(i->second_);
+                }
+
+                WorkQueue* queue = GetSubsystem<WorkQueue>();
+                if (queue)
+                    queue->ParallelFor(updateConnections_, 1, BuildServerUpdateWork);
+                else
+                {
+                    for (unsigned i = 0; i < updateConnections_.Size(); ++i)
+                        updateConnections_[i]->BuildServerUpdate();
+                }
+
+                // Link the created replication states to the scene objects, then build the snapshots which are sent
+                // for the nodes replicated after this update
+                for (unsigned i = 0; i < updateConnections_.Size(); ++i)
+                    updateConnections_[i]->ApplyReplicationStateChanges();
+
+                if (queue)
+                    queue->ParallelFor(updateConnections_, 1, BuildServerSnapshotWork);
+                else
+                {
+                    for (unsigned i = 0; i < updateConnections_.Size(); ++i)
+                        updateConnections_[i]->BuildServerSnapshot();
+                }
+
+                for (unsigned i = 0; i < updateConnections_.Size(); ++i)
+                {
+                    Connection* connection = updateConnections_[i];
+                    connection->SendBufferedMessages();
+                    connection->SendRemoteEvents();
+                    connection->SendPackages();
                 }
             }
         }
@@ -563,6 +706,7 @@ void Network::OnServerConnected()
     // Send the identity map now
     VectorBuffer msg;
     msg.WriteVariantMap(serverConnection_->GetIdentity());
+    msg.WriteVLE(PROTOCOL_VERSION);
     serverConnection_->SendMessage(MSG_IDENTITY, true, true, msg);
 
     SendEvent(E_SERVERCONNECTED);
@@ -598,6 +742,8 @@ void Network::ConfigureNetworkSimulator()
 
 void RegisterNetworkLibrary(Context* context)
 {
+    InterestGrid::RegisterObject(context);
+    LagCompensation::RegisterObject(context);
     NetworkPriority::RegisterObject(context);
 }
 
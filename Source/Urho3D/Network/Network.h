@@ -43,6 +43,15 @@ template <class T> unsigned MakeHash(kNet::MessageConnection* value)
     return ((unsigned)(size_t)value) >> 9;
 }
 
+/// Compact remote event data layout. Event data matching the layout is sent without the keys and value types.
+struct RemoteEventSchema
+{
+    /// Event data keys, sorted by hash value.
+    PODVector<StringHash> keys_;
+    /// Value types corresponding to the keys.
+    PODVector<VariantType> types_;
+};
+
 /// %Network subsystem. Manages client-server communications using the UDP protocol.
 class URHO3D_API Network : public Object, public kNet::IMessageHandler, public kNet::INetworkServerListener
 {
@@ -97,8 +106,20 @@ public:
     void UnregisterRemoteEvent(StringHash eventType);
     /// Unregister all remote events.
     void UnregisterAllRemoteEvents();
+    /// Register a compact encoding for a remote event type, defined by the keys and value types of the layout map. Event data with exactly the same keys and value types is sent without them. Must be registered identically on both the server and the client.
+    void RegisterRemoteEventSchema(StringHash eventType, const VariantMap& layout);
+    /// Unregister the compact encoding of a remote event type.
+    void UnregisterRemoteEventSchema(StringHash eventType);
+    /// Set whether a queued remote event is replaced by a later event of the same type and sender node before being sent.
+    void SetRemoteEventCoalescing(StringHash eventType, bool enable);
     /// Set the package download cache directory.
     void SetPackageCacheDir(const String& path);
+    /// Set the size in bytes of package file fragments sent to clients.
+    void SetPackageFragmentSize(unsigned size);
+    /// Set the maximum number of package file fragments sent to a client before it acknowledges them.
+    void SetPackageWindowSize(unsigned fragments);
+    /// Set whether to LZ4 compress package file fragments sent to clients.
+    void SetPackageCompression(bool enable);
     /// Trigger all client connections in the specified scene to download a package file from the server. Can be used to download additional resource packages when clients are already joined in the scene. The package must have been added as a requirement to the scene, or else the eventual download will fail.
     void SendPackageToClients(Scene* scene, PackageFile* package);
     /// Perform an HTTP request to the specified URL. Empty verb defaults to a GET request. Return a request object which can be used to read the response data.
@@ -125,10 +146,23 @@ public:
     bool IsServerRunning() const;
     /// Return whether a remote event is allowed to be received.
     bool CheckRemoteEvent(StringHash eventType) const;
+    /// Return the compact encoding of a remote event type, or null if not registered.
+    const RemoteEventSchema* GetRemoteEventSchema(StringHash eventType) const;
+    /// Return whether queued remote events of a type are coalesced.
+    bool GetRemoteEventCoalescing(StringHash eventType) const;
 
     /// Return the package download cache directory.
     const String& GetPackageCacheDir() const { return packageCacheDir_; }
 
+    /// Return the size in bytes of package file fragments sent to clients.
+    unsigned GetPackageFragmentSize() const { return packageFragmentSize_; }
+
+    /// Return the maximum number of unacknowledged package file fragments sent to a client.
+    unsigned GetPackageWindowSize() const { return packageWindowSize_; }
+
+    /// Return whether package file fragments are LZ4 compressed.
+    bool GetPackageCompression() const { return packageCompression_; }
+
     /// Process incoming messages from connections. Called by HandleBeginFrame.
     void Update(float timeStep);
     /// Send outgoing messages after frame logic. Called by HandleRenderUpdate.
@@ -156,8 +190,14 @@ private:
     HashSet<StringHash> allowedRemoteEvents_;
     /// Remote event fixed blacklist.
     HashSet<StringHash> blacklistedRemoteEvents_;
+    /// Compact remote event encodings.
+    HashMap<StringHash, RemoteEventSchema> remoteEventSchemas_;
+    /// Remote events to coalesce.
+    HashSet<StringHash> coalescedRemoteEvents_;
     /// Networked scenes.
     HashSet<Scene*> networkScenes_;
+    /// Client connections to build server updates for.
+    PODVector<Connection*> updateConnections_;
     /// Update FPS.
     int updateFps_;
     /// Simulated latency (send delay) in milliseconds.
@@ -170,6 +210,12 @@ private:
     float updateAcc_;
     /// Package cache directory.
     String packageCacheDir_;
+    /// Package file fragment size.
+    unsigned packageFragmentSize_;
+    /// Maximum number of unacknowledged package file fragments.
+    unsigned packageWindowSize_;
+    /// Package file fragment compression flag.
+    bool packageCompression_;
 };
 
 /// Register Network library objects.
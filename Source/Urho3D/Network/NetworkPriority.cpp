@@ -23,7 +23,9 @@
 #include "../Precompiled.h"
 
 #include "../Core/Context.h"
+#include "../Network/InterestGrid.h"
 #include "../Network/NetworkPriority.h"
+#include "../Scene/Scene.h"
 
 #include "../DebugNew.h"
 
@@ -42,12 +44,17 @@ NetworkPriority::NetworkPriority(Context* context) :
     basePriority_(DEFAULT_BASE_PRIORITY),
     distanceFactor_(DEFAULT_DISTANCE_FACTOR),
     minPriority_(DEFAULT_MIN_PRIORITY),
-    alwaysUpdateOwner_(true)
+    alwaysUpdateOwner_(true),
+    interestGrid_(0),
+    interestIndex_(M_MAX_UNSIGNED),
+    interestEntry_(M_MAX_UNSIGNED)
 {
 }
 
 NetworkPriority::~NetworkPriority()
 {
+    if (interestGrid_)
+        interestGrid_->RemoveNetworkPriority(this);
 }
 
 void NetworkPriority::RegisterObject(Context* context)
@@ -97,4 +104,17 @@ bool NetworkPriority::CheckUpdate(float distance, float& accumulator)
         return false;
 }
 
+void NetworkPriority::OnSceneSet(Scene* scene)
+{
+    if (interestGrid_)
+        interestGrid_->RemoveNetworkPriority(this);
+
+    if (scene)
+    {
+        InterestGrid* grid = scene->GetComponent<InterestGrid>();
+        if (grid)
+            grid->AddNetworkPriority(this);
+    }
+}
+
 }
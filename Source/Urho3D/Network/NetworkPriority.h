@@ -27,11 +27,15 @@
 namespace Urho3D
 {
 
+class InterestGrid;
+
 /// %Network interest management settings component.
 class URHO3D_API NetworkPriority : public Component
 {
     URHO3D_OBJECT(NetworkPriority, Component);
 
+    friend class InterestGrid;
+
 public:
     /// Construct.
     NetworkPriority(Context* context);
@@ -64,6 +68,10 @@ public:
     /// Increment and check priority accumulator. Return true if should update. Called by Connection.
     bool CheckUpdate(float distance, float& accumulator);
 
+protected:
+    /// Handle scene being assigned.
+    virtual void OnSceneSet(Scene* scene);
+
 private:
     /// Base priority.
     float basePriority_;
@@ -73,6 +81,12 @@ private:
     float minPriority_;
     /// Update owner at full rate flag.
     bool alwaysUpdateOwner_;
+    /// Interest grid this component is registered to.
+    InterestGrid* interestGrid_;
+    /// Index in the interest grid.
+    unsigned interestIndex_;
+    /// Index of the node entry in the interest grid as of the last update.
+    unsigned interestEntry_;
 };
 
 }
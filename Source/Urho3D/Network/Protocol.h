@@ -25,18 +25,18 @@
 namespace Urho3D
 {
 
-/// Client->server: send VariantMap of identity and authentication data.
+/// Client->server: send VariantMap of identity and authentication data, followed by the protocol version as a VLE.
 static const int MSG_IDENTITY = 0x5;
 /// Client->server: send controls (buttons and mouse movement.)
 static const int MSG_CONTROLS = 0x6;
 /// Client->server: scene has been loaded and client is ready to proceed.
 static const int MSG_SCENELOADED = 0x7;
-/// Client->server: request a package file.
+/// Client->server: request a package file, starting from the data already received before an interrupted download. A nonzero offset is followed by the checksum of the data already received.
 static const int MSG_REQUESTPACKAGE = 0x8;
 
-/// Server->client: package file data fragment.
+/// Server->client: package file data fragment. Contains the file offset, the offset the transfer started from and the uncompressed size.
 static const int MSG_PACKAGEDATA = 0x9;
-/// Server->client: load new scene. In case of empty filename the client should just empty the scene.
+/// Server->client: load new scene. In case of empty filename the client should just empty the scene. The package list is followed by the protocol version as a VLE.
 static const int MSG_LOADSCENE = 0xa;
 /// Server->client: wrong scene checksum, can not participate.
 static const int MSG_SCENECHECKSUMERROR = 0xb;
@@ -63,10 +63,40 @@ static const int MSG_REMOTEEVENT = 0x14;
 static const int MSG_REMOTENODEEVENT = 0x15;
 /// Server->client: info about package.
 static const int MSG_PACKAGEINFO = 0x16;
+/// Server->client: part of a scene snapshot, delta compressed against a snapshot acknowledged by the client.
+static const int MSG_SNAPSHOT = 0x17;
+/// Client->server: acknowledge a fully received scene snapshot.
+static const int MSG_SNAPSHOTACK = 0x18;
+/// Client->server: acknowledge package file data received contiguously from the start of the file.
+static const int MSG_PACKAGEACK = 0x19;
+/// Client->server and server->client: remote events queued during one network update. Each event is preceded by a VLE of the sender node ID shifted left by one, with the lowest bit set if the event data is written according to a registered schema, and the event type. The event data is preceded by its size as a VLE, so that an event with an unknown schema can be skipped.
+static const int MSG_REMOTEEVENTBATCH = 0x1a;
+
+/// Version of the replication and remote event message formats. Clients and servers with a different version refuse to connect, so that for example a peer without remote event batching is not sent batches.
+static const unsigned PROTOCOL_VERSION = 3;
 
 /// Fixed content ID for client controls update.
 static const unsigned CONTROLS_CONTENT_ID = 1;
-/// Package file fragment size.
-static const unsigned PACKAGE_FRAGMENT_SIZE = 1024;
+/// Fixed content ID for snapshot acknowledgements.
+static const unsigned SNAPSHOTACK_CONTENT_ID = 2;
+/// Default package file fragment size.
+static const unsigned PACKAGE_FRAGMENT_SIZE = 16384;
+/// Maximum package file fragment size.
+static const unsigned MAX_PACKAGE_FRAGMENT_SIZE = 65536;
+/// Default number of unacknowledged package file fragments in transfer.
+static const unsigned PACKAGE_WINDOW_SIZE = 64;
+
+/// Network recording message flag: the message was sent, otherwise received.
+static const unsigned char RECORD_OUTBOUND = 0x1;
+/// Network recording message flag: reliable message.
+static const unsigned char RECORD_RELIABLE = 0x2;
+/// Network recording message flag: in-order message.
+static const unsigned char RECORD_INORDER = 0x4;
+/// Network recording message flag: a content ID follows the message ID.
+static const unsigned char RECORD_CONTENTID = 0x8;
+/// Network recording message flag: the message ID and content ID are written as 32-bit values instead of VLE.
+static const unsigned char RECORD_LONGID = 0x10;
+/// Snapshot message data size limit. Kept below the transport fragment size, as fragmented messages are sent reliably.
+static const unsigned SNAPSHOT_PART_SIZE = 400;
 
 }
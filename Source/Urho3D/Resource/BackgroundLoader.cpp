@@ -24,7 +24,9 @@
 
 #include "../Precompiled.h"
 
+#include "../Container/Swap.h"
 #include "../Core/Context.h"
+#include "../Core/ProcessUtils.h"
 #include "../Core/Profiler.h"
 #include "../IO/Log.h"
 #include "../Resource/BackgroundLoader.h"
@@ -36,92 +38,142 @@
 namespace Urho3D
 {
 
-BackgroundLoader::BackgroundLoader(ResourceCache* owner) :
-    owner_(owner)
+static const int MAX_DEFAULT_THREADS = 4;
+
+/// Background loader thread.
+class BackgroundLoadThread : public RefCounted, public Thread
 {
+public:
+    /// Construct.
+    BackgroundLoadThread(BackgroundLoader* owner) :
+        owner_(owner)
+    {
+    }
+
+    /// Load resources until stopped, sleeping when the queue is empty.
+    virtual void ThreadFunction()
+    {
+        while (shouldRun_)
+        {
+            if (!owner_->LoadNextResource(this))
+                wakeEvent_.Wait();
+        }
+    }
+
+    /// Wake up the thread to check for queued resources.
+    void Wake() { wakeEvent_.Set(); }
+
+    /// Stop the thread after it finishes its current resource, and wait for it to exit.
+    void StopLoading()
+    {
+        shouldRun_ = false;
+        wakeEvent_.Set();
+        Stop();
+    }
+
+private:
+    /// Background loader.
+    BackgroundLoader* owner_;
+    /// Event for waking up the thread.
+    Condition wakeEvent_;
+};
+
+static bool LoadsBefore(const BackgroundLoadEntry& lhs, const BackgroundLoadEntry& rhs)
+{
+    if (lhs.priority_ != rhs.priority_)
+        return lhs.priority_ > rhs.priority_;
+    else
+        return (int)(lhs.order_ - rhs.order_) < 0;
 }
 
-BackgroundLoader::~BackgroundLoader()
+static void PushHeap(PODVector<BackgroundLoadEntry>& heap, const BackgroundLoadEntry& entry)
 {
-    MutexLock lock(backgroundLoadMutex_);
+    unsigned index = heap.Size();
+    heap.Push(entry);
 
-    backgroundLoadQueue_.Clear();
+    while (index)
+    {
+        unsigned parent = (index - 1) / 2;
+        if (!LoadsBefore(heap[index], heap[parent]))
+            break;
+        Swap(heap[index], heap[parent]);
+        index = parent;
+    }
 }
 
-void BackgroundLoader::ThreadFunction()
+static void PopHeap(PODVector<BackgroundLoadEntry>& heap)
 {
-    while (shouldRun_)
+    heap[0] = heap.Back();
+    heap.Pop();
+
+    unsigned index = 0;
+    unsigned size = heap.Size();
+    for (;;)
     {
-        backgroundLoadMutex_.Acquire();
+        unsigned first = index;
+        unsigned left = index * 2 + 1;
+        unsigned right = left + 1;
+        if (left < size && LoadsBefore(heap[left], heap[first]))
+            first = left;
+        if (right < size && LoadsBefore(heap[right], heap[first]))
+            first = right;
+        if (first == index)
+            break;
+        Swap(heap[index], heap[first]);
+        index = first;
+    }
+}
 
-        // Search for a queued resource that has not been loaded yet
-        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Begin();
-        while (i != backgroundLoadQueue_.End())
-        {
-            if (i->second_.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
-                break;
-            else
-                ++i;
-        }
+BackgroundLoader::BackgroundLoader(ResourceCache* owner) :
+    owner_(owner),
+    numThreads_((unsigned)Clamp((int)GetNumPhysicalCPUs() - 1, 1, MAX_DEFAULT_THREADS)),
+    loadOrder_(0)
+{
+}
 
-        if (i == backgroundLoadQueue_.End())
-        {
-            // No resources to load found
-            backgroundLoadMutex_.Release();
-            Time::Sleep(5);
-        }
-        else
-        {
-            BackgroundLoadItem& item = i->second_;
-            Resource* resource = item.resource_;
-            // We can be sure that the item is not removed from the queue as long as it is in the
-            // "queued" or "loading" state
-            backgroundLoadMutex_.Release();
-
-            bool success = false;
-            SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
-            if (file)
-            {
-                resource->SetAsyncLoadState(ASYNC_LOADING);
-                success = resource->BeginLoad(*file);
-            }
+BackgroundLoader::~BackgroundLoader()
+{
+    StopThreads();
 
-            // Process dependencies now
-            // Need to lock the queue again when manipulating other entries
-            Pair<StringHash, StringHash> key = MakePair(resource->GetType(), resource->GetNameHash());
-            backgroundLoadMutex_.Acquire();
-            if (item.dependents_.Size())
-            {
-                for (HashSet<Pair<StringHash, StringHash> >::Iterator i = item.dependents_.Begin();
-                     i != item.dependents_.End(); ++i)
-                {
-                    HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(*i);
-                    if (j != backgroundLoadQueue_.End())
-                        j->second_.dependencies_.Erase(key);
-                }
+    MutexLock lock(backgroundLoadMutex_);
 
-                item.dependents_.Clear();
-            }
+    backgroundLoadQueue_.Clear();
+    loadHeap_.Clear();
+    finishQueue_.Clear();
+}
 
-            resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
-            backgroundLoadMutex_.Release();
-        }
-    }
+void BackgroundLoader::SetNumThreads(unsigned num)
+{
+    num = (unsigned)Max((int)num, 1);
+    if (num == numThreads_)
+        return;
+
+    numThreads_ = num;
+    StopThreads();
+
+    MutexLock lock(backgroundLoadMutex_);
+    if (!loadHeap_.Empty())
+        StartThreads();
 }
 
-bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller)
+bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller, float priority)
 {
     StringHash nameHash(name);
     Pair<StringHash, StringHash> key = MakePair(type, nameHash);
 
     MutexLock lock(backgroundLoadMutex_);
 
-    // Check if already exists in the queue
-    if (backgroundLoadQueue_.Find(key) != backgroundLoadQueue_.End())
+    // Check if already exists in the queue. If so, it may need to be loaded sooner
+    HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(key);
+    if (i != backgroundLoadQueue_.End())
+    {
+        RaisePriority(i->second_, key, priority);
         return false;
+    }
 
     BackgroundLoadItem& item = backgroundLoadQueue_[key];
     item.sendEventOnFailure_ = sendEventOnFailure;
+    item.priority_ = priority;
 
     // Make sure the pointer is non-null and is a Resource subclass
     item.resource_ = DynamicCast<Resource>(owner_->GetContext()->CreateObject(type));
@@ -147,7 +199,8 @@ bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool s
     item.resource_->SetName(name);
     item.resource_->SetAsyncLoadState(ASYNC_QUEUED);
 
-    // If this is a resource calling for the background load of more resources, mark the dependency as necessary
+    // If this is a resource calling for the background load of more resources, mark the dependency as necessary. The caller
+    // can not finish before its dependencies, so they are loaded with at least its priority
     if (caller)
     {
         Pair<StringHash, StringHash> callerKey = MakePair(caller->GetType(), caller->GetNameHash());
@@ -156,6 +209,7 @@ bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool s
         {
             BackgroundLoadItem& callerItem = j->second_;
             item.dependents_.Insert(callerKey);
+            item.priority_ = Max(item.priority_, callerItem.priority_);
             callerItem.dependencies_.Insert(key);
         }
         else
@@ -163,9 +217,11 @@ bool BackgroundLoader::QueueResource(StringHash type, const String& name, bool s
                        " requested for a background loaded resource but was not in the background load queue");
     }
 
-    // Start the background loader thread now
-    if (!IsStarted())
-        Run();
+    PushLoadEntry(key, item.priority_);
+
+    // Start the background loader threads now
+    if (threads_.Empty())
+        StartThreads();
 
     return true;
 }
@@ -179,21 +235,37 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
     HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(key);
     if (i != backgroundLoadQueue_.End())
     {
+        BackgroundLoadItem& item = i->second_;
+        Resource* resource = item.resource_;
+
+        // The resource is needed immediately, so its dependencies go before everything else. If it has not started loading
+        // yet, load it now in this thread rather than wait for a loader thread to become free
+        RaisePriority(item, key, M_INFINITY);
+        bool loadHere = resource->GetAsyncLoadState() == ASYNC_QUEUED;
+        if (loadHere)
+            resource->SetAsyncLoadState(ASYNC_LOADING);
         backgroundLoadMutex_.Release();
 
         {
-            Resource* resource = i->second_.resource_;
             HiresTimer waitTimer;
             bool didWait = false;
 
+            if (loadHere)
+                LoadItem(item);
+
             for (;;)
             {
-                unsigned numDeps = i->second_.dependencies_.Size();
+                backgroundLoadMutex_.Acquire();
+                unsigned numDeps = item.dependencies_.Size();
                 AsyncLoadState state = resource->GetAsyncLoadState();
+                backgroundLoadMutex_.Release();
+
                 if (numDeps > 0 || state == ASYNC_QUEUED || state == ASYNC_LOADING)
                 {
+                    // Help loading the dependencies if some are still queued, otherwise wait for the loader threads
                     didWait = true;
-                    Time::Sleep(1);
+                    if (!LoadNextResource(0, M_INFINITY))
+                        loadedEvent_.Wait();
                 }
                 else
                     break;
@@ -205,7 +277,7 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
         }
 
         // This may take a long time and may potentially wait on other resources, so it is important we do not hold the mutex during this
-        FinishBackgroundLoading(i->second_);
+        FinishBackgroundLoading(item);
 
         backgroundLoadMutex_.Acquire();
         backgroundLoadQueue_.Erase(i);
@@ -217,43 +289,174 @@ void BackgroundLoader::WaitForResource(StringHash type, StringHash nameHash)
 
 void BackgroundLoader::FinishResources(int maxMs)
 {
-    if (IsStarted())
+    HiresTimer timer;
+
+    backgroundLoadMutex_.Acquire();
+
+    // Resources are finished in the order they became ready. The finish queue may also contain resources that were already
+    // finished when requested from the cache
+    unsigned index = 0;
+    while (index < finishQueue_.Size())
     {
-        HiresTimer timer;
+        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(finishQueue_[index++]);
+        if (i == backgroundLoadQueue_.End())
+            continue;
+
+        Resource* resource = i->second_.resource_;
+        unsigned numDeps = i->second_.dependencies_.Size();
+        AsyncLoadState state = resource->GetAsyncLoadState();
+        if (numDeps > 0 || state == ASYNC_QUEUED || state == ASYNC_LOADING)
+            continue;
 
+        // Finishing a resource may need it to wait for other resources to load, in which case we can not
+        // hold on to the mutex
+        backgroundLoadMutex_.Release();
+        FinishBackgroundLoading(i->second_);
         backgroundLoadMutex_.Acquire();
+        backgroundLoadQueue_.Erase(i);
 
-        for (HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Begin();
-             i != backgroundLoadQueue_.End();)
+        // Break when the time limit passed so that we keep sufficient FPS
+        if (timer.GetUSec(false) >= maxMs * 1000)
+            break;
+    }
+
+    finishQueue_.Erase(0, index);
+
+    backgroundLoadMutex_.Release();
+}
+
+unsigned BackgroundLoader::GetNumQueuedResources() const
+{
+    MutexLock lock(backgroundLoadMutex_);
+    return backgroundLoadQueue_.Size();
+}
+
+bool BackgroundLoader::LoadNextResource(BackgroundLoadThread* thread, float minPriority)
+{
+    backgroundLoadMutex_.Acquire();
+
+    while (!loadHeap_.Empty() && loadHeap_[0].priority_ >= minPriority)
+    {
+        BackgroundLoadEntry entry = loadHeap_[0];
+        PopHeap(loadHeap_);
+
+        // Skip entries of resources that were already loaded, or that have been requeued with a higher priority
+        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator i = backgroundLoadQueue_.Find(entry.key_);
+        if (i == backgroundLoadQueue_.End() || i->second_.priority_ != entry.priority_ ||
+            i->second_.resource_->GetAsyncLoadState() != ASYNC_QUEUED)
+            continue;
+
+        // We can be sure that the item is not removed from the queue as long as it is in the "queued" or "loading" state
+        BackgroundLoadItem& item = i->second_;
+        item.resource_->SetAsyncLoadState(ASYNC_LOADING);
+        backgroundLoadMutex_.Release();
+
+        LoadItem(item);
+        return true;
+    }
+
+    if (thread)
+        idleThreads_.Push(thread);
+    backgroundLoadMutex_.Release();
+    return false;
+}
+
+void BackgroundLoader::LoadItem(BackgroundLoadItem& item)
+{
+    Resource* resource = item.resource_;
+
+    bool success = false;
+    SharedPtr<File> file = owner_->GetFile(resource->GetName(), item.sendEventOnFailure_);
+    if (file)
+        success = owner_->BeginLoadResource(resource, *file);
+
+    // Process dependencies now
+    // Need to lock the queue again when manipulating other entries
+    Pair<StringHash, StringHash> key = MakePair(resource->GetType(), resource->GetNameHash());
+    backgroundLoadMutex_.Acquire();
+    if (item.dependents_.Size())
+    {
+        for (HashSet<Pair<StringHash, StringHash> >::Iterator i = item.dependents_.Begin(); i != item.dependents_.End(); ++i)
         {
-            Resource* resource = i->second_.resource_;
-            unsigned numDeps = i->second_.dependencies_.Size();
-            AsyncLoadState state = resource->GetAsyncLoadState();
-            if (numDeps > 0 || state == ASYNC_QUEUED || state == ASYNC_LOADING)
-                ++i;
-            else
+            HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(*i);
+            if (j != backgroundLoadQueue_.End())
             {
-                // Finishing a resource may need it to wait for other resources to load, in which case we can not
-                // hold on to the mutex
-                backgroundLoadMutex_.Release();
-                FinishBackgroundLoading(i->second_);
-                backgroundLoadMutex_.Acquire();
-                i = backgroundLoadQueue_.Erase(i);
+                j->second_.dependencies_.Erase(key);
+                CheckReadyToFinish(j->second_, *i);
             }
-
-            // Break when the time limit passed so that we keep sufficient FPS
-            if (timer.GetUSec(false) >= maxMs * 1000)
-                break;
         }
 
-        backgroundLoadMutex_.Release();
+        item.dependents_.Clear();
     }
+
+    resource->SetAsyncLoadState(success ? ASYNC_SUCCESS : ASYNC_FAIL);
+    CheckReadyToFinish(item, key);
+    backgroundLoadMutex_.Release();
+
+    loadedEvent_.Set();
 }
 
-unsigned BackgroundLoader::GetNumQueuedResources() const
+void BackgroundLoader::RaisePriority(BackgroundLoadItem& item, const Pair<StringHash, StringHash>& key, float priority)
 {
-    MutexLock lock(backgroundLoadMutex_);
-    return backgroundLoadQueue_.Size();
+    if (priority <= item.priority_)
+        return;
+
+    item.priority_ = priority;
+    if (item.resource_->GetAsyncLoadState() == ASYNC_QUEUED)
+        PushLoadEntry(key, priority);
+
+    for (HashSet<Pair<StringHash, StringHash> >::Iterator i = item.dependencies_.Begin(); i != item.dependencies_.End(); ++i)
+    {
+        HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem>::Iterator j = backgroundLoadQueue_.Find(*i);
+        if (j != backgroundLoadQueue_.End())
+            RaisePriority(j->second_, *i, priority);
+    }
+}
+
+void BackgroundLoader::PushLoadEntry(const Pair<StringHash, StringHash>& key, float priority)
+{
+    BackgroundLoadEntry entry;
+    entry.priority_ = priority;
+    entry.order_ = loadOrder_++;
+    entry.key_ = key;
+    PushHeap(loadHeap_, entry);
+
+    if (!idleThreads_.Empty())
+    {
+        idleThreads_.Back()->Wake();
+        idleThreads_.Pop();
+    }
+}
+
+void BackgroundLoader::CheckReadyToFinish(BackgroundLoadItem& item, const Pair<StringHash, StringHash>& key)
+{
+    AsyncLoadState state = item.resource_->GetAsyncLoadState();
+    if (item.dependencies_.Empty() && (state == ASYNC_SUCCESS || state == ASYNC_FAIL))
+        finishQueue_.Push(key);
+}
+
+void BackgroundLoader::StartThreads()
+{
+    for (unsigned i = 0; i < numThreads_; ++i)
+    {
+        SharedPtr<BackgroundLoadThread> thread(new BackgroundLoadThread(this));
+        thread->Run();
+        threads_.Push(thread);
+    }
+}
+
+void BackgroundLoader::StopThreads()
+{
+    // Can not hold the mutex while waiting for the threads, as they may need it to finish their current resource
+    Vector<SharedPtr<BackgroundLoadThread> > threads;
+    {
+        MutexLock lock(backgroundLoadMutex_);
+        threads.Swap(threads_);
+        idleThreads_.Clear();
+    }
+
+    for (unsigned i = 0; i < threads.Size(); ++i)
+        threads[i]->StopLoading();
 }
 
 void BackgroundLoader::FinishBackgroundLoading(BackgroundLoadItem& item)
@@ -27,12 +27,15 @@
 #include "../Core/Mutex.h"
 #include "../Container/Ptr.h"
 #include "../Container/RefCounted.h"
+#include "../Core/Condition.h"
 #include "../Core/Thread.h"
+#include "../Math/MathDefs.h"
 #include "../Math/StringHash.h"
 
 namespace Urho3D
 {
 
+class BackgroundLoadThread;
 class Resource;
 class ResourceCache;
 
@@ -45,34 +48,65 @@ struct BackgroundLoadItem
     HashSet<Pair<StringHash, StringHash> > dependencies_;
     /// Resources that depend on this resource's loading.
     HashSet<Pair<StringHash, StringHash> > dependents_;
+    /// Load priority. Higher priority resources are loaded first.
+    float priority_;
     /// Whether to send failure event.
     bool sendEventOnFailure_;
 };
 
+/// Background load priority queue entry.
+struct BackgroundLoadEntry
+{
+    /// Load priority at the time of queuing. If the item's priority has been raised since, the entry is stale.
+    float priority_;
+    /// Queuing order, to load equal priorities first in first out.
+    unsigned order_;
+    /// Resource type and name hash.
+    Pair<StringHash, StringHash> key_;
+};
+
 /// Background loader of resources. Owned by the ResourceCache.
-class BackgroundLoader : public RefCounted, public Thread
+class BackgroundLoader : public RefCounted
 {
+    friend class BackgroundLoadThread;
+
 public:
     /// Construct.
     BackgroundLoader(ResourceCache* owner);
 
-    /// Destruct. Forcibly clear the load queue.
+    /// Destruct. Stop the loader threads and forcibly clear the load queue.
     ~BackgroundLoader();
 
-    /// Resource background loading loop.
-    virtual void ThreadFunction();
-
-    /// Queue loading of a resource. The name must be sanitated to ensure consistent format. Return true if queued (not a duplicate and resource was a known type).
-    bool QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller);
-    /// Wait and finish possible loading of a resource when being requested from the cache.
+    /// Set number of loader threads. Running threads are stopped after finishing their current resource, and the new threads are started on the next background load request.
+    void SetNumThreads(unsigned num);
+    /// Queue loading of a resource. The name must be sanitated to ensure consistent format. Resources loaded by the caller inherit its priority, if higher. Queuing a resource that is already queued raises its priority if higher. Return true if queued (not a duplicate and resource was a known type).
+    bool QueueResource(StringHash type, const String& name, bool sendEventOnFailure, Resource* caller, float priority = 0.0f);
+    /// Wait and finish possible loading of a resource when being requested from the cache. If the loading has not started, load it in the calling thread, and load its dependencies before other resources.
     void WaitForResource(StringHash type, StringHash nameHash);
     /// Process resources that are ready to finish.
     void FinishResources(int maxMs);
 
+    /// Return number of loader threads.
+    unsigned GetNumThreads() const { return numThreads_; }
+
     /// Return amount of resources in the load queue.
     unsigned GetNumQueuedResources() const;
 
 private:
+    /// Load the highest priority queued resource, if its priority is at least the minimum. Called by the loader threads, and by the main thread when waiting for a resource. Return false if none, in which case the loader thread is marked idle.
+    bool LoadNextResource(BackgroundLoadThread* thread, float minPriority = -M_INFINITY);
+    /// Begin loading an item already marked as loading, and mark it and its dependents ready to finish as applicable.
+    void LoadItem(BackgroundLoadItem& item);
+    /// Raise the priority of a queued item and recursively of its dependencies, and wake a thread if it was requeued. Must be called with the mutex held.
+    void RaisePriority(BackgroundLoadItem& item, const Pair<StringHash, StringHash>& key, float priority);
+    /// Push an item into the priority queue and wake an idle loader thread. Must be called with the mutex held.
+    void PushLoadEntry(const Pair<StringHash, StringHash>& key, float priority);
+    /// Mark an item ready to finish if it has been loaded and has no pending dependencies. Must be called with the mutex held.
+    void CheckReadyToFinish(BackgroundLoadItem& item, const Pair<StringHash, StringHash>& key);
+    /// Create and start the loader threads. Must be called with the mutex held.
+    void StartThreads();
+    /// Stop and remove the loader threads.
+    void StopThreads();
     /// Finish one background loaded resource.
     void FinishBackgroundLoading(BackgroundLoadItem& item);
 
@@ -82,6 +116,20 @@ private:
     mutable Mutex backgroundLoadMutex_;
     /// Resources that are queued for background loading.
     HashMap<Pair<StringHash, StringHash>, BackgroundLoadItem> backgroundLoadQueue_;
+    /// Priority queue of resources waiting to be loaded, as a binary heap.
+    PODVector<BackgroundLoadEntry> loadHeap_;
+    /// Resources that have been loaded and are ready to finish in the main thread.
+    PODVector<Pair<StringHash, StringHash> > finishQueue_;
+    /// Loader threads.
+    Vector<SharedPtr<BackgroundLoadThread> > threads_;
+    /// Loader threads waiting for work.
+    PODVector<BackgroundLoadThread*> idleThreads_;
+    /// Event signaled whenever a resource has been loaded, for the main thread waiting for a resource.
+    Condition loadedEvent_;
+    /// Number of loader threads to start.
+    unsigned numThreads_;
+    /// Queuing order counter.
+    unsigned loadOrder_;
 };
 
 }
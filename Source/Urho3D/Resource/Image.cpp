@@ -774,6 +774,42 @@ bool Image::Save(Serializer& dest) const
     return success;
 }
 
+unsigned Image::GetProcessedVersion() const
+{
+    return 1;
+}
+
+bool Image::SaveProcessed(Serializer& dest) const
+{
+    if (IsCompressed() || !data_ || depth_ != 1 || cubemap_ || array_ || nextSibling_)
+        return false;
+
+    unsigned dataSize = width_ * height_ * components_;
+    bool success = true;
+    success &= dest.WriteInt(width_);
+    success &= dest.WriteInt(height_);
+    success &= dest.WriteUInt(components_);
+    success &= dest.Write(data_.Get(), dataSize) == dataSize;
+    return success;
+}
+
+bool Image::LoadProcessed(Deserializer& source)
+{
+    int width = source.ReadInt();
+    int height = source.ReadInt();
+    unsigned components = source.ReadUInt();
+    if (!components || !SetSize(width, height, components))
+        return false;
+
+    cubemap_ = false;
+    array_ = false;
+    sRGB_ = false;
+    nextSibling_.Reset();
+
+    unsigned dataSize = width_ * height_ * components_;
+    return source.Read(data_.Get(), dataSize) == dataSize;
+}
+
 
 bool Image::SetSize(int width, int height, unsigned components)
 {
@@ -2033,6 +2069,11 @@ unsigned char* Image::GetImageData(Deserializer& source, int& width, int& height
 {
     unsigned dataSize = source.GetSize();
 
+    // Decode directly from a memory mapped package to avoid copying the encoded data
+    File* file = dynamic_cast<File*>(&source);
+    if (file && file->GetMappedData())
+        return stbi_load_from_memory(file->GetMappedData(), dataSize, &width, &height, (int*)&components, 0);
+
     SharedArrayPtr<unsigned char> buffer(new unsigned char[dataSize]);
     source.Read(buffer.Get(), dataSize);
     return stbi_load_from_memory(buffer.Get(), dataSize, &width, &height, (int*)&components, 0);
@@ -103,6 +103,12 @@ public:
     virtual bool BeginLoad(Deserializer& source);
     /// Save the image to a stream. Regardless of original format, the image is saved as png. Compressed image data is not supported. Return true if successful.
     virtual bool Save(Serializer& dest) const;
+    /// Return the version of the processed data for the processed resource cache.
+    virtual unsigned GetProcessedVersion() const;
+    /// Save the decoded image data for the processed resource cache. Compressed, 3D, cubemap and array images are not supported, as they are loaded without decoding. Return true if successful.
+    virtual bool SaveProcessed(Serializer& dest) const;
+    /// Load decoded image data from the processed resource cache. Return true if successful.
+    virtual bool LoadProcessed(Deserializer& source);
 
     /// Set 2D size and number of color components. Old image data will be destroyed and new data is undefined. Return true if successful.
     bool SetSize(int width, int height, unsigned components);
@@ -25,6 +25,7 @@
 #include "../Core/Profiler.h"
 #include "../IO/Log.h"
 #include "../Resource/Resource.h"
+#include "../Resource/ResourceCache.h"
 
 namespace Urho3D
 {
@@ -51,7 +52,9 @@ bool Resource::Load(Deserializer& source)
     // If we are loading synchronously in a non-main thread, behave as if async loading (for example use
     // GetTempResource() instead of GetResource() to load resource dependencies)
     SetAsyncLoadState(Thread::IsMainThread() ? ASYNC_DONE : ASYNC_LOADING);
-    bool success = BeginLoad(source);
+    // Use the processed resource cache if available
+    ResourceCache* cache = GetSubsystem<ResourceCache>();
+    bool success = cache ? cache->BeginLoadResource(this, source) : BeginLoad(source);
     if (success)
         success &= EndLoad();
     SetAsyncLoadState(ASYNC_DONE);
@@ -82,6 +85,22 @@ bool Resource::Save(Serializer& dest) const
     return false;
 }
 
+unsigned Resource::GetProcessedVersion() const
+{
+    // Processed resource cache is not supported unless overridden by subclasses
+    return 0;
+}
+
+bool Resource::SaveProcessed(Serializer& dest) const
+{
+    return false;
+}
+
+bool Resource::LoadProcessed(Deserializer& source)
+{
+    return false;
+}
+
 void Resource::SetName(const String& name)
 {
     name_ = name;
@@ -63,6 +63,12 @@ public:
     virtual bool EndLoad();
     /// Save resource. Return true if successful.
     virtual bool Save(Serializer& dest) const;
+    /// Return the version of the processed data written by SaveProcessed(), or 0 if the processed resource cache is not supported. Must be increased when the processed data or the loading result changes.
+    virtual unsigned GetProcessedVersion() const;
+    /// Save the loaded resource data in a form that is faster to load than the source file. Called after BeginLoad() for the processed resource cache, possibly from a worker thread. Return true if successful.
+    virtual bool SaveProcessed(Serializer& dest) const;
+    /// Load resource from data written by SaveProcessed(), instead of BeginLoad(). May be called from a worker thread. Return true if successful.
+    virtual bool LoadProcessed(Deserializer& source);
 
     /// Set name.
     void SetName(const String& name);
@@ -67,13 +67,31 @@ static const char* checkDirs[] =
 
 static const SharedPtr<Resource> noResource;
 
+/// Default processed resource cache size limit.
+static const unsigned long long DEFAULT_PROCESSED_CACHE_SIZE_LIMIT = 256 * 1024 * 1024;
+
+/// Return the resource name index key of a file name. Case-insensitive on platforms with case-insensitive file systems.
+static StringHash GetIndexKey(const String& name)
+{
+#if defined(_WIN32) || defined(__APPLE__)
+    return StringHash(name.ToLower());
+#else
+    return StringHash(name);
+#endif
+}
+
 ResourceCache::ResourceCache(Context* context) :
     Object(context),
     autoReloadResources_(false),
     returnFailedResources_(false),
     searchPackagesFirst_(true),
+    indexResources_(false),
+    resourceIndexDirty_(true),
     isRouting_(false),
-    finishBackgroundResourcesMs_(5)
+    finishBackgroundResourcesMs_(5),
+    processedCacheSizeLimit_(DEFAULT_PROCESSED_CACHE_SIZE_LIMIT),
+    processedCacheSize_(0),
+    processedCacheWrites_(0)
 {
     // Register Resource library object factories
     RegisterResourceLibrary(context_);
@@ -120,9 +138,10 @@ bool ResourceCache::AddResourceDir(const String& pathName, unsigned priority)
         resourceDirs_.Insert(priority, fixedPath);
     else
         resourceDirs_.Push(fixedPath);
+    resourceIndexDirty_ = true;
 
-    // If resource auto-reloading active, create a file watcher for the directory
-    if (autoReloadResources_)
+    // If resource auto-reloading or indexing active, create a file watcher for the directory
+    if (autoReloadResources_ || indexResources_)
     {
         SharedPtr<FileWatcher> watcher(new FileWatcher(context_));
         watcher->StartWatching(fixedPath, true);
@@ -148,6 +167,7 @@ bool ResourceCache::AddPackageFile(PackageFile* package, unsigned priority)
         packages_.Insert(priority, SharedPtr<PackageFile>(package));
     else
         packages_.Push(SharedPtr<PackageFile>(package));
+    resourceIndexDirty_ = true;
 
     URHO3D_LOGINFO("Added resource package " + package->GetName());
     return true;
@@ -191,6 +211,7 @@ void ResourceCache::RemoveResourceDir(const String& pathName)
         if (!resourceDirs_[i].Compare(fixedPath, false))
         {
             resourceDirs_.Erase(i);
+            resourceIndexDirty_ = true;
             // Remove the filewatcher with the matching path
             for (unsigned j = 0; j < fileWatchers_.Size(); ++j)
             {
@@ -218,6 +239,7 @@ void ResourceCache::RemovePackageFile(PackageFile* package, bool releaseResource
                 ReleasePackageResources(*i, forceRelease);
             URHO3D_LOGINFO("Removed resource package " + (*i)->GetName());
             packages_.Erase(i);
+            resourceIndexDirty_ = true;
             return;
         }
     }
@@ -238,6 +260,7 @@ void ResourceCache::RemovePackageFile(const String& fileName, bool releaseResour
                 ReleasePackageResources(*i, forceRelease);
             URHO3D_LOGINFO("Removed resource package " + (*i)->GetName());
             packages_.Erase(i);
+            resourceIndexDirty_ = true;
             return;
         }
     }
@@ -442,22 +465,79 @@ void ResourceCache::SetAutoReloadResources(bool enable)
 {
     if (enable != autoReloadResources_)
     {
-        if (enable)
-        {
-            for (unsigned i = 0; i < resourceDirs_.Size(); ++i)
-            {
-                SharedPtr<FileWatcher> watcher(new FileWatcher(context_));
-                watcher->StartWatching(resourceDirs_[i], true);
-                fileWatchers_.Push(watcher);
-            }
-        }
-        else
-            fileWatchers_.Clear();
-
         autoReloadResources_ = enable;
+        UpdateFileWatchers();
     }
 }
 
+void ResourceCache::SetIndexResources(bool enable)
+{
+    MutexLock lock(resourceMutex_);
+
+    if (enable != indexResources_)
+    {
+        indexResources_ = enable;
+        // The index is built on the first lookup
+        resourceIndex_.Clear();
+        resourceIndexDirty_ = true;
+        UpdateFileWatchers();
+    }
+}
+
+void ResourceCache::SetProcessedCacheDir(const String& path)
+{
+    MutexLock lock(processedCacheMutex_);
+
+    processedCacheEntries_.Clear();
+    processedCacheSize_ = 0;
+    processedCacheDir_ = AddTrailingSlash(path);
+    if (processedCacheDir_.Empty())
+        return;
+
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    if (!fileSystem->DirExists(processedCacheDir_) && !fileSystem->CreateDir(processedCacheDir_))
+    {
+        URHO3D_LOGERROR("Could not create processed resource cache directory " + processedCacheDir_);
+        processedCacheDir_.Clear();
+        return;
+    }
+
+    // Remove files left over from interrupted writes
+    Vector<String> fileNames;
+    fileSystem->ScanDir(fileNames, processedCacheDir_, "*.tmp", SCAN_FILES, false);
+    for (unsigned i = 0; i < fileNames.Size(); ++i)
+        fileSystem->Delete(processedCacheDir_ + fileNames[i]);
+
+    // Use the modification times of existing entries as their last use times
+    fileSystem->ScanDir(fileNames, processedCacheDir_, "*.bin", SCAN_FILES, false);
+    for (unsigned i = 0; i < fileNames.Size(); ++i)
+    {
+        ProcessedResourceEntry entry;
+        entry.fileName_ = fileNames[i];
+        entry.size_ = File(context_, processedCacheDir_ + fileNames[i]).GetSize();
+        entry.lastUse_ = fileSystem->GetLastModifiedTime(processedCacheDir_ + fileNames[i]);
+        processedCacheEntries_[StringHash(fileNames[i])] = entry;
+        processedCacheSize_ += entry.size_;
+    }
+
+    EvictProcessedResources();
+}
+
+void ResourceCache::SetProcessedCacheSizeLimit(unsigned long long limit)
+{
+    MutexLock lock(processedCacheMutex_);
+
+    processedCacheSizeLimit_ = limit;
+    EvictProcessedResources();
+}
+
+void ResourceCache::SetNumBackgroundLoadThreads(unsigned num)
+{
+#ifdef URHO3D_THREADING
+    backgroundLoader_->SetNumThreads(num);
+#endif
+}
+
 void ResourceCache::AddResourceRouter(ResourceRouter* router, bool addAsFirst)
 {
     // Check for duplicate
@@ -635,7 +715,8 @@ Resource* ResourceCache::GetResource(StringHash type, const String& nameIn, bool
     return resource;
 }
 
-bool ResourceCache::BackgroundLoadResource(StringHash type, const String& nameIn, bool sendEventOnFailure, Resource* caller)
+bool ResourceCache::BackgroundLoadResource(StringHash type, const String& nameIn, bool sendEventOnFailure, Resource* caller,
+    float priority)
 {
 #ifdef URHO3D_THREADING
     // If empty name, fail immediately
@@ -648,7 +729,7 @@ bool ResourceCache::BackgroundLoadResource(StringHash type, const String& nameIn
     if (FindResource(type, nameHash) != noResource)
         return false;
 
-    return backgroundLoader_->QueueResource(type, name, sendEventOnFailure, caller);
+    return backgroundLoader_->QueueResource(type, name, sendEventOnFailure, caller, priority);
 #else
     // When threading not supported, fall back to synchronous loading
     return GetResource(type, nameIn, sendEventOnFailure);
@@ -708,6 +789,64 @@ SharedPtr<Resource> ResourceCache::GetTempResource(StringHash type, const String
     return resource;
 }
 
+bool ResourceCache::BeginLoadResource(Resource* resource, Deserializer& source)
+{
+    unsigned version = resource->GetProcessedVersion();
+    if (!version)
+        return resource->BeginLoad(source);
+
+    String dir;
+    {
+        MutexLock lock(processedCacheMutex_);
+        dir = processedCacheDir_;
+    }
+
+    // The source data is identified by its checksum, which is available only for files
+    unsigned checksum = dir.Empty() ? 0 : source.GetChecksum();
+    if (!checksum)
+        return resource->BeginLoad(source);
+
+    // Entries are named by the source data rather than the resource name, so identical files are stored only once
+    unsigned sourceSize = source.GetSize();
+    String entryName = ToStringHex(resource->GetType().Value()) + "_" + ToStringHex(checksum) + "_" + ToStringHex(sourceSize) +
+        "_" + String(version) + ".bin";
+    StringHash key(entryName);
+
+    bool found;
+    {
+        MutexLock lock(processedCacheMutex_);
+        found = processedCacheEntries_.Contains(key);
+    }
+
+    if (found)
+    {
+        if (LoadProcessedResource(resource, dir + entryName, checksum, sourceSize))
+        {
+            unsigned time = Time::GetTimeSinceEpoch();
+            MutexLock lock(processedCacheMutex_);
+            HashMap<StringHash, ProcessedResourceEntry>::Iterator i = processedCacheEntries_.Find(key);
+            if (i != processedCacheEntries_.End() && dir == processedCacheDir_)
+            {
+                // Store the last use time also to the file, so that it is retained for the next run
+                i->second_.lastUse_ = time;
+                GetSubsystem<FileSystem>()->SetLastModifiedTime(dir + entryName, time);
+            }
+            return true;
+        }
+
+        URHO3D_LOGWARNING("Removing invalid processed resource cache entry " + entryName);
+        MutexLock lock(processedCacheMutex_);
+        if (dir == processedCacheDir_)
+            RemoveProcessedResource(key);
+    }
+
+    if (!resource->BeginLoad(source))
+        return false;
+
+    StoreProcessedResource(resource, dir, entryName, checksum, sourceSize);
+    return true;
+}
+
 unsigned ResourceCache::GetNumBackgroundLoadResources() const
 {
 #ifdef URHO3D_THREADING
@@ -717,6 +856,15 @@ unsigned ResourceCache::GetNumBackgroundLoadResources() const
 #endif
 }
 
+unsigned ResourceCache::GetNumBackgroundLoadThreads() const
+{
+#ifdef URHO3D_THREADING
+    return backgroundLoader_->GetNumThreads();
+#else
+    return 0;
+#endif
+}
+
 void ResourceCache::GetResources(PODVector<Resource*>& result, StringHash type) const
 {
     result.Clear();
@@ -745,17 +893,26 @@ bool ResourceCache::Exists(const String& nameIn) const
     if (name.Empty())
         return false;
 
-    for (unsigned i = 0; i < packages_.Size(); ++i)
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+
+    if (indexResources_)
     {
-        if (packages_[i]->Exists(name))
+        if (FindIndexEntry(name))
             return true;
     }
-
-    FileSystem* fileSystem = GetSubsystem<FileSystem>();
-    for (unsigned i = 0; i < resourceDirs_.Size(); ++i)
+    else
     {
-        if (fileSystem->FileExists(resourceDirs_[i] + name))
-            return true;
+        for (unsigned i = 0; i < packages_.Size(); ++i)
+        {
+            if (packages_[i]->Exists(name))
+                return true;
+        }
+
+        for (unsigned i = 0; i < resourceDirs_.Size(); ++i)
+        {
+            if (fileSystem->FileExists(resourceDirs_[i] + name))
+                return true;
+        }
     }
 
     // Fallback using absolute path
@@ -782,10 +939,22 @@ unsigned long long ResourceCache::GetTotalMemoryUse() const
     return total;
 }
 
+unsigned long long ResourceCache::GetProcessedCacheSize() const
+{
+    MutexLock lock(processedCacheMutex_);
+    return processedCacheSize_;
+}
+
 String ResourceCache::GetResourceFileName(const String& name) const
 {
     MutexLock lock(resourceMutex_);
 
+    if (indexResources_)
+    {
+        const ResourceIndexEntry* entry = FindIndexEntry(name);
+        return entry && entry->dir_ < resourceDirs_.Size() ? resourceDirs_[entry->dir_] + name : String();
+    }
+
     FileSystem* fileSystem = GetSubsystem<FileSystem>();
     for (unsigned i = 0; i < resourceDirs_.Size(); ++i)
     {
@@ -1076,6 +1245,15 @@ void ResourceCache::HandleBeginFrame(StringHash eventType, VariantMap& eventData
         String fileName;
         while (fileWatchers_[i]->GetNextChange(fileName))
         {
+            if (indexResources_)
+            {
+                MutexLock lock(resourceMutex_);
+                UpdateResourceIndex(fileName);
+            }
+
+            if (!autoReloadResources_)
+                continue;
+
             ReloadResourceWithDependencies(fileName);
 
             // Finally send a general file changed event even if the file was not a tracked resource
@@ -1100,18 +1278,35 @@ void ResourceCache::HandleBeginFrame(StringHash eventType, VariantMap& eventData
 File* ResourceCache::SearchResourceDirs(const String& nameIn)
 {
     FileSystem* fileSystem = GetSubsystem<FileSystem>();
-    for (unsigned i = 0; i < resourceDirs_.Size(); ++i)
+    unsigned dirIndex = M_MAX_UNSIGNED;
+
+    if (indexResources_)
     {
-        if (fileSystem->FileExists(resourceDirs_[i] + nameIn))
+        const ResourceIndexEntry* entry = FindIndexEntry(nameIn);
+        if (entry)
+            dirIndex = entry->dir_;
+    }
+    else
+    {
+        for (unsigned i = 0; i < resourceDirs_.Size(); ++i)
         {
-            // Construct the file first with full path, then rename it to not contain the resource path,
-            // so that the file's name can be used in further GetFile() calls (for example over the network)
-            File* file(new File(context_, resourceDirs_[i] + nameIn));
-            file->SetName(nameIn);
-            return file;
+            if (fileSystem->FileExists(resourceDirs_[i] + nameIn))
+            {
+                dirIndex = i;
+                break;
+            }
         }
     }
 
+    if (dirIndex < resourceDirs_.Size())
+    {
+        // Construct the file first with full path, then rename it to not contain the resource path,
+        // so that the file's name can be used in further GetFile() calls (for example over the network)
+        File* file(new File(context_, resourceDirs_[dirIndex] + nameIn));
+        file->SetName(nameIn);
+        return file;
+    }
+
     // Fallback using absolute path
     if (fileSystem->FileExists(nameIn))
         return new File(context_, nameIn);
@@ -1121,6 +1316,12 @@ File* ResourceCache::SearchResourceDirs(const String& nameIn)
 
 File* ResourceCache::SearchPackages(const String& nameIn)
 {
+    if (indexResources_)
+    {
+        const ResourceIndexEntry* entry = FindIndexEntry(nameIn);
+        return entry && entry->package_ ? new File(context_, entry->package_, nameIn) : 0;
+    }
+
     for (unsigned i = 0; i < packages_.Size(); ++i)
     {
         if (packages_[i]->Exists(nameIn))
@@ -1130,6 +1331,181 @@ File* ResourceCache::SearchPackages(const String& nameIn)
     return 0;
 }
 
+void ResourceCache::UpdateFileWatchers()
+{
+    if (autoReloadResources_ || indexResources_)
+    {
+        if (fileWatchers_.Empty())
+        {
+            for (unsigned i = 0; i < resourceDirs_.Size(); ++i)
+            {
+                SharedPtr<FileWatcher> watcher(new FileWatcher(context_));
+                watcher->StartWatching(resourceDirs_[i], true);
+                fileWatchers_.Push(watcher);
+            }
+        }
+    }
+    else
+        fileWatchers_.Clear();
+}
+
+const ResourceIndexEntry* ResourceCache::FindIndexEntry(const String& name) const
+{
+    if (resourceIndexDirty_)
+        RebuildResourceIndex();
+
+    HashMap<StringHash, ResourceIndexEntry>::ConstIterator i = resourceIndex_.Find(GetIndexKey(name));
+    return i != resourceIndex_.End() ? &i->second_ : 0;
+}
+
+void ResourceCache::RebuildResourceIndex() const
+{
+    URHO3D_PROFILE(RebuildResourceIndex);
+
+    resourceIndex_.Clear();
+
+    // Record the first directory and package containing each file, as they are searched in priority order
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    for (unsigned i = 0; i < resourceDirs_.Size(); ++i)
+    {
+        Vector<String> fileNames;
+        fileSystem->ScanDir(fileNames, resourceDirs_[i], "*", SCAN_FILES | SCAN_HIDDEN, true);
+        for (unsigned j = 0; j < fileNames.Size(); ++j)
+        {
+            ResourceIndexEntry& entry = resourceIndex_[GetIndexKey(fileNames[j])];
+            if (entry.dir_ == M_MAX_UNSIGNED)
+                entry.dir_ = i;
+        }
+    }
+
+    for (unsigned i = 0; i < packages_.Size(); ++i)
+    {
+        const HashMap<String, PackageEntry>& entries = packages_[i]->GetEntries();
+        for (HashMap<String, PackageEntry>::ConstIterator j = entries.Begin(); j != entries.End(); ++j)
+        {
+            ResourceIndexEntry& entry = resourceIndex_[GetIndexKey(j->first_)];
+            if (!entry.package_)
+                entry.package_ = packages_[i];
+        }
+    }
+
+    resourceIndexDirty_ = false;
+    URHO3D_LOGDEBUGF("Indexed %u resource files", resourceIndex_.Size());
+}
+
+void ResourceCache::UpdateResourceIndex(const String& name)
+{
+    // If a rebuild is pending, the change will be picked up by it
+    if (resourceIndexDirty_)
+        return;
+
+    StringHash key = GetIndexKey(name);
+    ResourceIndexEntry& entry = resourceIndex_[key];
+    entry.dir_ = M_MAX_UNSIGNED;
+
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    for (unsigned i = 0; i < resourceDirs_.Size(); ++i)
+    {
+        if (fileSystem->FileExists(resourceDirs_[i] + name))
+        {
+            entry.dir_ = i;
+            break;
+        }
+    }
+
+    if (entry.dir_ == M_MAX_UNSIGNED && !entry.package_)
+        resourceIndex_.Erase(key);
+}
+
+bool ResourceCache::LoadProcessedResource(Resource* resource, const String& fileName, unsigned checksum, unsigned sourceSize)
+{
+    File file(context_);
+    if (!file.Open(fileName))
+        return false;
+
+    if (file.ReadFileID() != "UPRC" || file.ReadUInt() != checksum || file.ReadUInt() != sourceSize ||
+        file.ReadUInt() != resource->GetProcessedVersion())
+        return false;
+
+    return resource->LoadProcessed(file);
+}
+
+bool ResourceCache::StoreProcessedResource
+    (Resource* resource, const String& dir, const String& entryName, unsigned checksum, unsigned sourceSize)
+{
+    // Write to a temporary file first, so that partially written entries are never loaded
+    String tempFileName;
+    {
+        MutexLock lock(processedCacheMutex_);
+        tempFileName = dir + entryName + "." + String(processedCacheWrites_++) + ".tmp";
+    }
+
+    unsigned size = 0;
+    bool success = false;
+    {
+        File file(context_);
+        if (file.Open(tempFileName, FILE_WRITE))
+        {
+            file.WriteFileID("UPRC");
+            file.WriteUInt(checksum);
+            file.WriteUInt(sourceSize);
+            file.WriteUInt(resource->GetProcessedVersion());
+            success = resource->SaveProcessed(file);
+            size = file.GetSize();
+        }
+    }
+
+    FileSystem* fileSystem = GetSubsystem<FileSystem>();
+    MutexLock lock(processedCacheMutex_);
+
+    // Discard if the resource does not support saving its current data, if the cache was changed meanwhile, if the entry
+    // was stored by another thread already, or if the entry alone would exceed the size limit
+    StringHash key(entryName);
+    if (!success || dir != processedCacheDir_ || processedCacheEntries_.Contains(key) || size > processedCacheSizeLimit_ ||
+        !fileSystem->Rename(tempFileName, dir + entryName))
+    {
+        fileSystem->Delete(tempFileName);
+        return false;
+    }
+
+    ProcessedResourceEntry& entry = processedCacheEntries_[key];
+    entry.fileName_ = entryName;
+    entry.size_ = size;
+    entry.lastUse_ = Time::GetTimeSinceEpoch();
+    processedCacheSize_ += size;
+
+    EvictProcessedResources();
+    return true;
+}
+
+void ResourceCache::RemoveProcessedResource(StringHash key)
+{
+    HashMap<StringHash, ProcessedResourceEntry>::Iterator i = processedCacheEntries_.Find(key);
+    if (i == processedCacheEntries_.End())
+        return;
+
+    GetSubsystem<FileSystem>()->Delete(processedCacheDir_ + i->second_.fileName_);
+    processedCacheSize_ -= i->second_.size_;
+    processedCacheEntries_.Erase(i);
+}
+
+void ResourceCache::EvictProcessedResources()
+{
+    while (processedCacheSize_ > processedCacheSizeLimit_ && !processedCacheEntries_.Empty())
+    {
+        HashMap<StringHash, ProcessedResourceEntry>::Iterator oldest = processedCacheEntries_.Begin();
+        for (HashMap<StringHash, ProcessedResourceEntry>::Iterator i = processedCacheEntries_.Begin();
+             i != processedCacheEntries_.End(); ++i)
+        {
+            if (i->second_.lastUse_ < oldest->second_.lastUse_)
+                oldest = i;
+        }
+
+        URHO3D_LOGDEBUG("Evicting processed resource cache entry " + oldest->second_.fileName_);
+        RemoveProcessedResource(oldest->first_);
+    }
+}
+
 void RegisterResourceLibrary(Context* context)
 {
     Image::RegisterObject(context);
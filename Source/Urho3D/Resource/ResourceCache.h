@@ -56,6 +56,40 @@ struct ResourceGroup
     HashMap<StringHash, SharedPtr<Resource> > resources_;
 };
 
+/// Location of a resource file in the resource name index.
+struct ResourceIndexEntry
+{
+    /// Construct with defaults.
+    ResourceIndexEntry() :
+        dir_(M_MAX_UNSIGNED),
+        package_(0)
+    {
+    }
+
+    /// Index of the highest priority resource directory containing the file, or M_MAX_UNSIGNED if none.
+    unsigned dir_;
+    /// Highest priority package file containing the file, or null if none.
+    PackageFile* package_;
+};
+
+/// Processed resource cache entry.
+struct ProcessedResourceEntry
+{
+    /// Construct with defaults.
+    ProcessedResourceEntry() :
+        size_(0),
+        lastUse_(0)
+    {
+    }
+
+    /// File name in the processed resource cache directory.
+    String fileName_;
+    /// File size in bytes.
+    unsigned size_;
+    /// Time of last use in seconds since the epoch.
+    unsigned lastUse_;
+};
+
 /// Resource request types.
 enum ResourceRequest
 {
@@ -128,6 +162,14 @@ public:
 
     /// Set how many milliseconds maximum per frame to spend on finishing background loaded resources.
     void SetFinishBackgroundResourcesMs(int ms) { finishBackgroundResourcesMs_ = Max(ms, 1); }
+    /// Set number of background loader threads. Default is one less than the number of physical CPU cores, at most 4.
+    void SetNumBackgroundLoadThreads(unsigned num);
+    /// Enable or disable indexing the files in resource directories and packages by name. When enabled, file lookups do not need to probe the file system. The index is updated by file watchers when file changes can be detected. Default false.
+    void SetIndexResources(bool enable);
+    /// Set the directory of the persistent processed resource cache. Resource types that support it are stored there in their loaded form, and are loaded from it instead of their source files while the source files are unchanged. Empty path (default) disables the cache.
+    void SetProcessedCacheDir(const String& path);
+    /// Set the maximum total size in bytes of the processed resource cache. Least recently used entries are removed when it is exceeded. Default 256 MB.
+    void SetProcessedCacheSizeLimit(unsigned long long limit);
 
     /// Add a resource router object. By default there is none, so the routing process is skipped.
     void AddResourceRouter(ResourceRouter* router, bool addAsFirst = false);
@@ -140,10 +182,12 @@ public:
     Resource* GetResource(StringHash type, const String& name, bool sendEventOnFailure = true);
     /// Load a resource without storing it in the resource cache. Return null if not found or if fails. Can be called from outside the main thread if the resource itself is safe to load completely (it does not possess for example GPU data.)
     SharedPtr<Resource> GetTempResource(StringHash type, const String& name, bool sendEventOnFailure = true);
-    /// Background load a resource. An event will be sent when complete. Return true if successfully stored to the load queue, false if eg. already exists. Can be called from outside the main thread.
-    bool BackgroundLoadResource(StringHash type, const String& name, bool sendEventOnFailure = true, Resource* caller = 0);
+    /// Background load a resource. An event will be sent when complete. Resources with higher priority are loaded first, for example based on distance. Queuing an already queued resource with a higher priority raises its priority. Return true if successfully stored to the load queue, false if eg. already exists. Can be called from outside the main thread.
+    bool BackgroundLoadResource(StringHash type, const String& name, bool sendEventOnFailure = true, Resource* caller = 0, float priority = 0.0f);
     /// Return number of pending background-loaded resources.
     unsigned GetNumBackgroundLoadResources() const;
+    /// Call BeginLoad() of a resource, or load it from the processed resource cache if possible. Store to the processed resource cache on a successful load. Called by Resource::Load() and the background loader. Can be called from outside the main thread.
+    bool BeginLoadResource(Resource* resource, Deserializer& source);
     /// Return all loaded resources of a specific type.
     void GetResources(PODVector<Resource*>& result, StringHash type) const;
     /// Return an already loaded resource of specific type & name, or null if not found. Will not load if does not exist.
@@ -165,7 +209,7 @@ public:
     /// Template version of loading a resource without storing it to the cache.
     template <class T> SharedPtr<T> GetTempResource(const String& name, bool sendEventOnFailure = true);
     /// Template version of queueing a resource background load.
-    template <class T> bool BackgroundLoadResource(const String& name, bool sendEventOnFailure = true, Resource* caller = 0);
+    template <class T> bool BackgroundLoadResource(const String& name, bool sendEventOnFailure = true, Resource* caller = 0, float priority = 0.0f);
     /// Template version of returning loaded resources of a specific type.
     template <class T> void GetResources(PODVector<T*>& result) const;
     /// Return whether a file exists by name.
@@ -191,6 +235,21 @@ public:
     /// Return how many milliseconds maximum to spend on finishing background loaded resources.
     int GetFinishBackgroundResourcesMs() const { return finishBackgroundResourcesMs_; }
 
+    /// Return number of background loader threads.
+    unsigned GetNumBackgroundLoadThreads() const;
+
+    /// Return whether resource files are indexed by name.
+    bool GetIndexResources() const { return indexResources_; }
+
+    /// Return the processed resource cache directory.
+    const String& GetProcessedCacheDir() const { return processedCacheDir_; }
+
+    /// Return the maximum total size of the processed resource cache.
+    unsigned long long GetProcessedCacheSizeLimit() const { return processedCacheSizeLimit_; }
+
+    /// Return the current total size of the processed resource cache.
+    unsigned long long GetProcessedCacheSize() const;
+
     /// Return a resource router by index.
     ResourceRouter* GetResourceRouter(unsigned index) const;
 
@@ -223,6 +282,23 @@ private:
     File* SearchResourceDirs(const String& nameIn);
     /// Search resource packages for file.
     File* SearchPackages(const String& nameIn);
+    /// Create or remove the resource directory file watchers according to the auto-reload and indexing settings.
+    void UpdateFileWatchers();
+    /// Return the resource name index entry of a file, or null if not found. Rebuilds the index first if necessary.
+    const ResourceIndexEntry* FindIndexEntry(const String& name) const;
+    /// Rebuild the resource name index from the resource directories and packages.
+    void RebuildResourceIndex() const;
+    /// Update the resource directory of a file in the resource name index after the file has changed.
+    void UpdateResourceIndex(const String& name);
+    /// Load a resource from a processed resource cache file. Return true if successful.
+    bool LoadProcessedResource(Resource* resource, const String& fileName, unsigned checksum, unsigned sourceSize);
+    /// Save a loaded resource to the processed resource cache. Return true if successful.
+    bool StoreProcessedResource
+        (Resource* resource, const String& dir, const String& entryName, unsigned checksum, unsigned sourceSize);
+    /// Remove a processed resource cache entry and its file. Called with the processed resource cache mutex locked.
+    void RemoveProcessedResource(StringHash key);
+    /// Remove least recently used processed resource cache entries until within the size limit. Called with the processed resource cache mutex locked.
+    void EvictProcessedResources();
 
     /// Mutex for thread-safe access to the resource directories, resource packages and resource dependencies.
     mutable Mutex resourceMutex_;
@@ -230,7 +306,7 @@ private:
     HashMap<StringHash, ResourceGroup> resourceGroups_;
     /// Resource load directories.
     Vector<String> resourceDirs_;
-    /// File watchers for resource directories, if automatic reloading enabled.
+    /// File watchers for resource directories, if automatic reloading or indexing enabled.
     Vector<SharedPtr<FileWatcher> > fileWatchers_;
     /// Package files.
     Vector<SharedPtr<PackageFile> > packages_;
@@ -240,12 +316,30 @@ private:
     SharedPtr<BackgroundLoader> backgroundLoader_;
     /// Resource routers.
     Vector<SharedPtr<ResourceRouter> > resourceRouters_;
+    /// Resource file locations by name hash.
+    mutable HashMap<StringHash, ResourceIndexEntry> resourceIndex_;
+    /// Mutex for thread-safe access to the processed resource cache.
+    mutable Mutex processedCacheMutex_;
+    /// Processed resource cache entries by file name hash.
+    HashMap<StringHash, ProcessedResourceEntry> processedCacheEntries_;
+    /// Processed resource cache directory.
+    String processedCacheDir_;
+    /// Processed resource cache size limit in bytes.
+    unsigned long long processedCacheSizeLimit_;
+    /// Processed resource cache total size in bytes.
+    unsigned long long processedCacheSize_;
+    /// Counter for unique temporary file names when storing to the processed resource cache.
+    unsigned processedCacheWrites_;
     /// Automatic resource reloading flag.
     bool autoReloadResources_;
     /// Return failed resources flag.
     bool returnFailedResources_;
     /// Search priority flag.
     bool searchPackagesFirst_;
+    /// Resource name indexing flag.
+    bool indexResources_;
+    /// Resource name index needs rebuild flag.
+    mutable bool resourceIndexDirty_;
     /// Resource routing flag to prevent endless recursion.
     mutable bool isRouting_;
     /// How many milliseconds maximum per frame to spend on finishing background loaded resources.
@@ -270,10 +364,10 @@ template <class T> SharedPtr<T> ResourceCache::GetTempResource(const String& nam
     return StaticCast<T>(GetTempResource(type, name, sendEventOnFailure));
 }
 
-template <class T> bool ResourceCache::BackgroundLoadResource(const String& name, bool sendEventOnFailure, Resource* caller)
+template <class T> bool ResourceCache::BackgroundLoadResource(const String& name, bool sendEventOnFailure, Resource* caller, float priority)
 {
     StringHash type = T::GetTypeStatic();
-    return BackgroundLoadResource(type, name, sendEventOnFailure, caller);
+    return BackgroundLoadResource(type, name, sendEventOnFailure, caller, priority);
 }
 
 template <class T> void ResourceCache::GetResources(PODVector<T*>& result) const
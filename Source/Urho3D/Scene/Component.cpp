@@ -96,7 +96,7 @@ void Component::MarkNetworkUpdate()
     if (!networkUpdate_ && id_ < FIRST_LOCAL_ID)
     {
         Scene* scene = GetScene();
-        if (scene)
+        if (scene && !scene->IsNetworkUpdateSuppressed())
         {
             scene->MarkNetworkUpdate(this);
             networkUpdate_ = true;
@@ -155,6 +155,12 @@ void Component::AddReplicationState(ComponentReplicationState* state)
     networkState_->replicationStates_.Push(state);
 }
 
+void Component::RemoveReplicationState(ComponentReplicationState* state)
+{
+    if (networkState_)
+        networkState_->replicationStates_.Remove(state);
+}
+
 void Component::PrepareNetworkUpdate()
 {
     if (!networkState_)
@@ -170,6 +176,7 @@ void Component::PrepareNetworkUpdate()
     {
         networkState_->currentValues_.Resize(numAttributes);
         networkState_->previousValues_.Resize(numAttributes);
+        networkState_->cachedUpdates_.Clear();
 
         // Copy the default attribute values to the previous state as a starting point
         for (unsigned i = 0; i < numAttributes; ++i)
@@ -186,9 +193,11 @@ void Component::PrepareNetworkUpdate()
 
         OnGetAttribute(attr, networkState_->currentValues_[i]);
 
-        if (networkState_->currentValues_[i] != networkState_->previousValues_[i])
+        if (IsNetworkAttributeChanged(i))
         {
             networkState_->previousValues_[i] = networkState_->currentValues_[i];
+            // The encoded updates are no longer valid
+            networkState_->cachedUpdates_.Clear();
 
             // Mark the attribute dirty in all replication states that are tracking this component
             for (PODVector<ReplicationState*>::Iterator j = networkState_->replicationStates_.Begin();
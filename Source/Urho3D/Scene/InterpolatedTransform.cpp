@@ -0,0 +1,306 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Core/Context.h"
+#include "../Scene/InterpolatedTransform.h"
+#include "../Scene/Scene.h"
+#include "../Scene/SceneEvents.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Unwrapped tick of the first sample. Leaves room for late samples that are older than it.
+static const unsigned FIRST_TICK = 0x10000;
+/// Maximum number of buffered samples.
+static const unsigned MAX_SAMPLES = 64;
+static const float DEFAULT_UPDATE_INTERVAL = 1.0f / 30.0f;
+static const float MIN_UPDATE_INTERVAL = 1.0f / 240.0f;
+static const float MAX_UPDATE_INTERVAL = 1.0f;
+static const float UPDATE_INTERVAL_RATE = 0.05f;
+/// Render time error in seconds above which the render time is reset instead of corrected gradually.
+static const double CLOCK_SNAP_THRESHOLD = 0.5;
+static const float CLOCK_CORRECTION_RATE = 2.0f;
+
+InterpolatedTransform::InterpolatedTransform(Context* context) :
+    Component(context),
+    renderTick_(0.0),
+    localTime_(0.0),
+    latestArrival_(0.0),
+    updateInterval_(DEFAULT_UPDATE_INTERVAL),
+    numUnderruns_(0),
+    clockValid_(false),
+    extrapolating_(false),
+    subscribed_(false)
+{
+}
+
+InterpolatedTransform::~InterpolatedTransform()
+{
+}
+
+void InterpolatedTransform::RegisterObject(Context* context)
+{
+    context->RegisterFactory<InterpolatedTransform>();
+}
+
+void InterpolatedTransform::Update(float timeStep, float squaredSnapThreshold)
+{
+    localTime_ += timeStep;
+
+    Scene* scene = GetScene();
+    if (samples_.Empty() || !node_ || !scene)
+        return;
+
+    // Render behind the latest sample by the interpolation delay, following the network timestamp rate. Advance at the local
+    // rate and correct gradually toward the target to absorb arrival jitter, never going backward
+    const TransformSample& latest = samples_.Back();
+    double targetTick = latest.tick_ + (localTime_ - latestArrival_ - scene->GetInterpolationDelay()) / updateInterval_;
+    double error = targetTick - renderTick_;
+    if (!clockValid_ || (error >= 0.0 ? error : -error) * updateInterval_ > CLOCK_SNAP_THRESHOLD)
+    {
+        renderTick_ = targetTick;
+        clockValid_ = true;
+    }
+    else
+    {
+        double nextTick = renderTick_ + timeStep / updateInterval_;
+        nextTick += (targetTick - nextTick) * Min(timeStep * CLOCK_CORRECTION_RATE, 1.0f);
+        if (nextTick > renderTick_)
+            renderTick_ = nextTick;
+    }
+
+    // Drop samples that are no longer needed, keeping one before the interpolated pair for the tangent
+    while (samples_.Size() > 3 && samples_[2].tick_ <= renderTick_)
+        samples_.Erase(0);
+
+    Vector3 position;
+    Quaternion rotation;
+    unsigned last = samples_.Size() - 1;
+
+    if (renderTick_ <= samples_[0].tick_)
+    {
+        position = samples_[0].position_;
+        rotation = samples_[0].rotation_;
+        extrapolating_ = false;
+    }
+    else if (renderTick_ >= samples_[last].tick_)
+    {
+        const TransformSample& b = samples_[last];
+        position = b.position_;
+        rotation = b.rotation_;
+        extrapolating_ = true;
+
+        if (last > 0)
+        {
+            // Extrapolate up to the limit, then ease back to the latest sample in case the node has stopped moving, as
+            // no further updates would be sent in that case
+            const TransformSample& a = samples_[last - 1];
+            float maxAhead = scene->GetMaxExtrapolation() / updateInterval_;
+            float ahead = (float)(renderTick_ - b.tick_);
+            float t = ahead <= maxAhead ? ahead : Max(2.0f * maxAhead - ahead, 0.0f);
+            if (t > 0.0f && (b.position_ - a.position_).LengthSquared() <= squaredSnapThreshold)
+            {
+                t /= (float)(b.tick_ - a.tick_);
+                position = b.position_ + (b.position_ - a.position_) * t;
+                rotation = (Quaternion::IDENTITY.Slerp(b.rotation_ * a.rotation_.Inverse(), t) * b.rotation_).Normalized();
+            }
+        }
+    }
+    else
+    {
+        unsigned i = 0;
+        while (samples_[i + 1].tick_ <= renderTick_)
+            ++i;
+
+        const TransformSample& a = samples_[i];
+        const TransformSample& b = samples_[i + 1];
+        float span = (float)(b.tick_ - a.tick_);
+        float t = (float)(renderTick_ - a.tick_) / span;
+        extrapolating_ = false;
+
+        // Do not interpolate across a snap, but hold the previous position until it is reached
+        if ((b.position_ - a.position_).LengthSquared() > squaredSnapThreshold)
+            position = a.position_;
+        else
+        {
+            // Cubic Hermite spline with Catmull-Rom style tangents from the neighbouring samples
+            const TransformSample& prev = (i > 0 && (a.position_ - samples_[i - 1].position_).LengthSquared() <=
+                squaredSnapThreshold) ? samples_[i - 1] : a;
+            const TransformSample& next = (i + 2 <= last && (samples_[i + 2].position_ - b.position_).LengthSquared() <=
+                squaredSnapThreshold) ? samples_[i + 2] : b;
+            Vector3 m0 = (b.position_ - prev.position_) * (span / (float)(b.tick_ - prev.tick_));
+            Vector3 m1 = (next.position_ - a.position_) * (span / (float)(next.tick_ - a.tick_));
+            float t2 = t * t;
+            float t3 = t2 * t;
+            position = a.position_ * (2.0f * t3 - 3.0f * t2 + 1.0f) + m0 * (t3 - 2.0f * t2 + t) + b.position_ * (3.0f * t2 -
+                2.0f * t3) + m1 * (t3 - t2);
+        }
+
+        rotation = a.rotation_.Slerp(b.rotation_, t);
+    }
+
+    if (position != node_->GetPosition())
+        node_->SetPosition(position);
+    if (rotation != node_->GetRotation())
+        node_->SetRotation(rotation);
+}
+
+void InterpolatedTransform::AddPosition(const Vector3& position, unsigned char timeStamp)
+{
+    GetSample(timeStamp).position_ = position;
+}
+
+void InterpolatedTransform::AddRotation(const Quaternion& rotation, unsigned char timeStamp)
+{
+    GetSample(timeStamp).rotation_ = rotation;
+}
+
+void InterpolatedTransform::Snap()
+{
+    if (samples_.Empty())
+        return;
+
+    samples_.Erase(0, samples_.Size() - 1);
+    clockValid_ = false;
+    extrapolating_ = false;
+
+    if (node_)
+    {
+        node_->SetPosition(samples_[0].position_);
+        node_->SetRotation(samples_[0].rotation_);
+    }
+}
+
+Vector3 InterpolatedTransform::GetTargetPosition() const
+{
+    if (!samples_.Empty())
+        return samples_.Back().position_;
+    else
+        return node_ ? node_->GetPosition() : Vector3::ZERO;
+}
+
+Quaternion InterpolatedTransform::GetTargetRotation() const
+{
+    if (!samples_.Empty())
+        return samples_.Back().rotation_;
+    else
+        return node_ ? node_->GetRotation() : Quaternion::IDENTITY;
+}
+
+void InterpolatedTransform::OnNodeSet(Node* node)
+{
+    if (!node)
+    {
+        samples_.Clear();
+        clockValid_ = false;
+    }
+}
+
+TransformSample& InterpolatedTransform::GetSample(unsigned char timeStamp)
+{
+    if (samples_.Empty())
+    {
+        TransformSample sample;
+        sample.tick_ = FIRST_TICK + timeStamp;
+        sample.position_ = node_ ? node_->GetPosition() : Vector3::ZERO;
+        sample.rotation_ = node_ ? node_->GetRotation() : Quaternion::IDENTITY;
+        samples_.Push(sample);
+        latestArrival_ = localTime_;
+
+        if (!subscribed_ && GetScene())
+        {
+            SubscribeToEvent(GetScene(), E_UPDATESMOOTHING, URHO3D_HANDLER(InterpolatedTransform, HandleUpdateSmoothing));
+            subscribed_ = true;
+        }
+
+        return samples_.Back();
+    }
+
+    // Unwrap the 8-bit timestamp relative to the latest sample
+    unsigned latestTick = samples_.Back().tick_;
+    unsigned char delta = (unsigned char)(timeStamp - latestTick);
+    if (!delta)
+        return samples_.Back();
+
+    if (delta < 128)
+    {
+        // Count an underrun if the buffer ran out shortly before this update arrived. After a longer wait the node has most
+        // likely just stopped changing, as unchanged attributes are not sent
+        Scene* scene = GetScene();
+        if (extrapolating_ && scene && (renderTick_ - latestTick) * updateInterval_ <= Max(scene->GetInterpolationDelay(),
+            scene->GetMaxExtrapolation()))
+        {
+            ++numUnderruns_;
+
+            using namespace InterpolationUnderrun;
+
+            VariantMap& eventData = GetEventDataMap();
+            eventData[P_NODE] = node_;
+            SendEvent(E_INTERPOLATIONUNDERRUN, eventData);
+        }
+
+        if (clockValid_)
+        {
+            float interval = (float)(localTime_ - latestArrival_) / delta;
+            updateInterval_ += (Clamp(interval, MIN_UPDATE_INTERVAL, MAX_UPDATE_INTERVAL) - updateInterval_) * UPDATE_INTERVAL_RATE;
+        }
+        latestArrival_ = localTime_;
+
+        // New sample inherits the attributes not included in this update from the previous one
+        TransformSample sample = samples_.Back();
+        sample.tick_ = latestTick + delta;
+        samples_.Push(sample);
+        if (samples_.Size() > MAX_SAMPLES)
+            samples_.Erase(0, samples_.Size() - MAX_SAMPLES);
+
+        return samples_.Back();
+    }
+    else
+    {
+        // Late sample: insert in order
+        unsigned tick = latestTick - (256 - delta);
+        unsigned i = samples_.Size() - 1;
+        while (i > 0 && samples_[i - 1].tick_ >= tick)
+            --i;
+        if (samples_[i].tick_ == tick)
+            return samples_[i];
+
+        TransformSample sample = i > 0 ? samples_[i - 1] : samples_[i];
+        sample.tick_ = tick;
+        samples_.Insert(i, sample);
+        return samples_[i];
+    }
+}
+
+void InterpolatedTransform::HandleUpdateSmoothing(StringHash eventType, VariantMap& eventData)
+{
+    using namespace UpdateSmoothing;
+
+    Update(eventData[P_TIMESTEP].GetFloat(), eventData[P_SQUAREDSNAPTHRESHOLD].GetFloat());
+}
+
+}
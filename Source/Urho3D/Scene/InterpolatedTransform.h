@@ -0,0 +1,113 @@
+//
+// Copyright (c) 2008-2016 the Urho3D project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../Scene/Component.h"
+
+namespace Urho3D
+{
+
+/// Time-stamped transform received from the network.
+struct TransformSample
+{
+    /// Update counter, unwrapped from the 8-bit network timestamp.
+    unsigned tick_;
+    /// Position in parent space.
+    Vector3 position_;
+    /// Rotation in parent space.
+    Quaternion rotation_;
+};
+
+/// Transform interpolation component for network updates. Buffers received positions and rotations by the network update timestamp and renders them with a delay using Hermite interpolation, extrapolating for a bounded time when the buffer runs out.
+class URHO3D_API InterpolatedTransform : public Component
+{
+    URHO3D_OBJECT(InterpolatedTransform, Component);
+
+public:
+    /// Construct.
+    InterpolatedTransform(Context* context);
+    /// Destruct.
+    ~InterpolatedTransform();
+    /// Register object factory.
+    static void RegisterObject(Context* context);
+
+    /// Advance the render time and apply the interpolated transform to the node. Interpolation delay and maximum extrapolation are read from the scene.
+    void Update(float timeStep, float squaredSnapThreshold);
+    /// Add a received position in parent space with the timestamp of the network update.
+    void AddPosition(const Vector3& position, unsigned char timeStamp);
+    /// Add a received rotation in parent space with the timestamp of the network update.
+    void AddRotation(const Quaternion& rotation, unsigned char timeStamp);
+    /// Discard buffered history and move the node immediately to the latest received transform.
+    void Snap();
+    /// Reset the underrun counter.
+    void ResetUnderruns() { numUnderruns_ = 0; }
+
+    /// Return number of buffered samples.
+    unsigned GetNumSamples() const { return samples_.Size(); }
+
+    /// Return latest received position in parent space.
+    Vector3 GetTargetPosition() const;
+    /// Return latest received rotation in parent space.
+    Quaternion GetTargetRotation() const;
+
+    /// Return estimated time in seconds per network timestamp tick.
+    float GetUpdateInterval() const { return updateInterval_; }
+
+    /// Return number of times the buffer has run out of samples.
+    unsigned GetNumUnderruns() const { return numUnderruns_; }
+
+    /// Return whether is currently extrapolating past the latest received sample.
+    bool IsExtrapolating() const { return extrapolating_; }
+
+protected:
+    /// Handle scene node being assigned at creation.
+    virtual void OnNodeSet(Node* node);
+
+private:
+    /// Return the sample for an update timestamp, creating it from the neighbouring state if necessary.
+    TransformSample& GetSample(unsigned char timeStamp);
+    /// Handle smoothing update event.
+    void HandleUpdateSmoothing(StringHash eventType, VariantMap& eventData);
+
+    /// Buffered samples in ascending timestamp order.
+    PODVector<TransformSample> samples_;
+    /// Render time in network update ticks.
+    double renderTick_;
+    /// Local time accumulated from scene updates.
+    double localTime_;
+    /// Local time when the latest sample arrived.
+    double latestArrival_;
+    /// Estimated time in seconds per network timestamp tick.
+    float updateInterval_;
+    /// Number of buffer underruns.
+    unsigned numUnderruns_;
+    /// Render time valid flag.
+    bool clockValid_;
+    /// Extrapolating flag.
+    bool extrapolating_;
+    /// Subscribed to smoothing update event flag.
+    bool subscribed_;
+};
+
+}
@@ -29,6 +29,7 @@
 #include "../Resource/XMLFile.h"
 #include "../Resource/JSONFile.h"
 #include "../Scene/Component.h"
+#include "../Scene/InterpolatedTransform.h"
 #include "../Scene/ObjectAnimation.h"
 #include "../Scene/ReplicationState.h"
 #include "../Scene/Scene.h"
@@ -86,10 +87,11 @@ void Node::RegisterObject(Context* context)
     URHO3D_ATTRIBUTE("Variables", VariantMap, vars_, Variant::emptyVariantMap, AM_FILE); // Network replication of vars uses custom data
     URHO3D_ACCESSOR_ATTRIBUTE("Network Position", GetNetPositionAttr, SetNetPositionAttr, Vector3, Vector3::ZERO,
         AM_NET | AM_LATESTDATA | AM_NOEDIT);
-    URHO3D_ACCESSOR_ATTRIBUTE("Network Rotation", GetNetRotationAttr, SetNetRotationAttr, PODVector<unsigned char>, Variant::emptyBuffer,
+    URHO3D_ACCESSOR_ATTRIBUTE("Network Rotation", GetNetRotationAttr, SetNetRotationAttr, Quaternion, Quaternion::IDENTITY,
         AM_NET | AM_LATESTDATA | AM_NOEDIT);
     URHO3D_ACCESSOR_ATTRIBUTE("Network Parent Node", GetNetParentAttr, SetNetParentAttr, PODVector<unsigned char>, Variant::emptyBuffer,
         AM_NET | AM_NOEDIT);
+    URHO3D_NETWORK_ENCODING("Network Rotation", NetworkEncoding(NE_SMALLESTTHREE, 15));
 }
 
 bool Node::Load(Deserializer& source, bool setInstanceDefault)
@@ -282,7 +284,7 @@ void Node::ApplyAttributes()
 
 void Node::MarkNetworkUpdate()
 {
-    if (!networkUpdate_ && scene_ && id_ < FIRST_LOCAL_ID)
+    if (!networkUpdate_ && scene_ && id_ < FIRST_LOCAL_ID && !scene_->IsNetworkUpdateSuppressed())
     {
         scene_->MarkNetworkUpdate(this);
         networkUpdate_ = true;
@@ -297,6 +299,12 @@ void Node::AddReplicationState(NodeReplicationState* state)
     networkState_->replicationStates_.Push(state);
 }
 
+void Node::RemoveReplicationState(NodeReplicationState* state)
+{
+    if (networkState_)
+        networkState_->replicationStates_.Remove(state);
+}
+
 bool Node::SaveXML(Serializer& dest, const String& indentation) const
 {
     SharedPtr<XMLFile> xml(new XMLFile(context_));
@@ -1365,19 +1373,32 @@ void Node::SetNetPositionAttr(const Vector3& value)
 {
     SmoothedTransform* transform = GetComponent<SmoothedTransform>();
     if (transform)
+    {
         transform->SetTargetPosition(value);
+        return;
+    }
+
+    InterpolatedTransform* interpolated = GetComponent<InterpolatedTransform>();
+    if (interpolated)
+        interpolated->AddPosition(value, GetNetworkTimeStamp());
     else
         SetPosition(value);
 }
 
-void Node::SetNetRotationAttr(const PODVector<unsigned char>& value)
+void Node::SetNetRotationAttr(const Quaternion& value)
 {
-    MemoryBuffer buf(value);
     SmoothedTransform* transform = GetComponent<SmoothedTransform>();
     if (transform)
-        transform->SetTargetRotation(buf.ReadPackedQuaternion());
+    {
+        transform->SetTargetRotation(value);
+        return;
+    }
+
+    InterpolatedTransform* interpolated = GetComponent<InterpolatedTransform>();
+    if (interpolated)
+        interpolated->AddRotation(value, GetNetworkTimeStamp());
     else
-        SetRotation(buf.ReadPackedQuaternion());
+        SetRotation(value);
 }
 
 void Node::SetNetParentAttr(const PODVector<unsigned char>& value)
@@ -1422,11 +1443,9 @@ const Vector3& Node::GetNetPositionAttr() const
     return position_;
 }
 
-const PODVector<unsigned char>& Node::GetNetRotationAttr() const
+const Quaternion& Node::GetNetRotationAttr() const
 {
-    attrBuffer_.Clear();
-    attrBuffer_.WritePackedQuaternion(rotation_);
-    return attrBuffer_.GetBuffer();
+    return rotation_;
 }
 
 const PODVector<unsigned char>& Node::GetNetParentAttr() const
@@ -1624,6 +1643,7 @@ void Node::PrepareNetworkUpdate()
     {
         networkState_->currentValues_.Resize(numAttributes);
         networkState_->previousValues_.Resize(numAttributes);
+        networkState_->cachedUpdates_.Clear();
 
         // Copy the default attribute values to the previous state as a starting point
         for (unsigned i = 0; i < numAttributes; ++i)
@@ -1640,9 +1660,11 @@ void Node::PrepareNetworkUpdate()
 
         OnGetAttribute(attr, networkState_->currentValues_[i]);
 
-        if (networkState_->currentValues_[i] != networkState_->previousValues_[i])
+        if (IsNetworkAttributeChanged(i))
         {
             networkState_->previousValues_[i] = networkState_->currentValues_[i];
+            // The encoded updates are no longer valid
+            networkState_->cachedUpdates_.Clear();
 
             // Mark the attribute dirty in all replication states that are tracking this node
             for (PODVector<ReplicationState*>::Iterator j = networkState_->replicationStates_.Begin();
@@ -1707,6 +1729,9 @@ void Node::MarkReplicationDirty()
 {
     if (networkState_)
     {
+        // Also update the dependency nodes, as the components may have changed
+        MarkNetworkUpdate();
+
         for (PODVector<ReplicationState*>::Iterator j = networkState_->replicationStates_.Begin();
              j != networkState_->replicationStates_.End(); ++j)
         {
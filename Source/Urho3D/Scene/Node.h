@@ -88,6 +88,8 @@ public:
     virtual void MarkNetworkUpdate();
     /// Add a replication state that is tracking this node.
     virtual void AddReplicationState(NodeReplicationState* state);
+    /// Remove a replication state that is no longer tracking this node.
+    void RemoveReplicationState(NodeReplicationState* state);
 
     /// Save to an XML file. Return true if successful.
     bool SaveXML(Serializer& dest, const String& indentation = "\t") const;
@@ -543,13 +545,13 @@ public:
     /// Set network position attribute.
     void SetNetPositionAttr(const Vector3& value);
     /// Set network rotation attribute.
-    void SetNetRotationAttr(const PODVector<unsigned char>& value);
+    void SetNetRotationAttr(const Quaternion& value);
     /// Set network parent attribute.
     void SetNetParentAttr(const PODVector<unsigned char>& value);
     /// Return network position attribute.
     const Vector3& GetNetPositionAttr() const;
     /// Return network rotation attribute.
-    const PODVector<unsigned char>& GetNetRotationAttr() const;
+    const Quaternion& GetNetRotationAttr() const;
     /// Return network parent attribute.
     const PODVector<unsigned char>& GetNetParentAttr() const;
     /// Load components and optionally load child nodes.
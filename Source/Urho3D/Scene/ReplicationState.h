@@ -26,6 +26,7 @@
 #include "../Container/HashMap.h"
 #include "../Container/HashSet.h"
 #include "../Container/Ptr.h"
+#include "../Core/Mutex.h"
 #include "../Math/StringHash.h"
 
 #include <cstring>
@@ -121,6 +122,54 @@ struct URHO3D_API DirtyBits
     unsigned char count_;
 };
 
+/// Encoded network attribute update, shared by all connections until the attribute values change.
+struct URHO3D_API CachedNetworkUpdate
+{
+    /// Construct with defaults.
+    CachedNetworkUpdate() :
+        latestData_(false),
+        encodeTime_(0)
+    {
+    }
+
+    /// Attribute bits the update was encoded with. Unused for latest data updates.
+    DirtyBits attributeBits_;
+    /// Encoded data, excluding the timestamp.
+    PODVector<unsigned char> data_;
+    /// Latest data update flag.
+    bool latestData_;
+    /// Time spent encoding in microseconds.
+    long long encodeTime_;
+};
+
+/// Network update encoding statistics.
+struct URHO3D_API NetworkEncodeStats
+{
+    /// Construct with zero counts.
+    NetworkEncodeStats() :
+        encodedUpdates_(0),
+        reusedUpdates_(0),
+        encodedBytes_(0),
+        reusedBytes_(0),
+        encodeTime_(0),
+        reusedTime_(0)
+    {
+    }
+
+    /// Number of updates encoded.
+    unsigned encodedUpdates_;
+    /// Number of updates reused from the cache.
+    unsigned reusedUpdates_;
+    /// Bytes encoded.
+    unsigned long long encodedBytes_;
+    /// Bytes reused from the cache instead of encoding.
+    unsigned long long reusedBytes_;
+    /// Time spent encoding in microseconds.
+    long long encodeTime_;
+    /// Encoding time saved by reusing cached updates in microseconds.
+    long long reusedTime_;
+};
+
 /// Per-object attribute state for network replication, allocated on demand.
 struct URHO3D_API NetworkState
 {
@@ -140,6 +189,10 @@ struct URHO3D_API NetworkState
     PODVector<ReplicationState*> replicationStates_;
     /// Previous user variables.
     VariantMap previousVars_;
+    /// Encoded updates for the current attribute values.
+    Vector<CachedNetworkUpdate> cachedUpdates_;
+    /// Mutex for the encoded updates, as server updates may be built for several connections in parallel.
+    Mutex cachedUpdatesMutex_;
     /// Bitmask for intercepting network messages. Used on the client only.
     unsigned long long interceptMask_;
 };
@@ -34,6 +34,7 @@
 #include "../Resource/XMLFile.h"
 #include "../Resource/JSONFile.h"
 #include "../Scene/Component.h"
+#include "../Scene/InterpolatedTransform.h"
 #include "../Scene/ObjectAnimation.h"
 #include "../Scene/ReplicationState.h"
 #include "../Scene/Scene.h"
@@ -54,6 +55,8 @@ const char* SUBSYSTEM_CATEGORY = "Subsystem";
 
 static const float DEFAULT_SMOOTHING_CONSTANT = 50.0f;
 static const float DEFAULT_SNAP_THRESHOLD = 5.0f;
+static const float DEFAULT_INTERPOLATION_DELAY = 0.1f;
+static const float DEFAULT_MAX_EXTRAPOLATION = 0.1f;
 
 Scene::Scene(Context* context) :
     Node(context),
@@ -67,9 +70,14 @@ Scene::Scene(Context* context) :
     elapsedTime_(0),
     smoothingConstant_(DEFAULT_SMOOTHING_CONSTANT),
     snapThreshold_(DEFAULT_SNAP_THRESHOLD),
+    interpolationDelay_(DEFAULT_INTERPOLATION_DELAY),
+    maxExtrapolation_(DEFAULT_MAX_EXTRAPOLATION),
     updateEnabled_(true),
     asyncLoading_(false),
-    threadedUpdate_(false)
+    threadedUpdate_(false),
+    snapshotReplication_(false),
+    networkInterpolation_(false),
+    networkUpdateSuppressed_(false)
 {
     // Assign an ID to self so that nodes can refer to this node as a parent
     SetID(GetFreeNodeID(REPLICATED));
@@ -87,9 +95,9 @@ Scene::~Scene()
     RemoveAllChildren();
 
     // Remove scene reference and owner from all nodes that still exist
-    for (HashMap<unsigned, Node*>::Iterator i = replicatedNodes_.Begin(); i != replicatedNodes_.End(); ++i)
+    for (FlatHashMap<unsigned, Node*>::Iterator i = replicatedNodes_.Begin(); i != replicatedNodes_.End(); ++i)
         i->second_->ResetScene();
-    for (HashMap<unsigned, Node*>::Iterator i = localNodes_.Begin(); i != localNodes_.End(); ++i)
+    for (FlatHashMap<unsigned, Node*>::Iterator i = localNodes_.Begin(); i != localNodes_.End(); ++i)
         i->second_->ResetScene();
 }
 
@@ -102,6 +110,11 @@ void Scene::RegisterObject(Context* context)
     URHO3D_ACCESSOR_ATTRIBUTE("Smoothing Constant", GetSmoothingConstant, SetSmoothingConstant, float, DEFAULT_SMOOTHING_CONSTANT,
         AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("Snap Threshold", GetSnapThreshold, SetSnapThreshold, float, DEFAULT_SNAP_THRESHOLD, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Network Interpolation", GetNetworkInterpolation, SetNetworkInterpolation, bool, false, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Interpolation Delay", GetInterpolationDelay, SetInterpolationDelay, float, DEFAULT_INTERPOLATION_DELAY,
+        AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Max Extrapolation", GetMaxExtrapolation, SetMaxExtrapolation, float, DEFAULT_MAX_EXTRAPOLATION,
+        AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("Elapsed Time", GetElapsedTime, SetElapsedTime, float, 0.0f, AM_FILE);
     URHO3D_ATTRIBUTE("Next Replicated Node ID", unsigned, replicatedNodeID_, FIRST_REPLICATED_ID, AM_FILE | AM_NOEDIT);
     URHO3D_ATTRIBUTE("Next Replicated Component ID", unsigned, replicatedComponentID_, FIRST_REPLICATED_ID, AM_FILE | AM_NOEDIT);
@@ -210,7 +223,7 @@ void Scene::AddReplicationState(NodeReplicationState* state)
     Node::AddReplicationState(state);
 
     // This is the first update for a new connection. Mark all replicated nodes dirty
-    for (HashMap<unsigned, Node*>::ConstIterator i = replicatedNodes_.Begin(); i != replicatedNodes_.End(); ++i)
+    for (FlatHashMap<unsigned, Node*>::ConstIterator i = replicatedNodes_.Begin(); i != replicatedNodes_.End(); ++i)
         state->sceneState_->dirtyNodes_.Insert(i->first_);
 }
 
@@ -664,6 +677,29 @@ void Scene::SetSnapThreshold(float threshold)
     Node::MarkNetworkUpdate();
 }
 
+void Scene::SetNetworkInterpolation(bool enable)
+{
+    networkInterpolation_ = enable;
+    Node::MarkNetworkUpdate();
+}
+
+void Scene::SetInterpolationDelay(float delay)
+{
+    interpolationDelay_ = Max(delay, 0.0f);
+    Node::MarkNetworkUpdate();
+}
+
+void Scene::SetMaxExtrapolation(float time)
+{
+    maxExtrapolation_ = Max(time, 0.0f);
+    Node::MarkNetworkUpdate();
+}
+
+void Scene::SetSnapshotReplication(bool enable)
+{
+    snapshotReplication_ = enable;
+}
+
 void Scene::SetAsyncLoadingMs(int ms)
 {
     asyncLoadingMs_ = Max(ms, 1);
@@ -707,12 +743,12 @@ Node* Scene::GetNode(unsigned id) const
 {
     if (id < FIRST_LOCAL_ID)
     {
-        HashMap<unsigned, Node*>::ConstIterator i = replicatedNodes_.Find(id);
+        FlatHashMap<unsigned, Node*>::ConstIterator i = replicatedNodes_.Find(id);
         return i != replicatedNodes_.End() ? i->second_ : 0;
     }
     else
     {
-        HashMap<unsigned, Node*>::ConstIterator i = localNodes_.Find(id);
+        FlatHashMap<unsigned, Node*>::ConstIterator i = localNodes_.Find(id);
         return i != localNodes_.End() ? i->second_ : 0;
     }
 }
@@ -734,12 +770,12 @@ Component* Scene::GetComponent(unsigned id) const
 {
     if (id < FIRST_LOCAL_ID)
     {
-        HashMap<unsigned, Component*>::ConstIterator i = replicatedComponents_.Find(id);
+        FlatHashMap<unsigned, Component*>::ConstIterator i = replicatedComponents_.Find(id);
         return i != replicatedComponents_.End() ? i->second_ : 0;
     }
     else
     {
-        HashMap<unsigned, Component*>::ConstIterator i = localComponents_.Find(id);
+        FlatHashMap<unsigned, Component*>::ConstIterator i = localComponents_.Find(id);
         return i != localComponents_.End() ? i->second_ : 0;
     }
 }
@@ -797,6 +833,7 @@ void Scene::Update(float timeStep)
 
         smoothingData_[P_CONSTANT] = constant;
         smoothingData_[P_SQUAREDSNAPTHRESHOLD] = squaredSnapThreshold;
+        smoothingData_[UpdateSmoothing::P_TIMESTEP] = timeStep;
         SendEvent(E_UPDATESMOOTHING, smoothingData_);
     }
 
@@ -926,7 +963,7 @@ void Scene::NodeAdded(Node* node)
     // If node with same ID exists, remove the scene reference from it and overwrite with the new node
     if (id < FIRST_LOCAL_ID)
     {
-        HashMap<unsigned, Node*>::Iterator i = replicatedNodes_.Find(id);
+        FlatHashMap<unsigned, Node*>::Iterator i = replicatedNodes_.Find(id);
         if (i != replicatedNodes_.End() && i->second_ != node)
         {
             URHO3D_LOGWARNING("Overwriting node with ID " + String(id));
@@ -940,7 +977,7 @@ void Scene::NodeAdded(Node* node)
     }
     else
     {
-        HashMap<unsigned, Node*>::Iterator i = localNodes_.Find(id);
+        FlatHashMap<unsigned, Node*>::Iterator i = localNodes_.Find(id);
         if (i != localNodes_.End() && i->second_ != node)
         {
             URHO3D_LOGWARNING("Overwriting node with ID " + String(id));
@@ -1025,7 +1062,7 @@ void Scene::ComponentAdded(Component* component)
 
     if (id < FIRST_LOCAL_ID)
     {
-        HashMap<unsigned, Component*>::Iterator i = replicatedComponents_.Find(id);
+        FlatHashMap<unsigned, Component*>::Iterator i = replicatedComponents_.Find(id);
         if (i != replicatedComponents_.End() && i->second_ != component)
         {
             URHO3D_LOGWARNING("Overwriting component with ID " + String(id));
@@ -1036,7 +1073,7 @@ void Scene::ComponentAdded(Component* component)
     }
     else
     {
-        HashMap<unsigned, Component*>::Iterator i = localComponents_.Find(id);
+        FlatHashMap<unsigned, Component*>::Iterator i = localComponents_.Find(id);
         if (i != localComponents_.End() && i->second_ != component)
         {
             URHO3D_LOGWARNING("Overwriting component with ID " + String(id));
@@ -1112,10 +1149,10 @@ void Scene::CleanupConnection(Connection* connection)
 {
     Node::CleanupConnection(connection);
 
-    for (HashMap<unsigned, Node*>::Iterator i = replicatedNodes_.Begin(); i != replicatedNodes_.End(); ++i)
+    for (FlatHashMap<unsigned, Node*>::Iterator i = replicatedNodes_.Begin(); i != replicatedNodes_.End(); ++i)
         i->second_->CleanupConnection(connection);
 
-    for (HashMap<unsigned, Component*>::Iterator i = replicatedComponents_.Begin(); i != replicatedComponents_.End(); ++i)
+    for (FlatHashMap<unsigned, Component*>::Iterator i = replicatedComponents_.Begin(); i != replicatedComponents_.End(); ++i)
         i->second_->CleanupConnection(connection);
 }
 
@@ -1535,6 +1572,7 @@ void RegisterSceneLibrary(Context* context)
     Node::RegisterObject(context);
     Scene::RegisterObject(context);
     SmoothedTransform::RegisterObject(context);
+    InterpolatedTransform::RegisterObject(context);
     UnknownComponent::RegisterObject(context);
     SplinePath::RegisterObject(context);
 }
@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include "../Container/FlatHashMap.h"
 #include "../Container/HashSet.h"
 #include "../Core/Mutex.h"
 #include "../Resource/XMLElement.h"
@@ -152,6 +153,14 @@ public:
     void SetSmoothingConstant(float constant);
     /// Set network client motion smoothing snap threshold.
     void SetSnapThreshold(float threshold);
+    /// Set whether network clients should use time-stamped interpolation (InterpolatedTransform) instead of exponential motion smoothing (SmoothedTransform) for replicated nodes. Should be set before clients connect.
+    void SetNetworkInterpolation(bool enable);
+    /// Set network client interpolation delay in seconds. Replicated nodes are rendered this far behind the latest received state.
+    void SetInterpolationDelay(float delay);
+    /// Set maximum time in seconds to extrapolate replicated node motion when the network client interpolation buffer runs out.
+    void SetMaxExtrapolation(float time);
+    /// Set whether to replicate attributes to clients as unreliable snapshots delta compressed against the last snapshot each client has acknowledged, instead of reliable delta updates. Node and component creation and removal are still sent reliably. To be called on the server.
+    void SetSnapshotReplication(bool enable);
     /// Set maximum milliseconds per frame to spend on async scene loading.
     void SetAsyncLoadingMs(int ms);
     /// Add a required package file for networking. To be called on the server.
@@ -172,6 +181,9 @@ public:
     /// Get nodes with specific tag from the whole scene, return false if empty.
     bool GetNodesWithTag(PODVector<Node*>& dest, const String& tag)  const;
 
+    /// Return replicated nodes by ID.
+    const FlatHashMap<unsigned, Node*>& GetReplicatedNodes() const { return replicatedNodes_; }
+
     /// Return whether updates are enabled.
     bool IsUpdateEnabled() const { return updateEnabled_; }
 
@@ -202,6 +214,18 @@ public:
     /// Return motion smoothing snap threshold.
     float GetSnapThreshold() const { return snapThreshold_; }
 
+    /// Return whether network clients use time-stamped interpolation.
+    bool GetNetworkInterpolation() const { return networkInterpolation_; }
+
+    /// Return network client interpolation delay in seconds.
+    float GetInterpolationDelay() const { return interpolationDelay_; }
+
+    /// Return maximum network client extrapolation time in seconds.
+    float GetMaxExtrapolation() const { return maxExtrapolation_; }
+
+    /// Return whether uses snapshot replication.
+    bool GetSnapshotReplication() const { return snapshotReplication_; }
+
     /// Return maximum milliseconds per frame to spend on async loading.
     int GetAsyncLoadingMs() const { return asyncLoadingMs_; }
 
@@ -222,6 +246,10 @@ public:
 
     /// Return threaded update flag.
     bool IsThreadedUpdate() const { return threadedUpdate_; }
+    /// Set whether node and component changes are marked for network update. Used to move nodes temporarily without replicating the change.
+    void SetNetworkUpdateSuppressed(bool enable) { networkUpdateSuppressed_ = enable; }
+    /// Return whether marking for network update is suppressed.
+    bool IsNetworkUpdateSuppressed() const { return networkUpdateSuppressed_; }
 
     /// Get free node ID, either non-local or local.
     unsigned GetFreeNodeID(CreateMode mode);
@@ -277,13 +305,13 @@ private:
     void PreloadResourcesJSON(const JSONValue& value);
 
     /// Replicated scene nodes by ID.
-    HashMap<unsigned, Node*> replicatedNodes_;
+    FlatHashMap<unsigned, Node*> replicatedNodes_;
     /// Local scene nodes by ID.
-    HashMap<unsigned, Node*> localNodes_;
+    FlatHashMap<unsigned, Node*> localNodes_;
     /// Replicated components by ID.
-    HashMap<unsigned, Component*> replicatedComponents_;
+    FlatHashMap<unsigned, Component*> replicatedComponents_;
     /// Local components by ID.
-    HashMap<unsigned, Component*> localComponents_;
+    FlatHashMap<unsigned, Component*> localComponents_;
     /// Cached tagged nodes by tag.
     HashMap<StringHash, PODVector<Node*> > taggedNodes_;
     /// Asynchronous loading progress.
@@ -326,12 +354,22 @@ private:
     float smoothingConstant_;
     /// Motion smoothing snap threshold.
     float snapThreshold_;
+    /// Network client interpolation delay.
+    float interpolationDelay_;
+    /// Network client maximum extrapolation time.
+    float maxExtrapolation_;
     /// Update enabled flag.
     bool updateEnabled_;
     /// Asynchronous loading flag.
     bool asyncLoading_;
     /// Threaded update flag.
     bool threadedUpdate_;
+    /// Snapshot replication flag.
+    bool snapshotReplication_;
+    /// Network client interpolation flag.
+    bool networkInterpolation_;
+    /// Network update marking suppressed flag.
+    bool networkUpdateSuppressed_;
 };
 
 /// Register Scene library objects.
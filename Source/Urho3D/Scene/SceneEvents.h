@@ -46,6 +46,7 @@ URHO3D_EVENT(E_UPDATESMOOTHING, UpdateSmoothing)
 {
     URHO3D_PARAM(P_CONSTANT, Constant);            // float
     URHO3D_PARAM(P_SQUAREDSNAPTHRESHOLD, SquaredSnapThreshold);  // float
+    URHO3D_PARAM(P_TIMESTEP, TimeStep);            // float
 }
 
 /// Scene drawable update finished. Custom animation (eg. IK) can be done at this point.
@@ -65,6 +66,12 @@ URHO3D_EVENT(E_TARGETROTATION, TargetRotationChanged)
 {
 }
 
+/// InterpolatedTransform ran out of buffered network states and started extrapolating.
+URHO3D_EVENT(E_INTERPOLATIONUNDERRUN, InterpolationUnderrun)
+{
+    URHO3D_PARAM(P_NODE, Node);                    // Node pointer
+}
+
 /// Scene attribute animation update.
 URHO3D_EVENT(E_ATTRIBUTEANIMATIONUPDATE, AttributeAnimationUpdate)
 {
@@ -23,9 +23,15 @@
 #include "../Precompiled.h"
 
 #include "../Core/Context.h"
+#include "../Core/Mutex.h"
+#include "../Core/Timer.h"
+#include "../IO/BitReader.h"
+#include "../IO/BitWriter.h"
 #include "../IO/Deserializer.h"
 #include "../IO/Log.h"
+#include "../IO/MemoryBuffer.h"
 #include "../IO/Serializer.h"
+#include "../IO/VectorBuffer.h"
 #include "../Resource/XMLElement.h"
 #include "../Resource/JSONValue.h"
 #include "../Scene/ReplicationState.h"
@@ -37,6 +43,118 @@
 namespace Urho3D
 {
 
+/// Write an attribute value for network replication using the attribute's network encoding.
+static void WriteNetworkValue(BitWriter& dest, const AttributeInfo& attr, const Variant& value)
+{
+    const NetworkEncoding& encoding = attr.netEncoding_;
+
+    switch (encoding.type_)
+    {
+    case NE_QUANTIZED:
+        {
+            float data[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            unsigned numComponents = 4;
+
+            switch (attr.type_)
+            {
+            case VAR_FLOAT:
+                data[0] = value.GetFloat();
+                numComponents = 1;
+                break;
+            case VAR_VECTOR2:
+                memcpy(data, value.GetVector2().Data(), 2 * sizeof(float));
+                numComponents = 2;
+                break;
+            case VAR_VECTOR3:
+                memcpy(data, value.GetVector3().Data(), 3 * sizeof(float));
+                numComponents = 3;
+                break;
+            default:
+                memcpy(data, value.GetVector4().Data(), 4 * sizeof(float));
+                break;
+            }
+
+            for (unsigned i = 0; i < numComponents; ++i)
+                dest.WriteQuantizedFloat(data[i], encoding.min_, encoding.max_, encoding.numBits_);
+        }
+        break;
+
+    case NE_SMALLESTTHREE:
+        dest.WriteSmallestThreeQuaternion(value.GetQuaternion(), encoding.numBits_);
+        break;
+
+    case NE_BITS:
+        dest.WriteBits(attr.type_ == VAR_BOOL ? (unsigned)value.GetBool() : (unsigned)value.GetInt(), encoding.numBits_);
+        break;
+
+    case NE_VARINT:
+        dest.WriteVarInt(value.GetInt());
+        break;
+
+    default:
+        dest.WriteVariantData(value);
+        break;
+    }
+}
+
+/// Read an attribute value written with WriteNetworkValue().
+static Variant ReadNetworkValue(BitReader& source, const AttributeInfo& attr)
+{
+    const NetworkEncoding& encoding = attr.netEncoding_;
+
+    switch (encoding.type_)
+    {
+    case NE_QUANTIZED:
+        {
+            float data[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            unsigned numComponents = attr.type_ == VAR_FLOAT ? 1 : (attr.type_ == VAR_VECTOR2 ? 2 : (attr.type_ == VAR_VECTOR3 ? 3 : 4));
+            for (unsigned i = 0; i < numComponents; ++i)
+                data[i] = source.ReadQuantizedFloat(encoding.min_, encoding.max_, encoding.numBits_);
+
+            switch (attr.type_)
+            {
+            case VAR_FLOAT:
+                return Variant(data[0]);
+            case VAR_VECTOR2:
+                return Variant(Vector2(data));
+            case VAR_VECTOR3:
+                return Variant(Vector3(data));
+            default:
+                return Variant(Vector4(data));
+            }
+        }
+
+    case NE_SMALLESTTHREE:
+        return Variant(source.ReadSmallestThreeQuaternion(encoding.numBits_));
+
+    case NE_BITS:
+        if (attr.type_ == VAR_BOOL)
+            return Variant(source.ReadBit());
+        else
+            return Variant((int)source.ReadBits(encoding.numBits_));
+
+    case NE_VARINT:
+        return Variant(source.ReadVarInt());
+
+    default:
+        return source.ReadVariant(attr.type_);
+    }
+}
+
+/// Find a cached network update by attribute bits.
+static const CachedNetworkUpdate* FindCachedUpdate(const Vector<CachedNetworkUpdate>& cachedUpdates, const DirtyBits& attributeBits,
+    bool latestData)
+{
+    for (Vector<CachedNetworkUpdate>::ConstIterator i = cachedUpdates.Begin(); i != cachedUpdates.End(); ++i)
+    {
+        if (i->latestData_ == latestData &&
+            (latestData || !memcmp(i->attributeBits_.data_, attributeBits.data_, MAX_NETWORK_ATTRIBUTES / 8)))
+            return &(*i);
+    }
+
+    return 0;
+}
+
 static unsigned RemapAttributeIndex(const Vector<AttributeInfo>* attributes, const AttributeInfo& netAttr, unsigned netAttrIndex)
 {
     if (!attributes)
@@ -59,7 +177,8 @@ Serializable::Serializable(Context* context) :
     Object(context),
     networkState_(0),
     instanceDefaultValues_(0),
-    temporary_(false)
+    temporary_(false),
+    networkTimeStamp_(0)
 {
 }
 
@@ -623,34 +742,12 @@ bool Serializable::SetAttribute(unsigned index, const Variant& value)
 
 bool Serializable::SetAttribute(const String& name, const Variant& value)
 {
-    const Vector<AttributeInfo>* attributes = GetAttributes();
-    if (!attributes)
-    {
-        URHO3D_LOGERROR(GetTypeName() + " has no attributes");
-        return false;
-    }
-
-    for (Vector<AttributeInfo>::ConstIterator i = attributes->Begin(); i != attributes->End(); ++i)
-    {
-        if (!i->name_.Compare(name, true))
-        {
-            // Check that the new value's type matches the attribute type
-            if (value.GetType() == i->type_)
-            {
-                OnSetAttribute(*i, value);
-                return true;
-            }
-            else
-            {
-                URHO3D_LOGERROR("Could not set attribute " + i->name_ + ": expected type " + Variant::GetTypeName(i->type_)
-                         + " but got " + value.GetTypeName());
-                return false;
-            }
-        }
-    }
+    return SetAttribute(StringHash(name), name, value);
+}
 
-    URHO3D_LOGERROR("Could not find attribute " + name + " in " + GetTypeName());
-    return false;
+bool Serializable::SetAttribute(const InternedString& name, const Variant& value)
+{
+    return SetAttribute(name.GetHash(), name.GetString(), value);
 }
 
 void Serializable::ResetToDefault()
@@ -726,7 +823,33 @@ void Serializable::AllocateNetworkState()
     }
 }
 
-void Serializable::WriteInitialDeltaUpdate(Serializer& dest, unsigned char timeStamp)
+bool Serializable::IsNetworkAttributeChanged(unsigned index) const
+{
+    const AttributeInfo& attr = networkState_->attributes_->At(index);
+    const Variant& current = networkState_->currentValues_[index];
+    const Variant& previous = networkState_->previousValues_[index];
+
+    if (current == previous)
+        return false;
+    if (attr.netEncoding_.type_ != NE_QUANTIZED && attr.netEncoding_.type_ != NE_SMALLESTTHREE)
+        return true;
+
+    // At most four 24-bit components or a smallest three quaternion
+    unsigned char currentData[16];
+    unsigned char previousData[16];
+    MemoryBuffer currentBuffer(currentData, sizeof currentData);
+    MemoryBuffer previousBuffer(previousData, sizeof previousData);
+    {
+        BitWriter currentWriter(currentBuffer);
+        BitWriter previousWriter(previousBuffer);
+        WriteNetworkValue(currentWriter, attr, current);
+        WriteNetworkValue(previousWriter, attr, previous);
+    }
+
+    return memcmp(currentData, previousData, currentBuffer.GetPosition()) != 0;
+}
+
+void Serializable::WriteInitialDeltaUpdate(Serializer& dest, unsigned char timeStamp, NetworkEncodeStats* stats)
 {
     if (!networkState_)
     {
@@ -749,18 +872,14 @@ void Serializable::WriteInitialDeltaUpdate(Serializer& dest, unsigned char timeS
             attributeBits.Set(i);
     }
 
-    // First write the change bitfield, then attribute data for non-default attributes
+    // First write the timestamp, then the change bitfield and attribute data for non-default attributes, which is the
+    // same as a delta update of those attributes
     dest.WriteUByte(timeStamp);
-    dest.Write(attributeBits.data_, (numAttributes + 7) >> 3);
-
-    for (unsigned i = 0; i < numAttributes; ++i)
-    {
-        if (attributeBits.IsSet(i))
-            dest.WriteVariantData(networkState_->currentValues_[i]);
-    }
+    WriteCachedUpdate(dest, attributeBits, false, stats);
 }
 
-void Serializable::WriteDeltaUpdate(Serializer& dest, const DirtyBits& attributeBits, unsigned char timeStamp)
+void Serializable::WriteDeltaUpdate(Serializer& dest, const DirtyBits& attributeBits, unsigned char timeStamp,
+    NetworkEncodeStats* stats)
 {
     if (!networkState_)
     {
@@ -768,25 +887,16 @@ void Serializable::WriteDeltaUpdate(Serializer& dest, const DirtyBits& attribute
         return;
     }
 
-    const Vector<AttributeInfo>* attributes = networkState_->attributes_;
-    if (!attributes)
+    if (!networkState_->attributes_)
         return;
 
-    unsigned numAttributes = attributes->Size();
-
-    // First write the change bitfield, then attribute data for changed attributes
+    // First write the timestamp, then the change bitfield and attribute data for changed attributes
     // Note: the attribute bits should not contain LATESTDATA attributes
     dest.WriteUByte(timeStamp);
-    dest.Write(attributeBits.data_, (numAttributes + 7) >> 3);
-
-    for (unsigned i = 0; i < numAttributes; ++i)
-    {
-        if (attributeBits.IsSet(i))
-            dest.WriteVariantData(networkState_->currentValues_[i]);
-    }
+    WriteCachedUpdate(dest, attributeBits, false, stats);
 }
 
-void Serializable::WriteLatestDataUpdate(Serializer& dest, unsigned char timeStamp)
+void Serializable::WriteLatestDataUpdate(Serializer& dest, unsigned char timeStamp, NetworkEncodeStats* stats)
 {
     if (!networkState_)
     {
@@ -794,19 +904,11 @@ void Serializable::WriteLatestDataUpdate(Serializer& dest, unsigned char timeSta
         return;
     }
 
-    const Vector<AttributeInfo>* attributes = networkState_->attributes_;
-    if (!attributes)
+    if (!networkState_->attributes_)
         return;
 
-    unsigned numAttributes = attributes->Size();
-
     dest.WriteUByte(timeStamp);
-
-    for (unsigned i = 0; i < numAttributes; ++i)
-    {
-        if (attributes->At(i).mode_ & AM_LATESTDATA)
-            dest.WriteVariantData(networkState_->currentValues_[i]);
-    }
+    WriteCachedUpdate(dest, DirtyBits(), true, stats);
 }
 
 bool Serializable::ReadDeltaUpdate(Deserializer& source)
@@ -821,16 +923,18 @@ bool Serializable::ReadDeltaUpdate(Deserializer& source)
 
     unsigned long long interceptMask = networkState_ ? networkState_->interceptMask_ : 0;
     unsigned char timeStamp = source.ReadUByte();
-    source.Read(attributeBits.data_, (numAttributes + 7) >> 3);
+    networkTimeStamp_ = timeStamp;
+    BitReader reader(source);
+    reader.Read(attributeBits.data_, (numAttributes + 7) >> 3);
 
-    for (unsigned i = 0; i < numAttributes && !source.IsEof(); ++i)
+    for (unsigned i = 0; i < numAttributes && reader.GetNumBitsLeft(); ++i)
     {
         if (attributeBits.IsSet(i))
         {
             const AttributeInfo& attr = attributes->At(i);
             if (!(interceptMask & (1ULL << i)))
             {
-                OnSetAttribute(attr, source.ReadVariant(attr.type_));
+                OnSetAttribute(attr, ReadNetworkValue(reader, attr));
                 changed = true;
             }
             else
@@ -842,7 +946,7 @@ bool Serializable::ReadDeltaUpdate(Deserializer& source)
                 eventData[P_TIMESTAMP] = (unsigned)timeStamp;
                 eventData[P_INDEX] = RemapAttributeIndex(GetAttributes(), attr, i);
                 eventData[P_NAME] = attr.name_;
-                eventData[P_VALUE] = source.ReadVariant(attr.type_);
+                eventData[P_VALUE] = ReadNetworkValue(reader, attr);
                 SendEvent(E_INTERCEPTNETWORKUPDATE, eventData);
             }
         }
@@ -862,15 +966,17 @@ bool Serializable::ReadLatestDataUpdate(Deserializer& source)
 
     unsigned long long interceptMask = networkState_ ? networkState_->interceptMask_ : 0;
     unsigned char timeStamp = source.ReadUByte();
+    networkTimeStamp_ = timeStamp;
+    BitReader reader(source);
 
-    for (unsigned i = 0; i < numAttributes && !source.IsEof(); ++i)
+    for (unsigned i = 0; i < numAttributes && reader.GetNumBitsLeft(); ++i)
     {
         const AttributeInfo& attr = attributes->At(i);
         if (attr.mode_ & AM_LATESTDATA)
         {
             if (!(interceptMask & (1ULL << i)))
             {
-                OnSetAttribute(attr, source.ReadVariant(attr.type_));
+                OnSetAttribute(attr, ReadNetworkValue(reader, attr));
                 changed = true;
             }
             else
@@ -882,7 +988,7 @@ bool Serializable::ReadLatestDataUpdate(Deserializer& source)
                 eventData[P_TIMESTAMP] = (unsigned)timeStamp;
                 eventData[P_INDEX] = RemapAttributeIndex(GetAttributes(), attr, i);
                 eventData[P_NAME] = attr.name_;
-                eventData[P_VALUE] = source.ReadVariant(attr.type_);
+                eventData[P_VALUE] = ReadNetworkValue(reader, attr);
                 SendEvent(E_INTERCEPTNETWORKUPDATE, eventData);
             }
         }
@@ -913,26 +1019,12 @@ Variant Serializable::GetAttribute(unsigned index) const
 
 Variant Serializable::GetAttribute(const String& name) const
 {
-    Variant ret;
-
-    const Vector<AttributeInfo>* attributes = GetAttributes();
-    if (!attributes)
-    {
-        URHO3D_LOGERROR(GetTypeName() + " has no attributes");
-        return ret;
-    }
-
-    for (Vector<AttributeInfo>::ConstIterator i = attributes->Begin(); i != attributes->End(); ++i)
-    {
-        if (!i->name_.Compare(name, true))
-        {
-            OnGetAttribute(*i, ret);
-            return ret;
-        }
-    }
+    return GetAttribute(StringHash(name), name);
+}
 
-    URHO3D_LOGERROR("Could not find attribute " + name + " in " + GetTypeName());
-    return ret;
+Variant Serializable::GetAttribute(const InternedString& name) const
+{
+    return GetAttribute(name.GetHash(), name.GetString());
 }
 
 Variant Serializable::GetAttributeDefault(unsigned index) const
@@ -1008,6 +1100,138 @@ bool Serializable::GetInterceptNetworkUpdate(const String& attributeName) const
     return false;
 }
 
+bool Serializable::SetAttribute(StringHash nameHash, const String& name, const Variant& value)
+{
+    const Vector<AttributeInfo>* attributes = GetAttributes();
+    if (!attributes)
+    {
+        URHO3D_LOGERROR(GetTypeName() + " has no attributes");
+        return false;
+    }
+
+    for (Vector<AttributeInfo>::ConstIterator i = attributes->Begin(); i != attributes->End(); ++i)
+    {
+        // The name hashes are compared first to skip most attributes cheaply. The hash is case-insensitive and different
+        // names may have the same hash, so confirm with the exact name
+        if (i->nameHash_ == nameHash && i->name_ == name)
+        {
+            // Check that the new value's type matches the attribute type
+            if (value.GetType() == i->type_)
+            {
+                OnSetAttribute(*i, value);
+                return true;
+            }
+            else
+            {
+                URHO3D_LOGERROR("Could not set attribute " + i->name_ + ": expected type " + Variant::GetTypeName(i->type_)
+                         + " but got " + value.GetTypeName());
+                return false;
+            }
+        }
+    }
+
+    URHO3D_LOGERROR("Could not find attribute " + name + " in " + GetTypeName());
+    return false;
+}
+
+Variant Serializable::GetAttribute(StringHash nameHash, const String& name) const
+{
+    Variant ret;
+
+    const Vector<AttributeInfo>* attributes = GetAttributes();
+    if (!attributes)
+    {
+        URHO3D_LOGERROR(GetTypeName() + " has no attributes");
+        return ret;
+    }
+
+    for (Vector<AttributeInfo>::ConstIterator i = attributes->Begin(); i != attributes->End(); ++i)
+    {
+        if (i->nameHash_ == nameHash && i->name_ == name)
+        {
+            OnGetAttribute(*i, ret);
+            return ret;
+        }
+    }
+
+    URHO3D_LOGERROR("Could not find attribute " + name + " in " + GetTypeName());
+    return ret;
+}
+
+void Serializable::WriteCachedUpdate(Serializer& dest, const DirtyBits& attributeBits, bool latestData,
+    NetworkEncodeStats* stats)
+{
+    Vector<CachedNetworkUpdate>& cachedUpdates = networkState_->cachedUpdates_;
+
+    // Server updates may be written for several connections in parallel, so the cache is accessed under the object's lock
+    {
+        MutexLock lock(networkState_->cachedUpdatesMutex_);
+        const CachedNetworkUpdate* cached = FindCachedUpdate(cachedUpdates, attributeBits, latestData);
+        if (cached)
+        {
+            if (cached->data_.Size())
+                dest.Write(&cached->data_.Front(), cached->data_.Size());
+            if (stats)
+            {
+                ++stats->reusedUpdates_;
+                stats->reusedBytes_ += cached->data_.Size();
+                stats->reusedTime_ += cached->encodeTime_;
+            }
+            return;
+        }
+    }
+
+    // Not cached yet: encode outside the lock
+    HiresTimer encodeTimer;
+    const Vector<AttributeInfo>* attributes = networkState_->attributes_;
+    unsigned numAttributes = attributes->Size();
+    VectorBuffer encoded;
+
+    // Values using the default encoding stay byte-aligned; the last partial byte of packed values is padded with zeros
+    {
+        BitWriter writer(encoded);
+        if (latestData)
+        {
+            for (unsigned i = 0; i < numAttributes; ++i)
+            {
+                const AttributeInfo& attr = attributes->At(i);
+                if (attr.mode_ & AM_LATESTDATA)
+                    WriteNetworkValue(writer, attr, networkState_->currentValues_[i]);
+            }
+        }
+        else
+        {
+            writer.Write(attributeBits.data_, (numAttributes + 7) >> 3);
+            for (unsigned i = 0; i < numAttributes; ++i)
+            {
+                if (attributeBits.IsSet(i))
+                    WriteNetworkValue(writer, attributes->At(i), networkState_->currentValues_[i]);
+            }
+        }
+    }
+
+    long long encodeTime = encodeTimer.GetUSec(false);
+    dest.Write(encoded.GetData(), encoded.GetSize());
+    if (stats)
+    {
+        ++stats->encodedUpdates_;
+        stats->encodedBytes_ += encoded.GetSize();
+        stats->encodeTime_ += encodeTime;
+    }
+
+    // Another connection may have encoded the same update meanwhile
+    MutexLock lock(networkState_->cachedUpdatesMutex_);
+    if (FindCachedUpdate(cachedUpdates, attributeBits, latestData))
+        return;
+
+    cachedUpdates.Push(CachedNetworkUpdate());
+    CachedNetworkUpdate& cached = cachedUpdates.Back();
+    cached.attributeBits_ = attributeBits;
+    cached.data_ = encoded.GetBuffer();
+    cached.latestData_ = latestData;
+    cached.encodeTime_ = encodeTime;
+}
+
 void Serializable::SetInstanceDefault(const String& name, const Variant& defaultValue)
 {
     // Allocate the instance level default value
@@ -23,6 +23,7 @@
 #pragma once
 
 #include "../Core/Attribute.h"
+#include "../Core/InternedString.h"
 #include "../Core/Object.h"
 
 #include <cstddef>
@@ -37,6 +38,7 @@ class XMLElement;
 class JSONValue;
 
 struct DirtyBits;
+struct NetworkEncodeStats;
 struct NetworkState;
 struct ReplicationState;
 
@@ -85,6 +87,8 @@ public:
     bool SetAttribute(unsigned index, const Variant& value);
     /// Set attribute by name. Return true if successfully set.
     bool SetAttribute(const String& name, const Variant& value);
+    /// Set attribute by interned name, using the precomputed name hash. Return true if successfully set.
+    bool SetAttribute(const InternedString& name, const Variant& value);
     /// Reset all editable attributes to their default values.
     void ResetToDefault();
     /// Remove instance's default values if they are set previously.
@@ -95,12 +99,12 @@ public:
     void SetInterceptNetworkUpdate(const String& attributeName, bool enable);
     /// Allocate network attribute state.
     void AllocateNetworkState();
-    /// Write initial delta network update.
-    void WriteInitialDeltaUpdate(Serializer& dest, unsigned char timeStamp);
-    /// Write a delta network update according to dirty attribute bits.
-    void WriteDeltaUpdate(Serializer& dest, const DirtyBits& attributeBits, unsigned char timeStamp);
-    /// Write a latest data network update.
-    void WriteLatestDataUpdate(Serializer& dest, unsigned char timeStamp);
+    /// Write initial delta network update. The encoded data is cached and reused for other connections until the attribute values change. Optionally accumulate encoding statistics.
+    void WriteInitialDeltaUpdate(Serializer& dest, unsigned char timeStamp, NetworkEncodeStats* stats = 0);
+    /// Write a delta network update according to dirty attribute bits. The encoded data is cached and reused for other connections until the attribute values change. Optionally accumulate encoding statistics.
+    void WriteDeltaUpdate(Serializer& dest, const DirtyBits& attributeBits, unsigned char timeStamp, NetworkEncodeStats* stats = 0);
+    /// Write a latest data network update. The encoded data is cached and reused for other connections until the attribute values change. Optionally accumulate encoding statistics.
+    void WriteLatestDataUpdate(Serializer& dest, unsigned char timeStamp, NetworkEncodeStats* stats = 0);
     /// Read and apply a network delta update. Return true if attributes were changed.
     bool ReadDeltaUpdate(Deserializer& source);
     /// Read and apply a network latest data update. Return true if attributes were changed.
@@ -110,6 +114,8 @@ public:
     Variant GetAttribute(unsigned index) const;
     /// Return attribute value by name. Return empty if not found.
     Variant GetAttribute(const String& name) const;
+    /// Return attribute value by interned name, using the precomputed name hash. Return empty if not found.
+    Variant GetAttribute(const InternedString& name) const;
     /// Return attribute default value by index. Return empty if illegal index.
     Variant GetAttributeDefault(unsigned index) const;
     /// Return attribute default value by name. Return empty if not found.
@@ -128,20 +134,34 @@ public:
     /// Return the network attribute state, if allocated.
     NetworkState* GetNetworkState() const { return networkState_; }
 
+    /// Return the timestamp of the network update being read, or the last one read.
+    unsigned char GetNetworkTimeStamp() const { return networkTimeStamp_; }
+
 protected:
+    /// Return whether a network attribute's current value differs from the previous value. Attributes with a lossy network encoding are compared as encoded, so that changes below their precision are not sent.
+    bool IsNetworkAttributeChanged(unsigned index) const;
+
     /// Network attribute state.
     NetworkState* networkState_;
 
 private:
+    /// Set attribute by name and its precalculated hash. Return true if successfully set.
+    bool SetAttribute(StringHash nameHash, const String& name, const Variant& value);
+    /// Return attribute value by name and its precalculated hash. Return empty if not found.
+    Variant GetAttribute(StringHash nameHash, const String& name) const;
     /// Set instance-level default value. Allocate the internal data structure as necessary.
     void SetInstanceDefault(const String& name, const Variant& defaultValue);
     /// Get instance-level default value.
     Variant GetInstanceDefault(const String& name) const;
+    /// Write network attribute update data excluding the timestamp, reusing a cached encoding when available.
+    void WriteCachedUpdate(Serializer& dest, const DirtyBits& attributeBits, bool latestData, NetworkEncodeStats* stats);
 
     /// Attribute default value at each instance level.
     VariantMap* instanceDefaultValues_;
     /// Temporary flag.
     bool temporary_;
+    /// Timestamp of the last read network update.
+    unsigned char networkTimeStamp_;
 };
 
 /// Template implementation of the enum attribute accessor invoke helper class.
@@ -283,5 +303,7 @@ public:
 #define URHO3D_MIXED_ACCESSOR_ATTRIBUTE(name, getFunction, setFunction, typeName, defaultValue, mode) context->RegisterAttribute<ClassName>(Urho3D::AttributeInfo(GetVariantType<typeName >(), name, new Urho3D::AttributeAccessorImpl<ClassName, typeName, MixedAttributeTrait<typeName > >(&ClassName::getFunction, &ClassName::setFunction), defaultValue, mode))
 /// Update the default value of an already registered attribute.
 #define URHO3D_UPDATE_ATTRIBUTE_DEFAULT_VALUE(name, defaultValue) context->UpdateAttributeDefaultValue<ClassName>(name, defaultValue)
+/// Set the network replication encoding of an already registered attribute.
+#define URHO3D_NETWORK_ENCODING(name, encoding) context->SetAttributeNetworkEncoding<ClassName>(name, encoding)
 
 }
@@ -117,6 +117,7 @@ bool UnknownComponent::LoadXML(const XMLElement& source, bool setInstanceDefault
         AttributeInfo attr;
         attr.mode_ = AM_FILE;
         attr.name_ = attrElem.GetAttribute("name");
+        attr.nameHash_ = attr.name_;
         attr.type_ = VAR_STRING;
 
         if (!attr.name_.Empty())
@@ -153,6 +154,7 @@ bool UnknownComponent::LoadJSON(const JSONValue& source, bool setInstanceDefault
         AttributeInfo attr;
         attr.mode_ = AM_FILE;
         attr.name_ = attrVal.Get("name").GetString();
+        attr.nameHash_ = attr.name_;
         attr.type_ = VAR_STRING;
 
         if (!attr.name_.Empty())
@@ -116,6 +116,9 @@ void Text3D::UpdateBatches(const FrameInfo& frame)
         customWorldTransform_ = Matrix3x4(worldPosition, frame.camera_->GetFaceCameraRotation(
             worldPosition, node_->GetWorldRotation(), faceCameraMode_), node_->GetWorldScale());
         worldBoundingBoxDirty_ = true;
+        // The octant's packed copy of the bounding box is now out of date, and the text may no longer fit its octant.
+        // Culling tests the drawable individually until the next octree update has refreshed the copy
+        MarkForUpdate();
     }
 
     for (unsigned i = 0; i < batches_.Size(); ++i)